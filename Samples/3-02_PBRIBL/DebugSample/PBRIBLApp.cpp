@@ -6,9 +6,10 @@
 #include "../../../SharedLibrary/Utils/StrPathUtils.h"
 #include "../../../SharedLibrary/Utils/AppUtils.h"
 #include "../../../SharedLibrary/Utils/CmdBufUtils.h"
+#include "../../../SharedLibrary/Utils/UploadManager.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
+#include "../../../SharedLibrary/AssetsLoader/AssetsLoader.h"
+#include "../../../SharedLibrary/Scene/Level.h"
 
 // #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -177,8 +178,6 @@ void PBRIBLApp::GetCameraPos(
         */
 void PBRIBLApp::InitHdrRenderObjects()
 {
-    SharedLib::RAIICommandBuffer raiiCmdBuffer(m_gfxCmdPool, m_device);
-
     // Load the HDRI image into RAM
     std::string hdriFilePath = SOURCE_PATH;
     hdriFilePath += "/../data/";
@@ -243,18 +242,13 @@ void PBRIBLApp::InitHdrRenderObjects()
 
         const uint32_t backgroundCubemapBytes = width * height * 4 * sizeof(float);
 
-        SharedLib::SendImgDataToGpu(
-            raiiCmdBuffer.m_cmdBuffer,
-            m_device,
-            m_graphicsQueue,
-            pHdrImgCubemapData,
-            backgroundCubemapBytes,
-            m_hdrCubeMap.image,
-            GetImgSubrsrcRange(0, 1, 0, 6),
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            backgroundBufToImgCopy,
-            *m_pAllocator
-        );
+        GetUploadManager()->EnqueueImgUpload(pHdrImgCubemapData,
+                                             backgroundCubemapBytes,
+                                             m_hdrCubeMap.image,
+                                             GetImgSubrsrcRange(0, 1, 0, 6),
+                                             VK_IMAGE_LAYOUT_UNDEFINED,
+                                             &backgroundBufToImgCopy,
+                                             1);
 
         delete[] pHdrImgCubemapData;
     }
@@ -305,18 +299,13 @@ void PBRIBLApp::InitHdrRenderObjects()
 
         const uint32_t diffIrradianceCubemapBytes = width * height * 4 * sizeof(float);
 
-        SharedLib::SendImgDataToGpu(
-            raiiCmdBuffer.m_cmdBuffer,
-            m_device,
-            m_graphicsQueue,
-            pDiffuseIrradianceCubemapImgInfoData,
-            diffIrradianceCubemapBytes,
-            m_diffuseIrradianceCubemap.image,
-            GetImgSubrsrcRange(0, 1, 0, 6),
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            diffIrradianceBufToImgCopy,
-            *m_pAllocator
-        );
+        GetUploadManager()->EnqueueImgUpload(pDiffuseIrradianceCubemapImgInfoData,
+                                             diffIrradianceCubemapBytes,
+                                             m_diffuseIrradianceCubemap.image,
+                                             GetImgSubrsrcRange(0, 1, 0, 6),
+                                             VK_IMAGE_LAYOUT_UNDEFINED,
+                                             &diffIrradianceBufToImgCopy,
+                                             1);
 
         delete[] pDiffuseIrradianceCubemapImgInfoData;
     }
@@ -382,18 +371,13 @@ void PBRIBLApp::InitHdrRenderObjects()
 
             const uint32_t prefilterEnvCubemapBytes = width * height * 4 * sizeof(float);
 
-            SharedLib::SendImgDataToGpu(
-                raiiCmdBuffer.m_cmdBuffer,
-                m_device,
-                m_graphicsQueue,
-                pPrefilterEnvCubemapImgsMipIData,
-                prefilterEnvCubemapBytes,
-                m_prefilterEnvCubemap.image,
-                GetImgSubrsrcRange(i, 1, 0, 6),
-                VK_IMAGE_LAYOUT_UNDEFINED,
-                prefilterEnvBufToImgCopy,
-                *m_pAllocator
-            );
+            GetUploadManager()->EnqueueImgUpload(pPrefilterEnvCubemapImgsMipIData,
+                                                 prefilterEnvCubemapBytes,
+                                                 m_prefilterEnvCubemap.image,
+                                                 GetImgSubrsrcRange(i, 1, 0, 6),
+                                                 VK_IMAGE_LAYOUT_UNDEFINED,
+                                                 &prefilterEnvBufToImgCopy,
+                                                 1);
 
             delete[] pPrefilterEnvCubemapImgsMipIData;
         }        
@@ -450,21 +434,19 @@ void PBRIBLApp::InitHdrRenderObjects()
 
         const uint32_t envBrdfBytes = width * height * 4 * sizeof(float);
 
-        SharedLib::SendImgDataToGpu(
-            raiiCmdBuffer.m_cmdBuffer,
-            m_device,
-            m_graphicsQueue,
-            pEnvBrdfImgInfoData,
-            envBrdfBytes,
-            m_envBrdfImg.image,
-            GetImgSubrsrcRange(0, 1, 0, 1),
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            envBrdfBufToImgCopy,
-            *m_pAllocator
-        );
+        GetUploadManager()->EnqueueImgUpload(pEnvBrdfImgInfoData,
+                                             envBrdfBytes,
+                                             m_envBrdfImg.image,
+                                             GetImgSubrsrcRange(0, 1, 0, 1),
+                                             VK_IMAGE_LAYOUT_UNDEFINED,
+                                             &envBrdfBufToImgCopy,
+                                             1);
 
         delete[] pEnvBrdfImgInfoData;
     }
+
+    // All the IBL images go to the GPU in one submission, which the frames' submissions come after.
+    GetUploadManager()->Flush();
 }
 
 // ================================================================================================================
@@ -599,11 +581,13 @@ void PBRIBLApp::AppInit()
     InitPhysicalDevice();
     InitGfxQueueFamilyIdx();
     InitPresentQueueFamilyIdx();
+    InitTransferQueueFamilyIdx();
 
     // Queue family index should be unique in vk1.2:
     // https://vulkan.lunarg.com/doc/view/1.2.198.0/windows/1.2-extensions/vkspec.html#VUID-VkDeviceCreateInfo-queueFamilyIndex-02802
     std::vector<VkDeviceQueueCreateInfo> deviceQueueInfos = CreateDeviceQueueInfos({ m_graphicsQueueFamilyIdx,
-                                                                                     m_presentQueueFamilyIdx });
+                                                                                     m_presentQueueFamilyIdx,
+                                                                                     m_transferQueueFamilyIdx });
     // We need the swap chain device extension and the dynamic rendering extension.
     const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
@@ -611,11 +595,13 @@ void PBRIBLApp::AppInit()
     InitVmaAllocator();
     InitGraphicsQueue();
     InitPresentQueue();
+    InitTransferQueue();
     InitGfxCommandPool();
     InitKHRFuncPtrs();
     InitSwapchain();  
 
     InitGfxCommandBuffers(m_swapchainImgCnt);
+    InitUploadManager();
     
     InitSphereVertexIndexBuffers();
     InitVpMatBuffer();
@@ -642,57 +628,38 @@ void PBRIBLApp::InitSphereVertexIndexBuffers()
     std::string inputfile = SOURCE_PATH;
     inputfile += "/../data/uvNormalSphere.obj";
 
-    tinyobj::ObjReaderConfig readerConfig;
-    tinyobj::ObjReader sphereObjReader;
-
-    sphereObjReader.ParseFromFile(inputfile, readerConfig);
+    // The loader merges the corners that the obj faces share, so the sphere's vertices are shared by its triangles.
+    // The cooked sphere goes into the build folder instead of the data folder, so later runs skip the obj parsing.
+    SharedLib::AssetsLoaderOptions loaderOptions;
+    {
+        loaderOptions.cookedCacheDir = COOKED_CACHE_PATH;
+    }
 
-    auto& shapes = sphereObjReader.GetShapes();
-    auto& attrib = sphereObjReader.GetAttrib();
+    SharedLib::ObjLoaderManager objLoaderManager(loaderOptions);
+    SharedLib::Level sphereLevel;
+    if (objLoaderManager.Load(inputfile, sphereLevel) == false)
+    {
+        throw std::runtime_error("Failed to load the sphere obj!");
+    }
 
     // We assume that this test only has one shape
-    assert(shapes.size() == 1, "This application only accepts one shape!");
+    assert(sphereLevel.m_meshEntities.size() == 1, "This application only accepts one shape!");
 
-    for (uint32_t s = 0; s < shapes.size(); s++)
-    {
-        // Loop over faces(polygon)
-        uint32_t index_offset = 0;
-        uint32_t idxBufIdx = 0;
-        for (uint32_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
-        {
-            uint32_t fv = shapes[s].mesh.num_face_vertices[f];
+    SharedLib::MeshEntity* pSphereEntity = sphereLevel.m_meshEntities.begin()->second;
+    const SharedLib::MeshPrimitive& spherePrimitive = pSphereEntity->m_meshPrimitives[0];
 
-            // Loop over vertices in the face.
-            for (uint32_t v = 0; v < fv; v++)
-            {
-                // Access to vertex
-                tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-
-                float vx = attrib.vertices[3 * size_t(idx.vertex_index) + 0];
-                float vy = attrib.vertices[3 * size_t(idx.vertex_index) + 1];
-                float vz = attrib.vertices[3 * size_t(idx.vertex_index) + 2];
-
-                // Transfer the vertex buffer's vertex index to the element index -- 6 * vertex index + xxx;
-                m_vertBufferData.push_back(vx);
-                m_vertBufferData.push_back(vy);
-                m_vertBufferData.push_back(vz);
-
-                // Check if `normal_index` is zero or positive. negative = no normal data
-                assert(idx.normal_index >= 0, "The model doesn't have normal information but it is necessary.");
-                float nx = attrib.normals[3 * size_t(idx.normal_index) + 0];
-                float ny = attrib.normals[3 * size_t(idx.normal_index) + 1];
-                float nz = attrib.normals[3 * size_t(idx.normal_index) + 2];
-
-                m_vertBufferData.push_back(nx);
-                m_vertBufferData.push_back(ny);
-                m_vertBufferData.push_back(nz);
-
-                m_idxBufferData.push_back(idxBufIdx);
-                idxBufIdx++;
-            }
-            index_offset += fv;
-        }
+    // A vert = pos + normal. The normals are generated when the obj doesn't have them.
+    const uint32_t sphereVertCnt = spherePrimitive.m_posData.size() / 3;
+    for (uint32_t vertIdx = 0; vertIdx < sphereVertCnt; vertIdx++)
+    {
+        m_vertBufferData.insert(m_vertBufferData.end(),
+                                spherePrimitive.m_posData.begin() + 3 * vertIdx,
+                                spherePrimitive.m_posData.begin() + 3 * vertIdx + 3);
+        m_vertBufferData.insert(m_vertBufferData.end(),
+                                spherePrimitive.m_normalData.begin() + 3 * vertIdx,
+                                spherePrimitive.m_normalData.begin() + 3 * vertIdx + 3);
     }
+    spherePrimitive.GetIndicesUint32(m_idxBufferData);
 
     const uint32_t vertBufferByteCnt = m_vertBufferData.size() * sizeof(float);
     const uint32_t idxBufferByteCnt = m_idxBufferData.size() * sizeof(uint32_t);
@@ -6,6 +6,7 @@
 #include "../../../SharedLibrary/Utils/StrPathUtils.h"
 #include "../../../SharedLibrary/Utils/DiskOpsUtils.h"
 #include "../../../SharedLibrary/Utils/CmdBufUtils.h"
+#include "../../../SharedLibrary/Utils/UploadManager.h"
 #include "../../../SharedLibrary/Utils/AppUtils.h"
 #include "../../../SharedLibrary/Utils/GltfUtils.h"
 #include <unordered_map>
@@ -14,8 +15,6 @@
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/quaternion.hpp>
-
-#include <glm/gtc/matrix_access.hpp>
 #include <cmath>
 
 #define TINYGLTF_IMPLEMENTATION
@@ -153,8 +152,6 @@ void SkinAnimGltfApp::GetCameraPos(
 // ================================================================================================================
 void SkinAnimGltfApp::ReadInInitIBL()
 {
-    SharedLib::RAIICommandBuffer raiiCmdBuffer(m_gfxCmdPool, m_device);
-
     // Load the HDRI image into RAM
     std::string hdriFilePath = SOURCE_PATH;
     hdriFilePath += "/../data/";
@@ -219,18 +216,13 @@ void SkinAnimGltfApp::ReadInInitIBL()
 
         const uint32_t diffIrradianceCubemapBytes = width * height * 4 * sizeof(float);
 
-        SharedLib::SendImgDataToGpu(
-            raiiCmdBuffer.m_cmdBuffer,
-            m_device,
-            m_graphicsQueue,
-            pDiffuseIrradianceCubemapImgInfoData,
-            diffIrradianceCubemapBytes,
-            m_diffuseIrradianceCubemap.image,
-            GetImgSubrsrcRange(0, 1, 0, 6),
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            diffIrradianceBufToImgCopy,
-            *m_pAllocator
-        );
+        GetUploadManager()->EnqueueImgUpload(pDiffuseIrradianceCubemapImgInfoData,
+                                             diffIrradianceCubemapBytes,
+                                             m_diffuseIrradianceCubemap.image,
+                                             GetImgSubrsrcRange(0, 1, 0, 6),
+                                             VK_IMAGE_LAYOUT_UNDEFINED,
+                                             &diffIrradianceBufToImgCopy,
+                                             1);
 
         delete[] pDiffuseIrradianceCubemapImgInfoData;
     }
@@ -296,18 +288,13 @@ void SkinAnimGltfApp::ReadInInitIBL()
 
             const uint32_t prefilterEnvCubemapBytes = width * height * 4 * sizeof(float);
 
-            SharedLib::SendImgDataToGpu(
-                raiiCmdBuffer.m_cmdBuffer,
-                m_device,
-                m_graphicsQueue,
-                pPrefilterEnvCubemapImgsMipIData,
-                prefilterEnvCubemapBytes,
-                m_prefilterEnvCubemap.image,
-                GetImgSubrsrcRange(i, 1, 0, 6),
-                VK_IMAGE_LAYOUT_UNDEFINED,
-                prefilterEnvBufToImgCopy,
-                *m_pAllocator
-            );
+            GetUploadManager()->EnqueueImgUpload(pPrefilterEnvCubemapImgsMipIData,
+                                                 prefilterEnvCubemapBytes,
+                                                 m_prefilterEnvCubemap.image,
+                                                 GetImgSubrsrcRange(i, 1, 0, 6),
+                                                 VK_IMAGE_LAYOUT_UNDEFINED,
+                                                 &prefilterEnvBufToImgCopy,
+                                                 1);
 
             delete[] pPrefilterEnvCubemapImgsMipIData;
         }
@@ -364,21 +351,19 @@ void SkinAnimGltfApp::ReadInInitIBL()
 
         const uint32_t envBrdfBytes = width * height * 4 * sizeof(float);
 
-        SharedLib::SendImgDataToGpu(
-            raiiCmdBuffer.m_cmdBuffer,
-            m_device,
-            m_graphicsQueue,
-            pEnvBrdfImgInfoData,
-            envBrdfBytes,
-            m_envBrdfImg.image,
-            GetImgSubrsrcRange(0, 1, 0, 1),
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            envBrdfBufToImgCopy,
-            *m_pAllocator
-        );
+        GetUploadManager()->EnqueueImgUpload(pEnvBrdfImgInfoData,
+                                             envBrdfBytes,
+                                             m_envBrdfImg.image,
+                                             GetImgSubrsrcRange(0, 1, 0, 1),
+                                             VK_IMAGE_LAYOUT_UNDEFINED,
+                                             &envBrdfBufToImgCopy,
+                                             1);
 
         delete[] pEnvBrdfImgInfoData;
     }
+
+    // All the IBL images go to the GPU in one submission, which the frames' submissions come after.
+    GetUploadManager()->Flush();
 }
 
 // ================================================================================================================
@@ -402,11 +387,13 @@ void SkinAnimGltfApp::AppInit()
     InitPhysicalDevice();
     InitGfxQueueFamilyIdx();
     InitPresentQueueFamilyIdx();
+    InitTransferQueueFamilyIdx();
 
     // Queue family index should be unique in vk1.2:
     // https://vulkan.lunarg.com/doc/view/1.2.198.0/windows/1.2-extensions/vkspec.html#VUID-VkDeviceCreateInfo-queueFamilyIndex-02802
     std::vector<VkDeviceQueueCreateInfo> deviceQueueInfos = CreateDeviceQueueInfos({ m_graphicsQueueFamilyIdx,
-                                                                                     m_presentQueueFamilyIdx });
+                                                                                     m_presentQueueFamilyIdx,
+                                                                                     m_transferQueueFamilyIdx });
     // We need the swap chain device extension and the dynamic rendering extension.
     const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
@@ -415,12 +402,14 @@ void SkinAnimGltfApp::AppInit()
     InitVmaAllocator();
     InitGraphicsQueue();
     InitPresentQueue();
+    InitTransferQueue();
     InitKHRFuncPtrs();
     InitSwapchain();
     // --------------
 
     InitGfxCommandPool();
     InitGfxCommandBuffers(m_swapchainImgCnt);
+    InitUploadManager();
 
     ReadInInitGltf();
     ReadInInitIBL();
@@ -898,6 +887,32 @@ void SkinAnimGltfApp::ReadInInitGltf()
         }
     }
 
+    // Flatten the skeleton into the hierarchy. Joints without animations keep these local transformations, so only
+    // the animated joints' subtrees are recomputed every frame.
+    SharedLib::TransformHierarchy& jointsHierarchy = m_skeletalMesh.skeleton.hierarchy;
+    std::vector<uint32_t> jointParentIdxs(skin.joints.size(), SharedLib::TransformHierarchy::InvalidNodeIdx);
+    for (uint32_t i = 0; i < skin.joints.size(); i++)
+    {
+        for (uint32_t childJointIdx : m_skeletalMesh.skeleton.joints[i].children)
+        {
+            jointParentIdxs[childJointIdx] = i;
+        }
+    }
+
+    jointsHierarchy.Init(jointParentIdxs);
+    for (uint32_t i = 0; i < skin.joints.size(); i++)
+    {
+        const Joint& joint = m_skeletalMesh.skeleton.joints[i];
+        if (joint.isTransformationMat)
+        {
+            jointsHierarchy.SetLocalMat(i, joint.localTransformation);
+        }
+        else
+        {
+            jointsHierarchy.SetLocalTrs(i, joint.localTranslation, joint.localRotation, joint.localScale);
+        }
+    }
+
     // Load the global transformation of the armeture in the scene.
     std::vector<float> nodesModelMats;
     SharedLib::GetNodesModelMats(model, nodesModelMats);
@@ -1346,167 +1361,139 @@ float GetInterploationAndInterval(
 }
 
 // ================================================================================================================
-// A chain trans matrix transforms a point in the joint space to the world/model space.
-// Joint i's joint matrix = Joint i's world (chain trans) matrix * joint i's inverse bind matrix.
-// A model sapce vert multiples joint matrix generates a vert that is 100% connected/affected by the joint, so for
-// a vertex affected by several joints, the vert final pos is the weight blend of these 100% affected vertices.
-//
-// The local transform matrix always has to be computed as M = T * R * S, where T is the matrix for the translation
-// part, R is the matrix for the rotation part, and S is the matrix for the scale part.
-void SkinAnimGltfApp::GenJointMatrix(
-    float parentChainTransformationMat[16],
-    uint32_t currentJoint,
-    std::vector<float>& jointsMatBuffer)
+void SkinAnimGltfApp::UpdateJointLocalTrs(
+    uint32_t jointIdx)
 {
-    const auto& joint = m_skeletalMesh.skeleton.joints[currentJoint];
+    const auto& joint = m_skeletalMesh.skeleton.joints[jointIdx];
 
-    float localTransformMat[16] = {};
-    if (joint.isTransformationMat)
+    // We don't play this joint's animation if it's transformation is represented by a matrix.
+    if (joint.isTransformationMat ||
+        ((joint.translationAnimation.keyframeTimes.size() == 0) &&
+         (joint.rotationAnimation.keyframeTimes.size() == 0) &&
+         (joint.scalingAnimation.keyframeTimes.size() == 0)))
     {
-        // We don't play this joint's animation if it's transformation is represented by a matrix.
-        memcpy(localTransformMat, joint.localTransformation, sizeof(localTransformMat));
+        return;
     }
-    else
-    {
-        float interpolatedTranslation[3];
-        memcpy(interpolatedTranslation, joint.localTranslation, sizeof(interpolatedTranslation));
-
-        glm::quat interpolatedRotQuat(joint.localRotation[3],
-                                      joint.localRotation[0],
-                                      joint.localRotation[1],
-                                      joint.localRotation[2]);
-
-        float interpolatedScale[3];
-        memcpy(interpolatedScale, joint.localScale, sizeof(interpolatedScale));
-
-        if (joint.translationAnimation.keyframeTimes.size() != 0)
-        {
-            uint32_t preIdx;
-            uint32_t postIdx;
-            float weight = GetInterploationAndInterval(joint.translationAnimation.keyframeTimes,
-                m_currentAnimTime, preIdx, postIdx);
-
-            const std::vector<float>& translationAnimData = joint.translationAnimation.keyframeTransformationsData;
 
-            float preTranslation[3] = { translationAnimData[preIdx * 3],
-                                        translationAnimData[preIdx * 3 + 1],
-                                        translationAnimData[preIdx * 3 + 2] };
+    float interpolatedTranslation[3];
+    memcpy(interpolatedTranslation, joint.localTranslation, sizeof(interpolatedTranslation));
 
-            float postTranslation[3] = { translationAnimData[postIdx * 3],
-                                         translationAnimData[postIdx * 3 + 1],
-                                         translationAnimData[postIdx * 3 + 2] };
+    glm::quat interpolatedRotQuat(joint.localRotation[3],
+                                  joint.localRotation[0],
+                                  joint.localRotation[1],
+                                  joint.localRotation[2]);
 
-            // C++ 20
-            interpolatedTranslation[0] = std::lerp(preTranslation[0], postTranslation[0], weight);
-            interpolatedTranslation[1] = std::lerp(preTranslation[1], postTranslation[1], weight);
-            interpolatedTranslation[2] = std::lerp(preTranslation[2], postTranslation[2], weight);
-        }
+    float interpolatedScale[3];
+    memcpy(interpolatedScale, joint.localScale, sizeof(interpolatedScale));
 
-        if (joint.rotationAnimation.keyframeTimes.size() != 0)
-        {
-            uint32_t preIdx;
-            uint32_t postIdx;
-            float weight = GetInterploationAndInterval(joint.rotationAnimation.keyframeTimes,
-                m_currentAnimTime, preIdx, postIdx);
+    if (joint.translationAnimation.keyframeTimes.size() != 0)
+    {
+        uint32_t preIdx;
+        uint32_t postIdx;
+        float weight = GetInterploationAndInterval(joint.translationAnimation.keyframeTimes,
+            m_currentAnimTime, preIdx, postIdx);
 
-            const std::vector<float>& rotationAnimData = joint.rotationAnimation.keyframeTransformationsData;
+        const std::vector<float>& translationAnimData = joint.translationAnimation.keyframeTransformationsData;
 
-            glm::quat preRotQuat(rotationAnimData[preIdx * 4 + 3],
-                rotationAnimData[preIdx * 4],
-                rotationAnimData[preIdx * 4 + 1],
-                rotationAnimData[preIdx * 4 + 2]);
+        float preTranslation[3] = { translationAnimData[preIdx * 3],
+                                    translationAnimData[preIdx * 3 + 1],
+                                    translationAnimData[preIdx * 3 + 2] };
 
-            glm::quat postRotQuat(rotationAnimData[postIdx * 4 + 3],
-                rotationAnimData[postIdx * 4],
-                rotationAnimData[postIdx * 4 + 1],
-                rotationAnimData[postIdx * 4 + 2]);
+        float postTranslation[3] = { translationAnimData[postIdx * 3],
+                                     translationAnimData[postIdx * 3 + 1],
+                                     translationAnimData[postIdx * 3 + 2] };
 
-            interpolatedRotQuat = glm::slerp(preRotQuat, postRotQuat, weight);
-        }
+        // C++ 20
+        interpolatedTranslation[0] = std::lerp(preTranslation[0], postTranslation[0], weight);
+        interpolatedTranslation[1] = std::lerp(preTranslation[1], postTranslation[1], weight);
+        interpolatedTranslation[2] = std::lerp(preTranslation[2], postTranslation[2], weight);
+    }
 
-        if (joint.scalingAnimation.keyframeTimes.size() != 0)
-        {
-            uint32_t preIdx;
-            uint32_t postIdx;
-            float weight = GetInterploationAndInterval(joint.scalingAnimation.keyframeTimes,
-                                                       m_currentAnimTime, preIdx, postIdx);
+    if (joint.rotationAnimation.keyframeTimes.size() != 0)
+    {
+        uint32_t preIdx;
+        uint32_t postIdx;
+        float weight = GetInterploationAndInterval(joint.rotationAnimation.keyframeTimes,
+            m_currentAnimTime, preIdx, postIdx);
 
-            const std::vector<float>& scalingAnimData = joint.scalingAnimation.keyframeTransformationsData;
+        const std::vector<float>& rotationAnimData = joint.rotationAnimation.keyframeTransformationsData;
 
-            float preScale[3] = { scalingAnimData[preIdx * 3],
-                                  scalingAnimData[preIdx * 3 + 1],
-                                  scalingAnimData[preIdx * 3 + 2] };
+        glm::quat preRotQuat(rotationAnimData[preIdx * 4 + 3],
+            rotationAnimData[preIdx * 4],
+            rotationAnimData[preIdx * 4 + 1],
+            rotationAnimData[preIdx * 4 + 2]);
 
-            float postScale[3] = { scalingAnimData[postIdx * 3],
-                                   scalingAnimData[postIdx * 3 + 1],
-                                   scalingAnimData[postIdx * 3 + 2] };
+        glm::quat postRotQuat(rotationAnimData[postIdx * 4 + 3],
+            rotationAnimData[postIdx * 4],
+            rotationAnimData[postIdx * 4 + 1],
+            rotationAnimData[postIdx * 4 + 2]);
 
-            // C++ 20
-            interpolatedScale[0] = std::lerp(preScale[0], postScale[0], weight);
-            interpolatedScale[1] = std::lerp(preScale[1], postScale[1], weight);
-            interpolatedScale[2] = std::lerp(preScale[2], postScale[2], weight);
-        }
+        interpolatedRotQuat = glm::slerp(preRotQuat, postRotQuat, weight);
+    }
 
-        glm::mat4 rotationMatrix = glm::toMat4(interpolatedRotQuat);
-        glm::vec4 rotRow0 = glm::row(rotationMatrix, 0);
-        glm::vec4 rotRow1 = glm::row(rotationMatrix, 1);
-        glm::vec4 rotRow2 = glm::row(rotationMatrix, 2);
+    if (joint.scalingAnimation.keyframeTimes.size() != 0)
+    {
+        uint32_t preIdx;
+        uint32_t postIdx;
+        float weight = GetInterploationAndInterval(joint.scalingAnimation.keyframeTimes,
+                                                   m_currentAnimTime, preIdx, postIdx);
 
-        float localTranslationMat[16] = {
-            1.f, 0.f, 0.f, interpolatedTranslation[0],
-            0.f, 1.f, 0.f, interpolatedTranslation[1],
-            0.f, 0.f, 1.f, interpolatedTranslation[2],
-            0.f, 0.f, 0.f, 1.f
-        };
+        const std::vector<float>& scalingAnimData = joint.scalingAnimation.keyframeTransformationsData;
 
-        float localRotationMat[16] = {
-            rotRow0[0], rotRow0[1], rotRow0[2], 0.f,
-            rotRow1[0], rotRow1[1], rotRow1[2], 0.f,
-            rotRow2[0], rotRow2[1], rotRow2[2], 0.f,
-            0.f,        0.f,        0.f,        1.f
-        };
+        float preScale[3] = { scalingAnimData[preIdx * 3],
+                              scalingAnimData[preIdx * 3 + 1],
+                              scalingAnimData[preIdx * 3 + 2] };
 
-        float localScaleMat[16] = {
-            interpolatedScale[0], 0.f,                  0.f,                  0.f,
-            0.f,                  interpolatedScale[1], 0.f,                  0.f,
-            0.f,                  0.f,                  interpolatedScale[2], 0.f,
-            0.f,                  0.f,                  0.f,                  1.f
-        };
+        float postScale[3] = { scalingAnimData[postIdx * 3],
+                               scalingAnimData[postIdx * 3 + 1],
+                               scalingAnimData[postIdx * 3 + 2] };
 
-        float localRSMat[16] = {};
-        SharedLib::MatrixMul4x4(localRotationMat, localScaleMat, localRSMat);
-        SharedLib::MatrixMul4x4(localTranslationMat, localRSMat, localTransformMat);
+        // C++ 20
+        interpolatedScale[0] = std::lerp(preScale[0], postScale[0], weight);
+        interpolatedScale[1] = std::lerp(preScale[1], postScale[1], weight);
+        interpolatedScale[2] = std::lerp(preScale[2], postScale[2], weight);
     }
 
-    float jointModelMat[16] = {};
-    SharedLib::MatrixMul4x4(parentChainTransformationMat, localTransformMat, jointModelMat);
-    
-    float jointMat[16] = {};
-    SharedLib::MatrixMul4x4(jointModelMat, joint.inverseBindMatrix.data(), jointMat);
-
-    uint32_t jointMatStartIdx = 16 * currentJoint;
-    memcpy(&jointsMatBuffer[jointMatStartIdx], jointMat, sizeof(jointMat));
+    float interpolatedRotation[4] = { interpolatedRotQuat.x,
+                                      interpolatedRotQuat.y,
+                                      interpolatedRotQuat.z,
+                                      interpolatedRotQuat.w };
 
-    for (uint32_t childIdx : joint.children)
-    {
-        GenJointMatrix(jointModelMat, childIdx, jointsMatBuffer);
-    }
+    m_skeletalMesh.skeleton.hierarchy.SetLocalTrs(jointIdx,
+                                                   interpolatedTranslation,
+                                                   interpolatedRotation,
+                                                   interpolatedScale);
 }
 
 // ================================================================================================================
+// A chain trans matrix transforms a point in the joint space to the world/model space.
+// Joint i's joint matrix = Joint i's world (chain trans) matrix * joint i's inverse bind matrix.
+// A model sapce vert multiples joint matrix generates a vert that is 100% connected/affected by the joint, so for
+// a vertex affected by several joints, the vert final pos is the weight blend of these 100% affected vertices.
+//
+// The hierarchy computes the chain trans matrices under the armature, whose transformation is applied on the top.
 void SkinAnimGltfApp::UpdateJointsTransAndMats()
 {
-    float modelMatData[16] = {
-        1.f, 0.f, 0.f, ModelWorldPos[0],
-        0.f, 1.f, 0.f, ModelWorldPos[1],
-        0.f, 0.f, 1.f, ModelWorldPos[2],
-        0.f, 0.f, 0.f, 1.f
-    };
-
-    std::vector<float> jointsMatBuffer(m_skeletalMesh.skeleton.joints.size() * 16);
+    SharedLib::TransformHierarchy& jointsHierarchy = m_skeletalMesh.skeleton.hierarchy;
+    uint32_t jointCnt = m_skeletalMesh.skeleton.joints.size();
 
     // Update all joints local transformation and generate the joint matrices for each joints into a RAM buffer.
-    GenJointMatrix(m_skeletalMesh.transformationMat, 0, jointsMatBuffer);
+    for (uint32_t i = 0; i < jointCnt; i++)
+    {
+        UpdateJointLocalTrs(i);
+    }
+    jointsHierarchy.Update();
+
+    std::vector<float> jointsMatBuffer(jointCnt * 16);
+    for (uint32_t i = 0; i < jointCnt; i++)
+    {
+        float jointModelMat[16] = {};
+        SharedLib::MatrixMul4x4(m_skeletalMesh.transformationMat, jointsHierarchy.GetWorldMat(i), jointModelMat);
+
+        float jointMat[16] = {};
+        SharedLib::MatrixMul4x4(jointModelMat, m_skeletalMesh.skeleton.joints[i].inverseBindMatrix.data(), jointMat);
+        memcpy(&jointsMatBuffer[16 * i], jointMat, sizeof(jointMat));
+    }
 
     // Send the joint RAM buffer to the corresponding joint gpu buffer.
     CopyRamDataToGpuBuffer(jointsMatBuffer.data(),
@@ -1,6 +1,7 @@
 #pragma once
 #include "../../../SharedLibrary/Application/GlfwApplication.h"
 #include "../../../SharedLibrary/Pipeline/Pipeline.h"
+#include "../../../SharedLibrary/Transform/TransformHierarchy.h"
 #include <chrono>
 #include <array>
 
@@ -66,6 +67,9 @@ struct Skeleton
 {
     std::vector<Joint> joints; // joints[0] is the root joint.
 
+    // The joints' local transformations flattened parent before child. Indexed by the joint ids.
+    SharedLib::TransformHierarchy hierarchy;
+
     std::vector<SharedLib::GpuBuffer> jointsMatsBuffers; // Each in-flight frame has its own joints matrices buffer.
 };
 
@@ -115,7 +119,8 @@ public:
 
 private:
 
-    void GenJointMatrix(float parentChainTransformationMat[16], uint32_t currentJoint, std::vector<float>& jointsMatBuffer);
+    // Play the joint's animation at the current anim time into its local TRS in the skeleton's hierarchy.
+    void UpdateJointLocalTrs(uint32_t jointIdx);
 
     void UpdateCamera();
     // Update joints/skeleton's local transformation and the joints' matrices.
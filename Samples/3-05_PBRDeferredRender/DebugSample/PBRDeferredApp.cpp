@@ -7,8 +7,8 @@
 #include "../../../SharedLibrary/Camera/Camera.h"
 #include "../../../SharedLibrary/Event/Event.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
+#include "../../../SharedLibrary/AssetsLoader/AssetsLoader.h"
+#include "../../../SharedLibrary/Scene/Level.h"
 
 #include "vk_mem_alloc.h"
 
@@ -201,57 +201,38 @@ void PBRDeferredApp::ReadInSphereData()
     std::string inputfile = SOURCE_PATH;
     inputfile += "/../data/uvNormalSphere.obj";
     
-    tinyobj::ObjReaderConfig readerConfig;
-    tinyobj::ObjReader sphereObjReader;
-
-    sphereObjReader.ParseFromFile(inputfile, readerConfig);
+    // The loader merges the corners that the obj faces share, so the sphere's vertices are shared by its triangles.
+    // The cooked sphere goes into the build folder instead of the data folder, so later runs skip the obj parsing.
+    SharedLib::AssetsLoaderOptions loaderOptions;
+    {
+        loaderOptions.cookedCacheDir = COOKED_CACHE_PATH;
+    }
 
-    auto& shapes = sphereObjReader.GetShapes();
-    auto& attrib = sphereObjReader.GetAttrib();
+    SharedLib::ObjLoaderManager objLoaderManager(loaderOptions);
+    SharedLib::Level sphereLevel;
+    if (objLoaderManager.Load(inputfile, sphereLevel) == false)
+    {
+        throw std::runtime_error("Failed to load the sphere obj!");
+    }
 
     // We assume that this test only has one shape
-    assert(shapes.size() == 1, "This application only accepts one shape!");
+    assert(sphereLevel.m_meshEntities.size() == 1, "This application only accepts one shape!");
 
-    for (uint32_t s = 0; s < shapes.size(); s++)
-    {
-        // Loop over faces(polygon)
-        uint32_t index_offset = 0;
-        uint32_t idxBufIdx = 0;
-        for (uint32_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
-        {
-            uint32_t fv = shapes[s].mesh.num_face_vertices[f];
+    SharedLib::MeshEntity* pSphereEntity = sphereLevel.m_meshEntities.begin()->second;
+    const SharedLib::MeshPrimitive& spherePrimitive = pSphereEntity->m_meshPrimitives[0];
 
-            // Loop over vertices in the face.
-            for (uint32_t v = 0; v < fv; v++)
-            {
-                // Access to vertex
-                tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-
-                float vx = attrib.vertices[3 * size_t(idx.vertex_index) + 0];
-                float vy = attrib.vertices[3 * size_t(idx.vertex_index) + 1];
-                float vz = attrib.vertices[3 * size_t(idx.vertex_index) + 2];
-
-                // Transfer the vertex buffer's vertex index to the element index -- 6 * vertex index + xxx;
-                m_vertData.push_back(vx);
-                m_vertData.push_back(vy);
-                m_vertData.push_back(vz);
-
-                // Check if `normal_index` is zero or positive. negative = no normal data
-                assert(idx.normal_index >= 0, "The model doesn't have normal information but it is necessary.");
-                float nx = attrib.normals[3 * size_t(idx.normal_index) + 0];
-                float ny = attrib.normals[3 * size_t(idx.normal_index) + 1];
-                float nz = attrib.normals[3 * size_t(idx.normal_index) + 2];
-
-                m_vertData.push_back(nx);
-                m_vertData.push_back(ny);
-                m_vertData.push_back(nz);
-
-                m_idxData.push_back(idxBufIdx);
-                idxBufIdx++;
-            }
-            index_offset += fv;
-        }
+    // A vert = pos + normal. The normals are generated when the obj doesn't have them.
+    const uint32_t sphereVertCnt = spherePrimitive.m_posData.size() / 3;
+    for (uint32_t vertIdx = 0; vertIdx < sphereVertCnt; vertIdx++)
+    {
+        m_vertData.insert(m_vertData.end(),
+                          spherePrimitive.m_posData.begin() + 3 * vertIdx,
+                          spherePrimitive.m_posData.begin() + 3 * vertIdx + 3);
+        m_vertData.insert(m_vertData.end(),
+                          spherePrimitive.m_normalData.begin() + 3 * vertIdx,
+                          spherePrimitive.m_normalData.begin() + 3 * vertIdx + 3);
     }
+    spherePrimitive.GetIndicesUint32(m_idxData);
 
     m_vertBufferByteCnt = m_vertData.size() * sizeof(float);
     m_idxBufferByteCnt = m_idxData.size() * sizeof(uint32_t);
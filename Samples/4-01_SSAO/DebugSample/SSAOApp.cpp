@@ -17,6 +17,9 @@
 
 #define CUSTOM_DEBUGGING 1
 
+// The geometry pass decodes the 20 bytes vertices in the geo_vert.hlsl.
+static const SharedLib::VertLayout GeoPassVertLayout = SharedLib::VERT_LAYOUT_OCT_TANGENT;
+
 // ================================================================================================================
 SSAOApp::SSAOApp() :
     ImGuiApplication(),
@@ -177,6 +180,16 @@ void SSAOApp::SendCameraDataToBuffer(
                            32 * sizeof(float));
 }
 
+// ================================================================================================================
+void SSAOApp::UploadDecodedTextures()
+{
+    m_pGltfLoaderManager->UploadDecodedTextures(m_device,
+                                                m_pAllocator,
+                                                GetUploadManager(),
+                                                GetSubmittedFrameCnt(),
+                                                GetCompletedFrameCnt());
+}
+
 // ================================================================================================================
 void SSAOApp::UpdateCameraAndGpuBuffer()
 {
@@ -502,13 +515,22 @@ SharedLib::PipelineColorBlendInfo SSAOApp::CreateDeferredLightingPassPipelineCol
 // ================================================================================================================
 void SSAOApp::InitGeoPassPipelineLayout()
 {
+    // Each primitive pushes the dequantization of its positions.
+    VkPushConstantRange vertDequantPushConstantInfo{};
+    {
+        vertDequantPushConstantInfo.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        vertDequantPushConstantInfo.offset = 0;
+        vertDequantPushConstantInfo.size = sizeof(SharedLib::VertDequant);
+    }
+
     // Create pipeline layout
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     {
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutInfo.setLayoutCount = 1;
         pipelineLayoutInfo.pSetLayouts = &m_geoPassPipelineDesSetLayout;
-        pipelineLayoutInfo.pushConstantRangeCount = 0;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &vertDequantPushConstantInfo;
     }
     
     VK_CHECK(vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_geoPassPipelineLayout));
@@ -557,25 +579,15 @@ void SSAOApp::InitGeoPassPipelineDescriptorSetLayout()
     }
     bindings.push_back(normalTextureBinding);
 
-    // Binding for the roughness metallic texture
-    VkDescriptorSetLayoutBinding roughnessMetallicTextureBinding{};
+    // Binding for the occlusion, roughness and metallic texture
+    VkDescriptorSetLayoutBinding ormTextureBinding{};
     {
-        roughnessMetallicTextureBinding.binding = 3;
-        roughnessMetallicTextureBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-        roughnessMetallicTextureBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        roughnessMetallicTextureBinding.descriptorCount = 1;
+        ormTextureBinding.binding = 3;
+        ormTextureBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        ormTextureBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        ormTextureBinding.descriptorCount = 1;
     }
-    bindings.push_back(roughnessMetallicTextureBinding);
-
-    // Binding for the occlusion texture
-    VkDescriptorSetLayoutBinding occlusionTextureBinding{};
-    {
-        occlusionTextureBinding.binding = 4;
-        occlusionTextureBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-        occlusionTextureBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        occlusionTextureBinding.descriptorCount = 1;
-    }
-    bindings.push_back(occlusionTextureBinding);
+    bindings.push_back(ormTextureBinding);
 
     // Create pipeline's descriptors layout
     // The Vulkan spec states: The VkDescriptorSetLayoutBinding::binding members of the elements of the pBindings array 
@@ -601,48 +613,23 @@ VkPipelineVertexInputStateCreateInfo SSAOApp::CreateGeoPassPipelineVertexInputIn
 {
     // Specifying all kinds of pipeline states
     // Vertex input state
-    VkVertexInputBindingDescription* pVertBindingDesc = new VkVertexInputBindingDescription();
-    memset(pVertBindingDesc, 0, sizeof(VkVertexInputBindingDescription));
-    {
-        pVertBindingDesc->binding = 0;
-        pVertBindingDesc->stride = 12 * sizeof(float);
-        pVertBindingDesc->inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    }
-    m_heapMemPtrVec.push_back(pVertBindingDesc);
+    // The binding 0 has the vertices and the binding 1 has the mesh entity's instance matrices at the locations 4 to 6.
+    VkVertexInputBindingDescription* pVertBindingDescs = new VkVertexInputBindingDescription[2];
+    m_heapArrayMemPtrVec.push_back(pVertBindingDescs);
 
-    VkVertexInputAttributeDescription* pVertAttrDescs = new VkVertexInputAttributeDescription[4];
-    memset(pVertAttrDescs, 0, sizeof(VkVertexInputAttributeDescription) * 4);
-    {
-        // Position
-        pVertAttrDescs[0].location = 0;
-        pVertAttrDescs[0].binding = 0;
-        pVertAttrDescs[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        pVertAttrDescs[0].offset = 0;
-        // Normal
-        pVertAttrDescs[1].location = 1;
-        pVertAttrDescs[1].binding = 0;
-        pVertAttrDescs[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        pVertAttrDescs[1].offset = 3 * sizeof(float);
-        // Tangent
-        pVertAttrDescs[2].location = 2;
-        pVertAttrDescs[2].binding = 0;
-        pVertAttrDescs[2].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-        pVertAttrDescs[2].offset = 6 * sizeof(float);
-        // UV
-        pVertAttrDescs[3].location = 3;
-        pVertAttrDescs[3].binding = 0;
-        pVertAttrDescs[3].format = VK_FORMAT_R32G32_SFLOAT;
-        pVertAttrDescs[3].offset = 10 * sizeof(float);
-    }
+    VkVertexInputAttributeDescription* pVertAttrDescs = new VkVertexInputAttributeDescription[7];
     m_heapArrayMemPtrVec.push_back(pVertAttrDescs);
 
+    uint32_t vertAttrCnt = SharedLib::GetVertInputDescs(GeoPassVertLayout, 0, pVertBindingDescs[0], pVertAttrDescs);
+    vertAttrCnt += SharedLib::GetInstanceInputDescs(1, 4, pVertBindingDescs[1], &pVertAttrDescs[vertAttrCnt]);
+
     VkPipelineVertexInputStateCreateInfo vertInputInfo{};
     {
         vertInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
         vertInputInfo.pNext = nullptr;
-        vertInputInfo.vertexBindingDescriptionCount = 1;
-        vertInputInfo.pVertexBindingDescriptions = pVertBindingDesc;
-        vertInputInfo.vertexAttributeDescriptionCount = 4;
+        vertInputInfo.vertexBindingDescriptionCount = 2;
+        vertInputInfo.pVertexBindingDescriptions = pVertBindingDescs;
+        vertInputInfo.vertexAttributeDescriptionCount = vertAttrCnt;
         vertInputInfo.pVertexAttributeDescriptions = pVertAttrDescs;
     }
 
@@ -1334,17 +1321,42 @@ void SSAOApp::CmdGeoPass(VkCommandBuffer cmdBuffer)
 
     vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_geoPassPipeline.GetVkPipeline());
 
+    // Distant primitives draw a coarser level of their index buffer, with at most a pixel of geometric error.
+    float cameraPos[3];
+    m_pCamera->GetPos(cameraPos);
+
+    // The primitives share the geometry arena's blocks, so the geometry is only rebound when the block or the index
+    // type changes. Each entity's instance matrices are a range of an arena block.
+    VkBuffer    boundVertBuffer = VK_NULL_HANDLE;
+    VkBuffer    boundIdxBuffer = VK_NULL_HANDLE;
+    VkIndexType boundIdxType = VK_INDEX_TYPE_MAX_ENUM;
+
     int meshEntityCnt = 0;
     for (const auto& meshEntity : m_pLevel->m_meshEntities)
     {
+        VkBuffer     instanceBuffer = meshEntity.second->GetInstanceBuffer();
+        VkDeviceSize instanceBufferOffset = meshEntity.second->GetInstanceBufferOffset();
+        vkCmdBindVertexBuffers(cmdBuffer, 1, 1, &instanceBuffer, &instanceBufferOffset);
+
         for (int i = 0; i < meshEntity.second->m_meshPrimitives.size(); i++)
         {
             // NOTE: We cannot put any barriers in a render pass.
             auto& meshPrimitive = meshEntity.second->m_meshPrimitives[i];
 
-            VkDeviceSize offsets[] = { 0 };
-            vkCmdBindVertexBuffers(cmdBuffer, 0, 1, meshPrimitive.GetVertBuffer(), offsets);
-            vkCmdBindIndexBuffer(cmdBuffer, meshPrimitive.GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT16);
+            VkBuffer vertBuffer = meshPrimitive.GetVertBuffer();
+            if (vertBuffer != boundVertBuffer)
+            {
+                VkDeviceSize vertBufferOffset = 0;
+                vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &vertBuffer, &vertBufferOffset);
+                boundVertBuffer = vertBuffer;
+            }
+
+            if ((meshPrimitive.GetIndexBuffer() != boundIdxBuffer) || (meshPrimitive.GetIndexType() != boundIdxType))
+            {
+                boundIdxBuffer = meshPrimitive.GetIndexBuffer();
+                boundIdxType = meshPrimitive.GetIndexType();
+                vkCmdBindIndexBuffer(cmdBuffer, boundIdxBuffer, 0, boundIdxType);
+            }
 
             vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
             vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
@@ -1354,12 +1366,51 @@ void SSAOApp::CmdGeoPass(VkCommandBuffer cmdBuffer)
             pushDescriptors.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &m_vpUboBuffers[m_acqSwapchainImgIdx].bufferDescInfo });
             pushDescriptors.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, meshPrimitive.GetBaseColorImgDescInfo() });
             pushDescriptors.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, meshPrimitive.GetNormalImgDescInfo() });
-            pushDescriptors.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, meshPrimitive.GetMetallicRoughnessImgDescInfo() });
-            pushDescriptors.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, meshPrimitive.GetOcclusionImgDescInfo() });
+            pushDescriptors.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, meshPrimitive.GetOrmImgDescInfo() });
 
             CmdAutoPushDescriptors(cmdBuffer, m_geoPassPipelineLayout, pushDescriptors);
 
-            vkCmdDrawIndexed(cmdBuffer, meshPrimitive.m_idxDataUint16.size(), 1, 0, 0, 0);
+            vkCmdPushConstants(cmdBuffer,
+                               m_geoPassPipelineLayout,
+                               VK_SHADER_STAGE_VERTEX_BIT,
+                               0,
+                               sizeof(SharedLib::VertDequant),
+                               &meshPrimitive.GetVertDequant());
+
+            // Every instance picks its level from its own distance and scale. The consecutive instances with the same
+            // level are drawn together, so the instance buffer doesn't need to be reordered per frame.
+            const uint32_t instanceCnt = meshEntity.second->GetInstanceCnt();
+            uint32_t       runFirstInstance = 0;
+            SharedLib::MeshLod runLod = meshPrimitive.SelectLod(cameraPos,
+                                                                m_pCamera->GetFov(),
+                                                                viewport.height,
+                                                                1.f,
+                                                                meshEntity.second->GetInstanceMat(0));
+            for (uint32_t instanceIdx = 1; instanceIdx <= instanceCnt; instanceIdx++)
+            {
+                SharedLib::MeshLod lod{};
+                if (instanceIdx < instanceCnt)
+                {
+                    lod = meshPrimitive.SelectLod(cameraPos,
+                                                  m_pCamera->GetFov(),
+                                                  viewport.height,
+                                                  1.f,
+                                                  meshEntity.second->GetInstanceMat(instanceIdx));
+                    if (lod.firstIdx == runLod.firstIdx)
+                    {
+                        continue;
+                    }
+                }
+
+                vkCmdDrawIndexed(cmdBuffer,
+                                 runLod.idxCnt,
+                                 instanceIdx - runFirstInstance,
+                                 meshPrimitive.GetFirstIdx() + runLod.firstIdx,
+                                 meshPrimitive.GetVertexOffset(),
+                                 runFirstInstance);
+                runFirstInstance = instanceIdx;
+                runLod = lod;
+            }
         }
         meshEntityCnt++;
     }
@@ -1561,23 +1612,38 @@ void SSAOApp::AppInit()
     InitPhysicalDevice();
     InitGfxQueueFamilyIdx();
     InitPresentQueueFamilyIdx();
+    InitTransferQueueFamilyIdx();
 
     // Queue family index should be unique in vk1.2:
     // https://vulkan.lunarg.com/doc/view/1.2.198.0/windows/1.2-extensions/vkspec.html#VUID-VkDeviceCreateInfo-queueFamilyIndex-02802
     std::vector<VkDeviceQueueCreateInfo> deviceQueueInfos = CreateDeviceQueueInfos({ m_graphicsQueueFamilyIdx,
-                                                                                     m_presentQueueFamilyIdx });
+                                                                                     m_presentQueueFamilyIdx,
+                                                                                     m_transferQueueFamilyIdx });
     // Dummy device extensions vector. Swapchain, dynamic rendering and push descriptors are enabled by default.
     // We have tools that don't need the swapchain extension and the swapchain extension requires surface instance extensions.
     const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
-    InitDevice(deviceExtensions, deviceQueueInfos, nullptr);
+
+    // The material textures are block compressed when the device can sample the BC formats.
+    VkPhysicalDeviceFeatures supportedFeatures{};
+    vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+
+    VkPhysicalDeviceFeatures2 enabledFeatures{};
+    {
+        enabledFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        enabledFeatures.features.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    }
+
+    InitDevice(deviceExtensions, deviceQueueInfos, &enabledFeatures);
     InitKHRFuncPtrs();
     InitVmaAllocator();
     InitGraphicsQueue();
     InitPresentQueue();
+    InitTransferQueue();
 
     InitSwapchain();
     InitGfxCommandPool();
     InitGfxCommandBuffers(m_swapchainImgCnt);
+    InitUploadManager();
     SwapchainColorImgsLayoutTrans(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
     SwapchainDepthImgsLayoutTrans(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 
@@ -1592,15 +1658,23 @@ void SSAOApp::AppInit()
     SetupInputHandler();
 
     // Load in gltf scene.
-    m_pGltfLoaderManager = new SharedLib::GltfLoaderManager();
+    SharedLib::AssetsLoaderOptions loaderOptions;
+    loaderOptions.compressTextures = (supportedFeatures.textureCompressionBC == VK_TRUE);
+    loaderOptions.vertLayout = GeoPassVertLayout;
+    loaderOptions.buildLods = true;
+    loaderOptions.cookedCacheDir = COOKED_CACHE_PATH;
+    m_pGltfLoaderManager = new SharedLib::GltfLoaderManager(loaderOptions);
     m_pLevel = new SharedLib::Level();
 
     std::string sceneLoadPathAbs = SOURCE_PATH;
     sceneLoadPathAbs += +"/../data/Sponza/Sponza.gltf";
     // sceneLoadPathAbs += +"/../data/Box/Box.gltf";
 
-    m_pGltfLoaderManager->Load(sceneLoadPathAbs, *m_pLevel);
-    m_pGltfLoaderManager->InitEntitesGpuRsrc(m_device, m_pAllocator, GetGfxCmdBuffer(0), m_graphicsQueue);
+    if (m_pGltfLoaderManager->Load(sceneLoadPathAbs, *m_pLevel) == false)
+    {
+        throw std::runtime_error("Failed to load the gltf scene!");
+    }
+    m_pGltfLoaderManager->InitEntitesGpuRsrc(m_physicalDevice, m_device, m_pAllocator, GetUploadManager());
 
     InitScreenQuadVsShaderModule();
 
@@ -72,6 +72,9 @@ public:
 
     void UpdateCameraAndGpuBuffer();
 
+    // Swaps the textures that finished decoding on the loader's threads into the scene.
+    void UploadDecodedTextures();
+
     void ImGuiFrame(VkCommandBuffer cmdBuffer) override;
 
     void CmdGeoPass(VkCommandBuffer cmdBuffer);
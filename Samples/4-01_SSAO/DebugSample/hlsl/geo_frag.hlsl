@@ -14,14 +14,9 @@ struct PSOutput
 [[vk::binding(2, 0)]] Texture2D i_normalTexture;
 [[vk::binding(2, 0)]] SamplerState i_normalSamplerState;
 
-// The textures for metalness and roughness properties are packed together in a single texture called
-// metallicRoughnessTexture. Its green channel contains roughness values and its blue channel contains metalness
-// values.
-[[vk::binding(3, 0)]] Texture2D i_roughnessMetallicTexture;
-[[vk::binding(3, 0)]] SamplerState i_roughnessMetallicSamplerState;
-
-[[vk::binding(4, 0)]] Texture2D i_occlusionTexture;
-[[vk::binding(4, 0)]] SamplerState i_occlusionSamplerState;
+// The occlusion, roughness and metalness packed in the r, g and b channels.
+[[vk::binding(3, 0)]] Texture2D i_ormTexture;
+[[vk::binding(3, 0)]] SamplerState i_ormSamplerState;
 
 PSOutput main(
     float4 i_pixelWorldPos     : POSITION0,
@@ -32,10 +27,13 @@ PSOutput main(
     PSOutput output = (PSOutput)0;
 
 	output.worldPos = i_pixelWorldPos;
-    output.worldNormal = i_normalTexture.Sample(i_normalSamplerState, i_uv);
+    // The RG8 and BC5 normal maps only keep the xy, so the z is rebuilt from the unit length.
+    float2 normalXy = i_normalTexture.Sample(i_normalSamplerState, i_uv).xy * 2.0 - 1.0;
+    float  normalZ  = sqrt(saturate(1.0 - dot(normalXy, normalXy)));
+    output.worldNormal = float4(float3(normalXy, normalZ) * 0.5 + 0.5, 1.0);
 	output.albedo = i_baseColorTexture.Sample(i_baseColorSamplerState, i_uv);
-	output.param.xy  = i_roughnessMetallicTexture.Sample(i_roughnessMetallicSamplerState, i_uv).yz;
-	output.param.z = i_occlusionTexture.Sample(i_occlusionSamplerState, i_uv).x;
+	float3 orm = i_ormTexture.Sample(i_ormSamplerState, i_uv).xyz;
+	output.param = orm.yzx;
 
 	return output;
 }
\ No newline at end of file
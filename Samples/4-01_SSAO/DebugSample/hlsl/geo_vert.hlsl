@@ -1,5 +1,7 @@
 #pragma pack_matrix(row_major)
 
+#include <vertexDecode.hlsl>
+
 struct VSOutput
 {
     float4 Pos : SV_POSITION;
@@ -9,12 +11,18 @@ struct VSOutput
     float2 UV : TEXCOORD0;
 };
 
+// The VERT_LAYOUT_OCT_TANGENT vertices.
 struct VSInput
 {
-    float3 vPosition : POSITION;
-    float3 vNormal : NORMAL;
-    float4 vTangent : TANGENT;
+    float4 vPosition : POSITION;
+    float2 vOctNormal : NORMAL;
+    float2 vOctTangent : TANGENT;
     float2 vUv : TEXCOORD;
+
+    // The mesh entity's instance matrix rows.
+    float4 iInstanceRow0 : INSTANCE0;
+    float4 iInstanceRow1 : INSTANCE1;
+    float4 iInstanceRow2 : INSTANCE2;
 };
 
 struct VertUBO
@@ -25,15 +33,24 @@ struct VertUBO
 
 [[vk::binding(0, 0)]] cbuffer UBO0 { VertUBO i_vertUbo; };
 
+[[vk::push_constant]] VertDequant i_vertDequant;
+
 VSOutput main(
     VSInput i_vertInput)
 {
     VSOutput output = (VSOutput)0;
 
-    output.WorldPos = mul(i_vertUbo.modelMat, float4(i_vertInput.vPosition, 1.0));
-    output.Normal.xyz = mul(i_vertUbo.modelMat, float4(i_vertInput.vNormal, 0.0)).xyz;
+    float3 pos = DequantizePos(i_vertInput.vPosition, i_vertDequant);
+    float3 normal = OctDecode(i_vertInput.vOctNormal);
+    float4 tangent = DecodeOctTangent(i_vertInput.vOctTangent, i_vertInput.vPosition);
+
+    float4x4 instanceMat = GetInstanceMat(i_vertInput.iInstanceRow0, i_vertInput.iInstanceRow1, i_vertInput.iInstanceRow2);
+    float4x4 modelMat = mul(i_vertUbo.modelMat, instanceMat);
+
+    output.WorldPos = mul(modelMat, float4(pos, 1.0));
+    output.Normal.xyz = mul(modelMat, float4(normal, 0.0)).xyz;
     output.Pos = mul(i_vertUbo.vpMat, output.WorldPos);
-    output.Tangent = mul(i_vertUbo.modelMat, float4(i_vertInput.vTangent.xyz, 0.0));
+    output.Tangent = float4(mul(modelMat, float4(tangent.xyz, 0.0)).xyz, tangent.w);
     output.UV = i_vertInput.vUv;
 
     return output;
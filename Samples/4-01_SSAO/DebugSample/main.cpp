@@ -32,6 +32,9 @@ int main()
 
         app.UpdateCameraAndGpuBuffer();
 
+        // Its uploads are submitted before the frame's command buffer, so the frame samples the new textures.
+        app.UploadDecodedTextures();
+
         // Fill the command buffer
         VkCommandBufferBeginInfo beginInfo{};
         {
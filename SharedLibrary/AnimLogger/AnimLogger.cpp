@@ -73,7 +73,9 @@ namespace SharedLib
                 imgInfo.mipLevels = 1;
                 imgInfo.arrayLayers = 1;
                 imgInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-                imgInfo.tiling = VK_IMAGE_TILING_LINEAR;
+                // It is only blitted to and copied out to a buffer by the CopyImgToRam(...), so the host never reads
+                // its texels and it doesn't need the linear tiling.
+                imgInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
                 imgInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
                 imgInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
             }
@@ -2,6 +2,7 @@
 #include "vk_mem_alloc.h"
 
 #include "CmdBufUtils.h"
+#include "UploadManager.h"
 #include "Application.h"
 #include "VulkanDbgUtils.h"
 #include "AppUtils.h"
@@ -16,9 +17,12 @@ namespace SharedLib
         m_physicalDevice(VK_NULL_HANDLE),
         m_device(VK_NULL_HANDLE),
         m_graphicsQueue(VK_NULL_HANDLE),
+        m_transferQueueFamilyIdx(-1),
+        m_transferQueue(VK_NULL_HANDLE),
         m_pAllocator(nullptr),
         m_debugMessenger(VK_NULL_HANDLE),
         m_gfxCmdPool(VK_NULL_HANDLE),
+        m_pUploadManager(nullptr),
         m_vkCmdPushDescriptorSetKHR(nullptr)
     {
         m_pAllocator = new VmaAllocator();
@@ -27,6 +31,13 @@ namespace SharedLib
     // ================================================================================================================
     Application::~Application()
     {
+        // Wait for the uploads in flight and release the staging ring
+        if (m_pUploadManager != nullptr)
+        {
+            m_pUploadManager->Finalize();
+            delete m_pUploadManager;
+        }
+
         // Destroy the command pool
         vkDestroyCommandPool(m_device, m_gfxCmdPool, nullptr);
 
@@ -199,16 +210,74 @@ namespace SharedLib
     }
 
     // ================================================================================================================
-    // Enable possible extensions all at once: dynamic rendering, swapchain and push descriptors.
+    void Application::InitTransferQueueFamilyIdx()
+    {
+        uint32_t queueFamilyPropCount;
+        vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyPropCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilyProps(queueFamilyPropCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyPropCount, queueFamilyProps.data());
+
+        m_transferQueueFamilyIdx = m_graphicsQueueFamilyIdx;
+        bool foundTransferOnly = false;
+        for (unsigned int i = 0; i < queueFamilyPropCount; ++i)
+        {
+            const VkQueueFamilyProperties& props = queueFamilyProps[i];
+
+            // The uploads copy single texels of the small mip levels, so a coarser granularity doesn't work. The
+            // compute queues can copy without the transfer bit.
+            const VkExtent3D& granularity = props.minImageTransferGranularity;
+            if ((props.queueFlags & VK_QUEUE_GRAPHICS_BIT) ||
+                ((props.queueFlags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) == 0) ||
+                (granularity.width != 1) || (granularity.height != 1) || (granularity.depth != 1))
+            {
+                continue;
+            }
+
+            const bool isTransferOnly = (props.queueFlags & VK_QUEUE_COMPUTE_BIT) == 0;
+            if ((m_transferQueueFamilyIdx == m_graphicsQueueFamilyIdx) || (isTransferOnly && (foundTransferOnly == false)))
+            {
+                m_transferQueueFamilyIdx = i;
+                foundTransferOnly = isTransferOnly;
+            }
+        }
+    }
+
+    // ================================================================================================================
+    // Enable possible extensions all at once: dynamic rendering, swapchain and push descriptors. The timeline semaphores
+    // of the UploadManager are enabled as well, which are core and required since Vulkan 1.2.
     void Application::InitDevice(
         const std::vector<const char*>&             deviceExts,
         const std::vector<VkDeviceQueueCreateInfo>& queueCreateInfos,
         void*                                       pNext)
     {
+        // The VkPhysicalDeviceVulkan12Features cannot be chained together with the timeline semaphore features.
+        VkPhysicalDeviceVulkan12Features* pVulkan12Features = nullptr;
+        for (VkBaseOutStructure* pStruct = static_cast<VkBaseOutStructure*>(pNext);
+             pStruct != nullptr;
+             pStruct = pStruct->pNext)
+        {
+            if (pStruct->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES)
+            {
+                pVulkan12Features = reinterpret_cast<VkPhysicalDeviceVulkan12Features*>(pStruct);
+            }
+        }
+
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeature{};
+        {
+            timelineSemaphoreFeature.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+            timelineSemaphoreFeature.pNext = pNext;
+            timelineSemaphoreFeature.timelineSemaphore = VK_TRUE;
+        }
+
+        if (pVulkan12Features != nullptr)
+        {
+            pVulkan12Features->timelineSemaphore = VK_TRUE;
+        }
+
         VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeature{};
         {
             dynamicRenderingFeature.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
-            dynamicRenderingFeature.pNext = pNext;
+            dynamicRenderingFeature.pNext = (pVulkan12Features != nullptr) ? pNext : &timelineSemaphoreFeature;
             dynamicRenderingFeature.dynamicRendering = VK_TRUE;
         }
 
@@ -247,6 +316,12 @@ namespace SharedLib
         vkGetDeviceQueue(m_device, m_graphicsQueueFamilyIdx, 0, &m_graphicsQueue);
     }
 
+    // ================================================================================================================
+    void Application::InitTransferQueue()
+    {
+        vkGetDeviceQueue(m_device, m_transferQueueFamilyIdx, 0, &m_transferQueue);
+    }
+
     // ================================================================================================================
     void Application::InitVmaAllocator(int flags)
     {
@@ -283,6 +358,29 @@ namespace SharedLib
         VK_CHECK(vkCreateCommandPool(m_device, &commandPoolInfo, nullptr, &m_gfxCmdPool));
     }
 
+    // ================================================================================================================
+    void Application::InitUploadManager(
+        VkDeviceSize ringByteCnt)
+    {
+        // Without the InitTransferQueue() or a dedicated family, the copies and the rendering share the graphics queue.
+        VkQueue      copyQueue = m_graphicsQueue;
+        unsigned int copyQueueFamilyIdx = m_graphicsQueueFamilyIdx;
+        if ((m_transferQueue != VK_NULL_HANDLE) && (m_transferQueueFamilyIdx != m_graphicsQueueFamilyIdx))
+        {
+            copyQueue = m_transferQueue;
+            copyQueueFamilyIdx = m_transferQueueFamilyIdx;
+        }
+
+        m_pUploadManager = new UploadManager();
+        m_pUploadManager->Init(m_device,
+                               *m_pAllocator,
+                               copyQueue,
+                               copyQueueFamilyIdx,
+                               m_graphicsQueue,
+                               m_graphicsQueueFamilyIdx,
+                               ringByteCnt);
+    }
+
     // ================================================================================================================
     void Application::InitGfxCommandBuffers(
         const uint32_t cmdBufCnt)
@@ -28,6 +28,8 @@ do { \
 // TODO3: GPU image format should have more information like currnet GPU image format.
 namespace SharedLib
 {
+    class UploadManager;
+
     // The second element is either VkDescriptorType* or VkDescriptorImageInfo*.
     typedef std::pair<VkDescriptorType, void*> PushDescriptorInfo;
 
@@ -81,6 +83,12 @@ namespace SharedLib
         std::vector<uint8_t> dataVec;
         uint32_t             componentType;
         // float*               pData;
+
+        // Byte offsets of the mip levels in the dataVec, the level 0 first. Empty means the dataVec is one level.
+        std::vector<uint32_t> mipByteOffsets;
+
+        // The GPU format of the dataVec when the user can't assume it, e.g. for the block compressed textures.
+        VkFormat format = VK_FORMAT_UNDEFINED;
     };
 
     struct BinBufferInfo
@@ -184,6 +192,9 @@ namespace SharedLib
         VkQueue GetGfxQueue() { return m_graphicsQueue; }
         VkCommandPool GetGfxCmdPool() { return m_gfxCmdPool; }
 
+        // Null before the InitUploadManager(...).
+        UploadManager* GetUploadManager() { return m_pUploadManager; }
+
         // The push descriptor update function is part of an extension so it has to be manually loaded
         PFN_vkCmdPushDescriptorSetKHR m_vkCmdPushDescriptorSetKHR;
 
@@ -198,6 +209,11 @@ namespace SharedLib
         void InitPhysicalDevice();
 
         void InitGfxQueueFamilyIdx();
+
+        // Prefers a transfer only family, which is usually a DMA engine, then any other non graphics family that can
+        // copy. Falls back to the graphics family when there is none, e.g. lavapipe has only one family. Its index
+        // has to be in the CreateDeviceQueueInfos(...) set. It needs the InitGfxQueueFamilyIdx().
+        void InitTransferQueueFamilyIdx();
         
         void InitDevice(const std::vector<const char*>&             deviceExts,
                         const std::vector<VkDeviceQueueCreateInfo>& queueCreateInfos,
@@ -206,10 +222,15 @@ namespace SharedLib
         void InitKHRFuncPtrs();
 
         void InitGraphicsQueue();
+        void InitTransferQueue();
         void InitVmaAllocator(int flags = 0);
         void InitGfxCommandPool();
         void InitGfxCommandBuffers(const uint32_t cmdBufCnt);
 
+        // The loaders' uploads go through it. Its copies run on the transfer queue when it is from a dedicated family,
+        // otherwise on the graphics queue. It needs the device, the VMA allocator and the graphics queue.
+        void InitUploadManager(VkDeviceSize ringByteCnt = 64 * 1024 * 1024);
+
         // CreateXXX(...) functions are more flexible. They are utility functions for children classes.
         // CreateXXX(...) cannot initialize any member objects. They have to return objects.
         VkShaderModule                       CreateShaderModule(const std::string& spvName);
@@ -228,11 +249,14 @@ namespace SharedLib
         VkDevice         m_device;
         unsigned int     m_graphicsQueueFamilyIdx;
         VkQueue          m_graphicsQueue;
+        unsigned int     m_transferQueueFamilyIdx;
+        VkQueue          m_transferQueue;
         VkCommandPool    m_gfxCmdPool;
         
         VkDebugUtilsMessengerEXT     m_debugMessenger;
         VmaAllocator*                m_pAllocator;
         std::vector<VkCommandBuffer> m_gfxCmdBufs;
+        UploadManager*               m_pUploadManager;
 
         std::vector<void*> m_heapMemPtrVec; // Manage heap memory -- Auto delete at the end.
         std::vector<void*> m_heapArrayMemPtrVec;
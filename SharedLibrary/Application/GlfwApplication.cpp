@@ -39,6 +39,8 @@ namespace SharedLib
         m_swapchainImgCnt(0),
         // m_swapchainNextImgId(0),
         m_acqSwapchainImgIdx(0),
+        m_submittedFrameCnt(0),
+        m_completedFrameCnt(0),
         m_gammaCorrectionPipeline(),
         m_gammaCorrectionVsShaderModule(VK_NULL_HANDLE),
         m_gammaCorrectionPsShaderModule(VK_NULL_HANDLE),
@@ -149,6 +151,7 @@ namespace SharedLib
         }
 
         WaitTheFence(m_inFlightFences[m_acqSwapchainImgIdx]);
+        m_completedFrameCnt = std::max(m_completedFrameCnt, m_inFlightFrameNums[m_acqSwapchainImgIdx]);
 
         // Reset unused previous frame's resource
         vkResetFences(m_device, 1, &m_inFlightFences[m_acqSwapchainImgIdx]);
@@ -183,6 +186,8 @@ namespace SharedLib
             submitInfo.pSignalSemaphores = &m_renderFinishedSemaphores[m_acqSwapchainImgIdx];
         }
         VK_CHECK(vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFences[m_acqSwapchainImgIdx]));
+        m_submittedFrameCnt++;
+        m_inFlightFrameNums[m_acqSwapchainImgIdx] = m_submittedFrameCnt;
 
         // Put the swapchain into the present info and wait for the graphics queue previously before presenting.
         VkPresentInfoKHR presentInfo{};
@@ -229,6 +234,7 @@ namespace SharedLib
         // Create Sync objects
         m_renderFinishedSemaphores.resize(m_swapchainImgCnt);
         m_inFlightFences.resize(m_swapchainImgCnt);
+        m_inFlightFrameNums.assign(m_swapchainImgCnt, 0);
 
         VkSemaphoreCreateInfo semaphoreInfo{};
         {
@@ -544,6 +550,7 @@ namespace SharedLib
         }
 
         vkDeviceWaitIdle(m_device);
+        m_completedFrameCnt = m_submittedFrameCnt;
         CleanupSwapchain();
         InitSwapchain();
     }
@@ -40,6 +40,13 @@ namespace SharedLib
 
         int GetSwapchainImgCnt() { return m_swapchainImgCnt; }
 
+        // The frames' timeline. Every submitted frame gets the next number, starting from 1. A frame is completed once
+        // its in flight fence, or any later one, has been waited, since the fence also covers the earlier submissions
+        // to the graphics queue. A resource that the submitted frames use can be freed once the completed count reaches
+        // the submitted count at its last use.
+        uint64_t GetSubmittedFrameCnt() { return m_submittedFrameCnt; }
+        uint64_t GetCompletedFrameCnt() { return m_completedFrameCnt; }
+
         void CmdSwapchainColorImgLayoutTrans(VkCommandBuffer      cmdBuffer,
                                              VkImageLayout        oldLayout,
                                              VkImageLayout        newLayout,
@@ -110,6 +117,9 @@ namespace SharedLib
         // std::vector<VkSemaphore> m_imageAvailableSemaphores;
         std::vector<VkSemaphore> m_renderFinishedSemaphores;
         std::vector<VkFence>     m_inFlightFences;
+        std::vector<uint64_t>    m_inFlightFrameNums; // The number of the frame last submitted with each fence.
+        uint64_t                 m_submittedFrameCnt;
+        uint64_t                 m_completedFrameCnt;
 
         // Deferred rendering requires final gamma correction, which can be put into the glfw application as util.
         SharedLib::Pipeline   m_gammaCorrectionPipeline;
@@ -3,61 +3,1414 @@
 #include "../Utils/StrPathUtils.h"
 #include "../Utils/GltfUtils.h"
 #include "../Utils/MathUtils.h"
+#include "../Utils/ThreadUtils.h"
+#include "../Utils/DiskOpsUtils.h"
+#include "../MeshProcessing/MeshTangentSpace.h"
+#include "../MeshProcessing/MeshOptimizer.h"
+#include "../MeshProcessing/MeshWeld.h"
+#include "../MeshProcessing/MeshLod.h"
+#include "CookedAssetCache.h"
+#include "AsyncTextureDecoder.h"
+#include "TextureBaker.h"
+#include "ObjParser.h"
 #include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <set>
 
 #define TINYGLTF_IMPLEMENTATION
 #include "tiny_gltf.h"
+#include "stb_image.h"
 
 namespace SharedLib
 {
+    // The texel source ids of the default textures, which all the primitives share. The gltf textures' ids are hashes,
+    // see the MakeGltfTexSrcId(...), and never this small.
+    static const uint64_t DefaultTexSrcIds[MESH_TEX_CNT] = { 1, 2, 3, 4 };
+    static const uint64_t MinGltfTexSrcId = 16;
+
+    // ================================================================================================================
+    // The defaults are 1x1 textures in the slots' uncompressed formats, see the MeshPrimitive::GetTexFormat(...). Every
+    // primitive references the same images.
+    static void SetDefaultBaseColorTex(
+        MeshPrimitive& meshPrimitive)
+    {
+        static const std::shared_ptr<const ImgInfo> defaultTex = []() {
+            auto tex = std::make_shared<ImgInfo>();
+            tex->pixHeight = 1;
+            tex->pixWidth = 1;
+            tex->componentCnt = 4;
+            tex->dataVec = std::vector<uint8_t>(4, 255);
+            return tex;
+        }();
+        meshPrimitive.SetCpuTex(MESH_TEX_BASE_COLOR, defaultTex, DefaultTexSrcIds[MESH_TEX_BASE_COLOR]);
+    }
+
+    // ================================================================================================================
+    // No occlusion, full roughness and no metalness.
+    static void SetDefaultOrmTex(
+        MeshPrimitive& meshPrimitive)
+    {
+        static const std::shared_ptr<const ImgInfo> defaultTex = []() {
+            auto tex = std::make_shared<ImgInfo>();
+            PackOrmImage(nullptr, nullptr, *tex);
+            return tex;
+        }();
+        meshPrimitive.SetCpuTex(MESH_TEX_ORM, defaultTex, DefaultTexSrcIds[MESH_TEX_ORM]);
+    }
+
+    // ================================================================================================================
+    // The flat tangent space normal (0, 0, 1). Its z is rebuilt in the shaders.
+    static void SetDefaultNormalTex(
+        MeshPrimitive& meshPrimitive)
+    {
+        static const std::shared_ptr<const ImgInfo> defaultTex = []() {
+            auto tex = std::make_shared<ImgInfo>();
+            tex->pixHeight = 1;
+            tex->pixWidth = 1;
+            tex->componentCnt = 2;
+            tex->dataVec = { 128, 128 };
+            return tex;
+        }();
+        meshPrimitive.SetCpuTex(MESH_TEX_NORMAL, defaultTex, DefaultTexSrcIds[MESH_TEX_NORMAL]);
+    }
+
+    // ================================================================================================================
+    // The images keep their encoded bytes through the parse, see the KeepEncodedGltfImage(...), and are decoded here to
+    // 8 bits RGBA.
+    static void ReadOutGltfImage(
+        const tinygltf::Model& model,
+        int                    imgIdx,
+        ImgInfo&               oImgInfo)
+    {
+        const auto& img = model.images[imgIdx];
+
+        int width = 0;
+        int height = 0;
+        int componentCnt = 0;
+        stbi_uc* pPixels = stbi_load_from_memory(img.image.data(), img.image.size(), &width, &height, &componentCnt, 4);
+        ASSERT(pPixels != nullptr, "Failed to decode a gltf image.");
+
+        oImgInfo.pixWidth     = width;
+        oImgInfo.pixHeight    = height;
+        oImgInfo.componentCnt = 4;
+        oImgInfo.dataVec.assign(pPixels, pPixels + 4 * width * height);
+        stbi_image_free(pPixels);
+    }
+
+    // ================================================================================================================
+    // A texture is defined by an image index, denoted by the source property and a sampler index (sampler). -1 for no
+    // texture.
+    static int GetGltfTexImgIdx(
+        const tinygltf::Model& model,
+        int                    texIdx)
+    {
+        return (texIdx == -1) ? -1 : model.textures[texIdx].source;
+    }
+
+    // ================================================================================================================
+    static VkSamplerAddressMode GetGltfWrapAddressMode(
+        int wrap)
+    {
+        switch (wrap)
+        {
+        case TINYGLTF_TEXTURE_WRAP_CLAMP_TO_EDGE:
+            return VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        case TINYGLTF_TEXTURE_WRAP_MIRRORED_REPEAT:
+            return VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT;
+        default:
+            return VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        }
+    }
+
+    // ================================================================================================================
+    // The texture's sampler. The default sampler for no texture, no sampler or the undefined filters.
+    static TexSamplerDesc GetGltfTexSamplerDesc(
+        const tinygltf::Model& model,
+        int                    texIdx)
+    {
+        TexSamplerDesc desc{};
+        if ((texIdx == -1) || (model.textures[texIdx].sampler == -1))
+        {
+            return desc;
+        }
+
+        const auto& sampler = model.samplers[model.textures[texIdx].sampler];
+        desc.addressModeU = GetGltfWrapAddressMode(sampler.wrapS);
+        desc.addressModeV = GetGltfWrapAddressMode(sampler.wrapT);
+
+        if (sampler.magFilter == TINYGLTF_TEXTURE_FILTER_NEAREST)
+        {
+            desc.magFilter = VK_FILTER_NEAREST;
+        }
+
+        switch (sampler.minFilter)
+        {
+        case TINYGLTF_TEXTURE_FILTER_NEAREST:
+            desc.minFilter = VK_FILTER_NEAREST;
+            desc.useMips = 0;
+            break;
+        case TINYGLTF_TEXTURE_FILTER_LINEAR:
+            desc.useMips = 0;
+            break;
+        case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST:
+            desc.minFilter = VK_FILTER_NEAREST;
+            desc.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+            break;
+        case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_NEAREST:
+            desc.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+            break;
+        case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR:
+            desc.minFilter = VK_FILTER_NEAREST;
+            break;
+        default:
+            break;
+        }
+        return desc;
+    }
+
+    // The gltf images of a primitive's texture slots, which are baked once all the primitives are decoded. -1 for none.
+    // The imgIdxs[MESH_TEX_ORM] is the metallic roughness image and the occlusionImgIdx is packed with it.
+    struct GltfTexImgRefs
+    {
+        MeshPrimitive* pMeshPrimitive;
+        int            imgIdxs[MESH_TEX_CNT];
+        int            occlusionImgIdx;
+    };
+
+    // ================================================================================================================
+    // False if the slot keeps its default texture.
+    static bool GetGltfTexSlotImgs(
+        const GltfTexImgRefs& refs,
+        MeshTexSlot           slot,
+        int&                  oImgIdx,
+        int&                  oOcclusionImgIdx)
+    {
+        oImgIdx = refs.imgIdxs[slot];
+        oOcclusionImgIdx = (slot == MESH_TEX_ORM) ? refs.occlusionImgIdx : -1;
+        return (oImgIdx >= 0) || (oOcclusionImgIdx >= 0);
+    }
+
+    // ================================================================================================================
+    // The texel source id of a slot's baked gltf images, see the TextureCache. The slot is part of it because it
+    // selects the bake, see the GetTexBakeDesc(...).
+    static uint64_t MakeGltfTexSrcId(
+        uint64_t    assetHash,
+        MeshTexSlot slot,
+        int         imgIdx,
+        int         occlusionImgIdx)
+    {
+        uint64_t imgBits = ((uint64_t)slot << 48) |
+                           ((uint64_t)(uint32_t)(occlusionImgIdx + 1) << 24) |
+                           (uint64_t)(uint32_t)(imgIdx + 1);
+        uint64_t srcId = assetHash ^ (imgBits * 0x9E3779B97F4A7C15ull);
+        return (srcId < MinGltfTexSrcId) ? (srcId + MinGltfTexSrcId) : srcId;
+    }
+
+    // ================================================================================================================
+    // Decodes the slot's gltf images to RGBA8 and bakes them. An ORM is packed first, unless its occlusion is the
+    // metallic roughness image's own red channel.
+    static void BakeGltfTexture(
+        const tinygltf::Model&     model,
+        const AssetsLoaderOptions& options,
+        MeshTexSlot                slot,
+        int                        imgIdx,
+        int                        occlusionImgIdx,
+        ThreadPool*                pThreadPool,
+        ImgInfo&                   oImg)
+    {
+        ImgInfo decodedImg;
+        if ((slot != MESH_TEX_ORM) || (occlusionImgIdx == imgIdx))
+        {
+            ReadOutGltfImage(model, imgIdx, decodedImg);
+        }
+        else
+        {
+            ImgInfo decodedOcclusion;
+            ImgInfo decodedMetallicRoughness;
+            if (occlusionImgIdx != -1)
+            {
+                ReadOutGltfImage(model, occlusionImgIdx, decodedOcclusion);
+            }
+            if (imgIdx != -1)
+            {
+                ReadOutGltfImage(model, imgIdx, decodedMetallicRoughness);
+            }
+
+            PackOrmImage((occlusionImgIdx != -1) ? &decodedOcclusion : nullptr,
+                         (imgIdx != -1) ? &decodedMetallicRoughness : nullptr,
+                         decodedImg);
+        }
+
+        BakeTexture(decodedImg.dataVec.data(),
+                    decodedImg.pixWidth,
+                    decodedImg.pixHeight,
+                    GetTexBakeDesc(options, slot),
+                    pThreadPool,
+                    oImg);
+    }
+
+    // ================================================================================================================
+    // The synchronous texture load. Every distinct texture of the primitives is baked once, the textures in parallel,
+    // and shared by all the slots that use it.
+    static void BakeGltfTextures(
+        const tinygltf::Model&             model,
+        const AssetsLoaderOptions&         options,
+        uint64_t                           assetHash,
+        ThreadPool*                        pThreadPool,
+        LoadProfiler*                      pProfiler,
+        const std::vector<GltfTexImgRefs>& texImgRefs)
+    {
+        struct TexBake
+        {
+            MeshTexSlot slot;
+            int         imgIdx;
+            int         occlusionImgIdx;
+            ImgInfo     img;
+        };
+
+        std::vector<TexBake>         bakes;
+        std::map<uint64_t, uint32_t> bakeIdxs; // <Texel source id, bake idx>.
+        uint32_t                     slotCnt = 0;
+        for (const auto& refs : texImgRefs)
+        {
+            for (uint32_t slot = 0; slot < MESH_TEX_CNT; slot++)
+            {
+                int imgIdx = -1;
+                int occlusionImgIdx = -1;
+                if (GetGltfTexSlotImgs(refs, (MeshTexSlot)slot, imgIdx, occlusionImgIdx))
+                {
+                    uint64_t srcId = MakeGltfTexSrcId(assetHash, (MeshTexSlot)slot, imgIdx, occlusionImgIdx);
+                    auto     bakeItr = bakeIdxs.find(srcId);
+                    if (bakeItr == bakeIdxs.end())
+                    {
+                        bakeItr = bakeIdxs.insert({ srcId, (uint32_t)bakes.size() }).first;
+                        bakes.push_back({ (MeshTexSlot)slot, imgIdx, occlusionImgIdx, ImgInfo{} });
+                    }
+                    slotCnt++;
+                }
+            }
+        }
+
+        const auto bakeStart = std::chrono::high_resolution_clock::now();
+        pThreadPool->ParallelFor(bakes.size(), [&](uint32_t bakeIdx) {
+            TexBake& bake = bakes[bakeIdx];
+
+            // The bytes are the encoded images'.
+            uint64_t encodedByteCnt = (bake.imgIdx != -1) ? model.images[bake.imgIdx].image.size() : 0;
+            if ((bake.occlusionImgIdx != -1) && (bake.occlusionImgIdx != bake.imgIdx))
+            {
+                encodedByteCnt += model.images[bake.occlusionImgIdx].image.size();
+            }
+
+            ScopedLoadPhase phase(pProfiler, LOAD_PHASE_IMAGE_DECODE, encodedByteCnt);
+            BakeGltfTexture(model, options, bake.slot, bake.imgIdx, bake.occlusionImgIdx, pThreadPool, bake.img);
+        });
+        const auto bakeEnd = std::chrono::high_resolution_clock::now();
+
+        const auto bakeDuration = std::chrono::duration_cast<std::chrono::milliseconds>(bakeEnd - bakeStart);
+        printf("Baking %d distinct textures for %d texture slots takes %d ms\n",
+               (int)bakes.size(), (int)slotCnt, (int)bakeDuration.count());
+
+        std::vector<std::shared_ptr<const ImgInfo>> bakedTexs(bakes.size());
+        for (uint32_t bakeIdx = 0; bakeIdx < bakes.size(); bakeIdx++)
+        {
+            bakedTexs[bakeIdx] = std::make_shared<const ImgInfo>(std::move(bakes[bakeIdx].img));
+        }
+
+        for (const auto& refs : texImgRefs)
+        {
+            for (uint32_t slot = 0; slot < MESH_TEX_CNT; slot++)
+            {
+                int imgIdx = -1;
+                int occlusionImgIdx = -1;
+                if (GetGltfTexSlotImgs(refs, (MeshTexSlot)slot, imgIdx, occlusionImgIdx))
+                {
+                    uint64_t srcId = MakeGltfTexSrcId(assetHash, (MeshTexSlot)slot, imgIdx, occlusionImgIdx);
+                    refs.pMeshPrimitive->SetCpuTex((MeshTexSlot)slot, bakedTexs[bakeIdxs[srcId]], srcId);
+                }
+            }
+        }
+    }
+
+    // ================================================================================================================
+    // The image loader of the TinyGltf. It keeps the encoded bytes in the image and only reads the header for the size,
+    // so the images are decoded on the workers instead of in the parse. They are always decoded to 4 bytes per pixel.
+    static bool KeepEncodedGltfImage(
+        tinygltf::Image*     pImage,
+        const int            imageIdx,
+        std::string*         pErr,
+        std::string*         pWarn,
+        int                  reqWidth,
+        int                  reqHeight,
+        const unsigned char* pBytes,
+        int                  size,
+        void*                pUserData)
+    {
+        int width = 0;
+        int height = 0;
+        int componentCnt = 0;
+        if (stbi_info_from_memory(pBytes, size, &width, &height, &componentCnt) == 0)
+        {
+            if (pErr != nullptr)
+            {
+                *pErr += "Unknown image format of the image " + std::to_string(imageIdx) + ".\n";
+            }
+            return false;
+        }
+
+        pImage->width      = width;
+        pImage->height     = height;
+        pImage->component  = 4;
+        pImage->bits       = 8;
+        pImage->pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+        pImage->image.assign(pBytes, pBytes + size);
+        return true;
+    }
+
+    // ================================================================================================================
+    // The external files of the buffers and images, relative to the gltf's directory. The embedded data uris and the
+    // glb's own chunk don't have a file.
+    static std::vector<std::string> GetGltfDepUris(
+        const tinygltf::Model& model)
+    {
+        std::vector<std::string> uris;
+        auto addUri = [&uris](const std::string& uri) {
+            if (uri.empty() || (uri.compare(0, 5, "data:") == 0))
+            {
+                return;
+            }
+
+            std::string decodedUri;
+            uris.push_back(tinygltf::URIDecode(uri, &decodedUri, nullptr) ? decodedUri : uri);
+        };
+
+        for (const auto& buffer : model.buffers)
+        {
+            addUri(buffer.uri);
+        }
+
+        for (const auto& image : model.images)
+        {
+            addUri(image.uri);
+        }
+        return uris;
+    }
+
+    // ================================================================================================================
+    // Bake a node's model matrix into the primitive's geometry, so every node referencing a mesh gets its own copy of
+    // the geometry in the world space. The normal is transformed by the cofactor matrix of the upper 3x3, which is the
+    // inverse transpose scaled by the determinant, and mirrored transformations flip the tangent handedness.
+    static void ApplyModelMatToMeshPrimitive(
+        const float    modelMat[16],
+        MeshPrimitive& meshPrimitive)
+    {
+        const float identityMat[16] = {
+            1.f, 0.f, 0.f, 0.f,
+            0.f, 1.f, 0.f, 0.f,
+            0.f, 0.f, 1.f, 0.f,
+            0.f, 0.f, 0.f, 1.f
+        };
+
+        if (memcmp(modelMat, identityMat, sizeof(identityMat)) == 0)
+        {
+            return;
+        }
+
+        const float* m = modelMat;
+        float cofactor[9] = {
+            m[5] * m[10] - m[6] * m[9], m[6] * m[8] - m[4] * m[10], m[4] * m[9] - m[5] * m[8],
+            m[2] * m[9] - m[1] * m[10], m[0] * m[10] - m[2] * m[8], m[1] * m[8] - m[0] * m[9],
+            m[1] * m[6] - m[2] * m[5],  m[2] * m[4] - m[0] * m[6],  m[0] * m[5] - m[1] * m[4]
+        };
+        float det = m[0] * cofactor[0] + m[1] * cofactor[1] + m[2] * cofactor[2];
+        float handedness = det < 0.f ? -1.f : 1.f;
+
+        uint32_t vertCnt = meshPrimitive.m_posData.size() / 3;
+        for (uint32_t i = 0; i < vertCnt; i++)
+        {
+            float* pPos = &meshPrimitive.m_posData[3 * i];
+            float pos[3] = { pPos[0], pPos[1], pPos[2] };
+            for (uint32_t row = 0; row < 3; row++)
+            {
+                pPos[row] = m[4 * row] * pos[0] + m[4 * row + 1] * pos[1] + m[4 * row + 2] * pos[2] + m[4 * row + 3];
+            }
+
+            float* pNormal = &meshPrimitive.m_normalData[3 * i];
+            float normal[3] = { pNormal[0], pNormal[1], pNormal[2] };
+            for (uint32_t row = 0; row < 3; row++)
+            {
+                pNormal[row] = handedness * (cofactor[3 * row] * normal[0] +
+                                             cofactor[3 * row + 1] * normal[1] +
+                                             cofactor[3 * row + 2] * normal[2]);
+            }
+            NormalizeVec(pNormal, 3);
+
+            float* pTangent = &meshPrimitive.m_tangentData[4 * i];
+            float tangent[3] = { pTangent[0], pTangent[1], pTangent[2] };
+            for (uint32_t row = 0; row < 3; row++)
+            {
+                pTangent[row] = m[4 * row] * tangent[0] + m[4 * row + 1] * tangent[1] + m[4 * row + 2] * tangent[2];
+            }
+            NormalizeVec(pTangent, 3);
+            pTangent[3] *= handedness;
+        }
+    }
+
+    // ================================================================================================================
+    // Tightly packed accessors with the expected component type are copied out of the gltf buffer in one go. Others
+    // need a conversion or de-interleave, which the ReadOutAccessorData(...) handles.
+    template<typename T>
+    static void CopyAccessorData(
+        const tinygltf::Model&    model,
+        const tinygltf::Accessor& accessor,
+        std::vector<T>&           oData)
+    {
+        AccessorView<T> view = GetAccessorView<T>(accessor, model.bufferViews, model.buffers);
+        if (view.IsValid())
+        {
+            oData.assign(view.begin(), view.end());
+        }
+        else
+        {
+            oData.resize(uint64_t(accessor.count) * GetComponentEleCnt(accessor.type));
+            ReadOutAccessorData(oData.data(), accessor, model.bufferViews, model.buffers);
+        }
+    }
+
+    // ================================================================================================================
+    // The float attributes may be quantized (KHR_mesh_quantization), e.g. normalized short positions or byte normals.
+    // They are converted into float here, so the rest of the SharedLib only deals with float attributes.
+    static void CopyAccessorDataAsFloat(
+        const tinygltf::Model&    model,
+        const tinygltf::Accessor& accessor,
+        std::vector<float>&       oData)
+    {
+        if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+        {
+            CopyAccessorData(model, accessor, oData);
+        }
+        else
+        {
+            oData.resize(uint64_t(accessor.count) * GetComponentEleCnt(accessor.type));
+            ReadOutAccessorDataAsFloat(oData.data(), accessor, model.bufferViews, model.buffers);
+        }
+    }
+
+    // ================================================================================================================
+    // Applies a vertex remap table, from the OptimizeVertexFetchRemap() or the GenerateWeldRemap(), to all the
+    // primitive's vertex data.
+    static void RemapMeshPrimitiveVertices(
+        const std::vector<uint32_t>& remap,
+        uint32_t                     newVertCnt,
+        MeshPrimitive&               meshPrimitive)
+    {
+        std::vector<float>* vertData[4] = { &meshPrimitive.m_posData,
+                                            &meshPrimitive.m_normalData,
+                                            &meshPrimitive.m_tangentData,
+                                            &meshPrimitive.m_texCoordData };
+        const uint32_t compCnts[4] = { 3, 3, 4, 2 };
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            std::vector<float> remappedData(newVertCnt * compCnts[i]);
+            RemapVertexData(vertData[i]->data(), remap.size(), compCnts[i], remap.data(), remappedData.data());
+            *vertData[i] = std::move(remappedData);
+        }
+    }
+
+    // ================================================================================================================
+    // Merges the duplicated vertices of the primitive and rewrites the indices to the merged vertices.
+    static void WeldMeshPrimitive(
+        const AssetsLoaderOptions& options,
+        std::vector<uint32_t>&     indices,
+        MeshPrimitive&             meshPrimitive)
+    {
+        uint32_t vertCnt = meshPrimitive.m_posData.size() / 3;
+
+        WeldStream streams[4] = {};
+        streams[0].pData   = meshPrimitive.m_posData.data();
+        streams[0].compCnt = 3;
+        streams[0].epsilon = options.weldPosEpsilon;
+        streams[1].pData   = meshPrimitive.m_normalData.data();
+        streams[1].compCnt = 3;
+        streams[1].epsilon = options.weldNormalEpsilon;
+        streams[2].pData   = meshPrimitive.m_tangentData.data();
+        streams[2].compCnt = 4;
+        streams[2].epsilon = options.weldNormalEpsilon;
+        streams[3].pData   = meshPrimitive.m_texCoordData.data();
+        streams[3].compCnt = 2;
+        streams[3].epsilon = options.weldUvEpsilon;
+
+        std::vector<uint32_t> remap(vertCnt);
+        uint32_t weldedVertCnt = GenerateWeldRemap(streams, 4, vertCnt, indices.data(), indices.size(), remap.data());
+        if (weldedVertCnt == vertCnt)
+        {
+            return;
+        }
+
+        RemapIndices(indices.data(), indices.size(), remap.data(), indices.data());
+        RemapMeshPrimitiveVertices(remap, weldedVertCnt, meshPrimitive);
+    }
+
+    // ================================================================================================================
+    // Runs the vertex cache, overdraw and vertex fetch optimizations on a triangle list primitive. The indices are
+    // the widened indices that are later stored by the SetIndices(), and the vertex data is remapped in place.
+    static void OptimizeMeshPrimitive(
+        std::vector<uint32_t>& indices,
+        MeshPrimitive&         meshPrimitive,
+        VertexCacheStats&      oStatsBefore,
+        VertexCacheStats&      oStatsAfter)
+    {
+        uint32_t vertCnt = meshPrimitive.m_posData.size() / 3;
+        oStatsBefore = AnalyzeVertexCache(indices.data(), indices.size(), vertCnt);
+
+        std::vector<uint32_t> cacheOptIndices(indices.size());
+        OptimizeVertexCache(indices.data(), indices.size(), vertCnt, cacheOptIndices.data());
+
+        // 1.05 trades at most 5% of the vertex cache efficiency for the overdraw.
+        OptimizeOverdraw(cacheOptIndices.data(),
+                         cacheOptIndices.size(),
+                         meshPrimitive.m_posData.data(),
+                         vertCnt,
+                         1.05f,
+                         indices.data());
+
+        std::vector<uint32_t> remap(vertCnt);
+        uint32_t newVertCnt = OptimizeVertexFetchRemap(indices.data(), indices.size(), vertCnt, remap.data());
+        RemapIndices(indices.data(), indices.size(), remap.data(), indices.data());
+        RemapMeshPrimitiveVertices(remap, newVertCnt, meshPrimitive);
+
+        oStatsAfter = AnalyzeVertexCache(indices.data(), indices.size(), newVertCnt);
+    }
+
+    // ================================================================================================================
+    // The loader independent part of a primitive's decoding, once its attributes and widened indices are in place. The
+    // optimizations, the LODs and the meshlets only run on triangle lists.
+    static void FinishMeshPrimitiveGeometry(
+        const AssetsLoaderOptions& options,
+        bool                       isTriangleList,
+        std::vector<uint32_t>&     indices,
+        MeshPrimitive&             meshPrimitive,
+        VertexCacheStats&          oStatsBefore,
+        VertexCacheStats&          oStatsAfter)
+    {
+        // Welding runs on the final attributes, so vertices that only differ by the generated data stay apart.
+        if (options.weldVertices)
+        {
+            WeldMeshPrimitive(options, indices, meshPrimitive);
+        }
+
+        if (options.optimizeMeshes && isTriangleList)
+        {
+            OptimizeMeshPrimitive(indices, meshPrimitive, oStatsBefore, oStatsAfter);
+        }
+
+        // The world sphere is the same until the instances of an instanced mesh replace it.
+        ComputeBoundingSphere(meshPrimitive.m_posData.data(),
+                              meshPrimitive.m_posData.size() / 3,
+                              meshPrimitive.m_boundingSphere);
+        memcpy(meshPrimitive.m_worldBoundingSphere,
+               meshPrimitive.m_boundingSphere,
+               sizeof(meshPrimitive.m_boundingSphere));
+
+        // The levels share the optimized vertices. The meshlets below are only built for the level 0.
+        if (options.buildLods && isTriangleList)
+        {
+            std::vector<uint32_t> lodIndices;
+            BuildMeshLodChain(indices.data(),
+                              indices.size(),
+                              meshPrimitive.m_posData.data(),
+                              meshPrimitive.m_normalData.data(),
+                              meshPrimitive.m_texCoordData.data(),
+                              meshPrimitive.m_posData.size() / 3,
+                              options.maxLodCnt,
+                              options.lodRatio,
+                              options.lodMaxRelError,
+                              lodIndices,
+                              meshPrimitive.m_lods);
+            meshPrimitive.SetIndices(lodIndices, options.allowUint8Indices);
+        }
+        else
+        {
+            meshPrimitive.SetIndices(indices, options.allowUint8Indices);
+        }
+
+        if (options.buildMeshlets && isTriangleList)
+        {
+            BuildMeshlets(indices.data(),
+                          indices.size(),
+                          meshPrimitive.m_posData.data(),
+                          meshPrimitive.m_posData.size() / 3,
+                          options.maxMeshletVerts,
+                          options.maxMeshletTris,
+                          meshPrimitive.m_meshletData);
+
+#ifndef NDEBUG
+            // The debug builds check the coverage, the limits, the indices, the spheres and the cones of every loaded
+            // primitive's meshlets, since a bad one only shows up as missing or wrongly culled triangles.
+            bool isMeshletDataValid = ValidateMeshlets(meshPrimitive.m_meshletData,
+                                                       indices.data(),
+                                                       indices.size(),
+                                                       meshPrimitive.m_posData.data(),
+                                                       meshPrimitive.m_posData.size() / 3,
+                                                       options.maxMeshletVerts,
+                                                       options.maxMeshletTris);
+            ASSERT(isMeshletDataValid, "The primitive's meshlets are invalid.");
+#endif
+        }
+    }
+
+    // ================================================================================================================
+    // The bytes of the primitive's float vertex attributes, for the load profiling.
+    static uint64_t GetMeshPrimitiveAttribByteCnt(
+        const MeshPrimitive& meshPrimitive)
+    {
+        uint64_t floatCnt = meshPrimitive.m_posData.size() +
+                            meshPrimitive.m_normalData.size() +
+                            meshPrimitive.m_texCoordData.size() +
+                            meshPrimitive.m_tangentData.size();
+        return floatCnt * sizeof(float);
+    }
+
+    // ================================================================================================================
+    // Unrolls a triangle strip or fan into a triangle list in place, with the winding that the glTF defines for them.
+    // Returns whether the indices are a triangle list afterwards, which the lines and the points are not.
+    static bool UnrollGltfTriangles(
+        int                    mode,
+        std::vector<uint32_t>& indices)
+    {
+        if ((mode == -1) || (mode == TINYGLTF_MODE_TRIANGLES))
+        {
+            return true;
+        }
+
+        if ((mode != TINYGLTF_MODE_TRIANGLE_STRIP) && (mode != TINYGLTF_MODE_TRIANGLE_FAN))
+        {
+            return false;
+        }
+
+        uint32_t triCnt = indices.size() >= 3 ? indices.size() - 2 : 0;
+        std::vector<uint32_t> triIndices(3 * triCnt);
+        for (uint32_t i = 0; i < triCnt; i++)
+        {
+            if (mode == TINYGLTF_MODE_TRIANGLE_STRIP)
+            {
+                // The odd triangles swap their last two vertices to keep the strip's winding.
+                triIndices[3 * i]     = indices[i];
+                triIndices[3 * i + 1] = indices[i + 1 + (i % 2)];
+                triIndices[3 * i + 2] = indices[i + 2 - (i % 2)];
+            }
+            else
+            {
+                triIndices[3 * i]     = indices[i + 1];
+                triIndices[3 * i + 1] = indices[i + 2];
+                triIndices[3 * i + 2] = indices[0];
+            }
+        }
+
+        indices.swap(triIndices);
+        return true;
+    }
+
+    // ================================================================================================================
+    // Decode one glTF primitive into the MeshPrimitive. It only reads the model, so it can run concurrently with other
+    // primitives' decoding.
+    static void LoadGltfMeshPrimitive(
+        const tinygltf::Model&     model,
+        const tinygltf::Primitive& primitive,
+        const float                modelMat[16],
+        const AssetsLoaderOptions& options,
+        MeshPrimitive&             meshPrimitive,
+        LoadProfiler*              pProfiler,
+        VertexCacheStats&          oStatsBefore,
+        VertexCacheStats&          oStatsAfter,
+        GltfTexImgRefs&            oTexImgRefs)
+    {
+        // All the accessors are read first and the missing attributes are generated after, so the two are profiled
+        // as separate phases.
+        ScopedLoadPhase accessorPhase(pProfiler, LOAD_PHASE_ACCESSOR_DECODE);
+
+        // Load pos
+        int posIdx = primitive.attributes.at("POSITION");
+        const auto& posAccessor = model.accessors[posIdx];
+
+        ASSERT(posAccessor.type == TINYGLTF_TYPE_VEC3, "The pos accessor type should be vec3.");
+
+        // The position is float3 or a quantized vec3 that is converted to float3.
+        CopyAccessorDataAsFloat(model, posAccessor, meshPrimitive.m_posData);
+
+        // Load indices. The gltf indices can be 8, 16 or 32 bits. They are widened here and the MeshPrimitive stores
+        // them in the narrowest type that fits. A non-indexed primitive gets a trivial index list, so every primitive
+        // can be drawn indexed.
+        std::vector<uint32_t> indices;
+        if (primitive.indices != -1)
+        {
+            const auto& idxAccessor = model.accessors[primitive.indices];
+            ASSERT(idxAccessor.type == TINYGLTF_TYPE_SCALAR, "The idx accessor type should be scalar.");
+
+            switch (idxAccessor.componentType)
+            {
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            {
+                std::vector<uint8_t> indicesUint8;
+                CopyAccessorData(model, idxAccessor, indicesUint8);
+                indices.assign(indicesUint8.begin(), indicesUint8.end());
+                break;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            {
+                std::vector<uint16_t> indicesUint16;
+                CopyAccessorData(model, idxAccessor, indicesUint16);
+                indices.assign(indicesUint16.begin(), indicesUint16.end());
+                break;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+                CopyAccessorData(model, idxAccessor, indices);
+                break;
+            default:
+                ASSERT(false, "The idx accessor data type should be uint8, uint16 or uint32.");
+            }
+        }
+        else
+        {
+            indices.resize(posAccessor.count);
+            std::iota(indices.begin(), indices.end(), 0);
+        }
+
+        // The pipelines only draw triangle lists, and the tangent space generation and the mesh processing read the
+        // indices as one, so the strips and the fans are unrolled. The lines and the points have no faces, so their
+        // missing normals and tangents get the generators' defaults.
+        const bool     isTriangleList = UnrollGltfTriangles(primitive.mode, indices);
+        const uint32_t faceIdxCnt = isTriangleList ? indices.size() : 0;
+
+        // Load normal
+        if (primitive.attributes.count("NORMAL") > 0)
+        {
+            int normalIdx = primitive.attributes.at("NORMAL");
+            const auto& normalAccessor = model.accessors[normalIdx];
+
+            ASSERT(normalAccessor.type == TINYGLTF_TYPE_VEC3, "The normal accessor type should be vec3.");
+
+            CopyAccessorDataAsFloat(model, normalAccessor, meshPrimitive.m_normalData);
+        }
+
+        // Load uv
+        if (primitive.attributes.count("TEXCOORD_0") > 0)
+        {
+            int uvIdx = primitive.attributes.at("TEXCOORD_0");
+            const auto& uvAccessor = model.accessors[uvIdx];
+
+            ASSERT(uvAccessor.type == TINYGLTF_TYPE_VEC2, "The uv accessor type should be vec2.");
+
+            CopyAccessorDataAsFloat(model, uvAccessor, meshPrimitive.m_texCoordData);
+        }
+
+        // Load tangent
+        if (primitive.attributes.count("TANGENT"))
+        {
+            int tangentIdx = primitive.attributes.at("TANGENT");
+            const auto& tangentAccessor = model.accessors[tangentIdx];
+
+            ASSERT(tangentAccessor.type == TINYGLTF_TYPE_VEC4, "The tangent accessor type should be vec4.");
+            ASSERT(tangentAccessor.count == posAccessor.count, "The tangent data count should be the same as the pos data count.");
+
+            CopyAccessorDataAsFloat(model, tangentAccessor, meshPrimitive.m_tangentData);
+        }
+
+        accessorPhase.SetByteCnt(GetMeshPrimitiveAttribByteCnt(meshPrimitive) + indices.size() * sizeof(uint32_t));
+        accessorPhase.End();
+
+        ScopedLoadPhase processingPhase(pProfiler, LOAD_PHASE_MESH_PROCESSING);
+        if (meshPrimitive.m_normalData.empty())
+        {
+            // Generate area weighted smooth normals from the triangles when the source doesn't have them.
+            meshPrimitive.m_normalData.resize(3 * posAccessor.count);
+            GenerateSmoothNormals(meshPrimitive.m_posData.data(),
+                                  posAccessor.count,
+                                  indices.data(),
+                                  faceIdxCnt,
+                                  meshPrimitive.m_normalData.data());
+        }
+
+        if (meshPrimitive.m_texCoordData.empty())
+        {
+            meshPrimitive.m_texCoordData = std::vector<float>(posAccessor.count * 2, 0.f);
+        }
+
+        if (meshPrimitive.m_tangentData.empty())
+        {
+            // Normal mapping needs a valid tangent frame, so generate it from the uvs. It runs before the model matrix
+            // is applied, which transforms the generated tangents together with the normals.
+            meshPrimitive.m_tangentData.resize(posAccessor.count * 4);
+            GenerateTangents(meshPrimitive.m_posData.data(),
+                             meshPrimitive.m_normalData.data(),
+                             meshPrimitive.m_texCoordData.data(),
+                             posAccessor.count,
+                             indices.data(),
+                             faceIdxCnt,
+                             meshPrimitive.m_tangentData.data());
+        }
+
+        ApplyModelMatToMeshPrimitive(modelMat, meshPrimitive);
+
+        FinishMeshPrimitiveGeometry(options, isTriangleList, indices, meshPrimitive, oStatsBefore, oStatsAfter);
+        processingPhase.SetByteCnt(GetMeshPrimitiveAttribByteCnt(meshPrimitive) + meshPrimitive.GetIdxByteCnt());
+
+        // Every slot starts with its default. The slots with a gltf texture only record its images here. The images are
+        // baked, or decoded asynchronously, once all the primitives are decoded, so each one is baked once however many
+        // primitives use it.
+        SetDefaultBaseColorTex(meshPrimitive);
+        SetDefaultOrmTex(meshPrimitive);
+        SetDefaultNormalTex(meshPrimitive);
+
+        // The baseColorFactor contains the red, green, blue, and alpha components of the main color of the material.
+        // No material, then we will create a pure white model.
+        int materialIdx = primitive.material;
+
+        if (materialIdx != -1)
+        {
+            const auto& material = model.materials[materialIdx];
+            // A texture binding is defined by an index of a texture object and an optional index of texture coordinates.
+            int baseColorTexIdx = material.pbrMetallicRoughness.baseColorTexture.index;
+            int metallicRoughnessTexIdx = material.pbrMetallicRoughness.metallicRoughnessTexture.index;
+            int occlusionTexIdx = material.occlusionTexture.index;
+            int normalTexIdx = material.normalTexture.index;
+            // material.emissiveTexture -- Let forget emissive. The renderer doesn't support emissive textures.
+
+            oTexImgRefs.imgIdxs[MESH_TEX_BASE_COLOR] = GetGltfTexImgIdx(model, baseColorTexIdx);
+
+            // The textures for metalness and roughness properties are packed together in a single texture called
+            // metallicRoughnessTexture. Its green channel contains roughness values and its blue channel contains
+            // metalness values. This texture MUST be encoded with linear transfer function and MAY use more than 8 bits
+            // per channel.
+            //
+            // The occlusion texture; it indicates areas that receive less indirect lighting from ambient sources.
+            // Direct lighting is not affected. The red channel of the texture encodes the occlusion value,
+            // where 0.0 means fully - occluded area(no indirect lighting) and 1.0 means not occluded area(full indirect lighting).
+            //
+            // Both end up in the one ORM texture, which is often already how the gltf stores them.
+            oTexImgRefs.imgIdxs[MESH_TEX_ORM] = GetGltfTexImgIdx(model, metallicRoughnessTexIdx);
+            oTexImgRefs.occlusionImgIdx = GetGltfTexImgIdx(model, occlusionTexIdx);
+
+            oTexImgRefs.imgIdxs[MESH_TEX_NORMAL] = GetGltfTexImgIdx(model, normalTexIdx);
+
+            // The ORM follows the metallic roughness' sampler, or the occlusion's without it.
+            meshPrimitive.m_texSamplers[MESH_TEX_BASE_COLOR] = GetGltfTexSamplerDesc(model, baseColorTexIdx);
+            int ormSamplerTexIdx = (metallicRoughnessTexIdx != -1) ? metallicRoughnessTexIdx : occlusionTexIdx;
+            meshPrimitive.m_texSamplers[MESH_TEX_ORM] = GetGltfTexSamplerDesc(model, ormSamplerTexIdx);
+            meshPrimitive.m_texSamplers[MESH_TEX_NORMAL] = GetGltfTexSamplerDesc(model, normalTexIdx);
+        }
+    }
+
+    // ================================================================================================================
+    // Grows the sphere to enclose the other sphere. Both are xyz center and w radius.
+    static void EncloseBoundingSphere(
+        float       sphere[4],
+        const float otherSphere[4])
+    {
+        float offset[3] = { otherSphere[0] - sphere[0], otherSphere[1] - sphere[1], otherSphere[2] - sphere[2] };
+        float dist = std::sqrt(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]);
+
+        if (dist + otherSphere[3] <= sphere[3])
+        {
+            return;
+        }
+
+        if (dist + sphere[3] <= otherSphere[3])
+        {
+            memcpy(sphere, otherSphere, 4 * sizeof(float));
+            return;
+        }
+
+        // Neither sphere contains the other, so the dist is positive. The new center is on the line between the two
+        // centers, halfway between their far ends.
+        float radius = 0.5f * (dist + sphere[3] + otherSphere[3]);
+        float shift = (radius - sphere[3]) / dist;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            sphere[c] += offset[c] * shift;
+        }
+        sphere[3] = radius;
+    }
+
+    // ================================================================================================================
+    // Copies the nodes' model matrices into the entity's instances. The primitives keep their geometry, their bounding
+    // spheres and their LOD errors in the mesh's space, so each instance can pick its own level.
+    static void InitMeshEntityInstances(
+        const std::vector<const float*>& instanceModelMats,
+        MeshEntity&                      meshEntity)
+    {
+        meshEntity.m_instanceMats.resize(instanceModelMats.size() * MeshEntity::InstanceMatFloatCnt);
+        for (uint32_t i = 0; i < instanceModelMats.size(); i++)
+        {
+            memcpy(&meshEntity.m_instanceMats[i * MeshEntity::InstanceMatFloatCnt],
+                   instanceModelMats[i],
+                   MeshEntity::InstanceMatFloatCnt * sizeof(float));
+        }
+
+        for (auto& meshPrimitive : meshEntity.m_meshPrimitives)
+        {
+            // The m_boundingSphere stays in the mesh's space for the LOD selection per instance. The world sphere
+            // encloses all the instances for the culling.
+            float enclosingSphere[4] = {};
+            for (uint32_t i = 0; i < instanceModelMats.size(); i++)
+            {
+                float instanceSphere[4];
+                TransformBoundingSphere(meshPrimitive.m_boundingSphere, instanceModelMats[i], instanceSphere);
+
+                if (i == 0)
+                {
+                    memcpy(enclosingSphere, instanceSphere, sizeof(instanceSphere));
+                }
+                else
+                {
+                    EncloseBoundingSphere(enclosingSphere, instanceSphere);
+                }
+            }
+            memcpy(meshPrimitive.m_worldBoundingSphere, enclosingSphere, sizeof(enclosingSphere));
+        }
+    }
+
+    // ================================================================================================================
+    // Depth first traversal, so the order of the output mesh nodes only depends on the gltf file.
+    static void CollectMeshNodes(
+        const tinygltf::Model& model,
+        int                    nodeIdx,
+        std::vector<int>&      oMeshNodeIdxs)
+    {
+        const auto& node = model.nodes[nodeIdx];
+        if (node.mesh != -1)
+        {
+            oMeshNodeIdxs.push_back(nodeIdx);
+        }
+
+        for (int childNodeIdx : node.children)
+        {
+            CollectMeshNodes(model, childNodeIdx, oMeshNodeIdxs);
+        }
+    }
+
+    // ================================================================================================================
+    // Turn every mesh node of the parsed model into a named MeshEntity.
+    static void DecodeGltfModel(
+        const tinygltf::Model&       model,
+        const AssetsLoaderOptions&   options,
+        ThreadPool*                  pThreadPool,
+        LoadProfiler*                pProfiler,
+        std::vector<std::string>&    oEntityNames,
+        std::vector<MeshEntity*>&    oMeshEntities,
+        std::vector<GltfTexImgRefs>& oTexImgRefs)
+    {
+        // Any node MAY contain one mesh, defined in its mesh property. Each node that references a mesh becomes
+        // a MeshEntity with the node's model matrix baked into its geometry, unless the mesh is instanced. A gltf
+        // without any scene just loads all its meshes in place.
+        std::vector<int>   meshNodeIdxs;
+        std::vector<float> nodesModelMats;
+        if (model.scenes.size() > 0)
+        {
+            int sceneIdx = model.defaultScene >= 0 ? model.defaultScene : 0;
+            for (int rootNodeIdx : model.scenes[sceneIdx].nodes)
+            {
+                CollectMeshNodes(model, rootNodeIdx, meshNodeIdxs);
+            }
+            SharedLib::GetNodesModelMats(model, nodesModelMats, sceneIdx);
+        }
+
+        std::vector<int>                       entityMeshIdxs;
+        std::vector<const float*>              entityModelMats;
+        std::vector<std::vector<const float*>> entityInstanceMats; // Only the instanced entities have any.
+        const float identityMat[16] = {
+            1.f, 0.f, 0.f, 0.f,
+            0.f, 1.f, 0.f, 0.f,
+            0.f, 0.f, 1.f, 0.f,
+            0.f, 0.f, 0.f, 1.f
+        };
+
+        if (model.scenes.size() > 0)
+        {
+            // A mesh referenced by several nodes becomes one entity in the mesh's space, created at its first node,
+            // and all its nodes' model matrices become the entity's instances.
+            std::vector<uint32_t> meshRefCnts(model.meshes.size(), 0);
+            std::vector<int>      meshInstancedEntityIdxs(model.meshes.size(), -1);
+            for (int nodeIdx : meshNodeIdxs)
+            {
+                meshRefCnts[model.nodes[nodeIdx].mesh]++;
+            }
+
+            for (int nodeIdx : meshNodeIdxs)
+            {
+                const auto& node = model.nodes[nodeIdx];
+                const auto& mesh = model.meshes[node.mesh];
+                std::string meshName = mesh.name.empty() ? "MeshEntity" : mesh.name;
+
+                if (options.instanceMeshes && (meshRefCnts[node.mesh] > 1))
+                {
+                    if (meshInstancedEntityIdxs[node.mesh] == -1)
+                    {
+                        meshInstancedEntityIdxs[node.mesh] = entityMeshIdxs.size();
+                        entityMeshIdxs.push_back(node.mesh);
+                        entityModelMats.push_back(identityMat);
+                        entityInstanceMats.emplace_back();
+                        oEntityNames.push_back(meshName + "_mesh" + std::to_string(node.mesh));
+                    }
+
+                    entityInstanceMats[meshInstancedEntityIdxs[node.mesh]].push_back(&nodesModelMats[nodeIdx * 16]);
+                    continue;
+                }
+
+                std::string name = node.name.empty() ? meshName : node.name;
+
+                entityMeshIdxs.push_back(node.mesh);
+                entityModelMats.push_back(&nodesModelMats[nodeIdx * 16]);
+                entityInstanceMats.emplace_back();
+                oEntityNames.push_back(name + "_" + std::to_string(nodeIdx));
+            }
+        }
+        else
+        {
+            for (int meshIdx = 0; meshIdx < model.meshes.size(); meshIdx++)
+            {
+                const auto& mesh = model.meshes[meshIdx];
+                entityMeshIdxs.push_back(meshIdx);
+                entityModelMats.push_back(identityMat);
+                entityInstanceMats.emplace_back();
+                oEntityNames.push_back((mesh.name.empty() ? "MeshEntity" : mesh.name) + "_" + std::to_string(meshIdx));
+            }
+        }
+
+        // https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#reference-mesh-primitive
+        // Meshes are defined as arrays of primitives. Primitives correspond to the data required for GPU draw calls.
+        // Primitives specify one or more attributes, corresponding to the vertex attributes used in the draw calls.
+        // The specification defines the following attribute semantics: POSITION, NORMAL, TANGENT, TEXCOORD_n, COLOR_n, JOINTS_n, and WEIGHTS_n.
+        //
+        // All the primitives of all the entities are flattened into one task list. Each task writes into its
+        // pre-allocated MeshPrimitive slot, so the result doesn't depend on the worker threads' scheduling.
+        oMeshEntities.resize(entityMeshIdxs.size());
+
+        std::vector<std::pair<uint32_t, uint32_t>> primitiveTasks; // <Entity idx, primitive idx>.
+        for (uint32_t entityIdx = 0; entityIdx < entityMeshIdxs.size(); entityIdx++)
+        {
+            const auto& mesh = model.meshes[entityMeshIdxs[entityIdx]];
+            oMeshEntities[entityIdx] = new MeshEntity();
+            oMeshEntities[entityIdx]->m_meshPrimitives.resize(mesh.primitives.size());
+
+            for (uint32_t primIdx = 0; primIdx < mesh.primitives.size(); primIdx++)
+            {
+                primitiveTasks.push_back({ entityIdx, primIdx });
+            }
+        }
+
+        std::vector<VertexCacheStats> statsBefore(primitiveTasks.size());
+        std::vector<VertexCacheStats> statsAfter(primitiveTasks.size());
+
+        oTexImgRefs.resize(primitiveTasks.size());
+        for (uint32_t taskIdx = 0; taskIdx < primitiveTasks.size(); taskIdx++)
+        {
+            uint32_t entityIdx = primitiveTasks[taskIdx].first;
+            uint32_t primIdx = primitiveTasks[taskIdx].second;
+            oTexImgRefs[taskIdx].pMeshPrimitive = &oMeshEntities[entityIdx]->m_meshPrimitives[primIdx];
+            std::fill(oTexImgRefs[taskIdx].imgIdxs, oTexImgRefs[taskIdx].imgIdxs + MESH_TEX_CNT, -1);
+            oTexImgRefs[taskIdx].occlusionImgIdx = -1;
+        }
+
+        const auto decodeStart = std::chrono::high_resolution_clock::now();
+        pThreadPool->ParallelFor(primitiveTasks.size(), [&](uint32_t taskIdx) {
+            uint32_t entityIdx = primitiveTasks[taskIdx].first;
+            uint32_t primIdx = primitiveTasks[taskIdx].second;
+
+            const auto& mesh = model.meshes[entityMeshIdxs[entityIdx]];
+            LoadGltfMeshPrimitive(model,
+                                  mesh.primitives[primIdx],
+                                  entityModelMats[entityIdx],
+                                  options,
+                                  oMeshEntities[entityIdx]->m_meshPrimitives[primIdx],
+                                  pProfiler,
+                                  statsBefore[taskIdx],
+                                  statsAfter[taskIdx],
+                                  oTexImgRefs[taskIdx]);
+        });
+        const auto decodeEnd = std::chrono::high_resolution_clock::now();
+
+        const auto decodeDuration = std::chrono::duration_cast<std::chrono::milliseconds>(decodeEnd - decodeStart);
+        printf("Decoding %d gltf primitives takes %d ms on %d threads\n",
+               (int)primitiveTasks.size(), (int)decodeDuration.count(), (int)pThreadPool->GetThreadCnt());
+
+        uint32_t instancedEntityCnt = 0;
+        uint32_t instanceCnt = 0;
+        for (uint32_t entityIdx = 0; entityIdx < entityInstanceMats.size(); entityIdx++)
+        {
+            if (entityInstanceMats[entityIdx].empty() == false)
+            {
+                InitMeshEntityInstances(entityInstanceMats[entityIdx], *oMeshEntities[entityIdx]);
+                instancedEntityCnt++;
+                instanceCnt += entityInstanceMats[entityIdx].size();
+            }
+        }
+
+        if (instancedEntityCnt > 0)
+        {
+            printf("Instancing %d shared gltf meshes as %d instances\n", (int)instancedEntityCnt, (int)instanceCnt);
+        }
+
+        if (options.optimizeMeshes)
+        {
+            // The whole asset's ratios, weighted by the primitives' triangle and vertex counts.
+            uint64_t triCnt = 0;
+            uint64_t vertCntBefore = 0;
+            uint64_t vertCntAfter = 0;
+            uint64_t transformedBefore = 0;
+            uint64_t transformedAfter = 0;
+            for (uint32_t i = 0; i < primitiveTasks.size(); i++)
+            {
+                triCnt += statsAfter[i].triCnt;
+                vertCntBefore += statsBefore[i].vertCnt;
+                vertCntAfter += statsAfter[i].vertCnt;
+                transformedBefore += statsBefore[i].transformedVertCnt;
+                transformedAfter += statsAfter[i].transformedVertCnt;
+            }
+
+            if ((triCnt > 0) && (vertCntBefore > 0) && (vertCntAfter > 0))
+            {
+                printf("Mesh optimization: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+                       (float)transformedBefore / triCnt, (float)transformedAfter / triCnt,
+                       (float)transformedBefore / vertCntBefore, (float)transformedAfter / vertCntAfter);
+            }
+        }
+    }
+
+    // ================================================================================================================
+    AssetsLoaderManager::AssetsLoaderManager(
+        const AssetsLoaderOptions& options)
+        : m_options(options)
+    {
+        m_pThreadPool = new ThreadPool(m_options.threadCnt);
+        m_pTextureDecoder = new AsyncTextureDecoder(m_pThreadPool, &m_loadProfiler);
+        m_pTexCache = new TextureCache();
+        m_pGeoArena = new GeometryArena();
+    }
+
     // ================================================================================================================
     AssetsLoaderManager::~AssetsLoaderManager()
     {
+        // The entities that weren't finalized only have their CPU data, e.g. an application copied the vertices out
+        // without creating the GPU resources. The decoding tasks and a deferred cooked asset write may still read them.
+        m_pTextureDecoder->DropPendingTexRefs();
+        m_pThreadPool->WaitIdle();
+        for (auto entity : m_entities)
+        {
+            delete entity;
+        }
+
+        delete m_pTextureDecoder;
+        delete m_pThreadPool;
+        delete m_pTexCache;
+        delete m_pGeoArena;
     }
 
     // ================================================================================================================
-    void AssetsLoaderManager::InitEntitesGpuRsrc(VkDevice        device,
-                                                 VmaAllocator*   pAllocator,
-                                                 VkCommandBuffer cmdBuffer,
-                                                 VkQueue         queue)
+    void AssetsLoaderManager::InitEntitesGpuRsrc(VkPhysicalDevice physicalDevice,
+                                                 VkDevice         device,
+                                                 VmaAllocator*    pAllocator,
+                                                 UploadManager*   pUploadManager)
     {
+        ScopedLoadPhase phase(&m_loadProfiler, LOAD_PHASE_GPU_UPLOAD);
+        m_pTexCache->Init(physicalDevice);
         for(auto entity : m_entities)
         {
-            entity->InitGpuRsrc(device, pAllocator, cmdBuffer, queue);
+            entity->InitGpuRsrc(device, pAllocator, pUploadManager);
+        }
+        pUploadManager->Flush();
+
+        // The manager only loads mesh entities. A texture that the cache shares is only uploaded once.
+        uint64_t           uploadByteCnt = 0;
+        std::set<uint64_t> texSrcIds;
+        for (auto entity : m_entities)
+        {
+            const MeshEntity* pMeshEntity = static_cast<const MeshEntity*>(entity);
+            uploadByteCnt += pMeshEntity->GetInstanceCnt() * MeshEntity::InstanceMatFloatCnt * sizeof(float);
+            for (const auto& meshPrimitive : pMeshEntity->m_meshPrimitives)
+            {
+                uploadByteCnt += meshPrimitive.m_vertData.size() + meshPrimitive.GetIdxByteCnt();
+
+                const MeshletData& meshletData = meshPrimitive.m_meshletData;
+                uploadByteCnt += meshletData.meshlets.size() * sizeof(Meshlet) +
+                                 meshletData.bounds.size() * sizeof(MeshletBounds) +
+                                 (meshletData.vertIndices.size() + meshletData.packedTris.size()) * sizeof(uint32_t);
+                for (uint32_t slot = 0; slot < MESH_TEX_CNT; slot++)
+                {
+                    const ImgInfo* pTex = meshPrimitive.GetTex((MeshTexSlot)slot);
+                    if ((pTex != nullptr) && texSrcIds.insert(meshPrimitive.m_texSrcIds[slot]).second)
+                    {
+                        uploadByteCnt += pTex->dataVec.size();
+                    }
+                }
+            }
         }
+        phase.SetByteCnt(uploadByteCnt);
+    }
+
+    // ================================================================================================================
+    uint32_t AssetsLoaderManager::UploadDecodedTextures(VkDevice       device,
+                                                        VmaAllocator*  pAllocator,
+                                                        UploadManager* pUploadManager,
+                                                        uint64_t       submittedFrameCnt,
+                                                        uint64_t       completedFrameCnt,
+                                                        uint32_t       maxTexCnt)
+    {
+        m_pTexCache->DestroyRetiredImgs(completedFrameCnt, device, pAllocator);
+        return m_pTextureDecoder->UploadDecodedTextures(device,
+                                                        pAllocator,
+                                                        pUploadManager,
+                                                        submittedFrameCnt,
+                                                        maxTexCnt);
     }
 
     // ================================================================================================================
     void AssetsLoaderManager::FinializeEntities(VkDevice      device,
                                                 VmaAllocator* pAllocator)
     {
+        // The decoding tasks and a deferred cooked asset write may still read the entities.
+        m_pTextureDecoder->DropPendingTexRefs();
+        m_pThreadPool->WaitIdle();
+
         for (auto entity : m_entities)
         {
             entity->Finialize(device, pAllocator);
             delete entity;
         }
+        m_entities.clear();
+
+        // The caller waited for the device, so the retired placeholders aren't in use anymore.
+        m_pTexCache->DestroyRetiredImgs(UINT64_MAX, device, pAllocator);
+        m_pTexCache->Finalize(device);
+        m_pGeoArena->Finalize(pAllocator);
+    }
+
+    // ================================================================================================================
+    bool AssetsLoaderManager::LoadCooked(const std::string&        absPath,
+                                         std::string&              oCookedPath,
+                                         uint64_t&                 oCookedKey,
+                                         std::vector<std::string>& oEntityNames,
+                                         std::vector<MeshEntity*>& oMeshEntities)
+    {
+        if (m_options.useCookedCache == false)
+        {
+            return false;
+        }
+
+        // The key covers the source content and the cooked file checks the source's dependencies, so a stale cooked
+        // file is just a miss.
+        ScopedLoadPhase phase(&m_loadProfiler, LOAD_PHASE_FILE_IO);
+        const auto cookedStart = std::chrono::high_resolution_clock::now();
+        oCookedPath = GetCookedAssetPath(absPath, m_options);
+        oCookedKey = ComputeCookedAssetKey(absPath, m_options);
+        bool isCookedLoaded = LoadCookedAsset(oCookedPath, oCookedKey, absPath, oEntityNames, oMeshEntities);
+        const auto cookedEnd = std::chrono::high_resolution_clock::now();
+
+        if (isCookedLoaded)
+        {
+            phase.SetByteCnt(std::filesystem::file_size(oCookedPath));
+
+            const auto cookedDuration = std::chrono::duration_cast<std::chrono::milliseconds>(cookedEnd - cookedStart);
+            printf("Loading the cooked asset %s takes %d ms\n", oCookedPath.c_str(), (int)cookedDuration.count());
+        }
+        return isCookedLoaded;
+    }
+
+    // ================================================================================================================
+    void AssetsLoaderManager::AddLoadedEntities(const std::vector<std::string>& entityNames,
+                                                const std::vector<MeshEntity*>& meshEntities,
+                                                Level&                          oLevel)
+    {
+        for (uint32_t entityIdx = 0; entityIdx < meshEntities.size(); entityIdx++)
+        {
+            meshEntities[entityIdx]->m_pTexCache = m_pTexCache;
+            meshEntities[entityIdx]->m_pGeoArena = m_pGeoArena;
+            for (auto& meshPrimitive : meshEntities[entityIdx]->m_meshPrimitives)
+            {
+                meshPrimitive.m_vertLayout = m_options.vertLayout;
+            }
+
+            m_entities.push_back(meshEntities[entityIdx]);
+            oLevel.AddMshEntity(entityNames[entityIdx], meshEntities[entityIdx]);
+        }
     }
 
     // ================================================================================================================
-    void GltfLoaderManager::Load(const std::string& absPath,
+    bool GltfLoaderManager::Load(const std::string& absPath,
                                  Level&             oLevel)
     {
         std::string filePostfix;
         if (GetFilePostfix(absPath, filePostfix))
         {
-            if (strcmp(filePostfix.c_str(), "gltf") == 0)
+            std::vector<std::string> entityNames;
+            std::vector<MeshEntity*> meshEntities;
+
+            // Try the cooked asset first.
+            uint64_t    cookedKey = 0;
+            std::string cookedPath;
+            bool        isCookedLoaded = LoadCooked(absPath, cookedPath, cookedKey, entityNames, meshEntities);
+
+            if (isCookedLoaded == false)
             {
                 tinygltf::Model model;
                 tinygltf::TinyGLTF loader;
                 std::string err;
                 std::string warn;
+                bool ret = false;
+
+                // The images are decoded on the workers, after the parse.
+                loader.SetImageLoader(KeepEncodedGltfImage, nullptr);
 
                 const auto start = std::chrono::high_resolution_clock::now();
-                bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, absPath);
+                std::string baseDir = std::filesystem::path(absPath).parent_path().string();
+                if (strcmp(filePostfix.c_str(), "gltf") == 0)
+                {
+                    // The JSON is read first, so that its read and its parse are profiled apart.
+                    std::vector<char> gltfJson;
+                    {
+                        ScopedLoadPhase phase(&m_loadProfiler, LOAD_PHASE_FILE_IO);
+                        ReadBinaryFile(absPath, gltfJson);
+                        phase.SetByteCnt(gltfJson.size());
+                    }
+
+                    ScopedLoadPhase phase(&m_loadProfiler, LOAD_PHASE_PARSE, gltfJson.size());
+                    ret = loader.LoadASCIIFromString(&model, &err, &warn, gltfJson.data(), gltfJson.size(), baseDir);
+                }
+                else if(strcmp(filePostfix.c_str(), "glb") == 0)
+                {
+                    // The glb is mapped instead of read into a temporary vector. TinyGltf copies the BIN chunk into the
+                    // model's buffer, so the mapping is dropped right after the parsing and the peak memory only holds
+                    // one copy of the binary data. The mapped pages are read during the parse, so it has the file IO.
+                    MappedFile glbFile;
+                    bool       isOpened = false;
+                    {
+                        ScopedLoadPhase phase(&m_loadProfiler, LOAD_PHASE_FILE_IO);
+                        isOpened = glbFile.Open(absPath);
+                        phase.SetByteCnt(glbFile.GetSize());
+                    }
+
+                    if (isOpened)
+                    {
+                        ScopedLoadPhase phase(&m_loadProfiler, LOAD_PHASE_PARSE, glbFile.GetSize());
+                        ret = loader.LoadBinaryFromMemory(&model, &err, &warn, glbFile.GetData(), glbFile.GetSize(), baseDir);
+                    }
+                    else
+                    {
+                        err = "Cannot open the glb file: " + absPath;
+                    }
+                }
+                else
+                {
+                    ASSERT(false, "Unsupported GLTF file format.");
+                }
                 const auto end = std::chrono::high_resolution_clock::now();
 
                 const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-                printf("Loading gltf file takes %d ms\n", duration.count()); // About 2000ms for the sponza model (50MB).
+                printf("Loading gltf file takes %d ms\n", (int)duration.count()); // The images are decoded after it.
 
                 if (!warn.empty()) {
                     printf("Warn: %s\n", warn.c_str());
@@ -69,310 +1422,257 @@ namespace SharedLib
 
                 if (!ret) {
                     printf("Failed to parse glTF\n");
-                    exit(1);
+                    return false;
                 }
 
-                // NOTE: TinyGltf loader has already loaded the binary buffer data and the images data.
-                const auto& binaryBuffer = model.buffers[0].data;
-                const unsigned char* pBufferData = binaryBuffer.data();
-
                 // NOTE: (1): TinyGltf loader has already loaded the binary buffer data and the images data.
                 //       (2): The gltf may has multiple buffers. The buffer idx should come from the buffer view.
                 //       (3): Be aware of the byte stride: https://github.com/KhronosGroup/glTF-Tutorials/blob/main/gltfTutorial/gltfTutorial_005_BuffersBufferViewsAccessors.md#data-interleaving
                 //       (4): Be aware of the base color factor: https://github.com/KhronosGroup/glTF-Tutorials/blob/main/gltfTutorial/gltfTutorial_011_SimpleMaterial.md#material-definition
-                // This example only supports gltf that only has one mesh and one skin.
-                assert(model.meshes.size() == 1, "This SharedLib Gltf Loader currently only supports one mesh.");
-                assert(model.skins.size() == 0, "This SharedLib Gltf Loader currently doesn't support the skinning."); // TODO: Support skinning and animation.
-                assert(model.scenes.size() == 1, "This SharedLib Gltf Loader currently only supports one scene.");
-                assert(model.scenes[0].nodes.size() == 1, "This SharedLib Gltf Loader currently only supports one node in the scene.");
-
-                // Load mesh and relevant info
-                // Any node MAY contain one mesh, defined in its mesh property. The mesh MAY be skinned using information provided in a referenced skin object.
-                // TODO: We should support multiple meshes in the future.
-                const auto& mesh = model.meshes[0];
-                MeshEntity* pMeshEntity = new MeshEntity();
-                pMeshEntity->m_meshPrimitives.resize(mesh.primitives.size());
-                m_entities.push_back(pMeshEntity);
-                oLevel.AddMshEntity("MeshEntity", pMeshEntity);
-
-                // https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#reference-mesh-primitive
-                // Meshes are defined as arrays of primitives. Primitives correspond to the data required for GPU draw calls.
-                // Primitives specify one or more attributes, corresponding to the vertex attributes used in the draw calls.
-                // The specification defines the following attribute semantics: POSITION, NORMAL, TANGENT, TEXCOORD_n, COLOR_n, JOINTS_n, and WEIGHTS_n.
-                
-                for (uint32_t i = 0; i < mesh.primitives.size(); i++)
-                {
-                    const auto& primitive = mesh.primitives[i];
-                    MeshPrimitive& meshPrimitive = pMeshEntity->m_meshPrimitives[i];
-                    
-                    // Load pos
-                    int posIdx = mesh.primitives[i].attributes.at("POSITION");
-                    const auto& posAccessor = model.accessors[posIdx];
-
-                    assert(posAccessor.componentType == TINYGLTF_PARAMETER_TYPE_FLOAT, "The pos accessor data type should be float.");
-                    assert(posAccessor.type          == TINYGLTF_TYPE_VEC3, "The pos accessor type should be vec3.");
-
-                    const auto& posBufferView = model.bufferViews[posAccessor.bufferView];
-                    // Assmue the data and element type of the position is float3
-                    meshPrimitive.m_posData.resize(3 * posAccessor.count);
-                    SharedLib::ReadOutAccessorData(meshPrimitive.m_posData.data(), posAccessor, model.bufferViews, model.buffers);
-
-                    // Load indices
-                    int indicesIdx = mesh.primitives[i].indices;
-                    const auto& idxAccessor = model.accessors[indicesIdx];
-
-                    assert(idxAccessor.componentType == TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT, "The idx accessor data type should be uint16.");
-                    assert(idxAccessor.type == TINYGLTF_TYPE_SCALAR, "The idx accessor type should be scalar.");
-
-                    meshPrimitive.m_idxDataUint16.resize(idxAccessor.count);
-                    SharedLib::ReadOutAccessorData(meshPrimitive.m_idxDataUint16.data(), idxAccessor, model.bufferViews, model.buffers);
-
-                    // Load normal
-                    int normalIdx = -1;
-                    if (mesh.primitives[i].attributes.count("NORMAL") > 0)
-                    {
-                        normalIdx = mesh.primitives[i].attributes.at("NORMAL");
-                        const auto& normalAccessor = model.accessors[normalIdx];
+                ASSERT(model.skins.size() == 0, "This SharedLib Gltf Loader currently doesn't support the skinning."); // TODO: Support skinning and animation.
 
-                        assert(normalAccessor.componentType == TINYGLTF_PARAMETER_TYPE_FLOAT, "The normal accessor data type should be float.");
-                        assert(normalAccessor.type == TINYGLTF_TYPE_VEC3, "The normal accessor type should be vec3.");
-
-                        meshPrimitive.m_normalData.resize(3 * normalAccessor.count);
-                        SharedLib::ReadOutAccessorData(meshPrimitive.m_normalData.data(), normalAccessor, model.bufferViews, model.buffers);
-                    }
-                    else
-                    {
-                        // If we don't have any normal geo data, then we will just apply the first triangle's normal to all the other
-                        // triangles/vertices.
-                        uint16_t idx0 = meshPrimitive.m_idxDataUint16[0];
-                        float vertPos0[3] = { meshPrimitive.m_posData[3 * idx0], meshPrimitive.m_posData[3 * idx0 + 1], meshPrimitive.m_posData[3 * idx0 + 2] };
-
-                        uint16_t idx1 = meshPrimitive.m_idxDataUint16[1];
-                        float vertPos1[3] = { meshPrimitive.m_posData[3 * idx1], meshPrimitive.m_posData[3 * idx1 + 1], meshPrimitive.m_posData[3 * idx1 + 2] };
+                // The dependencies are stamped right after the parse that read them.
+                std::vector<CookedAssetDep> cookedDeps;
+                if (m_options.useCookedCache)
+                {
+                    cookedDeps = StampCookedAssetDeps(absPath, GetGltfDepUris(model));
+                }
 
-                        uint16_t idx2 = meshPrimitive.m_idxDataUint16[2];
-                        float vertPos2[3] = { meshPrimitive.m_posData[3 * idx2], meshPrimitive.m_posData[3 * idx2 + 1], meshPrimitive.m_posData[3 * idx2 + 2] };
+                std::vector<GltfTexImgRefs> texImgRefs;
+                DecodeGltfModel(model, m_options, m_pThreadPool, &m_loadProfiler, entityNames, meshEntities, texImgRefs);
 
-                        float v1[3] = { vertPos1[0] - vertPos0[0], vertPos1[1] - vertPos0[1], vertPos1[2] - vertPos0[2] };
-                        float v2[3] = { vertPos2[0] - vertPos0[0], vertPos2[1] - vertPos0[1], vertPos2[2] - vertPos0[2] };
+                // The texel source ids only have to be distinct within the manager's TextureCache.
+                uint64_t assetHash = std::hash<std::string>{}(absPath);
 
-                        float autoGenNormal[3] = { 0.f };
-                        SharedLib::CrossProductVec3(v1, v2, autoGenNormal);
-                        SharedLib::NormalizeVec(autoGenNormal, 3);
+                // The cooked asset needs the decoded textures. With the asynchronous decoding, it is written on a
+                // worker once the batch's last texture is uploaded, and not at all when a texture failed to decode:
+                // its placeholder would be cooked in and reused by every later load until the source changes.
+                auto saveCookedAsset = [cookedPath, cookedKey, cookedDeps, entityNames, meshEntities]() {
+                    if (SaveCookedAsset(cookedPath, cookedKey, cookedDeps, entityNames, meshEntities) == false)
+                    {
+                        printf("Failed to write the cooked asset %s\n", cookedPath.c_str());
+                    }
+                };
 
-                        meshPrimitive.m_normalData.resize(3 * posAccessor.count);
-                        for (uint32_t i = 0; i < posAccessor.count; i++)
+                bool isCookWanted = m_options.useCookedCache && (meshEntities.size() > 0);
+                bool isCookDeferred = false;
+                if (m_options.asyncTextureDecode)
+                {
+                    ThreadPool* pThreadPool = m_pThreadPool;
+                    auto onBatchDone = [pThreadPool, saveCookedAsset, isCookWanted, cookedPath](bool isAnyFailed) {
+                        if (isCookWanted && isAnyFailed)
                         {
-                            uint32_t normalStartingIdx = i * 3;
-                            meshPrimitive.m_normalData[normalStartingIdx] = autoGenNormal[0];
-                            meshPrimitive.m_normalData[normalStartingIdx + 1] = autoGenNormal[1];
-                            meshPrimitive.m_normalData[normalStartingIdx + 2] = autoGenNormal[2];
+                            printf("Skipped the cooked asset %s, since a texture failed to decode.\n",
+                                   cookedPath.c_str());
                         }
-                    }
+                        else if (isCookWanted)
+                        {
+                            pThreadPool->Submit(saveCookedAsset);
+                        }
+                    };
+                    uint32_t batchId = m_pTextureDecoder->CreateBatch(onBatchDone);
 
-                    // Load uv
-                    int uvIdx = -1;
-                    if (mesh.primitives[i].attributes.count("TEXCOORD_0") > 0)
+                    // Each distinct texture is decoded once, however many slots use it. An ORM whose occlusion is
+                    // the metallic roughness image's own red channel is already packed, so it is baked as is.
+                    std::map<uint64_t, uint32_t> imgIds; // <Texel source id, decoder img id>.
+                    for (const auto& refs : texImgRefs)
                     {
-                        uvIdx = mesh.primitives[i].attributes.at("TEXCOORD_0");
-                        const auto& uvAccessor = model.accessors[uvIdx];
-
-                        assert(uvAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT, "The uv accessor data type should be float.");
-                        assert(uvAccessor.type == TINYGLTF_TYPE_VEC2, "The uv accessor type should be vec2.");
+                        for (uint32_t slot = 0; slot < MESH_TEX_CNT; slot++)
+                        {
+                            int imgIdx = -1;
+                            int occlusionImgIdx = -1;
+                            if (GetGltfTexSlotImgs(refs, (MeshTexSlot)slot, imgIdx, occlusionImgIdx) == false)
+                            {
+                                continue;
+                            }
 
-                        meshPrimitive.m_texCoordData.resize(2 * uvAccessor.count);
-                        SharedLib::ReadOutAccessorData(meshPrimitive.m_texCoordData.data(), uvAccessor, model.bufferViews, model.buffers);
-                    }
-                    else
-                    {
-                        // assert(false, "The loaded mesh doesn't have uv data.");
-                        meshPrimitive.m_texCoordData = std::vector<float>(posAccessor.count * 2, 0.f);
+                            uint64_t srcId = MakeGltfTexSrcId(assetHash, (MeshTexSlot)slot, imgIdx, occlusionImgIdx);
+                            auto     imgItr = imgIds.find(srcId);
+                            if (imgItr == imgIds.end())
+                            {
+                                TexBakeDesc bakeDesc = GetTexBakeDesc(m_options, (MeshTexSlot)slot);
+                                uint32_t    imgId = 0;
+                                if ((slot != MESH_TEX_ORM) || (occlusionImgIdx == imgIdx))
+                                {
+                                    imgId = m_pTextureDecoder->AddEncodedImg(model.images[imgIdx].image,
+                                                                             bakeDesc,
+                                                                             srcId);
+                                }
+                                else
+                                {
+                                    std::vector<uint8_t> noImg;
+                                    imgId = m_pTextureDecoder->AddEncodedOrmImgs(
+                                        (occlusionImgIdx >= 0) ? model.images[occlusionImgIdx].image : noImg,
+                                        (imgIdx >= 0) ? model.images[imgIdx].image : noImg,
+                                        bakeDesc,
+                                        srcId);
+                                }
+                                imgItr = imgIds.insert({ srcId, imgId }).first;
+                            }
+                            m_pTextureDecoder->AddTexRef(batchId, imgItr->second, refs.pMeshPrimitive, (MeshTexSlot)slot);
+                            isCookDeferred = true;
+                        }
                     }
+                }
+                else
+                {
+                    BakeGltfTextures(model, m_options, assetHash, m_pThreadPool, &m_loadProfiler, texImgRefs);
+                }
 
-                    // Load tangent
-                    int tangentIdx = -1;
-                    if (mesh.primitives[i].attributes.count("TANGENT"))
-                    {
-                        tangentIdx = mesh.primitives[i].attributes.at("TANGENT");
-                        const auto& tangentAccessor = model.accessors[tangentIdx];
+                if (isCookWanted && (isCookDeferred == false))
+                {
+                    saveCookedAsset();
+                }
+            }
 
-                        assert(tangentAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT, "The tangent accessor data type should be float.");
-                        assert(tangentAccessor.type == TINYGLTF_TYPE_VEC4, "The tangent accessor type should be vec4.");
-                        assert(tangentAccessor.count == posAccessor.count, "The tangent data count should be the same as the pos data count.");
+            AddLoadedEntities(entityNames, meshEntities, oLevel);
+            return true;
+        }
+        else
+        {
+            ASSERT(false, "Cannot find a postfix.");
+            return false;
+        }
+    }
 
-                        meshPrimitive.m_tangentData.resize(4 * tangentAccessor.count);
-                        SharedLib::ReadOutAccessorData(meshPrimitive.m_tangentData.data(), tangentAccessor, model.bufferViews, model.buffers);
-                    }
-                    else
-                    {
-                        // assert(false, "The loaded mesh doesn't have tangent data.");
-                        meshPrimitive.m_tangentData = std::vector<float>(posAccessor.count * 4, 0.f);
-                    }
+    // ================================================================================================================
+    bool ObjLoaderManager::Load(const std::string& absPath,
+                                Level&             oLevel)
+    {
+        std::vector<std::string> entityNames;
+        std::vector<MeshEntity*> meshEntities;
 
-                    // Load the base color texture or create a default pure color texture.
-                    // The baseColorFactor contains the red, green, blue, and alpha components of the main color of the material.
-                    int materialIdx = mesh.primitives[i].material;
-
-                    // All the textures are 4 components R8G8B8A8 textures.
-                    auto& pfnSetDefaultBaseColor = [](MeshPrimitive& meshPrimitive) {
-                        meshPrimitive.m_baseColorTex.pixHeight = 1;
-                        meshPrimitive.m_baseColorTex.pixWidth = 1;
-                        meshPrimitive.m_baseColorTex.componentCnt = 4;
-                        meshPrimitive.m_baseColorTex.dataVec = std::vector<uint8_t>(4, 255);
-                        };
-
-                    auto& pfnSetDefaultMetallicRoughness = [](MeshPrimitive& meshPrimitive) {
-                        float defaultMetallicRoughness[4] = { 0.f, 1.f, 0.f, 0.f };
-                        meshPrimitive.m_metallicRoughnessTex.pixHeight = 1;
-                        meshPrimitive.m_metallicRoughnessTex.pixWidth = 1;
-                        meshPrimitive.m_metallicRoughnessTex.componentCnt = 4;
-                        meshPrimitive.m_metallicRoughnessTex.dataVec = std::vector<uint8_t>(sizeof(defaultMetallicRoughness), 0);
-                        memcpy(meshPrimitive.m_metallicRoughnessTex.dataVec.data(), defaultMetallicRoughness, sizeof(defaultMetallicRoughness));
-                        };
-
-                    auto& pfnSetDefaultOcclusion = [](MeshPrimitive& meshPrimitive) {
-                        float defaultOcclusion[4] = { 1.f, 0.f, 0.f, 0.f };
-                        meshPrimitive.m_occlusionTex.pixHeight = 1;
-                        meshPrimitive.m_occlusionTex.pixWidth = 1;
-                        meshPrimitive.m_occlusionTex.componentCnt = 4;
-                        meshPrimitive.m_occlusionTex.dataVec = std::vector<uint8_t>(sizeof(defaultOcclusion), 0);
-                        memcpy(meshPrimitive.m_occlusionTex.dataVec.data(), &defaultOcclusion, sizeof(defaultOcclusion));
-                        };
-
-                    auto& pfnSetDefaultNormal = [](MeshPrimitive& meshPrimitive) {
-                        float defaultNormal[3] = { 0.f, 0.f, 1.f };
-                        meshPrimitive.m_normalTex.pixHeight = 1;
-                        meshPrimitive.m_normalTex.pixWidth = 1;
-                        meshPrimitive.m_normalTex.componentCnt = 3;
-                        meshPrimitive.m_normalTex.dataVec = std::vector<uint8_t>(sizeof(defaultNormal), 0);
-                        memcpy(meshPrimitive.m_normalTex.dataVec.data(), defaultNormal, sizeof(defaultNormal));
-                        };
-
-
-                    if (materialIdx != -1)
-                    {
-                        const auto& material = model.materials[materialIdx];
-                        // A texture binding is defined by an index of a texture object and an optional index of texture coordinates.
-                        // Its green channel contains roughness values and its blue channel contains metalness values.
-                        int baseColorTexIdx = material.pbrMetallicRoughness.baseColorTexture.index;
-                        int metallicRoughnessTexIdx = material.pbrMetallicRoughness.metallicRoughnessTexture.index;
-                        int occlusionTexIdx = material.occlusionTexture.index;
-                        int normalTexIdx = material.normalTexture.index;
-                        // material.emissiveTexture -- Let forget emissive. The renderer doesn't support emissive textures.
-
-                        if (baseColorTexIdx == -1)
-                        {
-                            pfnSetDefaultBaseColor(meshPrimitive);
-                        }
-                        else
-                        {
-                            // A texture is defined by an image index, denoted by the source property and a sampler index (sampler).
-                            // Assmue that all textures are 8 bits per channel. They are all xxx / 255. They all have 4 components.
-                            const auto& baseColorTex = model.textures[baseColorTexIdx];
-                            int baseColorTexImgIdx = baseColorTex.source;
+        uint64_t    cookedKey = 0;
+        std::string cookedPath;
+        if (LoadCooked(absPath, cookedPath, cookedKey, entityNames, meshEntities) == false)
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
 
-                            // This model has a base color texture.
-                            const auto& baseColorImg = model.images[baseColorTexImgIdx];
+            // The parser reads the mapped file in place, without a copy of the text.
+            ObjData     objData;
+            std::string err;
+            MappedFile  objFile;
+            bool        isOpened = false;
+            {
+                ScopedLoadPhase phase(&m_loadProfiler, LOAD_PHASE_FILE_IO);
+                isOpened = objFile.Open(absPath);
+                phase.SetByteCnt(objFile.GetSize());
+            }
 
-                            meshPrimitive.m_baseColorTex.pixWidth     = baseColorImg.width;
-                            meshPrimitive.m_baseColorTex.pixHeight    = baseColorImg.height;
-                            meshPrimitive.m_baseColorTex.componentCnt = baseColorImg.component;
-                            meshPrimitive.m_baseColorTex.dataVec      = baseColorImg.image;
+            if (isOpened == false)
+            {
+                printf("Cannot open the obj file: %s\n", absPath.c_str());
+                return false;
+            }
 
-                            assert(baseColorImg.component == 4, "All textures should have 4 components.");
-                            assert(baseColorImg.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, "All textures' each component should be a byte.");
-                        }
+            bool isParsed = false;
+            {
+                ScopedLoadPhase phase(&m_loadProfiler, LOAD_PHASE_PARSE, objFile.GetSize());
+                isParsed = ParseObj(reinterpret_cast<const char*>(objFile.GetData()),
+                                    objFile.GetSize(),
+                                    m_pThreadPool,
+                                    objData,
+                                    err);
+            }
 
-                        // The textures for metalness and roughness properties are packed together in a single texture called metallicRoughnessTexture.Its green
-                        // channel contains roughness values and its blue channel contains metalness values.This texture MUST be encoded with linear transfer function
-                        // and MAY use more than 8 bits per channel.
-                        if (metallicRoughnessTexIdx == -1)
-                        {
-                            pfnSetDefaultMetallicRoughness(meshPrimitive);
-                        }
-                        else
-                        {
-                            const auto& metallicRoughnessTex = model.textures[metallicRoughnessTexIdx];
-                            int metallicRoughnessTexImgIdx = metallicRoughnessTex.source;
+            if (isParsed == false)
+            {
+                printf("Failed to parse the obj %s: %s\n", absPath.c_str(), err.c_str());
+                return false;
+            }
+            objFile.Close();
+
+            const auto parseEnd = std::chrono::high_resolution_clock::now();
 
-                            const auto& metallicRoughnessImg = model.images[metallicRoughnessTexImgIdx];
+            meshEntities.resize(objData.groups.size());
+            std::vector<VertexCacheStats> statsBefore(objData.groups.size());
+            std::vector<VertexCacheStats> statsAfter(objData.groups.size());
+            for (uint32_t groupIdx = 0; groupIdx < objData.groups.size(); groupIdx++)
+            {
+                const auto& groupName = objData.groups[groupIdx].name;
+                entityNames.push_back((groupName.empty() ? "MeshEntity" : groupName) + "_" + std::to_string(groupIdx));
+                meshEntities[groupIdx] = new MeshEntity();
+                meshEntities[groupIdx]->m_meshPrimitives.resize(1);
+            }
 
-                            meshPrimitive.m_metallicRoughnessTex.pixWidth = metallicRoughnessImg.width;
-                            meshPrimitive.m_metallicRoughnessTex.pixHeight = metallicRoughnessImg.height;
-                            meshPrimitive.m_metallicRoughnessTex.componentCnt = metallicRoughnessImg.component;
-                            meshPrimitive.m_metallicRoughnessTex.dataVec = metallicRoughnessImg.image;
+            m_pThreadPool->ParallelFor(objData.groups.size(), [&](uint32_t groupIdx) {
+                MeshPrimitive& meshPrimitive = meshEntities[groupIdx]->m_meshPrimitives[0];
 
-                            assert(metallicRoughnessImg.component == 4, "All textures should have 4 components.");
-                            assert(metallicRoughnessImg.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, "All textures' each component should be a byte.");
-                        }
+                ScopedLoadPhase accessorPhase(&m_loadProfiler, LOAD_PHASE_ACCESSOR_DECODE);
+                std::vector<uint32_t> indices;
+                BuildObjGroupVertices(objData,
+                                      objData.groups[groupIdx],
+                                      meshPrimitive.m_posData,
+                                      meshPrimitive.m_texCoordData,
+                                      meshPrimitive.m_normalData,
+                                      indices);
+                accessorPhase.SetByteCnt(GetMeshPrimitiveAttribByteCnt(meshPrimitive) +
+                                         indices.size() * sizeof(uint32_t));
+                accessorPhase.End();
 
-                        if (normalTexIdx == -1)
-                        {
-                            pfnSetDefaultNormal(meshPrimitive);
-                        }
-                        else
-                        {
-                            const auto& normalTex = model.textures[normalTexIdx];
-                            int normalTexImgIdx = normalTex.source;
+                ScopedLoadPhase processingPhase(&m_loadProfiler, LOAD_PHASE_MESH_PROCESSING);
 
-                            const auto& normalImg = model.images[normalTexImgIdx];
+                uint32_t vertCnt = meshPrimitive.m_posData.size() / 3;
+                if (meshPrimitive.m_normalData.empty())
+                {
+                    meshPrimitive.m_normalData.resize(3 * vertCnt);
+                    GenerateSmoothNormals(meshPrimitive.m_posData.data(),
+                                          vertCnt,
+                                          indices.data(),
+                                          indices.size(),
+                                          meshPrimitive.m_normalData.data());
+                }
 
-                            meshPrimitive.m_normalTex.pixWidth = normalImg.width;
-                            meshPrimitive.m_normalTex.pixHeight = normalImg.height;
-                            meshPrimitive.m_normalTex.componentCnt = normalImg.component;
-                            meshPrimitive.m_normalTex.dataVec = normalImg.image;
+                if (meshPrimitive.m_texCoordData.empty())
+                {
+                    meshPrimitive.m_texCoordData = std::vector<float>(2 * vertCnt, 0.f);
+                }
 
-                            assert(normalImg.component == 4, "All textures should have 4 components.");
-                            assert(normalImg.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, "All textures' each component should be a byte.");
-                        }
+                meshPrimitive.m_tangentData.resize(4 * vertCnt);
+                GenerateTangents(meshPrimitive.m_posData.data(),
+                                 meshPrimitive.m_normalData.data(),
+                                 meshPrimitive.m_texCoordData.data(),
+                                 vertCnt,
+                                 indices.data(),
+                                 indices.size(),
+                                 meshPrimitive.m_tangentData.data());
 
-                        // The occlusion texture; it indicates areas that receive less indirect lighting from ambient sources.
-                        // Direct lighting is not affected.The red channel of the texture encodes the occlusion value,
-                        // where 0.0 means fully - occluded area(no indirect lighting) and 1.0 means not occluded area(full indirect lighting).
-                        if (occlusionTexIdx == -1)
-                        {
-                            pfnSetDefaultOcclusion(meshPrimitive);
-                        }
-                        else
-                        {
-                            const auto& occlusionTex = model.textures[occlusionTexIdx];
-                            int occlusionTexImgIdx = occlusionTex.source;
+                // The faces are always triangulated by the parser.
+                FinishMeshPrimitiveGeometry(m_options,
+                                            true,
+                                            indices,
+                                            meshPrimitive,
+                                            statsBefore[groupIdx],
+                                            statsAfter[groupIdx]);
+                processingPhase.SetByteCnt(GetMeshPrimitiveAttribByteCnt(meshPrimitive) + meshPrimitive.GetIdxByteCnt());
 
-                            const auto& occlusionImg = model.images[occlusionTexImgIdx];
+                SetDefaultBaseColorTex(meshPrimitive);
+                SetDefaultOrmTex(meshPrimitive);
+                SetDefaultNormalTex(meshPrimitive);
+            });
 
-                            meshPrimitive.m_occlusionTex.pixWidth = occlusionImg.width;
-                            meshPrimitive.m_occlusionTex.pixHeight = occlusionImg.height;
-                            meshPrimitive.m_occlusionTex.componentCnt = occlusionImg.component;
-                            meshPrimitive.m_occlusionTex.dataVec = occlusionImg.image;
+            const auto end = std::chrono::high_resolution_clock::now();
 
-                            assert(occlusionImg.component == 4, "All textures should have 4 components.");
-                            assert(occlusionImg.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, "All textures' each component should be a byte.");
-                        }
-                    }
-                    else
-                    {
-                        // No material, then we will create a pure white model.
-                        pfnSetDefaultBaseColor(meshPrimitive);
-                        pfnSetDefaultMetallicRoughness(meshPrimitive);
-                        pfnSetDefaultOcclusion(meshPrimitive);
-                        pfnSetDefaultNormal(meshPrimitive);
-                    }
-                }
-            }
-            else if(strcmp(filePostfix.c_str(), "glb") == 0)
-            {
-                //bool ret = loader.LoadBinaryFromFile(&model, &err, &warn, argv[1]); // for binary glTF(.glb)
-                ASSERT(false, "Currently don't support the glb file format.");
-            }
-            else
+            const auto parseDuration = std::chrono::duration_cast<std::chrono::milliseconds>(parseEnd - start);
+            const auto decodeDuration = std::chrono::duration_cast<std::chrono::milliseconds>(end - parseEnd);
+            printf("Parsing the obj file takes %d ms and decoding its %d groups takes %d ms on %d threads\n",
+                   (int)parseDuration.count(),
+                   (int)objData.groups.size(),
+                   (int)decodeDuration.count(),
+                   (int)m_pThreadPool->GetThreadCnt());
+
+            // There are no textures to decode, so the cooked asset can be written right away. The materials aren't
+            // loaded, so the mtl files don't change the decoded data and aren't dependencies.
+            if (m_options.useCookedCache && (meshEntities.size() > 0))
             {
-                ASSERT(false, "Unsupported GLTF file format.");
+                if (SaveCookedAsset(cookedPath, cookedKey, {}, entityNames, meshEntities) == false)
+                {
+                    printf("Failed to write the cooked asset %s\n", cookedPath.c_str());
+                }
             }
         }
-        else
-        {
-            ASSERT(false, "Cannot find a postfix.");
-        }
+
+        AddLoadedEntities(entityNames, meshEntities, oLevel);
+        return true;
     }
-    
 }
\ No newline at end of file
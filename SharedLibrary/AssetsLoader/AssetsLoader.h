@@ -2,6 +2,12 @@
 #include <string>
 #include <vector>
 #include <vulkan/vulkan.h>
+#include "../MeshProcessing/MeshletBuilder.h"
+#include "../MeshProcessing/VertexQuantizer.h"
+#include "../TextureProcessing/MipGenerator.h"
+#include "../TextureProcessing/BlockCompressor.h"
+#include "../Utils/UploadManager.h"
+#include "LoadProfiler.h"
 
 VK_DEFINE_HANDLE(VmaAllocator)
 
@@ -9,29 +15,170 @@ namespace SharedLib
 {
     class Level;
     class Entity;
+    class MeshEntity;
+    class ThreadPool;
+    class AsyncTextureDecoder;
+    class TextureCache;
+    class GeometryArena;
+
+    struct AssetsLoaderOptions
+    {
+        // Cache the decoded meshes and textures in a binary file after the first load, so later loads of the same
+        // unchanged asset skip the source file parsing. See the CookedAssetCache.h.
+        bool        useCookedCache = true;
+        std::string cookedCacheDir; // Empty means that the cooked file is put next to the source file.
+
+        // Primitives with less than 255 vertices store 8 bits indices. Only set it when the device has the
+        // VK_EXT_index_type_uint8 enabled.
+        bool allowUint8Indices = false;
+
+        // Reorder the triangles for the post-transform vertex cache and the overdraw, and then the vertices for the
+        // fetch locality. It only changes the draw order, never the rendered image. See the MeshOptimizer.h.
+        bool optimizeMeshes = true;
+
+        // Merge the duplicated vertices whose attributes are equal within the epsilons, which are in the attributes'
+        // own units. 0 only merges exact duplicates. The normal epsilon also applies to the tangent. See the MeshWeld.h.
+        bool  weldVertices      = true;
+        float weldPosEpsilon    = 0.f;
+        float weldNormalEpsilon = 0.f;
+        float weldUvEpsilon     = 0.f;
+
+        // Partition every primitive into meshlets for the mesh shader pipelines. See the MeshletBuilder.h.
+        bool     buildMeshlets   = false;
+        uint32_t maxMeshletVerts = DefaultMeshletMaxVerts;
+        uint32_t maxMeshletTris  = DefaultMeshletMaxTris;
+
+        // Append simplified levels to every triangle list primitive's index buffer for the distance based LOD
+        // selection. Each level keeps lodRatio of the previous level's triangles, and a level whose error would exceed
+        // lodMaxRelError times the primitive's bounding radius isn't built. Off by default, since only the applications
+        // that draw through the MeshPrimitive::SelectLod(...) use the levels. See the MeshLod.h.
+        bool     buildLods      = false;
+        uint32_t maxLodCnt      = 4;
+        float    lodRatio       = 0.5f;
+        float    lodMaxRelError = 0.05f;
+
+        // Load a mesh that several nodes reference once, in its own space, as one MeshEntity with an instance per node
+        // instead of a copy of its geometry baked per node. The primitives' world bounding spheres then enclose all
+        // the instances. See the MeshEntity::m_instanceMats.
+        bool instanceMeshes = true;
+
+        // The vertex buffer layout of every primitive. The compact layouts quantize the positions in the primitive's
+        // bounding box, so the vertex shaders need the primitive's GetVertDequant(). See the VertexQuantizer.h.
+        VertLayout vertLayout = VERT_LAYOUT_FLOAT;
+
+        // Decode the material images on the worker threads after the Load(...) returns. The primitives start with 1x1
+        // placeholder textures and the application swaps the decoded images in with the UploadDecodedTextures(...)
+        // every frame. A cooked asset load always has its decoded textures already.
+        bool asyncTextureDecode = true;
+
+        // The manager's worker threads for the decoding. 0 means std::thread::hardware_concurrency(). 1 runs the
+        // parallel loops on the loading thread, which is enough for e.g. a single small mesh.
+        uint32_t threadCnt = 0;
+
+        // Build the full mip chain of every material texture on the CPU. The base color is filtered in linear space
+        // and the normals are renormalized per level. See the MipGenerator.h.
+        bool      generateMips = true;
+        MipFilter mipFilter    = MIP_FILTER_KAISER;
+
+        // Block compress the material textures, after their mips, with a format per texture slot. A device that can't
+        // sample them, e.g. without the textureCompressionBC feature, gets them decompressed back to RGBA8 by the
+        // TextureCache at the upload. The reportTexPsnr prints every compressed texture's PSNR against its uncompressed
+        // level 0. See the BlockCompressor.h.
+        bool           compressTextures     = false;
+        TexCompression baseColorCompression = TEX_COMPRESSION_BC7;
+        TexCompression ormCompression       = TEX_COMPRESSION_BC7;
+        TexCompression normalCompression    = TEX_COMPRESSION_BC5;
+        bool           reportTexPsnr        = false;
+    };
 
     // AssetsLoaderManager is responsible for loading assets from disk, populating the Level object and manage the
-    // entities' release.
+    // entities' release. The levels' entity pointers are valid until the FinializeEntities(...) or the manager's
+    // destruction, which releases the entities that never got their GPU resources.
     class AssetsLoaderManager
     {
     public:
-        AssetsLoaderManager() {}
-        ~AssetsLoaderManager();
+        AssetsLoaderManager(const AssetsLoaderOptions& options = AssetsLoaderOptions());
+        virtual ~AssetsLoaderManager();
+
+        // False when the file can't be opened or parsed. The oLevel then gets no entities and the caller decides how to
+        // go on.
+        virtual bool Load(const std::string& absPath, Level& oLevel) = 0;
+
+        // All the entities' uploads are enqueued into the pUploadManager and submitted in its batches at the end,
+        // without waiting for them. The frames submitted after it to the same queue see the uploaded data. The textures'
+        // formats are checked against the physicalDevice's optimal tiling support.
+        void InitEntitesGpuRsrc(VkPhysicalDevice physicalDevice,
+                                VkDevice         device,
+                                VmaAllocator*    pAllocator,
+                                UploadManager*   pUploadManager);
+
+        // Call it once per frame after the InitEntitesGpuRsrc(...), before the frame's draws are recorded. It uploads
+        // at most maxTexCnt of the textures that finished decoding, to bound the frame's hitch, and returns the count
+        // of the textures that are still waiting. The frame counts are the application's frame timeline, see the
+        // GlfwApplication::GetSubmittedFrameCnt(). The replaced placeholders are destroyed by a later call, once all
+        // the frames submitted before their replacement have completed, so the graphics queue is never waited.
+        uint32_t UploadDecodedTextures(VkDevice       device,
+                                       VmaAllocator*  pAllocator,
+                                       UploadManager* pUploadManager,
+                                       uint64_t       submittedFrameCnt,
+                                       uint64_t       completedFrameCnt,
+                                       uint32_t       maxTexCnt = 4);
 
-        virtual void Load(const std::string& absPath, Level& oLevel) = 0;
-        void InitEntitesGpuRsrc(VkDevice device, VmaAllocator* pAllocator, VkCommandBuffer cmdBuffer, VkQueue queue);
         void FinializeEntities(VkDevice device, VmaAllocator* pAllocator);
 
+        // The per phase timings of all the loads, the texture decoding and the GPU uploads since its last Reset().
+        LoadProfiler& GetLoadProfiler() { return m_loadProfiler; }
+
     protected:
+        // Tries the absPath's cooked asset when the options use the cache. The cooked path and key are output either
+        // way, for the cooked asset's save after a miss.
+        bool LoadCooked(const std::string&        absPath,
+                        std::string&              oCookedPath,
+                        uint64_t&                 oCookedKey,
+                        std::vector<std::string>& oEntityNames,
+                        std::vector<MeshEntity*>& oMeshEntities);
+
+        // Hands the loaded entities to the level. The manager keeps them for the GPU resources and the release.
+        void AddLoadedEntities(const std::vector<std::string>& entityNames,
+                               const std::vector<MeshEntity*>& meshEntities,
+                               Level&                          oLevel);
+
         std::vector<Entity*> m_entities;
+        AssetsLoaderOptions  m_options;
+
+        // Worker pool for the CPU side asset decoding. Created with the manager so that several loads reuse the threads.
+        ThreadPool* m_pThreadPool;
+
+        // Owns the asynchronous texture decoding on the m_pThreadPool.
+        AsyncTextureDecoder* m_pTextureDecoder;
+
+        // Shares the GPU textures of all the loaded entities. See the TextureCache.h.
+        TextureCache* m_pTexCache;
+
+        // Holds the vertices and the indices of all the loaded entities. See the GeometryArena.h.
+        GeometryArena* m_pGeoArena;
+
+        LoadProfiler m_loadProfiler;
     };
 
     class GltfLoaderManager : public AssetsLoaderManager
     {
     public:
-        GltfLoaderManager() {}
+        GltfLoaderManager(const AssetsLoaderOptions& options = AssetsLoaderOptions()) : AssetsLoaderManager(options) {}
         ~GltfLoaderManager() {}
 
-        void Load(const std::string& absPath, Level& oLevel) override;
+        bool Load(const std::string& absPath, Level& oLevel) override;
+    };
+
+    // Each 'o' or 'g' group of the obj becomes a MeshEntity with one primitive, whose vertices are the group's distinct
+    // face corners. It goes through the same mesh processing and cooked cache as the gltf, but the materials aren't
+    // read, so all the primitives have the default textures. See the ObjParser.h.
+    class ObjLoaderManager : public AssetsLoaderManager
+    {
+    public:
+        ObjLoaderManager(const AssetsLoaderOptions& options = AssetsLoaderOptions()) : AssetsLoaderManager(options) {}
+        ~ObjLoaderManager() {}
+
+        bool Load(const std::string& absPath, Level& oLevel) override;
     };
-}
\ No newline at end of file
+}
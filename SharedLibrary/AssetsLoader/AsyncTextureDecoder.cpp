@@ -0,0 +1,266 @@
+#include "AsyncTextureDecoder.h"
+#include "../Utils/ThreadUtils.h"
+#include "stb_image.h"
+#include <algorithm>
+
+namespace SharedLib
+{
+    // ================================================================================================================
+    AsyncTextureDecoder::AsyncTextureDecoder(
+        ThreadPool*   pThreadPool,
+        LoadProfiler* pProfiler)
+        : m_pThreadPool(pThreadPool),
+          m_pProfiler(pProfiler)
+    {}
+
+    // ================================================================================================================
+    AsyncTextureDecoder::~AsyncTextureDecoder()
+    {
+        // The decoding tasks write into the slots.
+        m_pThreadPool->WaitIdle();
+    }
+
+    // ================================================================================================================
+    // Decodes to RGBA8. False if the image can't be decoded.
+    static bool DecodeRgba8Img(
+        const std::vector<uint8_t>& encodedData,
+        ImgInfo&                    oImg)
+    {
+        int width = 0;
+        int height = 0;
+        int componentCnt = 0;
+        stbi_uc* pPixels = stbi_load_from_memory(encodedData.data(),
+                                                 encodedData.size(),
+                                                 &width,
+                                                 &height,
+                                                 &componentCnt,
+                                                 4);
+        if (pPixels == nullptr)
+        {
+            return false;
+        }
+
+        oImg.pixWidth = width;
+        oImg.pixHeight = height;
+        oImg.componentCnt = 4;
+        oImg.dataVec.assign(pPixels, pPixels + 4 * width * height);
+        stbi_image_free(pPixels);
+        return true;
+    }
+
+    // ================================================================================================================
+    AsyncTextureDecoder::DecodeSlot* AsyncTextureDecoder::AddDecodeSlot(
+        uint64_t texSrcId)
+    {
+        m_decodeSlots.push_back(std::make_unique<DecodeSlot>());
+        DecodeSlot* pSlot = m_decodeSlots.back().get();
+        pSlot->isOrm = false;
+        pSlot->texSrcId = texSrcId;
+        pSlot->isDone = false;
+        pSlot->isFailed = false;
+        pSlot->pendingRefCnt = 0;
+        return pSlot;
+    }
+
+    // ================================================================================================================
+    uint32_t AsyncTextureDecoder::AddEncodedImg(
+        std::vector<uint8_t> encodedData,
+        const TexBakeDesc&   bakeDesc,
+        uint64_t             texSrcId)
+    {
+        uint32_t imgId = m_decodeSlots.size();
+
+        DecodeSlot* pSlot = AddDecodeSlot(texSrcId);
+        pSlot->encodedData = std::move(encodedData);
+
+        ThreadPool*   pThreadPool = m_pThreadPool;
+        LoadProfiler* pProfiler = m_pProfiler;
+        m_pThreadPool->Submit([pSlot, pThreadPool, pProfiler, bakeDesc]() {
+            ScopedLoadPhase phase(pProfiler, LOAD_PHASE_IMAGE_DECODE, pSlot->encodedData.size());
+
+            int width = 0;
+            int height = 0;
+            int componentCnt = 0;
+            stbi_uc* pPixels = stbi_load_from_memory(pSlot->encodedData.data(),
+                                                     pSlot->encodedData.size(),
+                                                     &width,
+                                                     &height,
+                                                     &componentCnt,
+                                                     4);
+            if (pPixels != nullptr)
+            {
+                // The ParallelFor(...) is safe on a worker. A large image's rows spread over the idle workers.
+                ImgInfo bakedImg;
+                BakeTexture(pPixels, width, height, bakeDesc, pThreadPool, bakedImg);
+                stbi_image_free(pPixels);
+                pSlot->decodedImg = std::make_shared<const ImgInfo>(std::move(bakedImg));
+            }
+            else
+            {
+                pSlot->isFailed = true;
+            }
+
+            pSlot->encodedData = std::vector<uint8_t>();
+            pSlot->isDone.store(true, std::memory_order_release);
+        });
+
+        return imgId;
+    }
+
+    // ================================================================================================================
+    uint32_t AsyncTextureDecoder::AddEncodedOrmImgs(
+        std::vector<uint8_t> encodedOcclusion,
+        std::vector<uint8_t> encodedMetallicRoughness,
+        const TexBakeDesc&   bakeDesc,
+        uint64_t             texSrcId)
+    {
+        uint32_t imgId = m_decodeSlots.size();
+
+        DecodeSlot* pSlot = AddDecodeSlot(texSrcId);
+        pSlot->encodedData = std::move(encodedMetallicRoughness);
+        pSlot->encodedOcclusionData = std::move(encodedOcclusion);
+        pSlot->isOrm = true;
+
+        ThreadPool*   pThreadPool = m_pThreadPool;
+        LoadProfiler* pProfiler = m_pProfiler;
+        m_pThreadPool->Submit([pSlot, pThreadPool, pProfiler, bakeDesc]() {
+            ScopedLoadPhase phase(pProfiler,
+                                  LOAD_PHASE_IMAGE_DECODE,
+                                  pSlot->encodedData.size() + pSlot->encodedOcclusionData.size());
+
+            ImgInfo occlusion{};
+            ImgInfo metallicRoughness{};
+            bool hasOcclusion = (pSlot->encodedOcclusionData.empty() == false);
+            bool hasMetallicRoughness = (pSlot->encodedData.empty() == false);
+
+            if ((hasOcclusion && (DecodeRgba8Img(pSlot->encodedOcclusionData, occlusion) == false)) ||
+                (hasMetallicRoughness && (DecodeRgba8Img(pSlot->encodedData, metallicRoughness) == false)))
+            {
+                pSlot->isFailed = true;
+            }
+            else
+            {
+                ImgInfo orm;
+                PackOrmImage(hasOcclusion ? &occlusion : nullptr,
+                             hasMetallicRoughness ? &metallicRoughness : nullptr,
+                             orm);
+                ImgInfo bakedImg;
+                BakeTexture(orm.dataVec.data(), orm.pixWidth, orm.pixHeight, bakeDesc, pThreadPool, bakedImg);
+                pSlot->decodedImg = std::make_shared<const ImgInfo>(std::move(bakedImg));
+            }
+
+            pSlot->encodedData = std::vector<uint8_t>();
+            pSlot->encodedOcclusionData = std::vector<uint8_t>();
+            pSlot->isDone.store(true, std::memory_order_release);
+        });
+
+        return imgId;
+    }
+
+    // ================================================================================================================
+    uint32_t AsyncTextureDecoder::CreateBatch(
+        const std::function<void(bool isAnyFailed)>& onDone)
+    {
+        m_batches.push_back({ onDone, 0, false });
+        return m_batches.size() - 1;
+    }
+
+    // ================================================================================================================
+    void AsyncTextureDecoder::AddTexRef(
+        uint32_t       batchId,
+        uint32_t       imgId,
+        MeshPrimitive* pMeshPrimitive,
+        MeshTexSlot    slot)
+    {
+        m_pendingRefs.push_back({ batchId, imgId, pMeshPrimitive, slot });
+        m_decodeSlots[imgId]->pendingRefCnt++;
+        m_batches[batchId].pendingRefCnt++;
+    }
+
+    // ================================================================================================================
+    uint32_t AsyncTextureDecoder::UploadDecodedTextures(
+        VkDevice       device,
+        VmaAllocator*  pAllocator,
+        UploadManager* pUploadManager,
+        uint64_t       retireFrame,
+        uint32_t       maxTexCnt)
+    {
+        // The limit is on the distinct images, so an image that is uploaded goes into all its slots in the same call.
+        std::vector<uint32_t> uploadedImgIds;
+
+        std::vector<TexRef> stillPendingRefs;
+        for (const TexRef& ref : m_pendingRefs)
+        {
+            DecodeSlot* pSlot = m_decodeSlots[ref.imgId].get();
+            if (pSlot->isDone.load(std::memory_order_acquire) == false)
+            {
+                stillPendingRefs.push_back(ref);
+                continue;
+            }
+
+            bool isImgUploaded = std::find(uploadedImgIds.begin(), uploadedImgIds.end(), ref.imgId) !=
+                                 uploadedImgIds.end();
+            if ((isImgUploaded == false) && (pSlot->isFailed == false) && (uploadedImgIds.size() >= maxTexCnt))
+            {
+                stillPendingRefs.push_back(ref);
+                continue;
+            }
+
+            Batch& batch = m_batches[ref.batchId];
+            pSlot->pendingRefCnt--;
+            if (pSlot->isFailed)
+            {
+                printf("Failed to decode a texture image. The placeholder texture is kept.\n");
+                batch.isAnyFailed = true;
+            }
+            else
+            {
+                if (isImgUploaded == false)
+                {
+                    uploadedImgIds.push_back(ref.imgId);
+                }
+
+                // The placeholders may still be in use by the frames in flight, so they are only retired.
+                ScopedLoadPhase phase(m_pProfiler, LOAD_PHASE_GPU_UPLOAD, pSlot->decodedImg->dataVec.size());
+                ref.pMeshPrimitive->SetTex(ref.slot,
+                                           pSlot->decodedImg,
+                                           pSlot->texSrcId,
+                                           retireFrame,
+                                           device,
+                                           pAllocator,
+                                           pUploadManager);
+
+                // The slots keep the texels alive after the last reference.
+                if (pSlot->pendingRefCnt == 0)
+                {
+                    pSlot->decodedImg.reset();
+                }
+            }
+
+            batch.pendingRefCnt--;
+            if ((batch.pendingRefCnt == 0) && batch.onDone)
+            {
+                batch.onDone(batch.isAnyFailed);
+            }
+        }
+
+        if (uploadedImgIds.empty() == false)
+        {
+            pUploadManager->Flush();
+        }
+
+        m_pendingRefs = std::move(stillPendingRefs);
+        return m_pendingRefs.size();
+    }
+
+    // ================================================================================================================
+    void AsyncTextureDecoder::DropPendingTexRefs()
+    {
+        for (const TexRef& ref : m_pendingRefs)
+        {
+            m_decodeSlots[ref.imgId]->pendingRefCnt--;
+            m_batches[ref.batchId].pendingRefCnt--;
+        }
+        m_pendingRefs.clear();
+    }
+}
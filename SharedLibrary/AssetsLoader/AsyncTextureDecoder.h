@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <vulkan/vulkan.h>
+#include "../Scene/Level.h"
+#include "TextureBaker.h"
+#include "LoadProfiler.h"
+
+namespace SharedLib
+{
+    class ThreadPool;
+
+    // Decodes the material images (png, jpg, ...) on the worker threads while the primitives render with their 1x1
+    // placeholder textures, so the first frame doesn't wait for the texture decoding.
+    //
+    // The loader adds every encoded image once and references it from each primitive texture slot that uses it. The
+    // render thread then calls the UploadDecodedTextures(...) every frame, which swaps the finished images into their
+    // slots. Only the decoding runs on the workers. The AddXxx(...) and the UploadDecodedTextures(...) must be called
+    // from the same thread.
+    class AsyncTextureDecoder
+    {
+    public:
+        // The decoding and the uploads are recorded into the pProfiler when it isn't null.
+        explicit AsyncTextureDecoder(ThreadPool* pThreadPool, LoadProfiler* pProfiler = nullptr);
+        ~AsyncTextureDecoder();
+
+        // Takes the encoded image and starts decoding it to RGBA8 and baking it on the pool. The returned id is for the
+        // AddTexRef(...). The texSrcId names the baked texels in the TextureCache.
+        uint32_t AddEncodedImg(std::vector<uint8_t> encodedData, const TexBakeDesc& bakeDesc, uint64_t texSrcId);
+
+        // Like the AddEncodedImg(...), but the two images are packed with the PackOrmImage(...) before the bake. An empty
+        // one takes its channels' defaults.
+        uint32_t AddEncodedOrmImgs(std::vector<uint8_t> encodedOcclusion,
+                                   std::vector<uint8_t> encodedMetallicRoughness,
+                                   const TexBakeDesc&   bakeDesc,
+                                   uint64_t             texSrcId);
+
+        // A batch groups the texture references of one load. The onDone runs in the UploadDecodedTextures(...) that
+        // resolves the batch's last reference, so it never runs for a batch without references. Its isAnyFailed tells
+        // whether any of the batch's images failed to decode and left its placeholder in place.
+        uint32_t CreateBatch(const std::function<void(bool isAnyFailed)>& onDone);
+        void     AddTexRef(uint32_t batchId, uint32_t imgId, MeshPrimitive* pMeshPrimitive, MeshTexSlot slot);
+
+        // Swaps up to maxTexCnt distinct decoded images into all their texture slots and returns the count of the
+        // references that are still waiting. The primitives' GPU resources must be initialized. The replaced
+        // placeholders are retired with the retireFrame, the last frame that may still sample them, and the uploads
+        // are flushed at the end. An image that fails to decode leaves the placeholder in place.
+        uint32_t UploadDecodedTextures(VkDevice       device,
+                                       VmaAllocator*  pAllocator,
+                                       UploadManager* pUploadManager,
+                                       uint64_t       retireFrame,
+                                       uint32_t       maxTexCnt);
+
+        // Forgets the waiting references, e.g. before their primitives are destroyed. The decoding tasks still finish.
+        void DropPendingTexRefs();
+
+        uint32_t GetPendingTexCnt() const { return m_pendingRefs.size(); }
+
+    private:
+        struct DecodeSlot
+        {
+            std::vector<uint8_t>           encodedData;
+            std::vector<uint8_t>           encodedOcclusionData; // Only for the AddEncodedOrmImgs(...).
+            bool                           isOrm;
+            uint64_t                       texSrcId;
+            std::shared_ptr<const ImgInfo> decodedImg; // Shared by all the slots that reference it.
+            std::atomic<bool>              isDone;
+            bool                           isFailed;
+            uint32_t                       pendingRefCnt;
+        };
+
+        struct TexRef
+        {
+            uint32_t       batchId;
+            uint32_t       imgId;
+            MeshPrimitive* pMeshPrimitive;
+            MeshTexSlot    slot;
+        };
+
+        struct Batch
+        {
+            std::function<void(bool isAnyFailed)> onDone;
+            uint32_t                              pendingRefCnt;
+            bool                                  isAnyFailed;
+        };
+
+        DecodeSlot* AddDecodeSlot(uint64_t texSrcId);
+
+        ThreadPool*   m_pThreadPool;
+        LoadProfiler* m_pProfiler;
+
+        // The workers write into the slots through raw pointers, so each slot has its own allocation.
+        std::vector<std::unique_ptr<DecodeSlot>> m_decodeSlots;
+        std::vector<TexRef>                      m_pendingRefs;
+        std::vector<Batch>                       m_batches;
+    };
+}
@@ -0,0 +1,555 @@
+#include "CookedAssetCache.h"
+#include "AssetsLoader.h"
+#include "../Scene/Level.h"
+#include "../Utils/DiskOpsUtils.h"
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+
+namespace SharedLib
+{
+    static const uint32_t CookedAssetMagic = 0x4B4F4F43; // "COOK"
+
+    struct CookedAssetHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint64_t byteCnt; // The whole file's size, including the header.
+        uint32_t entityCnt;
+        uint32_t depCnt;
+    };
+
+    static const uint64_t Fnv1aOffsetBasis = 0xcbf29ce484222325ull;
+    static const uint64_t Fnv1aPrime       = 0x100000001b3ull;
+
+    // ================================================================================================================
+    // FNV-1a over 8 bytes words with a byte wise tail. It is not meant to be cryptographic, it only has to tell whether
+    // the source changed, and it should be fast enough to hash a large gltf on every start up.
+    static uint64_t HashBytes(
+        const void* pData,
+        uint64_t    byteCnt,
+        uint64_t    hash)
+    {
+        const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+        uint64_t wordCnt = byteCnt / sizeof(uint64_t);
+        for (uint64_t i = 0; i < wordCnt; i++)
+        {
+            uint64_t word;
+            memcpy(&word, pBytes + i * sizeof(uint64_t), sizeof(uint64_t));
+            hash = (hash ^ word) * Fnv1aPrime;
+        }
+
+        for (uint64_t i = wordCnt * sizeof(uint64_t); i < byteCnt; i++)
+        {
+            hash = (hash ^ pBytes[i]) * Fnv1aPrime;
+        }
+
+        return hash;
+    }
+
+    // ================================================================================================================
+    template<typename T>
+    static uint64_t HashValue(
+        const T& val,
+        uint64_t hash)
+    {
+        return HashBytes(&val, sizeof(T), hash);
+    }
+
+    // ================================================================================================================
+    // Appends the cooked data into a byte vector. Arrays start at 8 bytes aligned offsets, so their elements are
+    // naturally aligned in the file.
+    class CookedWriter
+    {
+    public:
+        void Write(const void* pData, uint64_t byteCnt)
+        {
+            const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+            m_bytes.insert(m_bytes.end(), pBytes, pBytes + byteCnt);
+        }
+
+        void WriteU32(uint32_t val) { Write(&val, sizeof(val)); }
+        void WriteU64(uint64_t val) { Write(&val, sizeof(val)); }
+
+        void Align()
+        {
+            m_bytes.resize((m_bytes.size() + 7) & ~uint64_t(7), 0);
+        }
+
+        template<typename T>
+        void WriteArray(const std::vector<T>& vec)
+        {
+            uint64_t eleCnt = vec.size();
+            Align();
+            Write(&eleCnt, sizeof(eleCnt));
+            Write(vec.data(), eleCnt * sizeof(T));
+        }
+
+        void WriteString(const std::string& str)
+        {
+            WriteU32(str.size());
+            Write(str.data(), str.size());
+        }
+
+        void WriteImgInfo(const ImgInfo& imgInfo)
+        {
+            Align();
+            WriteU32(imgInfo.pixWidth);
+            WriteU32(imgInfo.pixHeight);
+            WriteU32(imgInfo.componentCnt);
+            WriteU32(imgInfo.componentType);
+            WriteArray(imgInfo.dataVec);
+            WriteArray(imgInfo.mipByteOffsets);
+            WriteU32(imgInfo.format);
+        }
+
+        std::vector<uint8_t>& GetBytes() { return m_bytes; }
+
+    private:
+        std::vector<uint8_t> m_bytes;
+    };
+
+    // ================================================================================================================
+    // Reads the cooked data back with bounds checks. Any out of range read puts the reader into the failed state and
+    // the following reads return zeros, so a truncated file is detected once at the end.
+    //
+    // The file is streamed instead of memory mapped. Every array ends up in a MeshEntity's vector anyway, because the
+    // culling, the deferred cook and the texture uploads all read them after the load, so a mapping would only add a
+    // second copy out of the page cache. Reading straight into the final vectors copies each byte once.
+    class CookedReader
+    {
+    public:
+        CookedReader(std::ifstream& file, uint64_t byteCnt)
+            : m_file(file), m_byteCnt(byteCnt), m_offset(0), m_failed(false)
+        {}
+
+        bool Read(void* pDst, uint64_t byteCnt)
+        {
+            if (m_failed || (byteCnt > m_byteCnt - m_offset))
+            {
+                m_failed = true;
+                memset(pDst, 0, byteCnt);
+                return false;
+            }
+
+            if (m_file.read(static_cast<char*>(pDst), byteCnt).fail())
+            {
+                m_failed = true;
+                memset(pDst, 0, byteCnt);
+                return false;
+            }
+
+            m_offset += byteCnt;
+            return true;
+        }
+
+        uint32_t ReadU32()
+        {
+            uint32_t val = 0;
+            Read(&val, sizeof(val));
+            return val;
+        }
+
+        uint64_t ReadU64()
+        {
+            uint64_t val = 0;
+            Read(&val, sizeof(val));
+            return val;
+        }
+
+        void Align()
+        {
+            uint8_t padding[8];
+            uint64_t alignedOffset = (m_offset + 7) & ~uint64_t(7);
+            if (m_failed == false)
+            {
+                Read(padding, std::min(alignedOffset, m_byteCnt) - m_offset);
+            }
+        }
+
+        template<typename T>
+        void ReadArray(std::vector<T>& oVec)
+        {
+            uint64_t eleCnt = 0;
+            Align();
+            Read(&eleCnt, sizeof(eleCnt));
+            if (m_failed || (eleCnt > (m_byteCnt - m_offset) / sizeof(T)))
+            {
+                m_failed = true;
+                return;
+            }
+
+            oVec.resize(eleCnt);
+            Read(oVec.data(), eleCnt * sizeof(T));
+        }
+
+        void ReadString(std::string& oStr)
+        {
+            uint32_t charCnt = ReadU32();
+            if (m_failed || (charCnt > m_byteCnt - m_offset))
+            {
+                m_failed = true;
+                return;
+            }
+
+            oStr.resize(charCnt);
+            Read(oStr.data(), charCnt);
+        }
+
+        void ReadImgInfo(ImgInfo& oImgInfo)
+        {
+            Align();
+            oImgInfo.pixWidth      = ReadU32();
+            oImgInfo.pixHeight     = ReadU32();
+            oImgInfo.componentCnt  = ReadU32();
+            oImgInfo.componentType = ReadU32();
+            ReadArray(oImgInfo.dataVec);
+            ReadArray(oImgInfo.mipByteOffsets);
+            oImgInfo.format = (VkFormat)ReadU32();
+
+            // The upload copies every level from its offset.
+            const std::vector<uint32_t>& mipByteOffsets = oImgInfo.mipByteOffsets;
+            if ((mipByteOffsets.empty() == false) && (mipByteOffsets.back() >= oImgInfo.dataVec.size()))
+            {
+                m_failed = true;
+            }
+        }
+
+        void SetFailed() { m_failed = true; }
+        bool IsFailed() const { return m_failed; }
+
+    private:
+        std::ifstream& m_file;
+        uint64_t       m_byteCnt;
+        uint64_t       m_offset;
+        bool           m_failed;
+    };
+
+    // ================================================================================================================
+    // Every loader option that changes the decoded data has to be hashed here.
+    static uint64_t HashLoaderOptions(
+        const AssetsLoaderOptions& options,
+        uint64_t                   hash)
+    {
+        hash = HashValue(CookedAssetVersion, hash);
+        hash = HashValue(options.allowUint8Indices, hash);
+        hash = HashValue(options.optimizeMeshes, hash);
+        hash = HashValue(options.weldVertices, hash);
+        hash = HashValue(options.weldPosEpsilon, hash);
+        hash = HashValue(options.weldNormalEpsilon, hash);
+        hash = HashValue(options.weldUvEpsilon, hash);
+        hash = HashValue(options.buildMeshlets, hash);
+        hash = HashValue(options.maxMeshletVerts, hash);
+        hash = HashValue(options.maxMeshletTris, hash);
+        hash = HashValue(options.buildLods, hash);
+        hash = HashValue(options.maxLodCnt, hash);
+        hash = HashValue(options.lodRatio, hash);
+        hash = HashValue(options.lodMaxRelError, hash);
+        hash = HashValue(options.instanceMeshes, hash);
+        hash = HashValue(options.generateMips, hash);
+        hash = HashValue(options.mipFilter, hash);
+        hash = HashValue(options.compressTextures, hash);
+        hash = HashValue(options.baseColorCompression, hash);
+        hash = HashValue(options.ormCompression, hash);
+        hash = HashValue(options.normalCompression, hash);
+        return hash;
+    }
+
+    // ================================================================================================================
+    uint64_t ComputeCookedAssetKey(
+        const std::string&         srcAbsPath,
+        const AssetsLoaderOptions& options)
+    {
+        uint64_t hash = Fnv1aOffsetBasis;
+
+        MappedFile srcFile;
+        if (srcFile.Open(srcAbsPath))
+        {
+            hash = HashBytes(srcFile.GetData(), srcFile.GetSize(), hash);
+        }
+
+        return HashLoaderOptions(options, hash);
+    }
+
+    // ================================================================================================================
+    // A missing file is stamped with the max byte count, which no existing file matches.
+    static CookedAssetDep StampCookedAssetDep(
+        const std::filesystem::path& srcDir,
+        const std::string&           relPath)
+    {
+        std::error_code ec;
+        std::filesystem::path filePath = srcDir / relPath;
+
+        CookedAssetDep dep{};
+        dep.relPath = relPath;
+        dep.byteCnt = std::filesystem::file_size(filePath, ec);
+        if (ec)
+        {
+            dep.byteCnt = UINT64_MAX;
+            return dep;
+        }
+
+        dep.lastWriteTime = std::filesystem::last_write_time(filePath, ec).time_since_epoch().count();
+        return dep;
+    }
+
+    // ================================================================================================================
+    std::vector<CookedAssetDep> StampCookedAssetDeps(
+        const std::string&              srcAbsPath,
+        const std::vector<std::string>& relPaths)
+    {
+        std::filesystem::path srcDir = std::filesystem::path(srcAbsPath).parent_path();
+
+        std::vector<CookedAssetDep> deps;
+        std::set<std::string>       stampedPaths;
+        for (const auto& relPath : relPaths)
+        {
+            if (stampedPaths.insert(relPath).second)
+            {
+                deps.push_back(StampCookedAssetDep(srcDir, relPath));
+            }
+        }
+        return deps;
+    }
+
+    // ================================================================================================================
+    std::string GetCookedAssetPath(
+        const std::string&         srcAbsPath,
+        const AssetsLoaderOptions& options)
+    {
+        std::filesystem::path srcPath(srcAbsPath);
+        std::string cookedName = srcPath.filename().string() + ".cooked";
+
+        if (options.cookedCacheDir.empty())
+        {
+            return (srcPath.parent_path() / cookedName).string();
+        }
+        else
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(options.cookedCacheDir, ec);
+            return (std::filesystem::path(options.cookedCacheDir) / cookedName).string();
+        }
+    }
+
+    // ================================================================================================================
+    bool SaveCookedAsset(
+        const std::string&                 cookedPath,
+        uint64_t                           key,
+        const std::vector<CookedAssetDep>& deps,
+        const std::vector<std::string>&    entityNames,
+        const std::vector<MeshEntity*>&    meshEntities)
+    {
+        ASSERT(entityNames.size() == meshEntities.size(), "Each mesh entity should have a name.");
+
+        CookedWriter writer;
+
+        // The textures shared by several primitives are written once, by their first primitive.
+        std::set<uint64_t> writtenTexSrcIds;
+
+        CookedAssetHeader header{};
+        writer.Write(&header, sizeof(header)); // Patched at the end.
+
+        for (const auto& dep : deps)
+        {
+            writer.WriteString(dep.relPath);
+            writer.Align();
+            writer.WriteU64(dep.byteCnt);
+            writer.WriteU64(dep.lastWriteTime);
+        }
+
+        for (uint32_t entityIdx = 0; entityIdx < meshEntities.size(); entityIdx++)
+        {
+            const auto& meshPrimitives = meshEntities[entityIdx]->m_meshPrimitives;
+            writer.WriteString(entityNames[entityIdx]);
+            writer.WriteArray(meshEntities[entityIdx]->m_instanceMats);
+            writer.WriteU32(meshPrimitives.size());
+
+            for (const auto& meshPrimitive : meshPrimitives)
+            {
+                writer.WriteArray(meshPrimitive.m_posData);
+                writer.WriteArray(meshPrimitive.m_normalData);
+                writer.WriteArray(meshPrimitive.m_tangentData);
+                writer.WriteArray(meshPrimitive.m_texCoordData);
+                writer.WriteU32(meshPrimitive.m_idxType);
+                writer.WriteArray(meshPrimitive.m_idxDataUint8);
+                writer.WriteArray(meshPrimitive.m_idxDataUint16);
+                writer.WriteArray(meshPrimitive.m_idxDataUint32);
+                writer.WriteArray(meshPrimitive.m_meshletData.meshlets);
+                writer.WriteArray(meshPrimitive.m_meshletData.bounds);
+                writer.WriteArray(meshPrimitive.m_meshletData.vertIndices);
+                writer.WriteArray(meshPrimitive.m_meshletData.packedTris);
+                writer.WriteArray(meshPrimitive.m_lods);
+                writer.Write(meshPrimitive.m_boundingSphere, sizeof(meshPrimitive.m_boundingSphere));
+                writer.Write(meshPrimitive.m_worldBoundingSphere, sizeof(meshPrimitive.m_worldBoundingSphere));
+                writer.Write(meshPrimitive.m_texSamplers, sizeof(meshPrimitive.m_texSamplers));
+
+                for (uint32_t slot = 0; slot < MESH_TEX_CNT; slot++)
+                {
+                    uint64_t       srcId = meshPrimitive.m_texSrcIds[slot];
+                    const ImgInfo* pTex = meshPrimitive.GetTex((MeshTexSlot)slot);
+                    bool           isFirst = (pTex != nullptr) && writtenTexSrcIds.insert(srcId).second;
+                    writer.WriteU64((pTex != nullptr) ? srcId : 0);
+                    writer.WriteU32(isFirst);
+                    if (isFirst)
+                    {
+                        writer.WriteImgInfo(*pTex);
+                    }
+                }
+            }
+        }
+
+        auto& bytes = writer.GetBytes();
+
+        header.magic     = CookedAssetMagic;
+        header.version   = CookedAssetVersion;
+        header.key       = key;
+        header.byteCnt   = bytes.size();
+        header.entityCnt = meshEntities.size();
+        header.depCnt    = deps.size();
+        memcpy(bytes.data(), &header, sizeof(header));
+
+        return WriteBinaryFileAtomic(cookedPath, bytes.data(), bytes.size());
+    }
+
+    // ================================================================================================================
+    bool LoadCookedAsset(
+        const std::string&        cookedPath,
+        uint64_t                  key,
+        const std::string&        srcAbsPath,
+        std::vector<std::string>& oEntityNames,
+        std::vector<MeshEntity*>& oMeshEntities)
+    {
+        std::error_code ec;
+        uint64_t cookedByteCnt = std::filesystem::file_size(cookedPath, ec);
+        if (ec)
+        {
+            return false;
+        }
+
+        std::ifstream cookedFile(cookedPath, std::ios::binary | std::ios::in);
+        if (cookedFile.is_open() == false)
+        {
+            return false;
+        }
+
+        CookedReader reader(cookedFile, cookedByteCnt);
+
+        CookedAssetHeader header{};
+        reader.Read(&header, sizeof(header));
+        if (reader.IsFailed() ||
+            (header.magic != CookedAssetMagic) ||
+            (header.version != CookedAssetVersion) ||
+            (header.key != key) ||
+            (header.byteCnt != cookedByteCnt))
+        {
+            return false;
+        }
+
+        // Only the files that the source references are checked, so the unrelated files around it don't matter.
+        std::filesystem::path srcDir = std::filesystem::path(srcAbsPath).parent_path();
+        for (uint32_t depIdx = 0; depIdx < header.depCnt; depIdx++)
+        {
+            CookedAssetDep dep{};
+            reader.ReadString(dep.relPath);
+            reader.Align();
+            dep.byteCnt = reader.ReadU64();
+            dep.lastWriteTime = static_cast<int64_t>(reader.ReadU64());
+            if (reader.IsFailed())
+            {
+                return false;
+            }
+
+            CookedAssetDep curDep = StampCookedAssetDep(srcDir, dep.relPath);
+            if ((curDep.byteCnt == UINT64_MAX) ||
+                (curDep.byteCnt != dep.byteCnt) ||
+                (curDep.lastWriteTime != dep.lastWriteTime))
+            {
+                return false;
+            }
+        }
+
+        std::vector<std::string> entityNames(header.entityCnt);
+        std::vector<MeshEntity*> meshEntities;
+        meshEntities.reserve(header.entityCnt);
+
+        // Every source id's image is read once and shared by all its slots.
+        std::map<uint64_t, std::shared_ptr<const ImgInfo>> readTexs;
+
+        for (uint32_t entityIdx = 0; (entityIdx < header.entityCnt) && (reader.IsFailed() == false); entityIdx++)
+        {
+            reader.ReadString(entityNames[entityIdx]);
+
+            MeshEntity* pMeshEntity = new MeshEntity();
+            meshEntities.push_back(pMeshEntity);
+            reader.ReadArray(pMeshEntity->m_instanceMats);
+
+            uint32_t primitiveCnt = reader.ReadU32();
+            if (primitiveCnt > cookedByteCnt)
+            {
+                reader.SetFailed();
+                break;
+            }
+
+            pMeshEntity->m_meshPrimitives.resize(primitiveCnt);
+            for (auto& meshPrimitive : pMeshEntity->m_meshPrimitives)
+            {
+                reader.ReadArray(meshPrimitive.m_posData);
+                reader.ReadArray(meshPrimitive.m_normalData);
+                reader.ReadArray(meshPrimitive.m_tangentData);
+                reader.ReadArray(meshPrimitive.m_texCoordData);
+                meshPrimitive.m_idxType = static_cast<VkIndexType>(reader.ReadU32());
+                reader.ReadArray(meshPrimitive.m_idxDataUint8);
+                reader.ReadArray(meshPrimitive.m_idxDataUint16);
+                reader.ReadArray(meshPrimitive.m_idxDataUint32);
+                reader.ReadArray(meshPrimitive.m_meshletData.meshlets);
+                reader.ReadArray(meshPrimitive.m_meshletData.bounds);
+                reader.ReadArray(meshPrimitive.m_meshletData.vertIndices);
+                reader.ReadArray(meshPrimitive.m_meshletData.packedTris);
+                reader.ReadArray(meshPrimitive.m_lods);
+                reader.Read(meshPrimitive.m_boundingSphere, sizeof(meshPrimitive.m_boundingSphere));
+                reader.Read(meshPrimitive.m_worldBoundingSphere, sizeof(meshPrimitive.m_worldBoundingSphere));
+                reader.Read(meshPrimitive.m_texSamplers, sizeof(meshPrimitive.m_texSamplers));
+
+                for (uint32_t slot = 0; slot < MESH_TEX_CNT; slot++)
+                {
+                    uint64_t srcId = reader.ReadU64();
+                    if (reader.ReadU32() != 0)
+                    {
+                        auto tex = std::make_shared<ImgInfo>();
+                        reader.ReadImgInfo(*tex);
+                        readTexs[srcId] = tex;
+                        meshPrimitive.SetCpuTex((MeshTexSlot)slot, tex, srcId);
+                    }
+                    else if (srcId != 0)
+                    {
+                        auto texItr = readTexs.find(srcId);
+                        if (texItr == readTexs.end())
+                        {
+                            reader.SetFailed();
+                            break;
+                        }
+                        meshPrimitive.SetCpuTex((MeshTexSlot)slot, texItr->second, srcId);
+                    }
+                }
+            }
+        }
+
+        if (reader.IsFailed())
+        {
+            for (auto pMeshEntity : meshEntities)
+            {
+                delete pMeshEntity;
+            }
+            return false;
+        }
+
+        oEntityNames  = std::move(entityNames);
+        oMeshEntities = std::move(meshEntities);
+        return true;
+    }
+}
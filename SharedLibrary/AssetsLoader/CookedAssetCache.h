@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace SharedLib
+{
+    class MeshEntity;
+    struct AssetsLoaderOptions;
+
+    // The cooked asset is a versioned binary dump of the decoded MeshEntities (geometry and decoded textures), so a
+    // load can skip the source file parsing entirely. The load streams each array straight into its final vector.
+    //
+    // Layout: CookedAssetHeader | dependency 0 | dependency 1 | ... | entity 0 | entity 1 | ...
+    //         dependency := relative path | byte count | last write time
+    //         entity     := name | instance matrices | primitive count | primitive 0 | primitive 1 | ...
+    //         primitive  := pos | normal | tangent | uv | idx type | 8, 16 and 32 bits indices | meshlets | lods |
+    //                       bounding sphere | world bounding sphere | 4 texture samplers | 4 textures
+    //         texture    := texel source id | is first | image, only if it is the source id's first texture. The id 0
+    //                       is a slot without a texture and never has an image.
+    //         image      := width | height | component count | component type | texels | mip byte offsets | format
+    // Every array is stored as an element count followed by the raw elements, starting at an 8 bytes aligned offset.
+
+    // Bump it whenever the cooked layout or the loader's decoded output changes, so stale cooked files are rebuilt.
+    const uint32_t CookedAssetVersion = 14;
+
+    // A file that the source references, e.g. a gltf's external buffer or image. Its path is relative to the source
+    // file's directory. Its size and last write time are checked on the load, which is much cheaper than hashing its
+    // content and still catches a re-export.
+    struct CookedAssetDep
+    {
+        std::string relPath;
+        uint64_t    byteCnt;
+        int64_t     lastWriteTime;
+    };
+
+    // The key is a hash of the source file's content and the loader options that change the decoded data. The files
+    // that the source references are validated by their CookedAssetDeps instead.
+    uint64_t ComputeCookedAssetKey(const std::string& srcAbsPath, const AssetsLoaderOptions& options);
+
+    std::string GetCookedAssetPath(const std::string& srcAbsPath, const AssetsLoaderOptions& options);
+
+    // Stats the relPaths, relative to the source file's directory. A duplicated path is only stamped once.
+    std::vector<CookedAssetDep> StampCookedAssetDeps(const std::string&              srcAbsPath,
+                                                     const std::vector<std::string>& relPaths);
+
+    bool SaveCookedAsset(const std::string&                 cookedPath,
+                         uint64_t                           key,
+                         const std::vector<CookedAssetDep>& deps,
+                         const std::vector<std::string>&    entityNames,
+                         const std::vector<MeshEntity*>&    meshEntities);
+
+    // Returns false if the cooked file doesn't exist, is from another version, has a different key, has a dependency
+    // that changed or is missing, or is truncated. The output vectors are only filled on success.
+    bool LoadCookedAsset(const std::string&        cookedPath,
+                         uint64_t                  key,
+                         const std::string&        srcAbsPath,
+                         std::vector<std::string>& oEntityNames,
+                         std::vector<MeshEntity*>& oMeshEntities);
+}
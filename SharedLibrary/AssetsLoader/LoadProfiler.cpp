@@ -0,0 +1,157 @@
+#include "LoadProfiler.h"
+#include <cstdio>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#elif !defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+namespace SharedLib
+{
+    // ================================================================================================================
+    void LoadProfiler::Reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (uint32_t phase = 0; phase < LOAD_PHASE_CNT; phase++)
+        {
+            m_phaseStats[phase] = LoadPhaseStats{};
+        }
+    }
+
+    // ================================================================================================================
+    void LoadProfiler::AddSample(
+        LoadPhase phase,
+        double    milliseconds,
+        uint64_t  byteCnt)
+    {
+        // The peak is read outside of the lock. It only grows, so the max keeps the latest one.
+        uint64_t peakRssBytes = m_isPhasePeakRssEnabled ? GetProcessPeakRssBytes() : 0;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        LoadPhaseStats& stats = m_phaseStats[phase];
+        stats.milliseconds += milliseconds;
+        stats.byteCnt += byteCnt;
+        stats.sampleCnt++;
+        stats.peakRssBytes = std::max(stats.peakRssBytes, peakRssBytes);
+    }
+
+    // ================================================================================================================
+    LoadPhaseStats LoadProfiler::GetPhaseStats(
+        LoadPhase phase) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_phaseStats[phase];
+    }
+
+    // ================================================================================================================
+    const char* LoadProfiler::GetPhaseName(
+        LoadPhase phase)
+    {
+        switch (phase)
+        {
+        case LOAD_PHASE_FILE_IO:
+            return "file_io";
+        case LOAD_PHASE_PARSE:
+            return "parse";
+        case LOAD_PHASE_ACCESSOR_DECODE:
+            return "accessor_decode";
+        case LOAD_PHASE_IMAGE_DECODE:
+            return "image_decode";
+        case LOAD_PHASE_MESH_PROCESSING:
+            return "mesh_processing";
+        case LOAD_PHASE_GPU_UPLOAD:
+            return "gpu_upload";
+        default:
+            return "unknown";
+        }
+    }
+
+    // ================================================================================================================
+    ScopedLoadPhase::ScopedLoadPhase(
+        LoadProfiler* pProfiler,
+        LoadPhase     phase,
+        uint64_t      byteCnt)
+        : m_pProfiler(pProfiler),
+          m_phase(phase),
+          m_byteCnt(byteCnt),
+          m_start(std::chrono::high_resolution_clock::now())
+    {}
+
+    // ================================================================================================================
+    void ScopedLoadPhase::End()
+    {
+        if (m_pProfiler != nullptr)
+        {
+            const auto end = std::chrono::high_resolution_clock::now();
+            m_pProfiler->AddSample(m_phase,
+                                   std::chrono::duration<double, std::milli>(end - m_start).count(),
+                                   m_byteCnt);
+            m_pProfiler = nullptr;
+        }
+    }
+
+    // ================================================================================================================
+    uint64_t GetProcessPeakRssBytes()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS memCounters{};
+        if (K32GetProcessMemoryInfo(GetCurrentProcess(), &memCounters, sizeof(memCounters)))
+        {
+            return memCounters.PeakWorkingSetSize;
+        }
+        return 0;
+#elif defined(__linux__)
+        // The VmHWM instead of the getrusage(...), whose peak also keeps the exited threads' high water mark and so
+        // can't be reset.
+        FILE* pStatus = fopen("/proc/self/status", "r");
+        if (pStatus == nullptr)
+        {
+            return 0;
+        }
+
+        uint64_t peakRssBytes = 0;
+        char line[256];
+        while (fgets(line, sizeof(line), pStatus) != nullptr)
+        {
+            unsigned long long peakRssKb = 0;
+            if (sscanf(line, "VmHWM: %llu kB", &peakRssKb) == 1)
+            {
+                peakRssBytes = peakRssKb * 1024;
+                break;
+            }
+        }
+        fclose(pStatus);
+        return peakRssBytes;
+#else
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+        {
+            return 0;
+        }
+        return usage.ru_maxrss; // Bytes on macOS.
+#endif
+    }
+
+    // ================================================================================================================
+    bool ResetProcessPeakRss()
+    {
+#if defined(__linux__)
+        // Writing 5 to the clear_refs resets the peak RSS to the current RSS since the Linux 4.0.
+        FILE* pClearRefs = fopen("/proc/self/clear_refs", "w");
+        if (pClearRefs == nullptr)
+        {
+            return false;
+        }
+        bool isReset = (fputs("5", pClearRefs) >= 0);
+        isReset = (fclose(pClearRefs) == 0) && isReset;
+        return isReset;
+#else
+        return false;
+#endif
+    }
+}
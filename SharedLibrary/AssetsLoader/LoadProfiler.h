@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+
+namespace SharedLib
+{
+    // The phases of an asset load. A phase can be recorded many times per load, e.g. once per primitive.
+    enum LoadPhase
+    {
+        LOAD_PHASE_FILE_IO,         // Reading or mapping the source file, or loading the whole cooked asset.
+        LOAD_PHASE_PARSE,           // The gltf's JSON, or the obj's text. The TinyGltf also reads the external buffers
+                                    // and images that a .gltf references in it.
+        LOAD_PHASE_ACCESSOR_DECODE, // Copying the source's vertex attributes and indices into the primitives.
+        LOAD_PHASE_IMAGE_DECODE,    // Decoding the material images and baking their mips and block compression.
+        LOAD_PHASE_MESH_PROCESSING, // Generating the normals and tangents, welding, optimizing, LODs and meshlets.
+        LOAD_PHASE_GPU_UPLOAD,      // Creating and filling the entities' buffers and textures.
+        LOAD_PHASE_CNT
+    };
+
+    struct LoadPhaseStats
+    {
+        // The phases that run on several workers at once sum their threads' times, so they can exceed the load's wall
+        // time. The serial phases are wall time.
+        double   milliseconds;
+        uint64_t byteCnt;      // The bytes that the phase consumed or produced. See the phases' records.
+        uint32_t sampleCnt;
+        uint64_t peakRssBytes; // The process' peak resident set when the phase's last sample ended. 0 unless the
+                               // profiler's per sample peak RSS is enabled.
+    };
+
+    // Accumulates the per phase timings of the loads. It is thread safe, so the workers record into it directly. The
+    // loaders always record into it, so a sample only takes the time and the byte count by default. The per phase peak
+    // RSS costs a read of the process' memory counters per sample, e.g. a parse of the /proc/self/status on Linux, so
+    // it is opt-in and the callers that only need the run's peak read the GetProcessPeakRssBytes() once at its end.
+    class LoadProfiler
+    {
+    public:
+        LoadProfiler() { Reset(); }
+
+        // The Reset() keeps it. Only change it while no phase is being recorded.
+        void SetPhasePeakRssEnabled(bool isEnabled) { m_isPhasePeakRssEnabled = isEnabled; }
+
+        void Reset();
+        void AddSample(LoadPhase phase, double milliseconds, uint64_t byteCnt);
+
+        LoadPhaseStats     GetPhaseStats(LoadPhase phase) const;
+        static const char* GetPhaseName(LoadPhase phase);
+
+    private:
+        mutable std::mutex m_mutex;
+        LoadPhaseStats     m_phaseStats[LOAD_PHASE_CNT];
+        bool               m_isPhasePeakRssEnabled = false;
+    };
+
+    // Records its scope's time into the profiler's phase when it is destroyed, or at the End() when the phase stops
+    // before the scope does. A null profiler records nothing.
+    class ScopedLoadPhase
+    {
+    public:
+        ScopedLoadPhase(LoadProfiler* pProfiler, LoadPhase phase, uint64_t byteCnt = 0);
+        ~ScopedLoadPhase() { End(); }
+
+        void SetByteCnt(uint64_t byteCnt) { m_byteCnt = byteCnt; }
+        void End();
+
+    private:
+        LoadProfiler* m_pProfiler;
+        LoadPhase     m_phase;
+        uint64_t      m_byteCnt;
+
+        std::chrono::high_resolution_clock::time_point m_start;
+    };
+
+    // The process' peak resident set size so far. 0 when the platform doesn't report it.
+    uint64_t GetProcessPeakRssBytes();
+
+    // Restarts the peak resident set size from the current one. Only Linux supports it, elsewhere it returns false and
+    // the peak keeps covering the whole process.
+    bool ResetProcessPeakRss();
+}
@@ -0,0 +1,608 @@
+#include "ObjParser.h"
+#include "../Utils/ThreadUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+namespace SharedLib
+{
+    // Texts below it are parsed in one chunk, where the threads' start up would cost more than the parsing.
+    static const uint64_t MinObjChunkByteCnt = 1 << 20;
+
+    // A corner whose indices were negative, i.e. relative to the end of the pools at its face. The chunk only knows its
+    // own pools' sizes, so the relative indices are resolved against the chunk's pools and fixed up by the chunk's
+    // pools' offsets once all the chunks are parsed.
+    struct ObjRelativeCorner
+    {
+        uint32_t cornerIdx;
+        uint32_t relativeMask; // Bit 0: position, bit 1: uv, bit 2: normal.
+    };
+
+    struct ObjChunk
+    {
+        std::vector<float>                            positions;
+        std::vector<float>                            uvs;
+        std::vector<float>                            normals;
+        std::vector<ObjCorner>                        corners;
+        std::vector<ObjRelativeCorner>                relativeCorners;
+        std::vector<std::pair<std::string, uint32_t>> groupStarts; // <Name, first chunk corner>.
+        std::string                                   err;
+    };
+
+    // ================================================================================================================
+    static inline bool IsObjSpace(
+        char c)
+    {
+        return (c == ' ') || (c == '\t') || (c == '\r');
+    }
+
+    // ================================================================================================================
+    static inline bool IsDigit(
+        char c)
+    {
+        return (c >= '0') && (c <= '9');
+    }
+
+    // ================================================================================================================
+    static inline const char* SkipObjSpaces(
+        const char* p,
+        const char* pEnd)
+    {
+        while ((p < pEnd) && IsObjSpace(*p))
+        {
+            p++;
+        }
+        return p;
+    }
+
+    // ================================================================================================================
+    // Decimal floats with an optional exponent. The digits are accumulated into an integer and scaled once, which is
+    // within an ulp of the correctly rounded float and a lot faster than the locale aware strtof(...).
+    static const char* ParseObjFloat(
+        const char* p,
+        const char* pEnd,
+        float&      oValue,
+        bool&       oIsValid)
+    {
+        static const double Pow10s[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+        p = SkipObjSpaces(p, pEnd);
+
+        bool isNegative = false;
+        if ((p < pEnd) && ((*p == '-') || (*p == '+')))
+        {
+            isNegative = (*p == '-');
+            p++;
+        }
+
+        // Digits beyond the 18th don't fit the mantissa and only shift the exponent.
+        const uint64_t MaxMantissa = 100000000000000000ull;
+        uint64_t mantissa = 0;
+        int32_t  exponent = 0;
+        bool     hasDigits = false;
+        while ((p < pEnd) && IsDigit(*p))
+        {
+            if (mantissa < MaxMantissa)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+            }
+            else
+            {
+                exponent++;
+            }
+            hasDigits = true;
+            p++;
+        }
+
+        if ((p < pEnd) && (*p == '.'))
+        {
+            p++;
+            while ((p < pEnd) && IsDigit(*p))
+            {
+                if (mantissa < MaxMantissa)
+                {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    exponent--;
+                }
+                hasDigits = true;
+                p++;
+            }
+        }
+
+        if (hasDigits == false)
+        {
+            oIsValid = false;
+            return p;
+        }
+
+        if ((p < pEnd) && ((*p == 'e') || (*p == 'E')))
+        {
+            p++;
+            bool isExpNegative = false;
+            if ((p < pEnd) && ((*p == '-') || (*p == '+')))
+            {
+                isExpNegative = (*p == '-');
+                p++;
+            }
+
+            int32_t expValue = 0;
+            while ((p < pEnd) && IsDigit(*p))
+            {
+                expValue = std::min(expValue * 10 + (*p - '0'), 1000);
+                p++;
+            }
+            exponent += isExpNegative ? -expValue : expValue;
+        }
+
+        double value = (double)mantissa;
+        uint32_t absExponent = std::abs(exponent);
+        double scale = (absExponent <= 22) ? Pow10s[absExponent] : std::pow(10.0, (double)absExponent);
+        value = (exponent < 0) ? value / scale : value * scale;
+
+        oValue = (float)(isNegative ? -value : value);
+        return p;
+    }
+
+    // ================================================================================================================
+    static const char* ParseObjInt(
+        const char* p,
+        const char* pEnd,
+        int32_t&    oValue,
+        bool&       oIsValid)
+    {
+        bool isNegative = false;
+        if ((p < pEnd) && ((*p == '-') || (*p == '+')))
+        {
+            isNegative = (*p == '-');
+            p++;
+        }
+
+        if ((p >= pEnd) || (IsDigit(*p) == false))
+        {
+            oIsValid = false;
+            return p;
+        }
+
+        int64_t value = 0;
+        while ((p < pEnd) && IsDigit(*p))
+        {
+            value = std::min<int64_t>(value * 10 + (*p - '0'), INT32_MAX);
+            p++;
+        }
+
+        oValue = (int32_t)(isNegative ? -value : value);
+        return p;
+    }
+
+    // ================================================================================================================
+    // Parses up to cnt floats and fills the missing ones with the defaults. At least minCnt floats are required.
+    static bool ParseObjFloats(
+        const char*  p,
+        const char*  pEnd,
+        uint32_t     minCnt,
+        uint32_t     cnt,
+        const float* pDefaults,
+        float*       oValues)
+    {
+        for (uint32_t i = 0; i < cnt; i++)
+        {
+            p = SkipObjSpaces(p, pEnd);
+            if (p == pEnd)
+            {
+                if (i < minCnt)
+                {
+                    return false;
+                }
+                oValues[i] = pDefaults[i];
+                continue;
+            }
+
+            bool isValid = true;
+            p = ParseObjFloat(p, pEnd, oValues[i], isValid);
+            if (isValid == false)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // ================================================================================================================
+    // A chunk local index from an obj index. Positive indices are absolute and 1 based, negative ones count back from
+    // the current end of the pool and are marked as relative.
+    static bool ResolveObjIdx(
+        int32_t   objIdx,
+        uint32_t  poolCnt,
+        uint32_t  relativeBit,
+        int32_t&  oIdx,
+        uint32_t& ioRelativeMask)
+    {
+        if (objIdx > 0)
+        {
+            oIdx = objIdx - 1;
+        }
+        else if (objIdx < 0)
+        {
+            oIdx = (int32_t)poolCnt + objIdx;
+            ioRelativeMask |= relativeBit;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    // ================================================================================================================
+    // Parses the corners of a face line and appends its triangle fan.
+    static bool ParseObjFace(
+        const char*             p,
+        const char*             pEnd,
+        ObjChunk&               chunk,
+        std::vector<ObjCorner>& faceCorners,
+        std::vector<uint32_t>&  faceRelativeMasks)
+    {
+        faceCorners.clear();
+        faceRelativeMasks.clear();
+
+        uint32_t posCnt = chunk.positions.size() / 3;
+        uint32_t uvCnt = chunk.uvs.size() / 2;
+        uint32_t normalCnt = chunk.normals.size() / 3;
+
+        while (true)
+        {
+            p = SkipObjSpaces(p, pEnd);
+            if (p == pEnd)
+            {
+                break;
+            }
+
+            // v, v/vt, v//vn or v/vt/vn.
+            ObjCorner corner = { -1, -1, -1 };
+            uint32_t  relativeMask = 0;
+            int32_t   objIdx = 0;
+            bool      isValid = true;
+
+            p = ParseObjInt(p, pEnd, objIdx, isValid);
+            if ((isValid == false) || (ResolveObjIdx(objIdx, posCnt, 1, corner.posIdx, relativeMask) == false))
+            {
+                return false;
+            }
+
+            if ((p < pEnd) && (*p == '/'))
+            {
+                p++;
+                if ((p < pEnd) && (*p != '/'))
+                {
+                    p = ParseObjInt(p, pEnd, objIdx, isValid);
+                    if ((isValid == false) || (ResolveObjIdx(objIdx, uvCnt, 2, corner.uvIdx, relativeMask) == false))
+                    {
+                        return false;
+                    }
+                }
+
+                if ((p < pEnd) && (*p == '/'))
+                {
+                    p++;
+                    p = ParseObjInt(p, pEnd, objIdx, isValid);
+                    if ((isValid == false) ||
+                        (ResolveObjIdx(objIdx, normalCnt, 4, corner.normalIdx, relativeMask) == false))
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            if ((p < pEnd) && (IsObjSpace(*p) == false))
+            {
+                return false;
+            }
+
+            faceCorners.push_back(corner);
+            faceRelativeMasks.push_back(relativeMask);
+        }
+
+        if (faceCorners.size() < 3)
+        {
+            return false;
+        }
+
+        for (uint32_t i = 2; i < faceCorners.size(); i++)
+        {
+            const uint32_t fanCorners[3] = { 0, i - 1, i };
+            for (uint32_t fanCorner : fanCorners)
+            {
+                if (faceRelativeMasks[fanCorner] != 0)
+                {
+                    chunk.relativeCorners.push_back({ (uint32_t)chunk.corners.size(), faceRelativeMasks[fanCorner] });
+                }
+                chunk.corners.push_back(faceCorners[fanCorner]);
+            }
+        }
+        return true;
+    }
+
+    // ================================================================================================================
+    static void ParseObjChunk(
+        const char* pBegin,
+        const char* pEnd,
+        ObjChunk&   oChunk)
+    {
+        std::vector<ObjCorner> faceCorners;
+        std::vector<uint32_t>  faceRelativeMasks;
+
+        const float defaults[3] = { 0.f, 0.f, 0.f };
+
+        const char* p = pBegin;
+        while (p < pEnd)
+        {
+            const char* pLineEnd = static_cast<const char*>(memchr(p, '\n', pEnd - p));
+            pLineEnd = (pLineEnd == nullptr) ? pEnd : pLineEnd;
+
+            const char* pLine = SkipObjSpaces(p, pLineEnd);
+            uint64_t    lineCharCnt = pLineEnd - pLine;
+            bool        isValid = true;
+
+            if ((lineCharCnt >= 2) && (pLine[0] == 'v') && IsObjSpace(pLine[1]))
+            {
+                float pos[3];
+                isValid = ParseObjFloats(pLine + 2, pLineEnd, 3, 3, defaults, pos);
+                oChunk.positions.insert(oChunk.positions.end(), pos, pos + 3);
+            }
+            else if ((lineCharCnt >= 3) && (pLine[0] == 'v') && (pLine[1] == 't') && IsObjSpace(pLine[2]))
+            {
+                float uv[2];
+                isValid = ParseObjFloats(pLine + 3, pLineEnd, 1, 2, defaults, uv);
+                oChunk.uvs.insert(oChunk.uvs.end(), uv, uv + 2);
+            }
+            else if ((lineCharCnt >= 3) && (pLine[0] == 'v') && (pLine[1] == 'n') && IsObjSpace(pLine[2]))
+            {
+                float normal[3];
+                isValid = ParseObjFloats(pLine + 3, pLineEnd, 3, 3, defaults, normal);
+                oChunk.normals.insert(oChunk.normals.end(), normal, normal + 3);
+            }
+            else if ((lineCharCnt >= 2) && (pLine[0] == 'f') && IsObjSpace(pLine[1]))
+            {
+                isValid = ParseObjFace(pLine + 2, pLineEnd, oChunk, faceCorners, faceRelativeMasks);
+            }
+            else if ((lineCharCnt >= 1) && ((pLine[0] == 'o') || (pLine[0] == 'g')) &&
+                     ((lineCharCnt == 1) || IsObjSpace(pLine[1])))
+            {
+                const char* pName = SkipObjSpaces(pLine + 1, pLineEnd);
+                const char* pNameEnd = pLineEnd;
+                while ((pNameEnd > pName) && IsObjSpace(pNameEnd[-1]))
+                {
+                    pNameEnd--;
+                }
+                oChunk.groupStarts.push_back({ std::string(pName, pNameEnd), (uint32_t)oChunk.corners.size() });
+            }
+
+            if (isValid == false)
+            {
+                oChunk.err = "Malformed obj line: " + std::string(pLine, std::min<uint64_t>(lineCharCnt, 64));
+                return;
+            }
+
+            p = pLineEnd + 1;
+        }
+    }
+
+    // ================================================================================================================
+    bool ParseObj(
+        const char*  pText,
+        uint64_t     byteCnt,
+        ThreadPool*  pThreadPool,
+        ObjData&     oData,
+        std::string& oErr)
+    {
+        oData = ObjData{};
+
+        auto parallelFor = [pThreadPool](uint32_t taskCnt, const std::function<void(uint32_t)>& func) {
+            if (pThreadPool != nullptr)
+            {
+                pThreadPool->ParallelFor(taskCnt, func);
+            }
+            else
+            {
+                for (uint32_t i = 0; i < taskCnt; i++)
+                {
+                    func(i);
+                }
+            }
+        };
+
+        // A few chunks per thread balance the chunks with more faces than others. The chunks start after a line end.
+        uint64_t maxChunkCnt = (pThreadPool != nullptr) ? 4 * std::max(pThreadPool->GetThreadCnt(), 1u) : 1;
+        uint64_t chunkCnt = std::clamp<uint64_t>(byteCnt / MinObjChunkByteCnt, 1, maxChunkCnt);
+
+        std::vector<uint64_t> chunkBegins(chunkCnt + 1, byteCnt);
+        chunkBegins[0] = 0;
+        for (uint64_t i = 1; i < chunkCnt; i++)
+        {
+            uint64_t begin = std::max(i * byteCnt / chunkCnt, chunkBegins[i - 1]);
+            const void* pLineEnd = memchr(pText + begin, '\n', byteCnt - begin);
+            chunkBegins[i] = (pLineEnd == nullptr) ? byteCnt : (static_cast<const char*>(pLineEnd) - pText + 1);
+        }
+
+        std::vector<ObjChunk> chunks(chunkCnt);
+        parallelFor(chunkCnt, [&](uint32_t chunkIdx) {
+            ParseObjChunk(pText + chunkBegins[chunkIdx], pText + chunkBegins[chunkIdx + 1], chunks[chunkIdx]);
+        });
+
+        for (const auto& chunk : chunks)
+        {
+            if (chunk.err.empty() == false)
+            {
+                oErr = chunk.err;
+                return false;
+            }
+        }
+
+        // The chunks' offsets in the concatenated pools.
+        std::vector<uint32_t> posBases(chunkCnt + 1, 0);
+        std::vector<uint32_t> uvBases(chunkCnt + 1, 0);
+        std::vector<uint32_t> normalBases(chunkCnt + 1, 0);
+        std::vector<uint32_t> cornerBases(chunkCnt + 1, 0);
+        for (uint64_t i = 0; i < chunkCnt; i++)
+        {
+            posBases[i + 1] = posBases[i] + chunks[i].positions.size() / 3;
+            uvBases[i + 1] = uvBases[i] + chunks[i].uvs.size() / 2;
+            normalBases[i + 1] = normalBases[i] + chunks[i].normals.size() / 3;
+            cornerBases[i + 1] = cornerBases[i] + chunks[i].corners.size();
+        }
+
+        oData.positions.resize(3 * posBases[chunkCnt]);
+        oData.uvs.resize(2 * uvBases[chunkCnt]);
+        oData.normals.resize(3 * normalBases[chunkCnt]);
+        oData.corners.resize(cornerBases[chunkCnt]);
+
+        // Only the relative indices need the previous chunks' pools. All the indices are checked against the whole
+        // pools here, since a chunk may refer to the positions of any other chunk.
+        int32_t posCnt = posBases[chunkCnt];
+        int32_t uvCnt = uvBases[chunkCnt];
+        int32_t normalCnt = normalBases[chunkCnt];
+        std::vector<uint8_t> isChunkValids(chunkCnt, 1);
+        parallelFor(chunkCnt, [&](uint32_t chunkIdx) {
+            ObjChunk& chunk = chunks[chunkIdx];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), oData.positions.begin() + 3 * posBases[chunkIdx]);
+            std::copy(chunk.uvs.begin(), chunk.uvs.end(), oData.uvs.begin() + 2 * uvBases[chunkIdx]);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), oData.normals.begin() + 3 * normalBases[chunkIdx]);
+
+            for (const auto& relativeCorner : chunk.relativeCorners)
+            {
+                ObjCorner& corner = chunk.corners[relativeCorner.cornerIdx];
+                corner.posIdx += (relativeCorner.relativeMask & 1) ? posBases[chunkIdx] : 0;
+                corner.uvIdx += (relativeCorner.relativeMask & 2) ? uvBases[chunkIdx] : 0;
+                corner.normalIdx += (relativeCorner.relativeMask & 4) ? normalBases[chunkIdx] : 0;
+            }
+
+            for (const auto& corner : chunk.corners)
+            {
+                if ((corner.posIdx < 0) || (corner.posIdx >= posCnt) ||
+                    (corner.uvIdx < -1) || (corner.uvIdx >= uvCnt) ||
+                    (corner.normalIdx < -1) || (corner.normalIdx >= normalCnt))
+                {
+                    isChunkValids[chunkIdx] = 0;
+                    break;
+                }
+            }
+            std::copy(chunk.corners.begin(), chunk.corners.end(), oData.corners.begin() + cornerBases[chunkIdx]);
+        });
+
+        if (std::find(isChunkValids.begin(), isChunkValids.end(), 0) != isChunkValids.end())
+        {
+            oErr = "The obj has out of range face indices.";
+            return false;
+        }
+
+        // A group lasts until the next group's start, which can be in a later chunk.
+        oData.groups.push_back({ "", 0, 0 });
+        for (uint64_t i = 0; i < chunkCnt; i++)
+        {
+            for (const auto& groupStart : chunks[i].groupStarts)
+            {
+                oData.groups.push_back({ groupStart.first, cornerBases[i] + groupStart.second, 0 });
+            }
+        }
+
+        for (uint32_t i = 0; i < oData.groups.size(); i++)
+        {
+            uint32_t groupEnd = (i + 1 < oData.groups.size()) ? oData.groups[i + 1].firstCorner : cornerBases[chunkCnt];
+            oData.groups[i].cornerCnt = groupEnd - oData.groups[i].firstCorner;
+        }
+
+        oData.groups.erase(std::remove_if(oData.groups.begin(),
+                                          oData.groups.end(),
+                                          [](const ObjGroup& group) { return group.cornerCnt == 0; }),
+                           oData.groups.end());
+        return true;
+    }
+
+    // ================================================================================================================
+    static inline uint32_t HashObjCorner(
+        const ObjCorner& corner)
+    {
+        uint32_t hash = (uint32_t)corner.posIdx * 0x9E3779B1u;
+        hash ^= (uint32_t)corner.uvIdx * 0x85EBCA77u;
+        hash ^= (uint32_t)corner.normalIdx * 0xC2B2AE3Du;
+        hash ^= hash >> 15;
+        hash *= 0x2C1B3C6Du;
+        hash ^= hash >> 12;
+        return hash;
+    }
+
+    // ================================================================================================================
+    void BuildObjGroupVertices(
+        const ObjData&         objData,
+        const ObjGroup&        group,
+        std::vector<float>&    oPos,
+        std::vector<float>&    oUvs,
+        std::vector<float>&    oNormals,
+        std::vector<uint32_t>& oIndices)
+    {
+        const ObjCorner* pCorners = &objData.corners[group.firstCorner];
+
+        bool hasUvs = true;
+        bool hasNormals = true;
+        for (uint32_t i = 0; i < group.cornerCnt; i++)
+        {
+            hasUvs = hasUvs && (pCorners[i].uvIdx >= 0);
+            hasNormals = hasNormals && (pCorners[i].normalIdx >= 0);
+        }
+
+        // Open addressing with the linear probing. The table is at most half full.
+        uint32_t tableSize = 16;
+        while (tableSize < 2 * group.cornerCnt)
+        {
+            tableSize *= 2;
+        }
+        std::vector<uint32_t> table(tableSize, UINT32_MAX);
+
+        std::vector<ObjCorner> vertCorners;
+        oIndices.resize(group.cornerCnt);
+        for (uint32_t i = 0; i < group.cornerCnt; i++)
+        {
+            ObjCorner corner = pCorners[i];
+            corner.uvIdx = hasUvs ? corner.uvIdx : -1;
+            corner.normalIdx = hasNormals ? corner.normalIdx : -1;
+
+            uint32_t slot = HashObjCorner(corner) & (tableSize - 1);
+            while (table[slot] != UINT32_MAX)
+            {
+                const ObjCorner& vertCorner = vertCorners[table[slot]];
+                if ((vertCorner.posIdx == corner.posIdx) &&
+                    (vertCorner.uvIdx == corner.uvIdx) &&
+                    (vertCorner.normalIdx == corner.normalIdx))
+                {
+                    break;
+                }
+                slot = (slot + 1) & (tableSize - 1);
+            }
+
+            if (table[slot] == UINT32_MAX)
+            {
+                table[slot] = vertCorners.size();
+                vertCorners.push_back(corner);
+            }
+            oIndices[i] = table[slot];
+        }
+
+        oPos.resize(3 * vertCorners.size());
+        oUvs.resize(hasUvs ? 2 * vertCorners.size() : 0);
+        oNormals.resize(hasNormals ? 3 * vertCorners.size() : 0);
+        for (uint32_t i = 0; i < vertCorners.size(); i++)
+        {
+            memcpy(&oPos[3 * i], &objData.positions[3 * vertCorners[i].posIdx], 3 * sizeof(float));
+            if (hasUvs)
+            {
+                memcpy(&oUvs[2 * i], &objData.uvs[2 * vertCorners[i].uvIdx], 2 * sizeof(float));
+            }
+            if (hasNormals)
+            {
+                memcpy(&oNormals[3 * i], &objData.normals[3 * vertCorners[i].normalIdx], 3 * sizeof(float));
+            }
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SharedLib
+{
+    class ThreadPool;
+
+    // One face corner of the obj. The indices are zero based into the ObjData's pools and -1 means that the corner
+    // doesn't have the attribute.
+    struct ObjCorner
+    {
+        int32_t posIdx;
+        int32_t uvIdx;
+        int32_t normalIdx;
+    };
+
+    // The corners of the faces after an 'o' or a 'g' line. The faces before the first one are in a group without a
+    // name. Empty groups are dropped.
+    struct ObjGroup
+    {
+        std::string name;
+        uint32_t    firstCorner;
+        uint32_t    cornerCnt;
+    };
+
+    // The obj's attribute pools and its triangulated faces, 3 corners per triangle. Polygons are split into triangle
+    // fans. Only the geometry is kept, the materials, smoothing groups, lines and points are skipped.
+    struct ObjData
+    {
+        std::vector<float>     positions; // 3 floats per position.
+        std::vector<float>     uvs;       // 2 floats per uv.
+        std::vector<float>     normals;   // 3 floats per normal.
+        std::vector<ObjCorner> corners;
+        std::vector<ObjGroup>  groups;
+    };
+
+    // Parses the obj text. Large texts are cut into chunks at the line ends and the chunks are parsed concurrently on
+    // the pThreadPool, then their pools are concatenated and the relative (negative) indices are resolved against the
+    // concatenated pools. Returns false with the oErr for malformed or out of range data.
+    bool ParseObj(const char*  pText,
+                  uint64_t     byteCnt,
+                  ThreadPool*  pThreadPool,
+                  ObjData&     oData,
+                  std::string& oErr);
+
+    // The indexed vertices of a group. Each distinct (position, uv, normal) corner becomes one vertex, so the corners
+    // that the obj faces share are shared by the triangles as well. The uvs and the normals are only output when all
+    // the group's corners have them, otherwise their vector is empty.
+    void BuildObjGroupVertices(const ObjData&         objData,
+                               const ObjGroup&        group,
+                               std::vector<float>&    oPos,
+                               std::vector<float>&    oUvs,
+                               std::vector<float>&    oNormals,
+                               std::vector<uint32_t>& oIndices);
+}
@@ -0,0 +1,201 @@
+#include "TextureBaker.h"
+#include "AssetsLoader.h"
+#include <cstdio>
+
+namespace SharedLib
+{
+    // Indexed by the TexCompression.
+    static const char* TexCompressionNames[] = { "none", "BC1", "BC3", "BC4", "BC5", "BC7" };
+
+    // ================================================================================================================
+    TexBakeDesc GetTexBakeDesc(
+        const AssetsLoaderOptions& options,
+        MeshTexSlot                slot)
+    {
+        TexBakeDesc desc{};
+        desc.generateMips = options.generateMips;
+        desc.mipFilter = options.mipFilter;
+        desc.channelCnt = 4;
+        desc.reportPsnr = options.reportTexPsnr;
+
+        // The color textures are filtered in linear space and the normal maps keep unit normals through the mips.
+        switch (slot)
+        {
+        case MESH_TEX_BASE_COLOR:
+        case MESH_TEX_EMISSIVE:
+            desc.colorSpace = MIP_COLOR_SPACE_SRGB;
+            desc.compression = options.baseColorCompression;
+            break;
+        case MESH_TEX_NORMAL:
+            desc.colorSpace = MIP_COLOR_SPACE_NORMAL;
+            desc.compression = options.normalCompression;
+            desc.channelCnt = 2;
+            break;
+        default:
+            desc.colorSpace = MIP_COLOR_SPACE_LINEAR;
+            desc.compression = options.ormCompression;
+            break;
+        }
+
+        if (options.compressTextures == false)
+        {
+            desc.compression = TEX_COMPRESSION_NONE;
+        }
+        return desc;
+    }
+
+    // ================================================================================================================
+    VkFormat GetBcVkFormat(
+        TexCompression compression,
+        MipColorSpace  colorSpace)
+    {
+        bool isSrgb = colorSpace == MIP_COLOR_SPACE_SRGB;
+        switch (compression)
+        {
+        case TEX_COMPRESSION_BC1:
+            return isSrgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case TEX_COMPRESSION_BC3:
+            return isSrgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+        case TEX_COMPRESSION_BC4:
+            return VK_FORMAT_BC4_UNORM_BLOCK;
+        case TEX_COMPRESSION_BC5:
+            return VK_FORMAT_BC5_UNORM_BLOCK;
+        case TEX_COMPRESSION_BC7:
+            return isSrgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+        default:
+            return VK_FORMAT_UNDEFINED;
+        }
+    }
+
+    // ================================================================================================================
+    void PackOrmImage(
+        const ImgInfo* pOcclusion,
+        const ImgInfo* pMetallicRoughness,
+        ImgInfo&       oOrm)
+    {
+        const ImgInfo* pSizeImg = (pMetallicRoughness != nullptr) ? pMetallicRoughness : pOcclusion;
+        uint32_t width = (pSizeImg != nullptr) ? pSizeImg->pixWidth : 1;
+        uint32_t height = (pSizeImg != nullptr) ? pSizeImg->pixHeight : 1;
+
+        oOrm = ImgInfo{};
+        oOrm.pixWidth = width;
+        oOrm.pixHeight = height;
+        oOrm.componentCnt = 4;
+        oOrm.dataVec.resize(4 * width * height);
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                uint8_t* pTexel = &oOrm.dataVec[4 * (y * width + x)];
+                pTexel[0] = 255;
+                pTexel[1] = 255;
+                pTexel[2] = 0;
+                pTexel[3] = 255;
+
+                if (pOcclusion != nullptr)
+                {
+                    uint32_t occlusionX = x * pOcclusion->pixWidth / width;
+                    uint32_t occlusionY = y * pOcclusion->pixHeight / height;
+                    pTexel[0] = pOcclusion->dataVec[4 * (occlusionY * pOcclusion->pixWidth + occlusionX)];
+                }
+
+                if (pMetallicRoughness != nullptr)
+                {
+                    pTexel[1] = pMetallicRoughness->dataVec[4 * (y * width + x) + 1];
+                    pTexel[2] = pMetallicRoughness->dataVec[4 * (y * width + x) + 2];
+                }
+            }
+        }
+    }
+
+    // ================================================================================================================
+    // Keeps the first channelCnt channels of every RGBA8 texel. The mip offsets shrink with the data.
+    static void DropChannels(
+        uint32_t               channelCnt,
+        std::vector<uint8_t>&  ioData,
+        std::vector<uint32_t>& ioMipByteOffsets)
+    {
+        uint32_t texelCnt = ioData.size() / 4;
+        for (uint32_t i = 0; i < texelCnt; i++)
+        {
+            for (uint32_t c = 0; c < channelCnt; c++)
+            {
+                ioData[i * channelCnt + c] = ioData[i * 4 + c];
+            }
+        }
+        ioData.resize(texelCnt * channelCnt);
+
+        for (uint32_t& offset : ioMipByteOffsets)
+        {
+            offset = offset / 4 * channelCnt;
+        }
+    }
+
+    // ================================================================================================================
+    void BakeTexture(
+        const uint8_t*     pRgba8,
+        uint32_t           width,
+        uint32_t           height,
+        const TexBakeDesc& desc,
+        ThreadPool*        pThreadPool,
+        ImgInfo&           oImg)
+    {
+        oImg.pixWidth = width;
+        oImg.pixHeight = height;
+        oImg.componentCnt = 4;
+        oImg.format = VK_FORMAT_UNDEFINED;
+        oImg.mipByteOffsets.clear();
+
+        std::vector<uint8_t> rgba8;
+        if (desc.generateMips)
+        {
+            GenerateMipChain(pRgba8,
+                             width,
+                             height,
+                             desc.mipFilter,
+                             desc.colorSpace,
+                             pThreadPool,
+                             rgba8,
+                             oImg.mipByteOffsets);
+        }
+        else
+        {
+            rgba8.assign(pRgba8, pRgba8 + 4 * width * height);
+        }
+
+        if (desc.compression == TEX_COMPRESSION_NONE)
+        {
+            if (desc.channelCnt < 4)
+            {
+                DropChannels(desc.channelCnt, rgba8, oImg.mipByteOffsets);
+                oImg.componentCnt = desc.channelCnt;
+            }
+            oImg.dataVec = std::move(rgba8);
+            return;
+        }
+
+        std::vector<uint32_t> rgba8MipByteOffsets = std::move(oImg.mipByteOffsets);
+        CompressBcMipChain(rgba8.data(),
+                           width,
+                           height,
+                           rgba8MipByteOffsets,
+                           desc.compression,
+                           pThreadPool,
+                           oImg.dataVec,
+                           oImg.mipByteOffsets);
+        oImg.format = GetBcVkFormat(desc.compression, desc.colorSpace);
+
+        if (desc.reportPsnr)
+        {
+            // The level 0 is the first in both layouts.
+            std::vector<uint8_t> decoded(4 * width * height);
+            DecompressBcImage(oImg.dataVec.data(), width, height, desc.compression, decoded.data());
+            printf("Compressed a %ux%u texture with the %s: %.2f dB PSNR\n",
+                   width,
+                   height,
+                   TexCompressionNames[desc.compression],
+                   ComputeBcPsnr(rgba8.data(), decoded.data(), width * height, desc.compression));
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan.h>
+#include "../Scene/Level.h"
+#include "../TextureProcessing/MipGenerator.h"
+#include "../TextureProcessing/BlockCompressor.h"
+
+namespace SharedLib
+{
+    struct AssetsLoaderOptions;
+    class ThreadPool;
+
+    // What the loader does to a decoded RGBA8 material image before it is uploaded.
+    struct TexBakeDesc
+    {
+        bool           generateMips;
+        MipFilter      mipFilter;
+        MipColorSpace  colorSpace;
+        TexCompression compression;
+        uint32_t       channelCnt; // The first channels that an uncompressed image keeps, 4 or 2 for the RG8 normals.
+        bool           reportPsnr;
+    };
+
+    // The bake of a texture slot under the loader options.
+    TexBakeDesc GetTexBakeDesc(const AssetsLoaderOptions& options, MeshTexSlot slot);
+
+    // The block compressed GPU format. The sRGB variants are used for the MIP_COLOR_SPACE_SRGB.
+    VkFormat GetBcVkFormat(TexCompression compression, MipColorSpace colorSpace);
+
+    // Packs the occlusion's r and the metallic roughness' g and b into one RGBA8 image in the MESH_TEX_ORM layout. Both
+    // may be the same image. A null one gives its channels' defaults: no occlusion, full roughness and no metalness.
+    // The output has the metallic roughness' size and the occlusion is point sampled if its size differs.
+    void PackOrmImage(const ImgInfo* pOcclusion, const ImgInfo* pMetallicRoughness, ImgInfo& oOrm);
+
+    // Generates the mips and compresses the image as the desc says. oImg receives the final texels, their mip offsets
+    // and, for a compressed image, its format. The pThreadPool is optional and may be the caller's own pool.
+    void BakeTexture(const uint8_t*     pRgba8,
+                     uint32_t           width,
+                     uint32_t           height,
+                     const TexBakeDesc& desc,
+                     ThreadPool*        pThreadPool,
+                     ImgInfo&           oImg);
+}
@@ -23,6 +23,7 @@ namespace SharedLib
         void GetNearPlane(float& width, float& height, float& near);
 
         void GetPos(float* oVec) { memcpy(oVec, m_pos, sizeof(float) * 3); };
+        float GetFov() const { return m_fov; } // Vertical field of view in radians.
 
         void SetView(float* iView);
         void SetPos(float* iPos) { memcpy(m_pos, iPos, sizeof(m_pos)); }
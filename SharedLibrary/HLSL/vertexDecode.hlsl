@@ -0,0 +1,70 @@
+// Decoders of the compact MeshPrimitive vertex layouts. See the SharedLibrary/MeshProcessing/VertexQuantizer.h.
+//
+// VERT_LAYOUT_OCT_TANGENT inputs:                   VERT_LAYOUT_TANGENT_ANGLE inputs:
+//     [[vk::location(0)]] float4 vPosition;             [[vk::location(0)]] float4 vPosition;
+//     [[vk::location(1)]] float2 vOctNormal;            [[vk::location(1)]] float2 vOctNormal;
+//     [[vk::location(2)]] float2 vOctTangent;           [[vk::location(3)]] float2 vUv;
+//     [[vk::location(3)]] float2 vUv;
+//
+// The unorm, snorm and half inputs arrive as floats already. Only the dequantization is left to the shader.
+
+struct VertDequant
+{
+    float4 posScale;  // xyz
+    float4 posOffset; // xyz
+};
+
+float3 DequantizePos(float4 unormPos, VertDequant dequant)
+{
+    return dequant.posOffset.xyz + dequant.posScale.xyz * unormPos.xyz;
+}
+
+// Unfolds the octahedron's lower half. The snorm's -32768 is already clamped to -1 by the input assembly.
+float3 OctDecode(float2 oct)
+{
+    float3 v = float3(oct.xy, 1.0 - abs(oct.x) - abs(oct.y));
+    float t = max(-v.z, 0.0);
+    v.x += (v.x >= 0.0) ? -t : t;
+    v.y += (v.y >= 0.0) ? -t : t;
+    return normalize(v);
+}
+
+// VERT_LAYOUT_OCT_TANGENT: the w of the unorm position is 1 for a positive bitangent sign and 0 for a negative one.
+float4 DecodeOctTangent(float2 octTangent, float4 unormPos)
+{
+    return float4(OctDecode(octTangent), unormPos.w * 2.0 - 1.0);
+}
+
+// The branchless orthonormal basis around a unit normal, Duff et al. 2017.
+void TangentBasis(float3 n, out float3 basis1, out float3 basis2)
+{
+    float s = (n.z >= 0.0) ? 1.0 : -1.0;
+    float a = -1.0 / (s + n.z);
+    float b = n.x * n.y * a;
+    basis1 = float3(1.0 + s * n.x * n.x * a, s * b, -s * n.x);
+    basis2 = float3(b, s + n.y * n.y * a, -n.y);
+}
+
+// VERT_LAYOUT_TANGENT_ANGLE: the position's w holds the tangent's angle around the normal in its low 15 bits and the
+// negative bitangent sign in the top bit.
+float4 DecodeTangentAngle(float3 normal, float4 unormPos)
+{
+    uint bits = uint(round(unormPos.w * 65535.0));
+    float angle = (float(bits & 0x7FFFu) / 32768.0 - 0.5) * 6.28318530718;
+
+    float3 basis1;
+    float3 basis2;
+    TangentBasis(normal, basis1, basis2);
+
+    float sinAngle;
+    float cosAngle;
+    sincos(angle, sinAngle, cosAngle);
+    return float4(cosAngle * basis1 + sinAngle * basis2, (bits & 0x8000u) ? -1.0 : 1.0);
+}
+
+// The MeshEntity's per instance model matrix, whose 3 rows come from the instance vertex buffer. See the
+// GetInstanceInputDescs(...) in the SharedLibrary/Scene/Level.h.
+float4x4 GetInstanceMat(float4 row0, float4 row1, float4 row2)
+{
+    return float4x4(row0, row1, row2, float4(0.0, 0.0, 0.0, 1.0));
+}
@@ -0,0 +1,557 @@
+#include "ClusterLod.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "../Utils/ThreadUtils.h"
+#include "../Utils/DiskOpsUtils.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+namespace SharedLib
+{
+    // Clusters per group. Nanite uses 8 to 32 with a graph partitioner, but the greedy grouping's groups get less
+    // compact as they grow.
+    static const uint32_t ClusterLodGroupSize = 4;
+
+    // A group whose simplification keeps more than this ratio of its triangles is not worth another level.
+    static const float ClusterLodMinReduction = 0.85f;
+
+    // ================================================================================================================
+    // The smallest sphere around the sphere a that also contains the sphere b, written into the a.
+    static void MergeSphere(
+        float*       a,
+        const float* b)
+    {
+        float d[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float dist = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        if (dist + b[3] <= a[3])
+        {
+            return;
+        }
+        if (dist + a[3] <= b[3])
+        {
+            memcpy(a, b, sizeof(float) * 4);
+            return;
+        }
+
+        float radius = (a[3] + dist + b[3]) * 0.5f;
+        float shift = (radius - a[3]) / dist;
+        a[0] += d[0] * shift;
+        a[1] += d[1] * shift;
+        a[2] += d[2] * shift;
+        a[3] = radius;
+    }
+
+    // ================================================================================================================
+    // The error seen from the camera, per unit of distance. A camera inside the bounds sees any error as too large.
+    static float ProjectedLodError(
+        const float* bounds,
+        float        error,
+        const float* cameraPos)
+    {
+        if (error == 0.f)
+        {
+            return 0.f;
+        }
+        if (error == FLT_MAX)
+        {
+            return FLT_MAX;
+        }
+
+        float d[3] = { bounds[0] - cameraPos[0], bounds[1] - cameraPos[1], bounds[2] - cameraPos[2] };
+        float dist = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) - bounds[3];
+        return dist > 1e-6f ? error / dist : FLT_MAX;
+    }
+
+    // ================================================================================================================
+    // The cluster's triangles as vertex buffer indices.
+    static void GetClusterIndices(
+        const ClusterLodDag&   dag,
+        const LodCluster&      cluster,
+        std::vector<uint32_t>& oIndices)
+    {
+        const uint32_t* pVerts = &dag.payload[cluster.payloadOffset];
+        const uint32_t* pTris = pVerts + cluster.vertCnt;
+        for (uint32_t tri = 0; tri < cluster.triCnt; tri++)
+        {
+            oIndices.push_back(pVerts[pTris[tri] & 0xFF]);
+            oIndices.push_back(pVerts[(pTris[tri] >> 8) & 0xFF]);
+            oIndices.push_back(pVerts[(pTris[tri] >> 16) & 0xFF]);
+        }
+    }
+
+    // ================================================================================================================
+    // Splits the triangles into meshlets. The vertices are compacted first, so the builder's per vertex data only
+    // covers the triangles' vertices. The meshlets' vertIndices are converted back to the vertex buffer indices.
+    static void BuildCompactMeshlets(
+        const std::vector<uint32_t>& indices,
+        const float*                 pPos,
+        MeshletData&                 oData)
+    {
+        std::vector<uint32_t> globalVerts(indices);
+        std::sort(globalVerts.begin(), globalVerts.end());
+        globalVerts.erase(std::unique(globalVerts.begin(), globalVerts.end()), globalVerts.end());
+
+        std::vector<float> localPos(globalVerts.size() * 3);
+        for (uint32_t i = 0; i < globalVerts.size(); i++)
+        {
+            memcpy(&localPos[3 * i], &pPos[3 * globalVerts[i]], sizeof(float) * 3);
+        }
+
+        std::vector<uint32_t> localIndices(indices.size());
+        for (uint32_t i = 0; i < indices.size(); i++)
+        {
+            localIndices[i] = std::lower_bound(globalVerts.begin(), globalVerts.end(), indices[i]) - globalVerts.begin();
+        }
+
+        BuildMeshlets(localIndices.data(),
+                      localIndices.size(),
+                      localPos.data(),
+                      globalVerts.size(),
+                      DefaultMeshletMaxVerts,
+                      DefaultMeshletMaxTris,
+                      oData);
+
+        for (uint32_t& vert : oData.vertIndices)
+        {
+            vert = globalVerts[vert];
+        }
+    }
+
+    // ================================================================================================================
+    static void AppendMeshletsAsClusters(
+        const MeshletData& meshletData,
+        uint32_t           lodLevel,
+        const float*       pLodBounds, // Null to use each meshlet's own sphere.
+        float              lodError,
+        ClusterLodDag&     dag)
+    {
+        for (uint32_t m = 0; m < meshletData.meshlets.size(); m++)
+        {
+            const Meshlet& meshlet = meshletData.meshlets[m];
+
+            LodCluster cluster{};
+            cluster.payloadOffset = dag.payload.size();
+            cluster.vertCnt = meshlet.vertCnt;
+            cluster.triCnt = meshlet.triCnt;
+            cluster.lodLevel = lodLevel;
+            cluster.lodError = lodError;
+            cluster.parentLodError = FLT_MAX;
+
+            if (pLodBounds != nullptr)
+            {
+                memcpy(cluster.lodBounds, pLodBounds, sizeof(float) * 4);
+            }
+            else
+            {
+                memcpy(cluster.lodBounds, meshletData.bounds[m].center, sizeof(float) * 3);
+                cluster.lodBounds[3] = meshletData.bounds[m].radius;
+            }
+            memcpy(cluster.parentLodBounds, cluster.lodBounds, sizeof(float) * 4);
+
+            dag.payload.insert(dag.payload.end(),
+                               meshletData.vertIndices.begin() + meshlet.vertOffset,
+                               meshletData.vertIndices.begin() + meshlet.vertOffset + meshlet.vertCnt);
+            dag.payload.insert(dag.payload.end(),
+                               meshletData.packedTris.begin() + meshlet.triOffset,
+                               meshletData.packedTris.begin() + meshlet.triOffset + meshlet.triCnt);
+            dag.clusters.push_back(cluster);
+        }
+    }
+
+    // ================================================================================================================
+    // Greedily groups the clusters with the neighbours that share the most vertices with the group.
+    static void GroupClusters(
+        const ClusterLodDag&                dag,
+        const std::vector<uint32_t>&        levelClusters,
+        std::vector<std::vector<uint32_t>>& oGroups)
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> vertClusters; // <Vertex, idx in the levelClusters>.
+        for (uint32_t i = 0; i < levelClusters.size(); i++)
+        {
+            const LodCluster& cluster = dag.clusters[levelClusters[i]];
+            for (uint32_t v = 0; v < cluster.vertCnt; v++)
+            {
+                vertClusters.push_back({ dag.payload[cluster.payloadOffset + v], i });
+            }
+        }
+        std::sort(vertClusters.begin(), vertClusters.end());
+
+        std::vector<std::unordered_map<uint32_t, uint32_t>> sharedVertCnts(levelClusters.size());
+        for (uint32_t i = 0; i < vertClusters.size();)
+        {
+            uint32_t j = i + 1;
+            while ((j < vertClusters.size()) && (vertClusters[j].first == vertClusters[i].first))
+            {
+                j++;
+            }
+
+            for (uint32_t a = i; a < j; a++)
+            {
+                for (uint32_t b = a + 1; b < j; b++)
+                {
+                    sharedVertCnts[vertClusters[a].second][vertClusters[b].second]++;
+                    sharedVertCnts[vertClusters[b].second][vertClusters[a].second]++;
+                }
+            }
+            i = j;
+        }
+
+        std::vector<bool> grouped(levelClusters.size(), false);
+        for (uint32_t seed = 0; seed < levelClusters.size(); seed++)
+        {
+            if (grouped[seed])
+            {
+                continue;
+            }
+
+            std::vector<uint32_t> group = { seed };
+            grouped[seed] = true;
+
+            std::unordered_map<uint32_t, uint32_t> candidates = sharedVertCnts[seed];
+            while (group.size() < ClusterLodGroupSize)
+            {
+                // The smallest index wins the ties, so the grouping doesn't depend on the hash map's order.
+                uint32_t best = UINT32_MAX;
+                uint32_t bestShared = 0;
+                for (const auto& candidate : candidates)
+                {
+                    if (grouped[candidate.first])
+                    {
+                        continue;
+                    }
+
+                    if ((candidate.second > bestShared) ||
+                        ((candidate.second == bestShared) && (candidate.first < best)))
+                    {
+                        best = candidate.first;
+                        bestShared = candidate.second;
+                    }
+                }
+
+                if (best == UINT32_MAX)
+                {
+                    break;
+                }
+
+                group.push_back(best);
+                grouped[best] = true;
+                for (const auto& neighbour : sharedVertCnts[best])
+                {
+                    candidates[neighbour.first] += neighbour.second;
+                }
+            }
+
+            for (uint32_t& member : group)
+            {
+                member = levelClusters[member];
+            }
+            oGroups.push_back(group);
+        }
+    }
+
+    // ================================================================================================================
+    void BuildClusterLodDag(
+        const uint32_t* pIndices,
+        uint32_t        idxCnt,
+        const float*    pPos,
+        uint32_t        vertCnt,
+        ThreadPool*     pThreadPool,
+        ClusterLodDag&  oDag)
+    {
+        oDag.positions.assign(pPos, pPos + 3 * vertCnt);
+        oDag.clusters.clear();
+        oDag.payload.clear();
+        oDag.lodLevelCnt = 0;
+
+        if (idxCnt < 3)
+        {
+            return;
+        }
+
+        {
+            std::vector<uint32_t> indices(pIndices, pIndices + idxCnt - idxCnt % 3);
+            MeshletData meshletData;
+            BuildCompactMeshlets(indices, pPos, meshletData);
+            AppendMeshletsAsClusters(meshletData, 0, nullptr, 0.f, oDag);
+        }
+        oDag.lodLevelCnt = 1;
+
+        std::vector<uint32_t> levelClusters(oDag.clusters.size());
+        for (uint32_t i = 0; i < levelClusters.size(); i++)
+        {
+            levelClusters[i] = i;
+        }
+
+        while (levelClusters.size() > 1)
+        {
+            std::vector<std::vector<uint32_t>> groups;
+            GroupClusters(oDag, levelClusters, groups);
+
+            struct GroupResult
+            {
+                bool        simplified = false;
+                float       error      = 0.f;
+                MeshletData meshletData;
+            };
+            std::vector<GroupResult> groupResults(groups.size());
+
+            auto simplifyGroup = [&](uint32_t groupIdx) {
+                std::vector<uint32_t> indices;
+                for (uint32_t clusterIdx : groups[groupIdx])
+                {
+                    GetClusterIndices(oDag, oDag.clusters[clusterIdx], indices);
+                }
+
+                std::vector<uint32_t> simplifiedIndices(indices.size());
+                float error = 0.f;
+                uint32_t simplifiedIdxCnt = SimplifyMesh(indices.data(),
+                                                         indices.size(),
+                                                         pPos,
+                                                         vertCnt,
+                                                         (indices.size() / 6) * 3,
+                                                         FLT_MAX,
+                                                         true,
+                                                         simplifiedIndices.data(),
+                                                         &error);
+                if ((simplifiedIdxCnt == 0) || (simplifiedIdxCnt > ClusterLodMinReduction * indices.size()))
+                {
+                    return;
+                }
+
+                simplifiedIndices.resize(simplifiedIdxCnt);
+                GroupResult& result = groupResults[groupIdx];
+                result.simplified = true;
+                result.error = error;
+                BuildCompactMeshlets(simplifiedIndices, pPos, result.meshletData);
+            };
+
+            if (pThreadPool != nullptr)
+            {
+                pThreadPool->ParallelFor(groups.size(), simplifyGroup);
+            }
+            else
+            {
+                for (uint32_t groupIdx = 0; groupIdx < groups.size(); groupIdx++)
+                {
+                    simplifyGroup(groupIdx);
+                }
+            }
+
+            // Link the levels in the group order, so the DAG is the same with or without the threads.
+            std::vector<uint32_t> nextLevelClusters;
+            bool anySimplified = false;
+            for (uint32_t groupIdx = 0; groupIdx < groups.size(); groupIdx++)
+            {
+                const GroupResult& result = groupResults[groupIdx];
+                if (result.simplified == false)
+                {
+                    // Its clusters are grouped again with the next level's clusters, where their locked borders are
+                    // likely inside of the new groups. They become roots if nothing can be simplified anymore.
+                    nextLevelClusters.insert(nextLevelClusters.end(), groups[groupIdx].begin(), groups[groupIdx].end());
+                    continue;
+                }
+                anySimplified = true;
+
+                // The group's error includes its children's, so the errors only grow towards the roots. The same
+                // for the bounds.
+                float groupBounds[4];
+                memcpy(groupBounds, oDag.clusters[groups[groupIdx][0]].lodBounds, sizeof(float) * 4);
+                float groupError = result.error;
+                for (uint32_t clusterIdx : groups[groupIdx])
+                {
+                    MergeSphere(groupBounds, oDag.clusters[clusterIdx].lodBounds);
+                    groupError = std::max(groupError, oDag.clusters[clusterIdx].lodError);
+                }
+
+                for (uint32_t clusterIdx : groups[groupIdx])
+                {
+                    LodCluster& cluster = oDag.clusters[clusterIdx];
+                    memcpy(cluster.parentLodBounds, groupBounds, sizeof(float) * 4);
+                    cluster.parentLodError = groupError;
+                }
+
+                uint32_t firstNewCluster = oDag.clusters.size();
+                AppendMeshletsAsClusters(result.meshletData, oDag.lodLevelCnt, groupBounds, groupError, oDag);
+                for (uint32_t i = firstNewCluster; i < oDag.clusters.size(); i++)
+                {
+                    nextLevelClusters.push_back(i);
+                }
+            }
+
+            if (anySimplified == false)
+            {
+                break;
+            }
+
+            oDag.lodLevelCnt++;
+            levelClusters = nextLevelClusters;
+        }
+    }
+
+    // ================================================================================================================
+    float ClusterLodErrorThreshold(
+        float pixelError,
+        float fovY,
+        float viewportHeight)
+    {
+        return pixelError * 2.f * std::tan(fovY * 0.5f) / viewportHeight;
+    }
+
+    // ================================================================================================================
+    void SelectClusterLodCut(
+        const ClusterLodDag&   dag,
+        const float            cameraPos[3],
+        float                  errorThreshold,
+        std::vector<uint32_t>& oClusterIdxs)
+    {
+        oClusterIdxs.clear();
+        for (uint32_t i = 0; i < dag.clusters.size(); i++)
+        {
+            const LodCluster& cluster = dag.clusters[i];
+            bool selfFineEnough = ProjectedLodError(cluster.lodBounds, cluster.lodError, cameraPos) <= errorThreshold;
+            bool parentTooCoarse = ProjectedLodError(cluster.parentLodBounds, cluster.parentLodError, cameraPos) > errorThreshold;
+            if (selfFineEnough && parentTooCoarse)
+            {
+                oClusterIdxs.push_back(i);
+            }
+        }
+    }
+
+    // ================================================================================================================
+    bool ValidateClusterLodDag(
+        const ClusterLodDag& dag)
+    {
+        uint32_t vertCnt = dag.positions.size() / 3;
+        for (uint32_t i = 0; i < dag.clusters.size(); i++)
+        {
+            const LodCluster& cluster = dag.clusters[i];
+            if ((cluster.vertCnt > 256) ||
+                ((uint64_t)cluster.payloadOffset + cluster.vertCnt + cluster.triCnt > dag.payload.size()))
+            {
+                printf("Cluster LOD validation: cluster %d is out of the payload.\n", i);
+                return false;
+            }
+
+            for (uint32_t v = 0; v < cluster.vertCnt; v++)
+            {
+                if (dag.payload[cluster.payloadOffset + v] >= vertCnt)
+                {
+                    printf("Cluster LOD validation: cluster %d references a vertex out of range.\n", i);
+                    return false;
+                }
+            }
+
+            const uint32_t* pTris = &dag.payload[cluster.payloadOffset + cluster.vertCnt];
+            for (uint32_t tri = 0; tri < cluster.triCnt; tri++)
+            {
+                if (((pTris[tri] & 0xFF) >= cluster.vertCnt) ||
+                    (((pTris[tri] >> 8) & 0xFF) >= cluster.vertCnt) ||
+                    (((pTris[tri] >> 16) & 0xFF) >= cluster.vertCnt))
+                {
+                    printf("Cluster LOD validation: cluster %d's triangle %d has a local index out of range.\n", i, tri);
+                    return false;
+                }
+            }
+
+            if (cluster.lodLevel >= dag.lodLevelCnt)
+            {
+                printf("Cluster LOD validation: cluster %d is at the level %d of %d.\n", i, cluster.lodLevel, dag.lodLevelCnt);
+                return false;
+            }
+
+            if (cluster.parentLodError < cluster.lodError)
+            {
+                printf("Cluster LOD validation: cluster %d's parent error is smaller than its own.\n", i);
+                return false;
+            }
+
+            if (cluster.parentLodError != FLT_MAX)
+            {
+                const float* a = cluster.lodBounds;
+                const float* b = cluster.parentLodBounds;
+                float d[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+                float dist = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+                if (dist + a[3] > b[3] * 1.0001f + 1e-5f)
+                {
+                    printf("Cluster LOD validation: cluster %d's parent bounds don't contain its bounds.\n", i);
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // ================================================================================================================
+    static uint64_t AlignOffset(uint64_t offset)
+    {
+        return (offset + 7) & ~7ull;
+    }
+
+    // ================================================================================================================
+    bool SaveClusterLodDag(
+        const std::string&   namePath,
+        const ClusterLodDag& dag)
+    {
+        ClusterLodFileHeader header{};
+        header.magic           = ClusterLodFileMagic;
+        header.version         = ClusterLodFileVersion;
+        header.vertCnt         = dag.positions.size() / 3;
+        header.clusterCnt      = dag.clusters.size();
+        header.payloadCnt      = dag.payload.size();
+        header.lodLevelCnt     = dag.lodLevelCnt;
+        header.positionsOffset = AlignOffset(sizeof(ClusterLodFileHeader));
+        header.clustersOffset  = AlignOffset(header.positionsOffset + sizeof(float) * dag.positions.size());
+        header.payloadOffset   = AlignOffset(header.clustersOffset + sizeof(LodCluster) * dag.clusters.size());
+
+        std::vector<uint8_t> bytes(header.payloadOffset + sizeof(uint32_t) * dag.payload.size(), 0);
+        memcpy(bytes.data(), &header, sizeof(header));
+        memcpy(bytes.data() + header.positionsOffset, dag.positions.data(), sizeof(float) * dag.positions.size());
+        memcpy(bytes.data() + header.clustersOffset, dag.clusters.data(), sizeof(LodCluster) * dag.clusters.size());
+        memcpy(bytes.data() + header.payloadOffset, dag.payload.data(), sizeof(uint32_t) * dag.payload.size());
+
+        return WriteBinaryFileAtomic(namePath, bytes.data(), bytes.size());
+    }
+
+    // ================================================================================================================
+    bool LoadClusterLodDag(
+        const std::string& namePath,
+        ClusterLodDag&     oDag)
+    {
+        MappedFile file;
+        if ((file.Open(namePath) == false) || (file.GetSize() < sizeof(ClusterLodFileHeader)))
+        {
+            return false;
+        }
+
+        ClusterLodFileHeader header{};
+        memcpy(&header, file.GetData(), sizeof(header));
+        if ((header.magic != ClusterLodFileMagic) || (header.version != ClusterLodFileVersion))
+        {
+            return false;
+        }
+
+        uint64_t positionsEnd = header.positionsOffset + sizeof(float) * 3 * (uint64_t)header.vertCnt;
+        uint64_t clustersEnd = header.clustersOffset + sizeof(LodCluster) * (uint64_t)header.clusterCnt;
+        uint64_t payloadEnd = header.payloadOffset + sizeof(uint32_t) * (uint64_t)header.payloadCnt;
+        if ((positionsEnd > file.GetSize()) || (clustersEnd > file.GetSize()) || (payloadEnd > file.GetSize()))
+        {
+            printf("The cluster LOD file %s is truncated.\n", namePath.c_str());
+            return false;
+        }
+
+        const uint8_t* pData = file.GetData();
+        oDag.positions.resize(3 * header.vertCnt);
+        oDag.clusters.resize(header.clusterCnt);
+        oDag.payload.resize(header.payloadCnt);
+        memcpy(oDag.positions.data(), pData + header.positionsOffset, sizeof(float) * oDag.positions.size());
+        memcpy(oDag.clusters.data(), pData + header.clustersOffset, sizeof(LodCluster) * oDag.clusters.size());
+        memcpy(oDag.payload.data(), pData + header.payloadOffset, sizeof(uint32_t) * oDag.payload.size());
+        oDag.lodLevelCnt = header.lodLevelCnt;
+        return true;
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SharedLib
+{
+    class ThreadPool;
+
+    // The offline half of a Nanite style virtualized geometry pipeline
+    // (https://advances.realtimerendering.com/s2021/Karis_Nanite_SIGGRAPH_Advances_2021_final.pdf).
+    //
+    // The mesh is split into meshlet sized clusters. The clusters are grouped by adjacency, each group is simplified to
+    // half of its triangles with its border vertices locked, and the result is split into new clusters, which form the
+    // next LOD level. It repeats until one cluster is left or no group can be simplified further. The clusters of a
+    // group that can't be simplified are carried over into the next level's grouping. The groups are the DAG's nodes:
+    // the clusters of a group are the children of the clusters made from it.
+    //
+    // Every cluster knows the error and the bounds of the group it was made from (lod*) and of the group it is merged
+    // into (parentLod*). The errors and the bounds only grow towards the roots, so the cut selection below is a local
+    // decision per cluster that never picks a cluster together with its ancestor or its descendant.
+    struct LodCluster
+    {
+        uint32_t payloadOffset;      // First element in the ClusterLodDag::payload: vertCnt indices, then triCnt tris.
+        uint32_t vertCnt;
+        uint32_t triCnt;
+        uint32_t lodLevel;           // 0 is the original geometry.
+        float    lodBounds[4];       // xyz center and w radius.
+        float    parentLodBounds[4];
+        float    lodError;           // 0 at the level 0.
+        float    parentLodError;     // FLT_MAX for the roots, so they are picked when nothing coarser exists.
+        uint32_t padding[2];
+    };
+
+    struct ClusterLodDag
+    {
+        std::vector<float>      positions; // float3. Every LOD indexes the same vertices.
+        std::vector<LodCluster> clusters;  // Ordered by the LOD level.
+        std::vector<uint32_t>   payload;   // Per cluster: vertex buffer indices, then triangles packed as in meshlets.
+        uint32_t                lodLevelCnt = 0;
+    };
+
+    // pThreadPool is optional. With it, the groups of a level are simplified in parallel. The result doesn't depend
+    // on the threads.
+    void BuildClusterLodDag(const uint32_t* pIndices,
+                            uint32_t        idxCnt,
+                            const float*    pPos,
+                            uint32_t        vertCnt,
+                            ThreadPool*     pThreadPool,
+                            ClusterLodDag&  oDag);
+
+    // The errorThreshold is the largest allowed error per unit of distance from the camera. A pixel error converts to it
+    // by pixelError * 2 * tan(fovY / 2) / viewportHeight.
+    float ClusterLodErrorThreshold(float pixelError, float fovY, float viewportHeight);
+
+    // The cut of the DAG for a camera: a cluster is picked if its own error is small enough and its parent's isn't.
+    // It is a linear scan of all the clusters on the CPU, the same test as a task shader would do per cluster.
+    void SelectClusterLodCut(const ClusterLodDag&   dag,
+                             const float            cameraPos[3],
+                             float                  errorThreshold,
+                             std::vector<uint32_t>& oClusterIdxs);
+
+    // Checks the payload ranges, the local indices, and that the errors and the bounds grow monotonically from every
+    // cluster to its parent group. Prints the first problem and returns false on a failure.
+    bool ValidateClusterLodDag(const ClusterLodDag& dag);
+
+    // The streamable file: ClusterLodFileHeader | positions | cluster table | payload. Each cluster's payload is one
+    // contiguous range, so a streaming loader can keep the header, the positions and the cluster table resident and
+    // read only the payload ranges of the clusters that its cuts select.
+    const uint32_t ClusterLodFileMagic   = 0x444F4C43; // "CLOD"
+    const uint32_t ClusterLodFileVersion = 1;
+
+    struct ClusterLodFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertCnt;
+        uint32_t clusterCnt;
+        uint32_t payloadCnt; // uint32 elements.
+        uint32_t lodLevelCnt;
+        uint64_t positionsOffset;
+        uint64_t clustersOffset;
+        uint64_t payloadOffset;
+    };
+
+    bool SaveClusterLodDag(const std::string& namePath, const ClusterLodDag& dag);
+    bool LoadClusterLodDag(const std::string& namePath, ClusterLodDag& oDag);
+}
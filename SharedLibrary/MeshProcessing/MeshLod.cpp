@@ -0,0 +1,186 @@
+#include "MeshLod.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace SharedLib
+{
+    // A level that keeps more than this share of the previous level's triangles isn't worth its index memory.
+    static const float MeshLodMinReduction = 0.95f;
+
+    // Per component weights of the interleaved normal (xyz) and uv attributes in the collapse costs. A unit of normal
+    // or uv difference costs as much as the same fraction of the mesh's size in distance.
+    static const float MeshLodAttribWeights[5] = { 0.5f, 0.5f, 0.5f, 1.f, 1.f };
+
+    // ================================================================================================================
+    void BuildMeshLodChain(
+        const uint32_t*        pIndices,
+        uint32_t               idxCnt,
+        const float*           pPos,
+        const float*           pNormals,
+        const float*           pUvs,
+        uint32_t               vertCnt,
+        uint32_t               maxLodCnt,
+        float                  ratio,
+        float                  maxRelError,
+        std::vector<uint32_t>& oIndices,
+        std::vector<MeshLod>&  oLods)
+    {
+        oIndices.assign(pIndices, pIndices + idxCnt);
+        oLods.clear();
+        oLods.push_back({ 0, idxCnt, 0.f });
+
+        float sphere[4];
+        ComputeBoundingSphere(pPos, vertCnt, sphere);
+        float maxError = maxRelError * sphere[3];
+
+        std::vector<float> attribs(vertCnt * 5);
+        for (uint32_t i = 0; i < vertCnt; i++)
+        {
+            attribs[5 * i + 0] = pNormals[3 * i + 0];
+            attribs[5 * i + 1] = pNormals[3 * i + 1];
+            attribs[5 * i + 2] = pNormals[3 * i + 2];
+            attribs[5 * i + 3] = pUvs[2 * i + 0];
+            attribs[5 * i + 4] = pUvs[2 * i + 1];
+        }
+
+        std::vector<uint32_t> prevIndices(pIndices, pIndices + idxCnt);
+        std::vector<uint32_t> simplifiedIndices(idxCnt);
+        std::vector<uint32_t> cacheOptIndices(idxCnt);
+        float                 accumulatedError = 0.f;
+
+        while (oLods.size() < maxLodCnt)
+        {
+            uint32_t prevIdxCnt = prevIndices.size();
+            uint32_t targetIdxCnt = (uint32_t)(prevIdxCnt / 3 * ratio) * 3;
+
+            float error = 0.f;
+            uint32_t newIdxCnt = SimplifyMeshWithAttributes(prevIndices.data(),
+                                                            prevIdxCnt,
+                                                            pPos,
+                                                            vertCnt,
+                                                            attribs.data(),
+                                                            5,
+                                                            MeshLodAttribWeights,
+                                                            targetIdxCnt,
+                                                            maxError - accumulatedError,
+                                                            true,
+                                                            simplifiedIndices.data(),
+                                                            &error);
+
+            if ((newIdxCnt == 0) || (newIdxCnt > prevIdxCnt * MeshLodMinReduction))
+            {
+                break;
+            }
+
+            OptimizeVertexCache(simplifiedIndices.data(), newIdxCnt, vertCnt, cacheOptIndices.data());
+
+            // The level is simplified from the previous one, so its error against the original geometry is at most
+            // the sum of the errors along the chain.
+            accumulatedError += error;
+            oLods.push_back({ (uint32_t)oIndices.size(), newIdxCnt, accumulatedError });
+            oIndices.insert(oIndices.end(), cacheOptIndices.begin(), cacheOptIndices.begin() + newIdxCnt);
+
+            prevIndices.assign(cacheOptIndices.begin(), cacheOptIndices.begin() + newIdxCnt);
+        }
+    }
+
+    // ================================================================================================================
+    void ComputeBoundingSphere(
+        const float* pPos,
+        uint32_t     vertCnt,
+        float        oSphere[4])
+    {
+        float bbMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float bbMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (uint32_t i = 0; i < vertCnt; i++)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                bbMin[c] = std::min(bbMin[c], pPos[3 * i + c]);
+                bbMax[c] = std::max(bbMax[c], pPos[3 * i + c]);
+            }
+        }
+
+        if (vertCnt == 0)
+        {
+            oSphere[0] = oSphere[1] = oSphere[2] = oSphere[3] = 0.f;
+            return;
+        }
+
+        float radiusSq = 0.f;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            oSphere[c] = 0.5f * (bbMin[c] + bbMax[c]);
+        }
+        for (uint32_t i = 0; i < vertCnt; i++)
+        {
+            float dx = pPos[3 * i + 0] - oSphere[0];
+            float dy = pPos[3 * i + 1] - oSphere[1];
+            float dz = pPos[3 * i + 2] - oSphere[2];
+            radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+        }
+        oSphere[3] = std::sqrt(radiusSq);
+    }
+
+    // ================================================================================================================
+    float TransformBoundingSphere(
+        const float  sphere[4],
+        const float* pMat,
+        float        oSphere[4])
+    {
+        float maxScaleSq = 0.f;
+        for (uint32_t col = 0; col < 3; col++)
+        {
+            float colLengthSq = pMat[col] * pMat[col] + pMat[4 + col] * pMat[4 + col] + pMat[8 + col] * pMat[8 + col];
+            maxScaleSq = std::max(maxScaleSq, colLengthSq);
+        }
+
+        for (uint32_t row = 0; row < 3; row++)
+        {
+            oSphere[row] = pMat[4 * row] * sphere[0] +
+                           pMat[4 * row + 1] * sphere[1] +
+                           pMat[4 * row + 2] * sphere[2] +
+                           pMat[4 * row + 3];
+        }
+
+        float maxScale = std::sqrt(maxScaleSq);
+        oSphere[3] = sphere[3] * maxScale;
+        return maxScale;
+    }
+
+    // ================================================================================================================
+    uint32_t SelectMeshLod(
+        const MeshLod* pLods,
+        uint32_t       lodCnt,
+        const float    boundingSphere[4],
+        const float    cameraPos[3],
+        float          fovY,
+        float          viewportHeight,
+        float          pixelError)
+    {
+        float dx = boundingSphere[0] - cameraPos[0];
+        float dy = boundingSphere[1] - cameraPos[1];
+        float dz = boundingSphere[2] - cameraPos[2];
+        float dist = std::sqrt(dx * dx + dy * dy + dz * dz) - boundingSphere[3];
+        if (dist <= 0.f)
+        {
+            return 0;
+        }
+
+        // An error of e at the distance d covers e / (2 * d * tan(fovY / 2)) of the viewport's height.
+        float maxError = pixelError * 2.f * dist * std::tan(fovY * 0.5f) / viewportHeight;
+
+        uint32_t lodIdx = 0;
+        for (uint32_t i = 1; i < lodCnt; i++)
+        {
+            if (pLods[i].error <= maxError)
+            {
+                lodIdx = i;
+            }
+        }
+        return lodIdx;
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace SharedLib
+{
+    // One detail level of a primitive: a range of the primitive's index buffer. All the levels index the same vertices,
+    // so switching the level only changes the draw's index range.
+    struct MeshLod
+    {
+        uint32_t firstIdx;
+        uint32_t idxCnt;
+        float    error; // World space error of the level against the original geometry. 0 for the level 0.
+    };
+
+    // Builds a discrete LOD chain for a triangle list. The level 0 is the input. Each next level is simplified from the
+    // previous one to ratio times its index count, with the normals and the uvs weighted into the collapse order, and
+    // its geometric error adds up the errors of the levels before it. The open borders and the uv or normal seams are
+    // locked, so the levels keep the silhouette of open meshes and don't tear at the seams. The chain stops early when
+    // a level's error would exceed the maxRelError times the bounding sphere's radius or it barely removes any
+    // triangle.
+    //
+    // oIndices receives the indices of all the levels back to back and oLods their ranges, the level 0 first. Each
+    // level's triangles are reordered for the vertex cache.
+    void BuildMeshLodChain(const uint32_t*        pIndices,
+                           uint32_t               idxCnt,
+                           const float*           pPos,
+                           const float*           pNormals,
+                           const float*           pUvs,
+                           uint32_t               vertCnt,
+                           uint32_t               maxLodCnt,
+                           float                  ratio,
+                           float                  maxRelError,
+                           std::vector<uint32_t>& oIndices,
+                           std::vector<MeshLod>&  oLods);
+
+    // xyz center and w radius of a sphere that contains all the positions. It is the bounding box's circumsphere
+    // shrunk to the farthest position, which is good enough for the LOD distances.
+    void ComputeBoundingSphere(const float* pPos, uint32_t vertCnt, float oSphere[4]);
+
+    // The sphere of a mesh drawn with the row-major affine pMat, given as its top 3 rows. The radius grows with the
+    // largest axis scale, the longest column of the upper 3x3, which is returned.
+    float TransformBoundingSphere(const float sphere[4], const float* pMat, float oSphere[4]);
+
+    // Picks the coarsest level whose error, projected from the nearest point of the bounding sphere, stays under the
+    // pixelError on a viewport of viewportHeight pixels and a fovY vertical field of view in radians. Returns the
+    // level's index. The camera inside the sphere always gets the level 0.
+    uint32_t SelectMeshLod(const MeshLod* pLods,
+                           uint32_t       lodCnt,
+                           const float    boundingSphere[4],
+                           const float    cameraPos[3],
+                           float          fovY,
+                           float          viewportHeight,
+                           float          pixelError);
+}
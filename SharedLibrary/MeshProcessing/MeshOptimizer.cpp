@@ -0,0 +1,455 @@
+#include "MeshOptimizer.h"
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <numeric>
+
+namespace SharedLib
+{
+    // The Forsyth scoring parameters from the paper. The LRU cache is modelled bigger than the FIFO one, because the
+    // scores only need to rank the vertices.
+    static const uint32_t ForsythCacheSize     = 32;
+    static const uint32_t ForsythValenceCnt    = 32; // Valence scores are tabulated up to it.
+    static const float    ForsythDecayPower    = 1.5f;
+    static const float    ForsythLastTriScore  = 0.75f;
+    static const float    ForsythValenceScale  = 2.f;
+    static const float    ForsythValencePower  = 0.5f;
+
+    // ================================================================================================================
+    static float ForsythVertexScore(
+        int32_t      cachePos,
+        uint32_t     liveTriCnt,
+        const float* pCacheScores,
+        const float* pValenceScores)
+    {
+        if (liveTriCnt == 0)
+        {
+            // No triangle needs it anymore.
+            return -1.f;
+        }
+
+        float score = cachePos >= 0 ? pCacheScores[cachePos] : 0.f;
+        if (liveTriCnt < ForsythValenceCnt)
+        {
+            score += pValenceScores[liveTriCnt];
+        }
+        else
+        {
+            score += ForsythValenceScale * std::pow((float)liveTriCnt, -ForsythValencePower);
+        }
+        return score;
+    }
+
+    // ================================================================================================================
+    VertexCacheStats AnalyzeVertexCache(
+        const uint32_t* pIndices,
+        uint32_t        idxCnt,
+        uint32_t        vertCnt,
+        uint32_t        cacheSize)
+    {
+        VertexCacheStats stats{};
+        stats.triCnt = idxCnt / 3;
+
+        // A vertex is in the FIFO cache if less than cacheSize misses happened after its own miss.
+        std::vector<uint32_t> missTimestamps(vertCnt, 0);
+        uint32_t timestamp = cacheSize + 1;
+        for (uint32_t i = 0; i < stats.triCnt * 3; i++)
+        {
+            uint32_t idx = pIndices[i];
+            if (missTimestamps[idx] == 0)
+            {
+                stats.vertCnt++;
+            }
+
+            if (timestamp - missTimestamps[idx] > cacheSize)
+            {
+                missTimestamps[idx] = timestamp++;
+                stats.transformedVertCnt++;
+            }
+        }
+
+        stats.acmr = stats.triCnt == 0 ? 0.f : (float)stats.transformedVertCnt / (float)stats.triCnt;
+        stats.atvr = stats.vertCnt == 0 ? 0.f : (float)stats.transformedVertCnt / (float)stats.vertCnt;
+        return stats;
+    }
+
+    // ================================================================================================================
+    void OptimizeVertexCache(
+        const uint32_t* pIndices,
+        uint32_t        idxCnt,
+        uint32_t        vertCnt,
+        uint32_t*       pOutIndices)
+    {
+        uint32_t triCnt = idxCnt / 3;
+        if (triCnt == 0)
+        {
+            return;
+        }
+
+        float cacheScores[ForsythCacheSize];
+        for (uint32_t i = 0; i < ForsythCacheSize; i++)
+        {
+            // The last triangle's vertices get a fixed score, so the next triangle doesn't prefer one of its edges.
+            if (i < 3)
+            {
+                cacheScores[i] = ForsythLastTriScore;
+            }
+            else
+            {
+                float scaler = 1.f - (float)(i - 3) / (float)(ForsythCacheSize - 3);
+                cacheScores[i] = std::pow(scaler, ForsythDecayPower);
+            }
+        }
+
+        float valenceScores[ForsythValenceCnt];
+        valenceScores[0] = 0.f;
+        for (uint32_t i = 1; i < ForsythValenceCnt; i++)
+        {
+            // Vertices with few triangles left get a boost, so lone triangles are not left behind.
+            valenceScores[i] = ForsythValenceScale * std::pow((float)i, -ForsythValencePower);
+        }
+
+        // The triangles that use each vertex. The first liveTriCnts[v] triangles of a vertex's list are not emitted yet.
+        std::vector<uint32_t> liveTriCnts(vertCnt, 0);
+        for (uint32_t i = 0; i < triCnt * 3; i++)
+        {
+            liveTriCnts[pIndices[i]]++;
+        }
+
+        std::vector<uint32_t> adjOffsets(vertCnt + 1, 0);
+        for (uint32_t v = 0; v < vertCnt; v++)
+        {
+            adjOffsets[v + 1] = adjOffsets[v] + liveTriCnts[v];
+        }
+
+        std::vector<uint32_t> adjTris(triCnt * 3);
+        {
+            std::vector<uint32_t> adjCursors(adjOffsets.begin(), adjOffsets.end() - 1);
+            for (uint32_t i = 0; i < triCnt * 3; i++)
+            {
+                adjTris[adjCursors[pIndices[i]]++] = i / 3;
+            }
+        }
+
+        std::vector<int32_t> cachePositions(vertCnt, -1);
+        std::vector<float>   vertScores(vertCnt);
+        for (uint32_t v = 0; v < vertCnt; v++)
+        {
+            vertScores[v] = ForsythVertexScore(-1, liveTriCnts[v], cacheScores, valenceScores);
+        }
+
+        std::vector<bool> triEmitted(triCnt, false);
+
+        // The triangle with the best score starts. Later triangles are only searched around the cache.
+        int64_t bestTri = 0;
+        {
+            float bestScore = -1.f;
+            for (uint32_t tri = 0; tri < triCnt; tri++)
+            {
+                const uint32_t* pTri = &pIndices[3 * tri];
+                float score = vertScores[pTri[0]] + vertScores[pTri[1]] + vertScores[pTri[2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTri = tri;
+                }
+            }
+        }
+
+        uint32_t cache[ForsythCacheSize + 3];
+        uint32_t newCache[ForsythCacheSize + 3];
+        uint32_t cacheCnt = 0;
+        uint32_t scanCursor = 0;
+
+        for (uint32_t emittedCnt = 0; emittedCnt < triCnt; emittedCnt++)
+        {
+            if (bestTri < 0)
+            {
+                // Nothing around the cache is left. The paper rescans all the triangles here, but taking the next one
+                // in the input order keeps it linear and barely changes the result.
+                while (triEmitted[scanCursor])
+                {
+                    scanCursor++;
+                }
+                bestTri = scanCursor;
+            }
+
+            const uint32_t* pTri = &pIndices[3 * bestTri];
+            memcpy(&pOutIndices[3 * emittedCnt], pTri, sizeof(uint32_t) * 3);
+            triEmitted[bestTri] = true;
+
+            // Remove the triangle from its vertices' live triangle lists.
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                uint32_t v = pTri[c];
+                uint32_t* pAdj = &adjTris[adjOffsets[v]];
+                uint32_t* pAdjEnd = pAdj + liveTriCnts[v];
+                uint32_t* pFound = std::find(pAdj, pAdjEnd, (uint32_t)bestTri);
+                std::swap(*pFound, *(pAdjEnd - 1));
+                liveTriCnts[v]--;
+            }
+
+            // The triangle's vertices move to the front of the LRU cache. The entries pushed past the cache size are
+            // evicted, but their scores still have to be updated once.
+            uint32_t newCacheCnt = 0;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                if (std::find(newCache, newCache + newCacheCnt, pTri[c]) == newCache + newCacheCnt)
+                {
+                    newCache[newCacheCnt++] = pTri[c];
+                }
+            }
+
+            for (uint32_t i = 0; i < cacheCnt; i++)
+            {
+                uint32_t v = cache[i];
+                if ((v != pTri[0]) && (v != pTri[1]) && (v != pTri[2]))
+                {
+                    newCache[newCacheCnt++] = v;
+                }
+            }
+
+            for (uint32_t i = 0; i < newCacheCnt; i++)
+            {
+                uint32_t v = newCache[i];
+                cachePositions[v] = i < ForsythCacheSize ? (int32_t)i : -1;
+                vertScores[v] = ForsythVertexScore(cachePositions[v], liveTriCnts[v], cacheScores, valenceScores);
+            }
+
+            cacheCnt = std::min(newCacheCnt, ForsythCacheSize);
+            memcpy(cache, newCache, sizeof(uint32_t) * cacheCnt);
+
+            // Only the triangles around the touched vertices have changed scores.
+            bestTri = -1;
+            float bestScore = -1.f;
+            for (uint32_t i = 0; i < newCacheCnt; i++)
+            {
+                uint32_t v = newCache[i];
+                const uint32_t* pAdj = &adjTris[adjOffsets[v]];
+                for (uint32_t j = 0; j < liveTriCnts[v]; j++)
+                {
+                    const uint32_t* pAdjTri = &pIndices[3 * pAdj[j]];
+                    float score = vertScores[pAdjTri[0]] + vertScores[pAdjTri[1]] + vertScores[pAdjTri[2]];
+                    if (score > bestScore)
+                    {
+                        bestScore = score;
+                        bestTri = pAdj[j];
+                    }
+                }
+            }
+        }
+    }
+
+    // ================================================================================================================
+    // Returns the FIFO cache misses of the triangle and updates the cache.
+    static uint32_t SimulateTriangleFifo(
+        const uint32_t*        pTri,
+        uint32_t               cacheSize,
+        std::vector<uint32_t>& missTimestamps,
+        uint32_t&              timestamp)
+    {
+        uint32_t misses = 0;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            if (timestamp - missTimestamps[pTri[c]] > cacheSize)
+            {
+                missTimestamps[pTri[c]] = timestamp++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+
+    // ================================================================================================================
+    void OptimizeOverdraw(
+        const uint32_t* pIndices,
+        uint32_t        idxCnt,
+        const float*    pPos,
+        uint32_t        vertCnt,
+        float           threshold,
+        uint32_t*       pOutIndices)
+    {
+        uint32_t triCnt = idxCnt / 3;
+        if (triCnt == 0)
+        {
+            return;
+        }
+
+        const uint32_t cacheSize = DefaultVertexCacheSize;
+        std::vector<uint32_t> missTimestamps(vertCnt, 0);
+        uint32_t timestamp = cacheSize + 1;
+
+        // Hard boundaries: a triangle that misses all its vertices starts from a cold cache anyway, so cutting there
+        // doesn't cost anything.
+        std::vector<uint32_t> hardStarts;
+        for (uint32_t tri = 0; tri < triCnt; tri++)
+        {
+            uint32_t misses = SimulateTriangleFifo(&pIndices[3 * tri], cacheSize, missTimestamps, timestamp);
+            if ((tri == 0) || (misses == 3))
+            {
+                hardStarts.push_back(tri);
+            }
+        }
+        hardStarts.push_back(triCnt);
+
+        // Soft boundaries: cut a hard cluster again where the ACMR from the last cut is already within the threshold
+        // of the whole cluster's ACMR. Bumping the timestamp past the cache size flushes the simulated cache.
+        std::vector<uint32_t> clusterStarts;
+        for (uint32_t h = 0; h + 1 < hardStarts.size(); h++)
+        {
+            uint32_t start = hardStarts[h];
+            uint32_t end = hardStarts[h + 1];
+
+            timestamp += cacheSize + 1;
+            uint32_t clusterMisses = 0;
+            for (uint32_t tri = start; tri < end; tri++)
+            {
+                clusterMisses += SimulateTriangleFifo(&pIndices[3 * tri], cacheSize, missTimestamps, timestamp);
+            }
+            float clusterThreshold = threshold * (float)clusterMisses / (float)(end - start);
+
+            timestamp += cacheSize + 1;
+            clusterStarts.push_back(start);
+            uint32_t softStart = start;
+            uint32_t softMisses = 0;
+            for (uint32_t tri = start; tri < end; tri++)
+            {
+                softMisses += SimulateTriangleFifo(&pIndices[3 * tri], cacheSize, missTimestamps, timestamp);
+                if ((tri + 1 < end) && ((float)softMisses / (float)(tri + 1 - softStart) <= clusterThreshold))
+                {
+                    softStart = tri + 1;
+                    softMisses = 0;
+                    clusterStarts.push_back(softStart);
+                    timestamp += cacheSize + 1;
+                }
+            }
+        }
+        clusterStarts.push_back(triCnt);
+
+        float meshCentroid[3] = { 0.f, 0.f, 0.f };
+        for (uint32_t v = 0; v < vertCnt; v++)
+        {
+            meshCentroid[0] += pPos[3 * v];
+            meshCentroid[1] += pPos[3 * v + 1];
+            meshCentroid[2] += pPos[3 * v + 2];
+        }
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            meshCentroid[k] /= (float)std::max(vertCnt, 1u);
+        }
+
+        // Clusters whose area weighted normal points away from the mesh center are more likely to be in front, so they
+        // are drawn first. It is a view independent heuristic, so it can only help the early depth test on average.
+        uint32_t clusterCnt = clusterStarts.size() - 1;
+        std::vector<float> clusterKeys(clusterCnt);
+        for (uint32_t cluster = 0; cluster < clusterCnt; cluster++)
+        {
+            float centroid[3] = { 0.f, 0.f, 0.f };
+            float normal[3] = { 0.f, 0.f, 0.f };
+            float areaSum = 0.f;
+            for (uint32_t tri = clusterStarts[cluster]; tri < clusterStarts[cluster + 1]; tri++)
+            {
+                const float* p0 = &pPos[3 * pIndices[3 * tri]];
+                const float* p1 = &pPos[3 * pIndices[3 * tri + 1]];
+                const float* p2 = &pPos[3 * pIndices[3 * tri + 2]];
+
+                float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+                float faceNormal[3] = { e1[1] * e2[2] - e1[2] * e2[1],
+                                        e1[2] * e2[0] - e1[0] * e2[2],
+                                        e1[0] * e2[1] - e1[1] * e2[0] };
+                float area = std::sqrt(faceNormal[0] * faceNormal[0] +
+                                       faceNormal[1] * faceNormal[1] +
+                                       faceNormal[2] * faceNormal[2]);
+
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    centroid[k] += area * (p0[k] + p1[k] + p2[k]) / 3.f;
+                    normal[k] += faceNormal[k];
+                }
+                areaSum += area;
+            }
+
+            float normalLen = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            if ((areaSum <= 0.f) || (normalLen <= 0.f))
+            {
+                clusterKeys[cluster] = 0.f;
+                continue;
+            }
+
+            float key = 0.f;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                key += (centroid[k] / areaSum - meshCentroid[k]) * normal[k] / normalLen;
+            }
+            clusterKeys[cluster] = key;
+        }
+
+        std::vector<uint32_t> clusterOrder(clusterCnt);
+        std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+        std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b) {
+            return clusterKeys[a] > clusterKeys[b];
+        });
+
+        uint32_t* pDst = pOutIndices;
+        for (uint32_t cluster : clusterOrder)
+        {
+            uint32_t start = clusterStarts[cluster];
+            uint32_t end = clusterStarts[cluster + 1];
+            memcpy(pDst, &pIndices[3 * start], sizeof(uint32_t) * 3 * (end - start));
+            pDst += 3 * (end - start);
+        }
+    }
+
+    // ================================================================================================================
+    uint32_t OptimizeVertexFetchRemap(
+        const uint32_t* pIndices,
+        uint32_t        idxCnt,
+        uint32_t        vertCnt,
+        uint32_t*       pOutRemap)
+    {
+        std::fill(pOutRemap, pOutRemap + vertCnt, UINT32_MAX);
+
+        uint32_t newVertCnt = 0;
+        for (uint32_t i = 0; i < idxCnt; i++)
+        {
+            uint32_t idx = pIndices[i];
+            if (pOutRemap[idx] == UINT32_MAX)
+            {
+                pOutRemap[idx] = newVertCnt++;
+            }
+        }
+        return newVertCnt;
+    }
+
+    // ================================================================================================================
+    void RemapVertexData(
+        const float*    pSrc,
+        uint32_t        vertCnt,
+        uint32_t        compCnt,
+        const uint32_t* pRemap,
+        float*          pDst)
+    {
+        for (uint32_t v = 0; v < vertCnt; v++)
+        {
+            if (pRemap[v] != UINT32_MAX)
+            {
+                memcpy(&pDst[compCnt * pRemap[v]], &pSrc[compCnt * v], sizeof(float) * compCnt);
+            }
+        }
+    }
+
+    // ================================================================================================================
+    void RemapIndices(
+        const uint32_t* pIndices,
+        uint32_t        idxCnt,
+        const uint32_t* pRemap,
+        uint32_t*       pOutIndices)
+    {
+        for (uint32_t i = 0; i < idxCnt; i++)
+        {
+            pOutIndices[i] = pRemap[pIndices[i]];
+        }
+    }
+}
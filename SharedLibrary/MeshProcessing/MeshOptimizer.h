@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+
+namespace SharedLib
+{
+    // Index and vertex reordering for triangle lists. A typical pass is OptimizeVertexCache, then OptimizeOverdraw on
+    // its output, then OptimizeVertexFetchRemap with RemapVertexData/RemapIndices. None of them changes the rendered
+    // image, only the order in which the GPU sees the triangles and the vertices.
+
+    // The post-transform vertex cache size used in the statistics and the overdraw clustering. Modern GPUs don't have a
+    // fixed size FIFO cache anymore, but a 16 entries FIFO is still a good proxy for their batch based vertex reuse.
+    const uint32_t DefaultVertexCacheSize = 16;
+
+    struct VertexCacheStats
+    {
+        uint32_t transformedVertCnt = 0; // Vertex shader invocations, which are the cache misses.
+        uint32_t triCnt             = 0;
+        uint32_t vertCnt            = 0; // Vertices referenced by the indices.
+
+        // Average cache miss ratio: transformed vertices per triangle. 3 is the worst and about 0.5 is the best on a
+        // large regular grid.
+        float acmr = 0.f;
+
+        // Average transformed vertex ratio: transformed vertices per referenced vertex. 1 is the best.
+        float atvr = 0.f;
+    };
+
+    // Simulates a FIFO post-transform cache of cacheSize entries over the triangle list.
+    VertexCacheStats AnalyzeVertexCache(const uint32_t* pIndices,
+                                        uint32_t        idxCnt,
+                                        uint32_t        vertCnt,
+                                        uint32_t        cacheSize = DefaultVertexCacheSize);
+
+    // Reorders the triangles for the post-transform vertex cache with Tom Forsyth's linear-speed vertex cache
+    // optimisation (https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html). pOutIndices must not alias
+    // pIndices.
+    void OptimizeVertexCache(const uint32_t* pIndices,
+                             uint32_t        idxCnt,
+                             uint32_t        vertCnt,
+                             uint32_t*       pOutIndices);
+
+    // Reorders the clusters of a vertex cache optimized triangle list, so the triangles facing outside of the mesh are
+    // drawn first and hide the ones behind them. The list is cut into clusters where the cache is flushed anyway, and
+    // then further where the cut costs less than (threshold - 1) of the cluster's ACMR, e.g. 1.05 allows the ACMR to
+    // get 5% worse. pPos is the float3 positions. pOutIndices must not alias pIndices.
+    void OptimizeOverdraw(const uint32_t* pIndices,
+                          uint32_t        idxCnt,
+                          const float*    pPos,
+                          uint32_t        vertCnt,
+                          float           threshold,
+                          uint32_t*       pOutIndices);
+
+    // Builds the remap table that orders the vertices by their first use in the indices, so the vertex fetch reads the
+    // vertex buffers nearly sequentially. pOutRemap[oldIdx] is the new index, or UINT32_MAX for an unreferenced vertex
+    // that gets dropped. Returns the vertex count after the remap.
+    uint32_t OptimizeVertexFetchRemap(const uint32_t* pIndices,
+                                      uint32_t        idxCnt,
+                                      uint32_t        vertCnt,
+                                      uint32_t*       pOutRemap);
+
+    // Applies the remap to a vertex attribute of compCnt floats per vertex. pDst must not alias pSrc and holds the
+    // remapped vertex count elements.
+    void RemapVertexData(const float*    pSrc,
+                         uint32_t        vertCnt,
+                         uint32_t        compCnt,
+                         const uint32_t* pRemap,
+                         float*          pDst);
+
+    // Applies the remap to the indices. pOutIndices can be the same as pIndices.
+    void RemapIndices(const uint32_t* pIndices,
+                      uint32_t        idxCnt,
+                      const uint32_t* pRemap,
+                      uint32_t*       pOutIndices);
+}
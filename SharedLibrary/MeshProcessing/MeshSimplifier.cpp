@@ -0,0 +1,523 @@
+#include "MeshSimplifier.h"
+#include <vector>
+#include <queue>
+#include <cmath>
+#include <algorithm>
+#include <cfloat>
+#include <cassert>
+
+namespace SharedLib
+{
+    // A collapse is rejected when it turns a triangle's normal by more than about 78 degrees.
+    static const double SimplifierMinNormalCos = 0.2;
+
+    // The symmetric 4x4 quadric matrix of the area weighted squared distance to a set of planes, and the total weight.
+    struct Quadric
+    {
+        double a00, a01, a02, a11, a12, a22;
+        double b0, b1, b2;
+        double c;
+        double weight;
+    };
+
+    // ================================================================================================================
+    static void AddPlaneToQuadric(
+        const double* n,
+        double        d,
+        double        weight,
+        Quadric&      q)
+    {
+        q.a00    += weight * n[0] * n[0];
+        q.a01    += weight * n[0] * n[1];
+        q.a02    += weight * n[0] * n[2];
+        q.a11    += weight * n[1] * n[1];
+        q.a12    += weight * n[1] * n[2];
+        q.a22    += weight * n[2] * n[2];
+        q.b0     += weight * n[0] * d;
+        q.b1     += weight * n[1] * d;
+        q.b2     += weight * n[2] * d;
+        q.c      += weight * d * d;
+        q.weight += weight;
+    }
+
+    // ================================================================================================================
+    static void AddQuadric(
+        const Quadric& src,
+        Quadric&       dst)
+    {
+        dst.a00    += src.a00;
+        dst.a01    += src.a01;
+        dst.a02    += src.a02;
+        dst.a11    += src.a11;
+        dst.a12    += src.a12;
+        dst.a22    += src.a22;
+        dst.b0     += src.b0;
+        dst.b1     += src.b1;
+        dst.b2     += src.b2;
+        dst.c      += src.c;
+        dst.weight += src.weight;
+    }
+
+    // ================================================================================================================
+    // The area weighted mean of the squared distances from the p to the quadric's planes.
+    static double EvalQuadric(
+        const Quadric& q,
+        const float*   p)
+    {
+        double x = p[0];
+        double y = p[1];
+        double z = p[2];
+        double err = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+                     2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+                     2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) +
+                     q.c;
+        return q.weight > 0.0 ? std::max(err / q.weight, 0.0) : 0.0;
+    }
+
+    // ================================================================================================================
+    static void TriangleNormalDouble(
+        const float* p0,
+        const float* p1,
+        const float* p2,
+        double*      oNormal)
+    {
+        double e1[3] = { (double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2] };
+        double e2[3] = { (double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2] };
+        oNormal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        oNormal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        oNormal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+
+    struct CollapseCandidate
+    {
+        double   cost;    // The geometric and the attributes' error, which orders the collapses.
+        double   geoCost; // Only the geometric error, which the maxError and the reported error are about.
+        uint32_t from;
+        uint32_t to;
+        uint32_t fromVersion;
+        uint32_t toVersion;
+
+        bool operator>(const CollapseCandidate& other) const { return cost > other.cost; }
+    };
+
+    // ================================================================================================================
+    uint32_t SimplifyMesh(
+        const uint32_t* pIndices,
+        uint32_t        idxCnt,
+        const float*    pPos,
+        uint32_t        vertCnt,
+        uint32_t        targetIdxCnt,
+        float           maxError,
+        bool            lockBorders,
+        uint32_t*       pOutIndices,
+        float*          pOutError)
+    {
+        return SimplifyMeshWithAttributes(pIndices,
+                                          idxCnt,
+                                          pPos,
+                                          vertCnt,
+                                          nullptr,
+                                          0,
+                                          nullptr,
+                                          targetIdxCnt,
+                                          maxError,
+                                          lockBorders,
+                                          pOutIndices,
+                                          pOutError);
+    }
+
+    // ================================================================================================================
+    uint32_t SimplifyMeshWithAttributes(
+        const uint32_t* pIndices,
+        uint32_t        idxCnt,
+        const float*    pPos,
+        uint32_t        vertCnt,
+        const float*    pAttribs,
+        uint32_t        attribCompCnt,
+        const float*    pAttribWeights,
+        uint32_t        targetIdxCnt,
+        float           maxError,
+        bool            lockBorders,
+        uint32_t*       pOutIndices,
+        float*          pOutError)
+    {
+        if (pAttribs == nullptr)
+        {
+            attribCompCnt = 0;
+        }
+        uint32_t triCnt = idxCnt / 3;
+        if (pOutError != nullptr)
+        {
+            *pOutError = 0.f;
+        }
+
+        // Work on the compacted vertices that the indices reference, so simplifying a small patch of a large mesh
+        // doesn't allocate per vertex data for the whole vertex buffer. When the indices can reference most of the
+        // vertices, a table of the vertCnt remaps them instead of the sort and the binary searches.
+        std::vector<uint32_t> globalVerts;
+        std::vector<uint32_t> tris(triCnt * 3);
+        if (triCnt * 3 >= vertCnt)
+        {
+            std::vector<uint32_t> globalToLocal(vertCnt, UINT32_MAX);
+            for (uint32_t i = 0; i < triCnt * 3; i++)
+            {
+                assert(pIndices[i] < vertCnt && "The index is out of the vertex buffer.");
+                uint32_t& local = globalToLocal[pIndices[i]];
+                if (local == UINT32_MAX)
+                {
+                    local = globalVerts.size();
+                    globalVerts.push_back(pIndices[i]);
+                }
+                tris[i] = local;
+            }
+        }
+        else
+        {
+            globalVerts.assign(pIndices, pIndices + triCnt * 3);
+            std::sort(globalVerts.begin(), globalVerts.end());
+            globalVerts.erase(std::unique(globalVerts.begin(), globalVerts.end()), globalVerts.end());
+            assert((globalVerts.empty() || (globalVerts.back() < vertCnt)) && "The index is out of the vertex buffer.");
+            for (uint32_t i = 0; i < triCnt * 3; i++)
+            {
+                tris[i] = std::lower_bound(globalVerts.begin(), globalVerts.end(), pIndices[i]) - globalVerts.begin();
+            }
+        }
+        uint32_t localVertCnt = globalVerts.size();
+
+        auto localPos = [&](uint32_t localVert) { return &pPos[3 * globalVerts[localVert]]; };
+        auto localAttribs = [&](uint32_t localVert) { return &pAttribs[attribCompCnt * globalVerts[localVert]]; };
+
+        // The attributes' error is scaled by the squared half diagonal of the bounds, so it is comparable to the
+        // squared distances of the quadrics for any size of the mesh.
+        double attribScale = 0.0;
+        if (attribCompCnt > 0)
+        {
+            float bbMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+            float bbMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+            for (uint32_t i = 0; i < localVertCnt; i++)
+            {
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    bbMin[c] = std::min(bbMin[c], localPos(i)[c]);
+                    bbMax[c] = std::max(bbMax[c], localPos(i)[c]);
+                }
+            }
+
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                double halfExtent = 0.5 * ((double)bbMax[c] - bbMin[c]);
+                attribScale += halfExtent * halfExtent;
+            }
+        }
+
+        // Per vertex: the total weight, the weighted sum of the squared attributes and the weighted sum of each
+        // attribute component. They merge by addition like the quadrics.
+        uint32_t            attribStride = attribCompCnt + 2;
+        std::vector<double> attribSums(localVertCnt * attribStride, 0.0);
+
+        std::vector<Quadric>               quadrics(localVertCnt, Quadric{});
+        std::vector<std::vector<uint32_t>> vertTris(localVertCnt);
+        std::vector<bool>                  triRemoved(triCnt, false);
+        for (uint32_t tri = 0; tri < triCnt; tri++)
+        {
+            const uint32_t* t = &tris[3 * tri];
+            if ((t[0] == t[1]) || (t[1] == t[2]) || (t[0] == t[2]))
+            {
+                triRemoved[tri] = true;
+                continue;
+            }
+
+            double n[3];
+            TriangleNormalDouble(localPos(t[0]), localPos(t[1]), localPos(t[2]), n);
+            double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (len > 0.0)
+            {
+                n[0] /= len;
+                n[1] /= len;
+                n[2] /= len;
+                const float* p0 = localPos(t[0]);
+                double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    AddPlaneToQuadric(n, d, len * 0.5, quadrics[t[c]]);
+                }
+
+                // A third of the triangle's area goes to each of its vertices' attributes.
+                for (uint32_t c = 0; (c < 3) && (attribCompCnt > 0); c++)
+                {
+                    double       weight = len * 0.5 / 3.0;
+                    double*      pSums = &attribSums[attribStride * t[c]];
+                    const float* pAttrib = localAttribs(t[c]);
+                    pSums[0] += weight;
+                    for (uint32_t k = 0; k < attribCompCnt; k++)
+                    {
+                        pSums[1] += weight * pAttribWeights[k] * pAttrib[k] * pAttrib[k];
+                        pSums[2 + k] += weight * pAttrib[k];
+                    }
+                }
+            }
+
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                vertTris[t[c]].push_back(tri);
+            }
+        }
+
+        // Undirected edges with their triangle counts, to find the borders and the non-manifold edges.
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        for (uint32_t tri = 0; tri < triCnt; tri++)
+        {
+            if (triRemoved[tri])
+            {
+                continue;
+            }
+
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                uint32_t a = tris[3 * tri + c];
+                uint32_t b = tris[3 * tri + (c + 1) % 3];
+                edges.push_back({ std::min(a, b), std::max(a, b) });
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        std::vector<bool> locked(localVertCnt, false);
+        for (uint32_t i = 0; i < edges.size();)
+        {
+            uint32_t j = i + 1;
+            while ((j < edges.size()) && (edges[j] == edges[i]))
+            {
+                j++;
+            }
+
+            uint32_t useCnt = j - i;
+            if ((useCnt > 2) || (lockBorders && (useCnt == 1)))
+            {
+                locked[edges[i].first] = true;
+                locked[edges[i].second] = true;
+            }
+            i = j;
+        }
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        std::vector<uint32_t> versions(localVertCnt, 0);
+        std::vector<bool>     vertRemoved(localVertCnt, false);
+        std::priority_queue<CollapseCandidate, std::vector<CollapseCandidate>, std::greater<CollapseCandidate>> heap;
+
+        // The weighted mean squared difference between the merged vertices' attributes and the kept vertex's ones.
+        auto evalAttribError = [&](uint32_t a, uint32_t b, uint32_t keep) {
+            if (attribCompCnt == 0)
+            {
+                return 0.0;
+            }
+
+            const double* pSumsA = &attribSums[attribStride * a];
+            const double* pSumsB = &attribSums[attribStride * b];
+            double        weight = pSumsA[0] + pSumsB[0];
+            if (weight <= 0.0)
+            {
+                return 0.0;
+            }
+
+            const float* pKeep = localAttribs(keep);
+            double err = pSumsA[1] + pSumsB[1];
+            for (uint32_t k = 0; k < attribCompCnt; k++)
+            {
+                double sum = pSumsA[2 + k] + pSumsB[2 + k];
+                err += pAttribWeights[k] * (weight * pKeep[k] * pKeep[k] - 2.0 * sum * pKeep[k]);
+            }
+            return std::max(err / weight, 0.0) * attribScale;
+        };
+
+        auto pushEdge = [&](uint32_t a, uint32_t b) {
+            // The cheaper direction of the two half-edge collapses.
+            Quadric q = quadrics[a];
+            AddQuadric(quadrics[b], q);
+
+            CollapseCandidate candidate{};
+            candidate.cost = -1.0;
+            if (locked[a] == false)
+            {
+                double geoCost = EvalQuadric(q, localPos(b));
+                candidate = { geoCost + evalAttribError(a, b, b), geoCost, a, b, versions[a], versions[b] };
+            }
+            if (locked[b] == false)
+            {
+                double geoCost = EvalQuadric(q, localPos(a));
+                double cost = geoCost + evalAttribError(a, b, a);
+                if ((candidate.cost < 0.0) || (cost < candidate.cost))
+                {
+                    candidate = { cost, geoCost, b, a, versions[b], versions[a] };
+                }
+            }
+
+            if (candidate.cost >= 0.0)
+            {
+                heap.push(candidate);
+            }
+        };
+
+        for (const auto& edge : edges)
+        {
+            pushEdge(edge.first, edge.second);
+        }
+
+        // Moving the from vertex onto the to vertex must keep every remaining triangle around it facing the same way.
+        auto isCollapseValid = [&](uint32_t from, uint32_t to) {
+            for (uint32_t tri : vertTris[from])
+            {
+                const uint32_t* t = &tris[3 * tri];
+                if (triRemoved[tri] || (t[0] == to) || (t[1] == to) || (t[2] == to))
+                {
+                    continue;
+                }
+
+                const float* p[3] = { localPos(t[0]), localPos(t[1]), localPos(t[2]) };
+                double oldNormal[3];
+                TriangleNormalDouble(p[0], p[1], p[2], oldNormal);
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    if (t[c] == from)
+                    {
+                        p[c] = localPos(to);
+                    }
+                }
+                double newNormal[3];
+                TriangleNormalDouble(p[0], p[1], p[2], newNormal);
+
+                double oldLenSq = oldNormal[0] * oldNormal[0] + oldNormal[1] * oldNormal[1] + oldNormal[2] * oldNormal[2];
+                double newLenSq = newNormal[0] * newNormal[0] + newNormal[1] * newNormal[1] + newNormal[2] * newNormal[2];
+                if (newLenSq <= 0.0)
+                {
+                    return false;
+                }
+                if (oldLenSq <= 0.0)
+                {
+                    continue;
+                }
+
+                double cosAngle = (oldNormal[0] * newNormal[0] + oldNormal[1] * newNormal[1] + oldNormal[2] * newNormal[2]) /
+                                  std::sqrt(oldLenSq * newLenSq);
+                if (cosAngle < SimplifierMinNormalCos)
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        uint32_t liveTriCnt = std::count(triRemoved.begin(), triRemoved.end(), false);
+        double maxCost = (double)maxError * (double)maxError;
+        double worstCost = 0.0;
+
+        while ((liveTriCnt * 3 > targetIdxCnt) && (heap.empty() == false))
+        {
+            CollapseCandidate candidate = heap.top();
+            heap.pop();
+
+            uint32_t from = candidate.from;
+            uint32_t to = candidate.to;
+            if (vertRemoved[from] || vertRemoved[to] ||
+                (versions[from] != candidate.fromVersion) || (versions[to] != candidate.toVersion))
+            {
+                // Stale, a newer candidate of the edge was pushed when a vertex changed.
+                continue;
+            }
+
+            // Without the attributes, every later candidate is over the limit too. With them, a later candidate may still
+            // be geometrically cheaper.
+            if (candidate.geoCost > maxCost)
+            {
+                if (attribCompCnt == 0)
+                {
+                    break;
+                }
+                continue;
+            }
+
+            if (isCollapseValid(from, to) == false)
+            {
+                continue;
+            }
+
+            // Rewire the from vertex's triangles to the to vertex. The ones on the collapsed edge degenerate.
+            for (uint32_t tri : vertTris[from])
+            {
+                if (triRemoved[tri])
+                {
+                    continue;
+                }
+
+                uint32_t* t = &tris[3 * tri];
+                if ((t[0] == to) || (t[1] == to) || (t[2] == to))
+                {
+                    triRemoved[tri] = true;
+                    liveTriCnt--;
+                    continue;
+                }
+
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    if (t[c] == from)
+                    {
+                        t[c] = to;
+                    }
+                }
+                vertTris[to].push_back(tri);
+            }
+
+            vertTris[from].clear();
+            vertRemoved[from] = true;
+            AddQuadric(quadrics[from], quadrics[to]);
+            for (uint32_t k = 0; k < attribStride; k++)
+            {
+                attribSums[attribStride * to + k] += attribSums[attribStride * from + k];
+            }
+            versions[to]++;
+            worstCost = std::max(worstCost, candidate.geoCost);
+
+            // The costs around the to vertex changed with its quadric.
+            std::vector<uint32_t> neighbours;
+            for (uint32_t tri : vertTris[to])
+            {
+                if (triRemoved[tri])
+                {
+                    continue;
+                }
+
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    if (tris[3 * tri + c] != to)
+                    {
+                        neighbours.push_back(tris[3 * tri + c]);
+                    }
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+            for (uint32_t neighbour : neighbours)
+            {
+                pushEdge(to, neighbour);
+            }
+        }
+
+        uint32_t outIdxCnt = 0;
+        for (uint32_t tri = 0; tri < triCnt; tri++)
+        {
+            if (triRemoved[tri] == false)
+            {
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    pOutIndices[outIdxCnt++] = globalVerts[tris[3 * tri + c]];
+                }
+            }
+        }
+
+        if (pOutError != nullptr)
+        {
+            *pOutError = (float)std::sqrt(worstCost);
+        }
+        return outIdxCnt;
+    }
+}
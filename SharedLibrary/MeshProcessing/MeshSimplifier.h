@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+
+namespace SharedLib
+{
+    // Quadric error metric simplification (Garland and Heckbert, https://www.cs.cmu.edu/~garland/Papers/quadrics.pdf)
+    // with half-edge collapses: a vertex is always collapsed onto one of its neighbours, so the simplified indices
+    // still address the original vertex buffer and several LODs can share it.
+    //
+    // The edges are collapsed cheapest first until the index count reaches the targetIdxCnt or the next collapse's
+    // error exceeds the maxError. A collapse that flips or degenerates a triangle is skipped. With lockBorders, the
+    // vertices on the edges that only one triangle of the input uses are never moved, so a simplified patch still
+    // matches its neighbours and the mesh's open borders stay in place. Non-manifold edges are always locked.
+    //
+    // Every index must be below the vertCnt. pOutIndices holds idxCnt elements and receives the remaining triangles in
+    // their input order. Returns the remaining index count. pOutError, if not null, receives the error of the worst
+    // collapse: the area weighted root mean square distance from the kept vertex to the planes of the original
+    // triangles it replaces, in the positions' units.
+    uint32_t SimplifyMesh(const uint32_t* pIndices,
+                          uint32_t        idxCnt,
+                          const float*    pPos,
+                          uint32_t        vertCnt,
+                          uint32_t        targetIdxCnt,
+                          float           maxError,
+                          bool            lockBorders,
+                          uint32_t*       pOutIndices,
+                          float*          pOutError);
+
+    // The same with per vertex attributes, e.g. the normals and the uvs, interleaved as attribCompCnt floats per vertex
+    // in the pAttribs. The collapses are ordered by the geometric error plus the area weighted mean squared difference
+    // between the removed vertices' attributes and the kept vertex's ones, times the pAttribWeights per component and
+    // the squared half diagonal of the input's bounds. So the collapses that smear the shading or stretch the uvs come
+    // last. The maxError and the pOutError stay geometric, so they keep meaning a distance for the LOD selection.
+    uint32_t SimplifyMeshWithAttributes(const uint32_t* pIndices,
+                                        uint32_t        idxCnt,
+                                        const float*    pPos,
+                                        uint32_t        vertCnt,
+                                        const float*    pAttribs,
+                                        uint32_t        attribCompCnt,
+                                        const float*    pAttribWeights,
+                                        uint32_t        targetIdxCnt,
+                                        float           maxError,
+                                        bool            lockBorders,
+                                        uint32_t*       pOutIndices,
+                                        float*          pOutError);
+}
@@ -0,0 +1,238 @@
+#include "MeshTangentSpace.h"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace SharedLib
+{
+    // ================================================================================================================
+    static inline void Sub3(const float* a, const float* b, float* res)
+    {
+        res[0] = a[0] - b[0];
+        res[1] = a[1] - b[1];
+        res[2] = a[2] - b[2];
+    }
+
+    // ================================================================================================================
+    static inline void Cross3(const float* a, const float* b, float* res)
+    {
+        res[0] = a[1] * b[2] - a[2] * b[1];
+        res[1] = a[2] * b[0] - a[0] * b[2];
+        res[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    // ================================================================================================================
+    static inline float Dot3(const float* a, const float* b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    // ================================================================================================================
+    static inline bool Normalize3(float* v)
+    {
+        float lenSq = Dot3(v, v);
+        if (lenSq <= 1e-20f)
+        {
+            return false;
+        }
+
+        float invLen = 1.f / std::sqrt(lenSq);
+        v[0] *= invLen;
+        v[1] *= invLen;
+        v[2] *= invLen;
+        return true;
+    }
+
+    // ================================================================================================================
+    // Remove the normal's component from the v and normalize it.
+    static inline bool ProjectOntoPlane(const float* n, float* v)
+    {
+        float d = Dot3(n, v);
+        v[0] -= d * n[0];
+        v[1] -= d * n[1];
+        v[2] -= d * n[2];
+        return Normalize3(v);
+    }
+
+    // ================================================================================================================
+    // Any unit vector perpendicular to the n. Used when the uvs cannot define a tangent.
+    static inline void BuildPerpendicular(const float* n, float* res)
+    {
+        const float axisX[3] = { 1.f, 0.f, 0.f };
+        const float axisY[3] = { 0.f, 1.f, 0.f };
+        const float* pAxis = std::fabs(n[0]) < 0.9f ? axisX : axisY;
+
+        res[0] = pAxis[0];
+        res[1] = pAxis[1];
+        res[2] = pAxis[2];
+        if (ProjectOntoPlane(n, res) == false)
+        {
+            res[0] = 1.f;
+            res[1] = 0.f;
+            res[2] = 0.f;
+        }
+    }
+
+    // ================================================================================================================
+    // The angle of the corner at the p0 in the triangle (p0, p1, p2).
+    static inline float CornerAngle(const float* p0, const float* p1, const float* p2)
+    {
+        float e1[3];
+        float e2[3];
+        Sub3(p1, p0, e1);
+        Sub3(p2, p0, e2);
+        if ((Normalize3(e1) == false) || (Normalize3(e2) == false))
+        {
+            return 0.f;
+        }
+
+        return std::acos(std::clamp(Dot3(e1, e2), -1.f, 1.f));
+    }
+
+    // ================================================================================================================
+    void GenerateSmoothNormals(
+        const float*    pPos,
+        uint32_t        vertCnt,
+        const uint32_t* pIndices,
+        uint32_t        idxCnt,
+        float*          pOutNormals)
+    {
+        std::fill(pOutNormals, pOutNormals + 3 * vertCnt, 0.f);
+
+        uint32_t triCnt = idxCnt / 3;
+        for (uint32_t tri = 0; tri < triCnt; tri++)
+        {
+            uint32_t i0 = pIndices[3 * tri];
+            uint32_t i1 = pIndices[3 * tri + 1];
+            uint32_t i2 = pIndices[3 * tri + 2];
+
+            float e1[3];
+            float e2[3];
+            float faceNormal[3];
+            Sub3(&pPos[3 * i1], &pPos[3 * i0], e1);
+            Sub3(&pPos[3 * i2], &pPos[3 * i0], e2);
+            Cross3(e1, e2, faceNormal);
+
+            // The cross product's length is twice the triangle's area, so the sum is area weighted for free.
+            for (uint32_t idx : { i0, i1, i2 })
+            {
+                pOutNormals[3 * idx]     += faceNormal[0];
+                pOutNormals[3 * idx + 1] += faceNormal[1];
+                pOutNormals[3 * idx + 2] += faceNormal[2];
+            }
+        }
+
+        // A separate contiguous pass, so the compiler can vectorize the normalization.
+        for (uint32_t i = 0; i < vertCnt; i++)
+        {
+            float* pNormal = &pOutNormals[3 * i];
+            if (Normalize3(pNormal) == false)
+            {
+                pNormal[0] = 0.f;
+                pNormal[1] = 0.f;
+                pNormal[2] = 1.f;
+            }
+        }
+    }
+
+    // ================================================================================================================
+    void GenerateTangents(
+        const float*    pPos,
+        const float*    pNormals,
+        const float*    pUvs,
+        uint32_t        vertCnt,
+        const uint32_t* pIndices,
+        uint32_t        idxCnt,
+        float*          pOutTangents)
+    {
+        // Accumulated tangents and bitangents of every vertex.
+        std::vector<float> tangentSums(3 * vertCnt, 0.f);
+        std::vector<float> bitangentSums(3 * vertCnt, 0.f);
+
+        uint32_t triCnt = idxCnt / 3;
+        for (uint32_t tri = 0; tri < triCnt; tri++)
+        {
+            const uint32_t triIndices[3] = { pIndices[3 * tri], pIndices[3 * tri + 1], pIndices[3 * tri + 2] };
+            const float* p0 = &pPos[3 * triIndices[0]];
+            const float* p1 = &pPos[3 * triIndices[1]];
+            const float* p2 = &pPos[3 * triIndices[2]];
+            const float* uv0 = &pUvs[2 * triIndices[0]];
+            const float* uv1 = &pUvs[2 * triIndices[1]];
+            const float* uv2 = &pUvs[2 * triIndices[2]];
+
+            float e1[3];
+            float e2[3];
+            Sub3(p1, p0, e1);
+            Sub3(p2, p0, e2);
+
+            float du1 = uv1[0] - uv0[0];
+            float dv1 = uv1[1] - uv0[1];
+            float du2 = uv2[0] - uv0[0];
+            float dv2 = uv2[1] - uv0[1];
+
+            // The uv area's sign tells whether the uv mapping is mirrored on this face. MikkTSpace only uses the sign
+            // and the directions, so it isn't divided by the area.
+            float uvArea = du1 * dv2 - du2 * dv1;
+            if (std::fabs(uvArea) < 1e-12f)
+            {
+                continue;
+            }
+            float uvSign = uvArea > 0.f ? 1.f : -1.f;
+
+            float faceTangent[3] = {
+                uvSign * (e1[0] * dv2 - e2[0] * dv1),
+                uvSign * (e1[1] * dv2 - e2[1] * dv1),
+                uvSign * (e1[2] * dv2 - e2[2] * dv1)
+            };
+            float faceBitangent[3] = {
+                uvSign * (e2[0] * du1 - e1[0] * du2),
+                uvSign * (e2[1] * du1 - e1[1] * du2),
+                uvSign * (e2[2] * du1 - e1[2] * du2)
+            };
+
+            const float* corners[3][3] = { { p0, p1, p2 }, { p1, p2, p0 }, { p2, p0, p1 } };
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                uint32_t idx = triIndices[c];
+                const float* n = &pNormals[3 * idx];
+
+                float t[3] = { faceTangent[0], faceTangent[1], faceTangent[2] };
+                float b[3] = { faceBitangent[0], faceBitangent[1], faceBitangent[2] };
+                if ((ProjectOntoPlane(n, t) == false) || (ProjectOntoPlane(n, b) == false))
+                {
+                    continue;
+                }
+
+                float angle = CornerAngle(corners[c][0], corners[c][1], corners[c][2]);
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    tangentSums[3 * idx + k]   += angle * t[k];
+                    bitangentSums[3 * idx + k] += angle * b[k];
+                }
+            }
+        }
+
+        for (uint32_t i = 0; i < vertCnt; i++)
+        {
+            const float* n = &pNormals[3 * i];
+            float* t = &tangentSums[3 * i];
+            float* b = &bitangentSums[3 * i];
+
+            // Re-project onto the normal's plane to remove the rounding drift. A zero sum, e.g. from degenerated uvs,
+            // falls back to any direction on the plane.
+            if (ProjectOntoPlane(n, t) == false)
+            {
+                BuildPerpendicular(n, t);
+            }
+
+            float nxt[3];
+            Cross3(n, t, nxt);
+            float sign = Dot3(nxt, b) < 0.f ? -1.f : 1.f;
+
+            pOutTangents[4 * i]     = t[0];
+            pOutTangents[4 * i + 1] = t[1];
+            pOutTangents[4 * i + 2] = t[2];
+            pOutTangents[4 * i + 3] = sign;
+        }
+    }
+}
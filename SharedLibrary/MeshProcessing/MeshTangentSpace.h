@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+
+namespace SharedLib
+{
+    // Tangent space generation for triangle lists. All the arrays are tightly packed float arrays of vertCnt elements:
+    // position<3>, normal<3>, uv<2> and tangent<4>. They only touch the primitive they are given, so callers can run
+    // them on different primitives concurrently, e.g. inside the loader's per primitive tasks.
+
+    // Area weighted smooth vertex normals. Each triangle adds its unnormalized face normal, whose length is twice its
+    // area, to its three vertices, and the sums are normalized at the end. Vertices that are not referenced by any
+    // non-degenerate triangle get (0, 0, 1).
+    void GenerateSmoothNormals(const float*    pPos,
+                               uint32_t        vertCnt,
+                               const uint32_t* pIndices,
+                               uint32_t        idxCnt,
+                               float*          pOutNormals);
+
+    // MikkTSpace compatible tangents (https://github.com/mmikk/MikkTSpace): each face's uv derivative tangent and
+    // bitangent are projected onto every corner's normal plane, normalized and weighted by the corner angle. The
+    // w component is the bitangent sign, where bitangent = w * cross(normal, tangent.xyz), as the glTF expects.
+    // Different from the reference implementation, it doesn't split vertices, so vertices shared by faces with
+    // mirrored uvs get the averaged tangent.
+    void GenerateTangents(const float*    pPos,
+                          const float*    pNormals,
+                          const float*    pUvs,
+                          uint32_t        vertCnt,
+                          const uint32_t* pIndices,
+                          uint32_t        idxCnt,
+                          float*          pOutTangents);
+}
@@ -0,0 +1,198 @@
+#include "MeshWeld.h"
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace SharedLib
+{
+    // The count of the epsilon components whose grid cells are hashed. A vertex probes the 3^n neighbouring cells, so
+    // it is kept small and the later epsilon components are only compared.
+    static const uint32_t MaxHashedCellCompCnt = 3;
+
+    // ================================================================================================================
+    // The exact key of a component without an epsilon. The +0 and -0 compare equal but have different bits.
+    static int64_t GetExactComponentKey(
+        float val)
+    {
+        if (val == 0.f)
+        {
+            return 0;
+        }
+
+        uint32_t bits = 0;
+        memcpy(&bits, &val, sizeof(float));
+        return bits;
+    }
+
+    // ================================================================================================================
+    // FNV-1a over the key's 64 bits words.
+    static uint64_t HashWeldKey(
+        const int64_t* pKey,
+        uint32_t       keyCompCnt)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (uint32_t c = 0; c < keyCompCnt; c++)
+        {
+            hash ^= (uint64_t)pKey[c];
+            hash *= 1099511628211ull;
+        }
+        return hash ^ (hash >> 29);
+    }
+
+    // ================================================================================================================
+    uint32_t GenerateWeldRemap(
+        const WeldStream* pStreams,
+        uint32_t          streamCnt,
+        uint32_t          vertCnt,
+        const uint32_t*   pIndices,
+        uint32_t          idxCnt,
+        uint32_t*         pOutRemap)
+    {
+        std::fill(pOutRemap, pOutRemap + vertCnt, UINT32_MAX);
+
+        // The hash key has the exact components first and then the grid cells of the first epsilon components. The
+        // cells are epsilon wide, so two values within the epsilon are at most one cell apart.
+        struct CellComp
+        {
+            uint32_t streamIdx;
+            uint32_t compIdx;
+        };
+
+        uint32_t              exactCompCnt = 0;
+        std::vector<CellComp> cellComps;
+        for (uint32_t s = 0; s < streamCnt; s++)
+        {
+            for (uint32_t c = 0; c < pStreams[s].compCnt; c++)
+            {
+                if (pStreams[s].epsilon <= 0.f)
+                {
+                    exactCompCnt++;
+                }
+                else if (cellComps.size() < MaxHashedCellCompCnt)
+                {
+                    cellComps.push_back({ s, c });
+                }
+            }
+        }
+        const uint32_t keyCompCnt = exactCompCnt + cellComps.size();
+
+        std::vector<int64_t> keys(vertCnt * keyCompCnt);
+        for (uint32_t v = 0; v < vertCnt; v++)
+        {
+            int64_t* pKey = &keys[v * keyCompCnt];
+            for (uint32_t s = 0; s < streamCnt; s++)
+            {
+                const WeldStream& stream = pStreams[s];
+                if (stream.epsilon <= 0.f)
+                {
+                    for (uint32_t c = 0; c < stream.compCnt; c++)
+                    {
+                        *pKey++ = GetExactComponentKey(stream.pData[v * stream.compCnt + c]);
+                    }
+                }
+            }
+
+            for (const CellComp& cellComp : cellComps)
+            {
+                const WeldStream& stream = pStreams[cellComp.streamIdx];
+                float val = stream.pData[v * stream.compCnt + cellComp.compIdx];
+                *pKey++ = (int64_t)std::floor((double)val / (double)stream.epsilon);
+            }
+        }
+
+        // Whether every epsilon component of the two vertices is equal within its stream's epsilon. The exact
+        // components are already equal when the keys are.
+        auto isWithinEpsilons = [&](uint32_t v0, uint32_t v1) {
+            for (uint32_t s = 0; s < streamCnt; s++)
+            {
+                const WeldStream& stream = pStreams[s];
+                if (stream.epsilon <= 0.f)
+                {
+                    continue;
+                }
+
+                const float* pVal0 = &stream.pData[v0 * stream.compCnt];
+                const float* pVal1 = &stream.pData[v1 * stream.compCnt];
+                for (uint32_t c = 0; c < stream.compCnt; c++)
+                {
+                    if (std::abs(pVal0[c] - pVal1[c]) > stream.epsilon)
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        };
+
+        // Open addressing with linear probing over the welded vertices. The table is at least twice the vertex count,
+        // so the probes stay short. A cell can hold several welded vertices, since their unhashed components may
+        // differ by more than the epsilon.
+        uint32_t tableSize = 1;
+        while (tableSize < vertCnt * 2)
+        {
+            tableSize *= 2;
+        }
+        const uint32_t tableMask = tableSize - 1;
+        std::vector<uint32_t> table(tableSize, UINT32_MAX);
+
+        uint32_t neighbourCellCnt = 1;
+        for (uint32_t i = 0; i < cellComps.size(); i++)
+        {
+            neighbourCellCnt *= 3;
+        }
+
+        std::vector<int64_t> probeKey(keyCompCnt);
+        uint32_t weldedVertCnt = 0;
+        for (uint32_t i = 0; i < idxCnt; i++)
+        {
+            uint32_t v = pIndices[i];
+            if (pOutRemap[v] != UINT32_MAX)
+            {
+                continue;
+            }
+
+            // Each neighbouring cell, e.g. 27 of them for the positions, is looked up for a welded vertex within the
+            // epsilons. The vertex's own cell is the first one.
+            const int64_t* pKey = &keys[v * keyCompCnt];
+            for (uint32_t n = 0; (n < neighbourCellCnt) && (pOutRemap[v] == UINT32_MAX); n++)
+            {
+                memcpy(probeKey.data(), pKey, sizeof(int64_t) * keyCompCnt);
+                uint32_t offsetCode = n;
+                for (uint32_t c = 0; c < cellComps.size(); c++)
+                {
+                    // The offsets 0, -1 and +1, so the n == 0 is the own cell.
+                    const int64_t offsets[3] = { 0, -1, 1 };
+                    probeKey[exactCompCnt + c] += offsets[offsetCode % 3];
+                    offsetCode /= 3;
+                }
+
+                uint32_t slot = (uint32_t)HashWeldKey(probeKey.data(), keyCompCnt) & tableMask;
+                while (table[slot] != UINT32_MAX)
+                {
+                    uint32_t other = table[slot];
+                    if ((memcmp(&keys[other * keyCompCnt], probeKey.data(), sizeof(int64_t) * keyCompCnt) == 0) &&
+                        isWithinEpsilons(v, other))
+                    {
+                        pOutRemap[v] = pOutRemap[other];
+                        break;
+                    }
+                    slot = (slot + 1) & tableMask;
+                }
+            }
+
+            if (pOutRemap[v] == UINT32_MAX)
+            {
+                uint32_t slot = (uint32_t)HashWeldKey(pKey, keyCompCnt) & tableMask;
+                while (table[slot] != UINT32_MAX)
+                {
+                    slot = (slot + 1) & tableMask;
+                }
+                table[slot] = v;
+                pOutRemap[v] = weldedVertCnt++;
+            }
+        }
+
+        return weldedVertCnt;
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+
+namespace SharedLib
+{
+    // One vertex attribute taking part in the welding. pData is tightly packed, compCnt floats per vertex.
+    struct WeldStream
+    {
+        const float* pData   = nullptr;
+        uint32_t     compCnt = 0;
+        float        epsilon = 0.f; // 0 only welds bitwise equal values, where +0 and -0 are the same.
+    };
+
+    // Builds the remap table that merges the vertices whose all streams are equal within their epsilons, so exporters'
+    // per face corner duplicates share one vertex again. The vertices are hashed by their exact components and by the
+    // epsilon wide grid cells of their first 3 epsilon components, e.g. the position's. Each vertex looks up its own
+    // and the neighbouring cells and compares the candidates component by component, so two vertices within the
+    // epsilons are welded even across a cell border. A vertex is welded to the first earlier one within the epsilons,
+    // so the welding isn't transitive. Nothing is averaged, the welded vertex keeps one of the merged vertices' values.
+    //
+    // Same as the OptimizeVertexFetchRemap(), pOutRemap[oldIdx] is the new index in the first use order, or UINT32_MAX
+    // for an unreferenced vertex, so the RemapVertexData() and RemapIndices() apply it. Returns the welded vertex count.
+    uint32_t GenerateWeldRemap(const WeldStream* pStreams,
+                               uint32_t          streamCnt,
+                               uint32_t          vertCnt,
+                               const uint32_t*   pIndices,
+                               uint32_t          idxCnt,
+                               uint32_t*         pOutRemap);
+}
@@ -0,0 +1,500 @@
+#include "MeshletBuilder.h"
+#include <cmath>
+#include <cstdio>
+#include <cassert>
+#include <algorithm>
+#include <array>
+
+namespace SharedLib
+{
+    // How much a candidate triangle's normal deviating from the meshlet's average normal costs, in new vertices.
+    static const float MeshletConeWeight = 0.5f;
+
+    // ================================================================================================================
+    static inline float Dot3(const float* a, const float* b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    // ================================================================================================================
+    // The unit normal of the triangle. Returns false for a degenerated triangle.
+    static bool TriangleNormal(
+        const float* p0,
+        const float* p1,
+        const float* p2,
+        float*       oNormal)
+    {
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        oNormal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        oNormal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        oNormal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+        float len = std::sqrt(Dot3(oNormal, oNormal));
+        if (len <= 1e-20f)
+        {
+            oNormal[0] = 0.f;
+            oNormal[1] = 0.f;
+            oNormal[2] = 0.f;
+            return false;
+        }
+
+        oNormal[0] /= len;
+        oNormal[1] /= len;
+        oNormal[2] /= len;
+        return true;
+    }
+
+    // ================================================================================================================
+    // Ritter's bounding sphere. It is at most about 5% larger than the minimal one.
+    static void ComputeMeshletSphere(
+        const MeshletData& data,
+        const Meshlet&     meshlet,
+        const float*       pPos,
+        MeshletBounds&     oBounds)
+    {
+        const uint32_t* pVerts = &data.vertIndices[meshlet.vertOffset];
+
+        auto farthestFrom = [&](const float* p) {
+            const float* pFarthest = p;
+            float maxDistSq = -1.f;
+            for (uint32_t i = 0; i < meshlet.vertCnt; i++)
+            {
+                const float* q = &pPos[3 * pVerts[i]];
+                float d[3] = { q[0] - p[0], q[1] - p[1], q[2] - p[2] };
+                float distSq = Dot3(d, d);
+                if (distSq > maxDistSq)
+                {
+                    maxDistSq = distSq;
+                    pFarthest = q;
+                }
+            }
+            return pFarthest;
+        };
+
+        const float* pA = farthestFrom(&pPos[3 * pVerts[0]]);
+        const float* pB = farthestFrom(pA);
+
+        float center[3] = { (pA[0] + pB[0]) * 0.5f, (pA[1] + pB[1]) * 0.5f, (pA[2] + pB[2]) * 0.5f };
+        float d[3] = { pB[0] - pA[0], pB[1] - pA[1], pB[2] - pA[2] };
+        float radius = std::sqrt(Dot3(d, d)) * 0.5f;
+
+        // Grow the sphere towards every point outside of it.
+        for (uint32_t i = 0; i < meshlet.vertCnt; i++)
+        {
+            const float* q = &pPos[3 * pVerts[i]];
+            float toQ[3] = { q[0] - center[0], q[1] - center[1], q[2] - center[2] };
+            float dist = std::sqrt(Dot3(toQ, toQ));
+            if (dist > radius)
+            {
+                float newRadius = (radius + dist) * 0.5f;
+                float shift = (newRadius - radius) / dist;
+                center[0] += toQ[0] * shift;
+                center[1] += toQ[1] * shift;
+                center[2] += toQ[2] * shift;
+                radius = newRadius;
+            }
+        }
+
+        oBounds.center[0] = center[0];
+        oBounds.center[1] = center[1];
+        oBounds.center[2] = center[2];
+        oBounds.radius = radius;
+    }
+
+    // ================================================================================================================
+    // The normal cone of the meshlet's non-degenerated triangles. It needs the sphere's center for the apex.
+    static void ComputeMeshletCone(
+        const MeshletData& data,
+        const Meshlet&     meshlet,
+        const float*       pPos,
+        MeshletBounds&     oBounds)
+    {
+        oBounds.coneAxis[0] = 0.f;
+        oBounds.coneAxis[1] = 0.f;
+        oBounds.coneAxis[2] = 0.f;
+        oBounds.coneCutoff = 1.f;
+        oBounds.coneApex[0] = oBounds.center[0];
+        oBounds.coneApex[1] = oBounds.center[1];
+        oBounds.coneApex[2] = oBounds.center[2];
+        oBounds.padding = 0.f;
+
+        std::vector<float> normals(3 * meshlet.triCnt);
+        std::vector<bool>  validNormals(meshlet.triCnt);
+        float axis[3] = { 0.f, 0.f, 0.f };
+        for (uint32_t tri = 0; tri < meshlet.triCnt; tri++)
+        {
+            uint32_t packedTri = data.packedTris[meshlet.triOffset + tri];
+            const float* p0 = &pPos[3 * data.vertIndices[meshlet.vertOffset + (packedTri & 0xFF)]];
+            const float* p1 = &pPos[3 * data.vertIndices[meshlet.vertOffset + ((packedTri >> 8) & 0xFF)]];
+            const float* p2 = &pPos[3 * data.vertIndices[meshlet.vertOffset + ((packedTri >> 16) & 0xFF)]];
+
+            float* n = &normals[3 * tri];
+            validNormals[tri] = TriangleNormal(p0, p1, p2, n);
+            axis[0] += n[0];
+            axis[1] += n[1];
+            axis[2] += n[2];
+        }
+
+        float axisLen = std::sqrt(Dot3(axis, axis));
+        if (axisLen <= 1e-20f)
+        {
+            return;
+        }
+        axis[0] /= axisLen;
+        axis[1] /= axisLen;
+        axis[2] /= axisLen;
+
+        float minDot = 1.f;
+        for (uint32_t tri = 0; tri < meshlet.triCnt; tri++)
+        {
+            if (validNormals[tri])
+            {
+                minDot = std::min(minDot, Dot3(axis, &normals[3 * tri]));
+            }
+        }
+
+        oBounds.coneAxis[0] = axis[0];
+        oBounds.coneAxis[1] = axis[1];
+        oBounds.coneAxis[2] = axis[2];
+
+        // A cone wider than about 84 degrees culls too rarely to be worth the test and makes the apex unstable.
+        if (minDot <= 0.1f)
+        {
+            return;
+        }
+
+        // Move the apex back along the axis until it is behind every triangle's plane:
+        // dot(center - t * axis - corner, normal) <= 0  =>  t >= dot(center - corner, normal) / dot(axis, normal).
+        float maxT = 0.f;
+        for (uint32_t tri = 0; tri < meshlet.triCnt; tri++)
+        {
+            if (validNormals[tri] == false)
+            {
+                continue;
+            }
+
+            uint32_t packedTri = data.packedTris[meshlet.triOffset + tri];
+            const float* p0 = &pPos[3 * data.vertIndices[meshlet.vertOffset + (packedTri & 0xFF)]];
+            const float* n = &normals[3 * tri];
+
+            float toCenter[3] = { oBounds.center[0] - p0[0], oBounds.center[1] - p0[1], oBounds.center[2] - p0[2] };
+            float t = Dot3(toCenter, n) / Dot3(axis, n);
+            maxT = std::max(maxT, t);
+        }
+
+        oBounds.coneApex[0] = oBounds.center[0] - axis[0] * maxT;
+        oBounds.coneApex[1] = oBounds.center[1] - axis[1] * maxT;
+        oBounds.coneApex[2] = oBounds.center[2] - axis[2] * maxT;
+        oBounds.coneCutoff = std::sqrt(1.f - minDot * minDot);
+    }
+
+    // ================================================================================================================
+    void BuildMeshlets(
+        const uint32_t* pIndices,
+        uint32_t        idxCnt,
+        const float*    pPos,
+        uint32_t        vertCnt,
+        uint32_t        maxVerts,
+        uint32_t        maxTris,
+        MeshletData&    oData)
+    {
+        assert(maxVerts >= 3 && maxVerts <= 256 && "The meshlet local indices are 8 bits.");
+        assert(maxTris >= 1 && "A meshlet needs at least one triangle.");
+
+        oData.meshlets.clear();
+        oData.bounds.clear();
+        oData.vertIndices.clear();
+        oData.packedTris.clear();
+
+        uint32_t triCnt = idxCnt / 3;
+        if (triCnt == 0)
+        {
+            return;
+        }
+
+        // The triangles that use each vertex. The first liveTriCnts[v] triangles of a vertex's list are unassigned.
+        std::vector<uint32_t> liveTriCnts(vertCnt, 0);
+        for (uint32_t i = 0; i < triCnt * 3; i++)
+        {
+            liveTriCnts[pIndices[i]]++;
+        }
+
+        std::vector<uint32_t> adjOffsets(vertCnt + 1, 0);
+        for (uint32_t v = 0; v < vertCnt; v++)
+        {
+            adjOffsets[v + 1] = adjOffsets[v] + liveTriCnts[v];
+        }
+
+        std::vector<uint32_t> adjTris(triCnt * 3);
+        {
+            std::vector<uint32_t> adjCursors(adjOffsets.begin(), adjOffsets.end() - 1);
+            for (uint32_t i = 0; i < triCnt * 3; i++)
+            {
+                adjTris[adjCursors[pIndices[i]]++] = i / 3;
+            }
+        }
+
+        std::vector<float> triNormals(3 * triCnt);
+        for (uint32_t tri = 0; tri < triCnt; tri++)
+        {
+            TriangleNormal(&pPos[3 * pIndices[3 * tri]],
+                           &pPos[3 * pIndices[3 * tri + 1]],
+                           &pPos[3 * pIndices[3 * tri + 2]],
+                           &triNormals[3 * tri]);
+        }
+
+        std::vector<bool>     triAssigned(triCnt, false);
+        std::vector<uint32_t> localIndices(vertCnt, UINT32_MAX); // Local index in the current meshlet.
+        Meshlet               meshlet{};
+        float                 normalSum[3] = { 0.f, 0.f, 0.f };
+        uint32_t              seedCursor = 0;
+
+        auto newVertCnt = [&](uint32_t tri) {
+            const uint32_t* pTri = &pIndices[3 * tri];
+            uint32_t cnt = (localIndices[pTri[0]] == UINT32_MAX) ? 1 : 0;
+            cnt += ((localIndices[pTri[1]] == UINT32_MAX) && (pTri[1] != pTri[0])) ? 1 : 0;
+            cnt += ((localIndices[pTri[2]] == UINT32_MAX) && (pTri[2] != pTri[0]) && (pTri[2] != pTri[1])) ? 1 : 0;
+            return cnt;
+        };
+
+        auto finishMeshlet = [&]() {
+            for (uint32_t i = 0; i < meshlet.vertCnt; i++)
+            {
+                localIndices[oData.vertIndices[meshlet.vertOffset + i]] = UINT32_MAX;
+            }
+
+            MeshletBounds bounds{};
+            ComputeMeshletSphere(oData, meshlet, pPos, bounds);
+            ComputeMeshletCone(oData, meshlet, pPos, bounds);
+
+            oData.meshlets.push_back(meshlet);
+            oData.bounds.push_back(bounds);
+
+            meshlet.vertOffset = oData.vertIndices.size();
+            meshlet.triOffset = oData.packedTris.size();
+            meshlet.vertCnt = 0;
+            meshlet.triCnt = 0;
+            normalSum[0] = 0.f;
+            normalSum[1] = 0.f;
+            normalSum[2] = 0.f;
+        };
+
+        for (uint32_t assignedCnt = 0; assignedCnt < triCnt; assignedCnt++)
+        {
+            // Pick the best unassigned triangle around the meshlet's vertices that still fits.
+            int64_t bestTri = -1;
+            float bestScore = 0.f;
+            float axis[3] = { normalSum[0], normalSum[1], normalSum[2] };
+            float axisLen = std::sqrt(Dot3(axis, axis));
+            if (axisLen > 0.f)
+            {
+                axis[0] /= axisLen;
+                axis[1] /= axisLen;
+                axis[2] /= axisLen;
+            }
+
+            for (uint32_t i = 0; i < meshlet.vertCnt; i++)
+            {
+                uint32_t v = oData.vertIndices[meshlet.vertOffset + i];
+                const uint32_t* pAdj = &adjTris[adjOffsets[v]];
+                for (uint32_t j = 0; j < liveTriCnts[v]; j++)
+                {
+                    uint32_t tri = pAdj[j];
+                    uint32_t extraVerts = newVertCnt(tri);
+                    if (meshlet.vertCnt + extraVerts > maxVerts)
+                    {
+                        continue;
+                    }
+
+                    float score = extraVerts + MeshletConeWeight * (1.f - Dot3(axis, &triNormals[3 * tri]));
+                    if ((bestTri < 0) || (score < bestScore))
+                    {
+                        bestTri = tri;
+                        bestScore = score;
+                    }
+                }
+            }
+
+            if (bestTri < 0)
+            {
+                // Nothing around fits anymore, so the next triangle in the index order seeds a new meshlet.
+                if (meshlet.triCnt > 0)
+                {
+                    finishMeshlet();
+                }
+
+                while (triAssigned[seedCursor])
+                {
+                    seedCursor++;
+                }
+                bestTri = seedCursor;
+            }
+
+            const uint32_t* pTri = &pIndices[3 * bestTri];
+            uint32_t packedTri = 0;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                uint32_t v = pTri[c];
+                if (localIndices[v] == UINT32_MAX)
+                {
+                    localIndices[v] = meshlet.vertCnt++;
+                    oData.vertIndices.push_back(v);
+                }
+                packedTri |= localIndices[v] << (8 * c);
+
+                // Remove the triangle from the vertex's unassigned triangle list.
+                uint32_t* pAdj = &adjTris[adjOffsets[v]];
+                uint32_t* pAdjEnd = pAdj + liveTriCnts[v];
+                uint32_t* pFound = std::find(pAdj, pAdjEnd, (uint32_t)bestTri);
+                std::swap(*pFound, *(pAdjEnd - 1));
+                liveTriCnts[v]--;
+            }
+
+            oData.packedTris.push_back(packedTri);
+            meshlet.triCnt++;
+            triAssigned[bestTri] = true;
+            normalSum[0] += triNormals[3 * bestTri];
+            normalSum[1] += triNormals[3 * bestTri + 1];
+            normalSum[2] += triNormals[3 * bestTri + 2];
+
+            if (meshlet.triCnt == maxTris)
+            {
+                finishMeshlet();
+            }
+        }
+
+        if (meshlet.triCnt > 0)
+        {
+            finishMeshlet();
+        }
+    }
+
+    // ================================================================================================================
+    bool ValidateMeshlets(
+        const MeshletData& data,
+        const uint32_t*    pIndices,
+        uint32_t           idxCnt,
+        const float*       pPos,
+        uint32_t           vertCnt,
+        uint32_t           maxVerts,
+        uint32_t           maxTris)
+    {
+        if (data.bounds.size() != data.meshlets.size())
+        {
+            printf("Meshlet validation: %d bounds for %d meshlets.\n", (int)data.bounds.size(), (int)data.meshlets.size());
+            return false;
+        }
+
+        // Every triangle as its three global indices, rotated to start from the smallest one so the winding is kept.
+        auto triKey = [](uint32_t i0, uint32_t i1, uint32_t i2) {
+            if ((i1 < i0) && (i1 <= i2))
+            {
+                return std::array<uint32_t, 3>{ i1, i2, i0 };
+            }
+            else if ((i2 < i0) && (i2 < i1))
+            {
+                return std::array<uint32_t, 3>{ i2, i0, i1 };
+            }
+            return std::array<uint32_t, 3>{ i0, i1, i2 };
+        };
+
+        std::vector<std::array<uint32_t, 3>> srcTris;
+        for (uint32_t i = 0; i + 2 < idxCnt; i += 3)
+        {
+            srcTris.push_back(triKey(pIndices[i], pIndices[i + 1], pIndices[i + 2]));
+        }
+
+        // The distance tolerance is relative to the meshlet's size.
+        const float eps = 1e-4f;
+
+        std::vector<std::array<uint32_t, 3>> meshletTris;
+        for (uint32_t m = 0; m < data.meshlets.size(); m++)
+        {
+            const Meshlet& meshlet = data.meshlets[m];
+            const MeshletBounds& bounds = data.bounds[m];
+
+            if ((meshlet.vertCnt > maxVerts) || (meshlet.triCnt > maxTris) || (meshlet.triCnt == 0))
+            {
+                printf("Meshlet validation: meshlet %d has %d vertices and %d triangles.\n",
+                       m, meshlet.vertCnt, meshlet.triCnt);
+                return false;
+            }
+
+            if ((meshlet.vertOffset + meshlet.vertCnt > data.vertIndices.size()) ||
+                (meshlet.triOffset + meshlet.triCnt > data.packedTris.size()))
+            {
+                printf("Meshlet validation: meshlet %d is out of the packed buffers.\n", m);
+                return false;
+            }
+
+            float tolerance = eps * std::max(bounds.radius, 1.f);
+            for (uint32_t i = 0; i < meshlet.vertCnt; i++)
+            {
+                uint32_t v = data.vertIndices[meshlet.vertOffset + i];
+                if (v >= vertCnt)
+                {
+                    printf("Meshlet validation: meshlet %d references the vertex %d out of %d.\n", m, v, vertCnt);
+                    return false;
+                }
+
+                const float* p = &pPos[3 * v];
+                float d[3] = { p[0] - bounds.center[0], p[1] - bounds.center[1], p[2] - bounds.center[2] };
+                if (std::sqrt(Dot3(d, d)) > bounds.radius + tolerance)
+                {
+                    printf("Meshlet validation: meshlet %d's sphere doesn't contain the vertex %d.\n", m, v);
+                    return false;
+                }
+            }
+
+            // The cone's half angle is acos(sqrt(1 - cutoff^2)) away from the axis.
+            float minNormalDot = std::sqrt(std::max(0.f, 1.f - bounds.coneCutoff * bounds.coneCutoff));
+            for (uint32_t tri = 0; tri < meshlet.triCnt; tri++)
+            {
+                uint32_t packedTri = data.packedTris[meshlet.triOffset + tri];
+                uint32_t local[3] = { packedTri & 0xFF, (packedTri >> 8) & 0xFF, (packedTri >> 16) & 0xFF };
+                if ((local[0] >= meshlet.vertCnt) || (local[1] >= meshlet.vertCnt) || (local[2] >= meshlet.vertCnt))
+                {
+                    printf("Meshlet validation: meshlet %d's triangle %d has a local index out of range.\n", m, tri);
+                    return false;
+                }
+
+                uint32_t global[3] = { data.vertIndices[meshlet.vertOffset + local[0]],
+                                       data.vertIndices[meshlet.vertOffset + local[1]],
+                                       data.vertIndices[meshlet.vertOffset + local[2]] };
+                meshletTris.push_back(triKey(global[0], global[1], global[2]));
+
+                float n[3];
+                if ((bounds.coneCutoff >= 1.f) ||
+                    (TriangleNormal(&pPos[3 * global[0]], &pPos[3 * global[1]], &pPos[3 * global[2]], n) == false))
+                {
+                    continue;
+                }
+
+                if (Dot3(n, bounds.coneAxis) < minNormalDot - eps)
+                {
+                    printf("Meshlet validation: meshlet %d's cone doesn't contain the triangle %d's normal.\n", m, tri);
+                    return false;
+                }
+
+                const float* p0 = &pPos[3 * global[0]];
+                float toApex[3] = { bounds.coneApex[0] - p0[0], bounds.coneApex[1] - p0[1], bounds.coneApex[2] - p0[2] };
+                if (Dot3(toApex, n) > tolerance)
+                {
+                    printf("Meshlet validation: meshlet %d's cone apex is in front of the triangle %d.\n", m, tri);
+                    return false;
+                }
+            }
+        }
+
+        std::sort(srcTris.begin(), srcTris.end());
+        std::sort(meshletTris.begin(), meshletTris.end());
+        if (srcTris != meshletTris)
+        {
+            printf("Meshlet validation: the meshlets don't cover the triangles exactly once.\n");
+            return false;
+        }
+
+        return true;
+    }
+}
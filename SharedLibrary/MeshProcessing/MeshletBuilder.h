@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace SharedLib
+{
+    // The meshlet structs follow the std430 layout, so the MeshletData's vectors can be copied into storage buffers
+    // as they are and read by the task and mesh shaders.
+    struct Meshlet
+    {
+        uint32_t vertOffset; // First element in the MeshletData::vertIndices.
+        uint32_t triOffset;  // First element in the MeshletData::packedTris.
+        uint32_t vertCnt;
+        uint32_t triCnt;
+    };
+
+    // The bounding sphere is for the frustum and occlusion culling. The normal cone is for the backface culling: all the
+    // meshlet's triangles are backfacing when dot(normalize(coneApex - cameraPos), coneAxis) >= coneCutoff. A cone that
+    // can't cull anything has the coneCutoff of 1.
+    struct MeshletBounds
+    {
+        float center[3];
+        float radius;
+        float coneAxis[3];
+        float coneCutoff;
+        float coneApex[3];
+        float padding;
+    };
+
+    struct MeshletData
+    {
+        std::vector<Meshlet>       meshlets;
+        std::vector<MeshletBounds> bounds;      // One per meshlet.
+        std::vector<uint32_t>      vertIndices; // The vertex buffer's index of every meshlet local vertex.
+        std::vector<uint32_t>      packedTris;  // Meshlet local indices of a triangle in the bits 0-7, 8-15 and 16-23.
+    };
+
+    // The limits recommended for most GPUs. 124 triangles leave the mesh shader's primitive indices in 128 * 3 bytes.
+    const uint32_t DefaultMeshletMaxVerts = 64;
+    const uint32_t DefaultMeshletMaxTris  = 124;
+
+    // Partitions a triangle list into meshlets of at most maxVerts (<= 256) vertices and maxTris triangles. A meshlet
+    // grows greedily with the neighbouring triangles that add the fewest new vertices and bend its normal cone the
+    // least, and a new meshlet starts from the next unassigned triangle in the index order. A vertex cache optimized
+    // index order keeps that seed close to the previous meshlet. pPos is the float3 positions. Only touches the given
+    // arrays, so different primitives can be built concurrently.
+    void BuildMeshlets(const uint32_t* pIndices,
+                       uint32_t        idxCnt,
+                       const float*    pPos,
+                       uint32_t        vertCnt,
+                       uint32_t        maxVerts,
+                       uint32_t        maxTris,
+                       MeshletData&    oData);
+
+    // Checks that the meshlets cover every input triangle exactly once, respect the limits, reference valid vertices,
+    // and that the spheres contain their vertices and the cones contain their triangles' normals with the apexes behind
+    // all the triangles' planes. Prints the first problem and returns false on a failure.
+    bool ValidateMeshlets(const MeshletData& data,
+                          const uint32_t*    pIndices,
+                          uint32_t           idxCnt,
+                          const float*       pPos,
+                          uint32_t           vertCnt,
+                          uint32_t           maxVerts,
+                          uint32_t           maxTris);
+}
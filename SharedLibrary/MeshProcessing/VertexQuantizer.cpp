@@ -0,0 +1,319 @@
+#include "VertexQuantizer.h"
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+
+namespace SharedLib
+{
+    static const float Pi = 3.14159265358979f;
+
+    // ================================================================================================================
+    static inline float Dot3(const float* a, const float* b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    // ================================================================================================================
+    static inline uint16_t FloatToUnorm16(float value)
+    {
+        return (uint16_t)std::lround(std::clamp(value, 0.f, 1.f) * 65535.f);
+    }
+
+    // ================================================================================================================
+    static inline int16_t FloatToSnorm16(float value)
+    {
+        return (int16_t)std::lround(std::clamp(value, -1.f, 1.f) * 32767.f);
+    }
+
+    // ================================================================================================================
+    uint16_t FloatToHalf(
+        float value)
+    {
+        uint32_t bits = 0;
+        memcpy(&bits, &value, sizeof(bits));
+
+        uint32_t sign = (bits >> 16) & 0x8000;
+        uint32_t absBits = bits & 0x7FFFFFFF;
+
+        // Infinities and NaNs. A NaN keeps a quiet mantissa bit.
+        if (absBits >= 0x7F800000)
+        {
+            return sign | 0x7C00 | ((absBits > 0x7F800000) ? 0x200 : 0);
+        }
+
+        // 65520 is the halfway point between the largest half and the infinity.
+        if (absBits >= 0x477FF000)
+        {
+            return sign | 0x7C00;
+        }
+
+        // Below the smallest normal half, 2^-14, the value is a multiple of 2^-24. The default rounding mode of the
+        // nearbyint(...) rounds to nearest even, and a rounded up 0x400 is the smallest normal half's encoding.
+        if (absBits < 0x38800000)
+        {
+            float absValue = std::abs(value);
+            return sign | (uint16_t)std::nearbyint(absValue * 16777216.f);
+        }
+
+        // Rebias the exponent from 127 to 15 and round the 13 dropped mantissa bits to nearest even. A carry out of
+        // the mantissa correctly bumps the exponent.
+        uint32_t half = (absBits - 0x38000000) >> 13;
+        uint32_t droppedBits = absBits & 0x1FFF;
+        if ((droppedBits > 0x1000) || ((droppedBits == 0x1000) && (half & 1)))
+        {
+            half++;
+        }
+        return sign | half;
+    }
+
+    // ================================================================================================================
+    // The unit vector projected on the octahedron and the octahedron's lower half folded over the upper half.
+    static void OctEncode(
+        const float* pVec,
+        int16_t*     oOct)
+    {
+        float l1Norm = std::abs(pVec[0]) + std::abs(pVec[1]) + std::abs(pVec[2]);
+        float x = (l1Norm > 0.f) ? pVec[0] / l1Norm : 0.f;
+        float y = (l1Norm > 0.f) ? pVec[1] / l1Norm : 0.f;
+        if (pVec[2] < 0.f)
+        {
+            float foldedX = (1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f);
+            float foldedY = (1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f);
+            x = foldedX;
+            y = foldedY;
+        }
+
+        oOct[0] = FloatToSnorm16(x);
+        oOct[1] = FloatToSnorm16(y);
+    }
+
+    // ================================================================================================================
+    // Same as the OctDecode(...) in the vertexDecode.hlsl.
+    static void OctDecode(
+        const int16_t* pOct,
+        float*         oVec)
+    {
+        float x = std::max(pOct[0] / 32767.f, -1.f);
+        float y = std::max(pOct[1] / 32767.f, -1.f);
+        float z = 1.f - std::abs(x) - std::abs(y);
+        float t = std::max(-z, 0.f);
+        x += (x >= 0.f) ? -t : t;
+        y += (y >= 0.f) ? -t : t;
+
+        float invLength = 1.f / std::sqrt(x * x + y * y + z * z);
+        oVec[0] = x * invLength;
+        oVec[1] = y * invLength;
+        oVec[2] = z * invLength;
+    }
+
+    // ================================================================================================================
+    // The branchless orthonormal basis around the unit normal of Duff et al. 2017, "Building an Orthonormal Basis,
+    // Revisited". Same as the TangentBasis(...) in the vertexDecode.hlsl.
+    static void BuildTangentBasis(
+        const float* pNormal,
+        float*       oBasis1,
+        float*       oBasis2)
+    {
+        float sign = (pNormal[2] >= 0.f) ? 1.f : -1.f;
+        float a = -1.f / (sign + pNormal[2]);
+        float b = pNormal[0] * pNormal[1] * a;
+
+        oBasis1[0] = 1.f + sign * pNormal[0] * pNormal[0] * a;
+        oBasis1[1] = sign * b;
+        oBasis1[2] = -sign * pNormal[0];
+
+        oBasis2[0] = b;
+        oBasis2[1] = sign + pNormal[1] * pNormal[1] * a;
+        oBasis2[2] = -pNormal[1];
+    }
+
+    // ================================================================================================================
+    // The tangent's angle around the normal in the low 15 bits and the bitangent sign in the top bit. The basis is
+    // built from the decoded normal, which is what the shader sees.
+    static uint16_t EncodeTangentAngle(
+        const int16_t* pOctNormal,
+        const float*   pTangent)
+    {
+        float normal[3];
+        float basis1[3];
+        float basis2[3];
+        OctDecode(pOctNormal, normal);
+        BuildTangentBasis(normal, basis1, basis2);
+
+        float angle = std::atan2(Dot3(pTangent, basis2), Dot3(pTangent, basis1));
+        uint32_t quantizedAngle = (uint32_t)std::lround((angle / (2.f * Pi) + 0.5f) * 32768.f) & 0x7FFF;
+        return quantizedAngle | ((pTangent[3] < 0.f) ? 0x8000 : 0);
+    }
+
+    // ================================================================================================================
+    uint32_t GetVertStride(
+        VertLayout layout)
+    {
+        switch (layout)
+        {
+        case VERT_LAYOUT_OCT_TANGENT:
+            return 20;
+        case VERT_LAYOUT_TANGENT_ANGLE:
+            return 16;
+        default:
+            return 12 * sizeof(float);
+        }
+    }
+
+    // ================================================================================================================
+    uint32_t GetVertInputDescs(
+        VertLayout                         layout,
+        uint32_t                           binding,
+        VkVertexInputBindingDescription&   oBindingDesc,
+        VkVertexInputAttributeDescription* oAttrDescs)
+    {
+        oBindingDesc = VkVertexInputBindingDescription{};
+        {
+            oBindingDesc.binding = binding;
+            oBindingDesc.stride = GetVertStride(layout);
+            oBindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        }
+
+        // The location, format and offset of each attribute.
+        struct VertAttr
+        {
+            uint32_t location;
+            VkFormat format;
+            uint32_t offset;
+        };
+
+        const VertAttr floatAttrs[] = {
+            { 0, VK_FORMAT_R32G32B32_SFLOAT,    0 },
+            { 1, VK_FORMAT_R32G32B32_SFLOAT,    3 * sizeof(float) },
+            { 2, VK_FORMAT_R32G32B32A32_SFLOAT, 6 * sizeof(float) },
+            { 3, VK_FORMAT_R32G32_SFLOAT,       10 * sizeof(float) }
+        };
+
+        const VertAttr octTangentAttrs[] = {
+            { 0, VK_FORMAT_R16G16B16A16_UNORM, 0 },
+            { 1, VK_FORMAT_R16G16_SNORM,       8 },
+            { 2, VK_FORMAT_R16G16_SNORM,       12 },
+            { 3, VK_FORMAT_R16G16_SFLOAT,      16 }
+        };
+
+        // The tangent is in the position's w, so there is nothing at the location 2.
+        const VertAttr tangentAngleAttrs[] = {
+            { 0, VK_FORMAT_R16G16B16A16_UNORM, 0 },
+            { 1, VK_FORMAT_R16G16_SNORM,       8 },
+            { 3, VK_FORMAT_R16G16_SFLOAT,      12 }
+        };
+
+        const VertAttr* pAttrs = floatAttrs;
+        uint32_t attrCnt = 4;
+        if (layout == VERT_LAYOUT_OCT_TANGENT)
+        {
+            pAttrs = octTangentAttrs;
+        }
+        else if (layout == VERT_LAYOUT_TANGENT_ANGLE)
+        {
+            pAttrs = tangentAngleAttrs;
+            attrCnt = 3;
+        }
+
+        for (uint32_t i = 0; i < attrCnt; i++)
+        {
+            oAttrDescs[i] = VkVertexInputAttributeDescription{};
+            {
+                oAttrDescs[i].location = pAttrs[i].location;
+                oAttrDescs[i].binding = binding;
+                oAttrDescs[i].format = pAttrs[i].format;
+                oAttrDescs[i].offset = pAttrs[i].offset;
+            }
+        }
+        return attrCnt;
+    }
+
+    // ================================================================================================================
+    void PackVertices(
+        VertLayout            layout,
+        const float*          pPos,
+        const float*          pNormals,
+        const float*          pTangents,
+        const float*          pUvs,
+        uint32_t              vertCnt,
+        VertDequant&          oDequant,
+        std::vector<uint8_t>& oVertData)
+    {
+        oDequant = VertDequant{ { 1.f, 1.f, 1.f, 0.f }, { 0.f, 0.f, 0.f, 0.f } };
+        oVertData.resize(vertCnt * GetVertStride(layout));
+
+        if (layout == VERT_LAYOUT_FLOAT)
+        {
+            float* pVertData = reinterpret_cast<float*>(oVertData.data());
+            for (uint32_t i = 0; i < vertCnt; i++)
+            {
+                memcpy(&pVertData[i * 12 + 0], &pPos[i * 3], 3 * sizeof(float));
+                memcpy(&pVertData[i * 12 + 3], &pNormals[i * 3], 3 * sizeof(float));
+                memcpy(&pVertData[i * 12 + 6], &pTangents[i * 4], 4 * sizeof(float));
+                memcpy(&pVertData[i * 12 + 10], &pUvs[i * 2], 2 * sizeof(float));
+            }
+            return;
+        }
+
+        // The positions are normalized in the bounding box. A flat axis keeps a 0 scale and all its positions at 0.
+        float posMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float posMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (uint32_t i = 0; i < vertCnt; i++)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                posMin[c] = std::min(posMin[c], pPos[i * 3 + c]);
+                posMax[c] = std::max(posMax[c], pPos[i * 3 + c]);
+            }
+        }
+
+        float posInvScale[3] = {};
+        for (uint32_t c = 0; (c < 3) && (vertCnt > 0); c++)
+        {
+            oDequant.posScale[c] = posMax[c] - posMin[c];
+            oDequant.posOffset[c] = posMin[c];
+            posInvScale[c] = (oDequant.posScale[c] > 0.f) ? 1.f / oDequant.posScale[c] : 0.f;
+        }
+
+        uint32_t stride = GetVertStride(layout);
+        for (uint32_t i = 0; i < vertCnt; i++)
+        {
+            uint8_t* pVert = &oVertData[i * stride];
+            const float* pTangent = &pTangents[i * 4];
+
+            uint16_t pos[4];
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                pos[c] = FloatToUnorm16((pPos[i * 3 + c] - posMin[c]) * posInvScale[c]);
+            }
+
+            int16_t octNormal[2];
+            OctEncode(&pNormals[i * 3], octNormal);
+
+            uint16_t uv[2] = { FloatToHalf(pUvs[i * 2]), FloatToHalf(pUvs[i * 2 + 1]) };
+
+            if (layout == VERT_LAYOUT_OCT_TANGENT)
+            {
+                // The unorm w is 1 for a positive bitangent sign and 0 for a negative one.
+                pos[3] = (pTangent[3] < 0.f) ? 0 : 65535;
+
+                int16_t octTangent[2];
+                OctEncode(pTangent, octTangent);
+
+                memcpy(pVert, pos, sizeof(pos));
+                memcpy(pVert + 8, octNormal, sizeof(octNormal));
+                memcpy(pVert + 12, octTangent, sizeof(octTangent));
+                memcpy(pVert + 16, uv, sizeof(uv));
+            }
+            else
+            {
+                pos[3] = EncodeTangentAngle(octNormal, pTangent);
+
+                memcpy(pVert, pos, sizeof(pos));
+                memcpy(pVert + 8, octNormal, sizeof(octNormal));
+                memcpy(pVert + 12, uv, sizeof(uv));
+            }
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace SharedLib
+{
+    // The vertex buffer layouts of the MeshPrimitive. The location 0 is the position, 1 the normal, 2 the tangent and
+    // 3 the uv in all of them, but the compact ones have to be decoded by the helpers in the
+    // SharedLibrary/HLSL/vertexDecode.hlsl. The positions are 16 bits normalized in the primitive's bounding box,
+    // so they need the primitive's VertDequant. The normals and tangents are octahedral encoded unit vectors.
+    enum VertLayout
+    {
+        VERT_LAYOUT_FLOAT,         // 48 bytes. pos float3, normal float3, tangent float4 and uv float2.
+        VERT_LAYOUT_OCT_TANGENT,   // 20 bytes. pos unorm16x4 with the tangent's w in the w, oct normal snorm16x2,
+                                   // oct tangent snorm16x2 and uv half2.
+        VERT_LAYOUT_TANGENT_ANGLE, // 16 bytes. pos unorm16x4 with the tangent's angle around the normal and its w in
+                                   // the w, oct normal snorm16x2 and uv half2.
+        VERT_LAYOUT_CNT
+    };
+
+    // The position is offset + scale * the unorm16 position. Two float4 so that it fits a push constant or a UBO as it
+    // is. The VERT_LAYOUT_FLOAT has the identity.
+    struct VertDequant
+    {
+        float posScale[4];  // xyz, w unused.
+        float posOffset[4]; // xyz, w unused.
+    };
+
+    uint32_t GetVertStride(VertLayout layout);
+
+    // The binding description of the layout at the binding and its attribute descriptions. The oAttrDescs must have
+    // room for 4. Returns the attribute count, which is 3 for the VERT_LAYOUT_TANGENT_ANGLE without the location 2.
+    uint32_t GetVertInputDescs(VertLayout                         layout,
+                               uint32_t                           binding,
+                               VkVertexInputBindingDescription&   oBindingDesc,
+                               VkVertexInputAttributeDescription* oAttrDescs);
+
+    // Interleaves the tightly packed vertex streams into the layout. The normals and the tangents' xyz are expected to
+    // be unit vectors and the tangents' w is the bitangent sign. The uvs keep about 3 significant digits as halves, so
+    // uvs that tile far beyond [-16, 16] lose precision.
+    void PackVertices(VertLayout            layout,
+                      const float*          pPos,
+                      const float*          pNormals,
+                      const float*          pTangents,
+                      const float*          pUvs,
+                      uint32_t              vertCnt,
+                      VertDequant&          oDequant,
+                      std::vector<uint8_t>& oVertData);
+
+    // The IEEE half with the round to nearest even. Overflows become infinities.
+    uint16_t FloatToHalf(float value);
+}
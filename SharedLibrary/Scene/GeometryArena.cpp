@@ -0,0 +1,136 @@
+#include "GeometryArena.h"
+#include "VulkanDbgUtils.h"
+#include <algorithm>
+
+namespace SharedLib
+{
+    // ================================================================================================================
+    GeometryRange GeometryArena::Alloc(
+        const void*    pData,
+        VkDeviceSize   byteCnt,
+        VkDeviceSize   alignment,
+        VmaAllocator*  pAllocator,
+        UploadManager* pUploadManager)
+    {
+        GeometryRange range{};
+        if (byteCnt == 0)
+        {
+            return range;
+        }
+
+        // The VMA only aligns to the powers of two. The other alignments, e.g. the 20 bytes vertex stride, get the
+        // slack to round the offset up within the allocation.
+        const bool isPowOfTwo = (alignment & (alignment - 1)) == 0;
+
+        VmaVirtualAllocationCreateInfo allocInfo{};
+        {
+            allocInfo.size = isPowOfTwo ? byteCnt : (byteCnt + alignment - 1);
+            allocInfo.alignment = isPowOfTwo ? alignment : 1;
+        }
+
+        VkDeviceSize allocOffset = 0;
+        bool isAllocated = false;
+        for (uint32_t blockIdx = 0; (blockIdx < m_blocks.size()) && (isAllocated == false); blockIdx++)
+        {
+            if (vmaVirtualAllocate(m_blocks[blockIdx].virtualBlock, &allocInfo, &range.alloc, &allocOffset) == VK_SUCCESS)
+            {
+                range.blockIdx = blockIdx;
+                isAllocated = true;
+            }
+        }
+
+        if (isAllocated == false)
+        {
+            AddBlock(allocInfo.size, pAllocator, pUploadManager);
+            range.blockIdx = m_blocks.size() - 1;
+            VK_CHECK(vmaVirtualAllocate(m_blocks.back().virtualBlock, &allocInfo, &range.alloc, &allocOffset));
+        }
+
+        range.offset = ((allocOffset + alignment - 1) / alignment) * alignment;
+        pUploadManager->EnqueueBufferUpload(pData, byteCnt, m_blocks[range.blockIdx].buffer.buffer, range.offset);
+        return range;
+    }
+
+    // ================================================================================================================
+    void GeometryArena::Free(
+        GeometryRange& range)
+    {
+        if (range.alloc == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        vmaVirtualFree(m_blocks[range.blockIdx].virtualBlock, range.alloc);
+        range = GeometryRange{};
+    }
+
+    // ================================================================================================================
+    void GeometryArena::Finalize(
+        VmaAllocator* pAllocator)
+    {
+        for (auto& block : m_blocks)
+        {
+            ASSERT(vmaIsVirtualBlockEmpty(block.virtualBlock), "All the ranges should be freed before the arena is finalized.");
+            vmaDestroyVirtualBlock(block.virtualBlock);
+            vmaDestroyBuffer(*pAllocator, block.buffer.buffer, block.buffer.bufferAlloc);
+        }
+        m_blocks.clear();
+    }
+
+    // ================================================================================================================
+    void GeometryArena::AddBlock(
+        VkDeviceSize   minByteCnt,
+        VmaAllocator*  pAllocator,
+        UploadManager* pUploadManager)
+    {
+        Block block{};
+        const VkDeviceSize blockByteCnt = std::max(minByteCnt, DefaultBlockByteCnt);
+
+        // The uploads of a dedicated copy queue write the block while the graphics queue reads its other ranges, so
+        // both of the queue families use it without the ownership transfers.
+        const uint32_t queueFamilyIndices[2] = { pUploadManager->GetCopyQueueFamilyIdx(),
+                                                 pUploadManager->GetDstQueueFamilyIdx() };
+
+        VkBufferCreateInfo bufferInfo{};
+        {
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = blockByteCnt;
+            bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                               VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                               VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+            if (pUploadManager->HasDedicatedCopyQueue())
+            {
+                bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+                bufferInfo.queueFamilyIndexCount = 2;
+                bufferInfo.pQueueFamilyIndices = queueFamilyIndices;
+            }
+            else
+            {
+                bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            }
+        }
+
+        // No host access flags, so the VMA picks the device local memory.
+        VmaAllocationCreateInfo bufferAllocInfo{};
+        {
+            bufferAllocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        }
+
+        VK_CHECK(vmaCreateBuffer(*pAllocator,
+                                 &bufferInfo,
+                                 &bufferAllocInfo,
+                                 &block.buffer.buffer,
+                                 &block.buffer.bufferAlloc,
+                                 nullptr));
+
+        VmaVirtualBlockCreateInfo virtualBlockInfo{};
+        {
+            virtualBlockInfo.size = blockByteCnt;
+        }
+        VK_CHECK(vmaCreateVirtualBlock(&virtualBlockInfo, &block.virtualBlock));
+
+        m_blocks.push_back(block);
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include "../Application/Application.h"
+#include "../Utils/UploadManager.h"
+#include "vk_mem_alloc.h"
+
+namespace SharedLib
+{
+    // A suballocated range of a GeometryArena block. The offset is in bytes from the start of the block's buffer.
+    struct GeometryRange
+    {
+        uint32_t             blockIdx;
+        VmaVirtualAllocation alloc;
+        VkDeviceSize         offset;
+    };
+
+    // Packs the vertices and the indices of many primitives into a few device local buffers, instead of a host visible
+    // allocation per buffer. Each block is one buffer that is bound as both the vertex and the index buffer, so the
+    // primitives in a block are drawn with their vertexOffset and firstIndex without rebinding. The entities' instance
+    // matrices and the primitives' meshlet data live in the same blocks, which are also storage buffers. The ranges are
+    // suballocated by VMA virtual blocks and filled by the staging copies of the UploadManager. A block is only added
+    // when the existing ones are full. Only the render thread may use it.
+    class GeometryArena
+    {
+    public:
+        GeometryArena() {}
+        ~GeometryArena() {}
+
+        // Enqueues the data into the pUploadManager, which the caller flushes. The range's offset is a multiple of the
+        // alignment, e.g. the vertex stride for the vertexOffset or the index size for the firstIndex. It doesn't
+        // have to be a power of two.
+        GeometryRange Alloc(const void*    pData,
+                            VkDeviceSize   byteCnt,
+                            VkDeviceSize   alignment,
+                            VmaAllocator*  pAllocator,
+                            UploadManager* pUploadManager);
+
+        // The GPU must not use the range anymore. A range without an allocation is ignored.
+        void Free(GeometryRange& range);
+
+        // Destroys the blocks. Every range must be freed before.
+        void Finalize(VmaAllocator* pAllocator);
+
+        VkBuffer GetBuffer(uint32_t blockIdx) const { return m_blocks[blockIdx].buffer.buffer; }
+        uint32_t GetBlockCnt() const { return m_blocks.size(); }
+
+        static constexpr VkDeviceSize DefaultBlockByteCnt = 64 * 1024 * 1024;
+
+        // The alignment of the ranges that are bound as storage buffers. It is the largest
+        // minStorageBufferOffsetAlignment that the Vulkan spec allows, so it fits every device.
+        static constexpr VkDeviceSize StorageBufferAlignment = 256;
+
+    private:
+        struct Block
+        {
+            GpuBuffer       buffer;
+            VmaVirtualBlock virtualBlock;
+        };
+
+        void AddBlock(VkDeviceSize minByteCnt, VmaAllocator* pAllocator, UploadManager* pUploadManager);
+
+        std::vector<Block> m_blocks;
+    };
+}
@@ -3,6 +3,8 @@
 #include "VulkanDbgUtils.h"
 #include "CmdBufUtils.h"
 #include "vk_mem_alloc.h"
+#include <algorithm>
+#include <cstring>
 
 namespace SharedLib
 {
@@ -37,15 +39,28 @@ namespace SharedLib
     }
 
     // ================================================================================================================
-    void MeshEntity::InitGpuRsrc(VkDevice        device,
-                                 VmaAllocator*   pAllocator,
-                                 VkCommandBuffer cmdBuffer,
-                                 VkQueue         queue)
+    void MeshEntity::InitGpuRsrc(VkDevice       device,
+                                 VmaAllocator*  pAllocator,
+                                 UploadManager* pUploadManager)
     {
         for (auto& meshPrimitive : m_meshPrimitives)
         {
-            meshPrimitive.InitGpuRsrc(device, pAllocator, cmdBuffer, queue);
+            meshPrimitive.InitGpuRsrc(device, pAllocator, pUploadManager, m_pTexCache, m_pGeoArena);
         }
+
+        const float identityInstanceMat[InstanceMatFloatCnt] = {
+            1.f, 0.f, 0.f, 0.f,
+            0.f, 1.f, 0.f, 0.f,
+            0.f, 0.f, 1.f, 0.f
+        };
+
+        // The instance matrices are read as a per instance vertex buffer at their range's offset, a row per float4.
+        const float* pInstanceMats = m_instanceMats.empty() ? identityInstanceMat : m_instanceMats.data();
+        m_instanceRange = m_pGeoArena->Alloc(pInstanceMats,
+                                             GetInstanceCnt() * InstanceMatFloatCnt * sizeof(float),
+                                             4 * sizeof(float),
+                                             pAllocator,
+                                             pUploadManager);
     }
 
     // ================================================================================================================
@@ -56,414 +71,408 @@ namespace SharedLib
         {
             meshPrimitive.FinializeGpuRsrc(device, pAllocator);
         }
+
+        if (m_pGeoArena != nullptr)
+        {
+            m_pGeoArena->Free(m_instanceRange);
+        }
     }
 
     // ================================================================================================================
-    void MeshPrimitive::InitGpuRsrc(VkDevice        device,
-                                    VmaAllocator*   pAllocator,
-                                    VkCommandBuffer cmdBuffer,
-                                    VkQueue         queue)
+    uint32_t MeshEntity::GetInstanceCnt() const
     {
-        uint32_t vertCount = m_posData.size() / 3;
-
-        // Create vertex buffer and send to GPU memory
-        // pos<3>, normal<3>, tangent<4>, uv<2>.
-        m_vertData.resize(vertCount * 12);
-        for (uint32_t i = 0; i < vertCount; i++)
-        {
-            m_vertData[i * 12 + 0] = m_posData[i * 3 + 0];
-            m_vertData[i * 12 + 1] = m_posData[i * 3 + 1];
-            m_vertData[i * 12 + 2] = m_posData[i * 3 + 2];
-
-            m_vertData[i * 12 + 3] = m_normalData[i * 3 + 0];
-            m_vertData[i * 12 + 4] = m_normalData[i * 3 + 1];
-            m_vertData[i * 12 + 5] = m_normalData[i * 3 + 2];
+        return m_instanceMats.empty() ? 1 : (m_instanceMats.size() / InstanceMatFloatCnt);
+    }
 
-            m_vertData[i * 12 + 6] = m_tangentData[i * 4 + 0];
-            m_vertData[i * 12 + 7] = m_tangentData[i * 4 + 1];
-            m_vertData[i * 12 + 8] = m_tangentData[i * 4 + 2];
-            m_vertData[i * 12 + 9] = m_tangentData[i * 4 + 3];
+    // ================================================================================================================
+    const float* MeshEntity::GetInstanceMat(
+        uint32_t instanceIdx) const
+    {
+        return m_instanceMats.empty() ? nullptr : &m_instanceMats[instanceIdx * InstanceMatFloatCnt];
+    }
 
-            m_vertData[i * 12 + 10] = m_texCoordData[i * 2 + 0];
-            m_vertData[i * 12 + 11] = m_texCoordData[i * 2 + 1];
+    // ================================================================================================================
+    uint32_t GetInstanceInputDescs(
+        uint32_t                           binding,
+        uint32_t                           firstLocation,
+        VkVertexInputBindingDescription&   oBindingDesc,
+        VkVertexInputAttributeDescription* oAttrDescs)
+    {
+        oBindingDesc = VkVertexInputBindingDescription{};
+        {
+            oBindingDesc.binding = binding;
+            oBindingDesc.stride = MeshEntity::InstanceMatFloatCnt * sizeof(float);
+            oBindingDesc.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
         }
 
-        // Init the GpuBuffer for the vert buffer.
+        const uint32_t rowCnt = 3;
+        for (uint32_t row = 0; row < rowCnt; row++)
         {
-            uint32_t vertBufferByteCnt = m_vertData.size() * sizeof(float);
-
-            VkBufferCreateInfo vertBufferInfo{};
+            oAttrDescs[row] = VkVertexInputAttributeDescription{};
             {
-                vertBufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-                vertBufferInfo.size        = vertBufferByteCnt;
-                vertBufferInfo.usage       = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-                vertBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+                oAttrDescs[row].location = firstLocation + row;
+                oAttrDescs[row].binding = binding;
+                oAttrDescs[row].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+                oAttrDescs[row].offset = row * 4 * sizeof(float);
             }
-
-            VmaAllocationCreateInfo vertBufferAllocInfo{};
-            {
-                vertBufferAllocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-                vertBufferAllocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT |
-                                            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-            }
-
-            vmaCreateBuffer(*pAllocator,
-                            &vertBufferInfo,
-                            &vertBufferAllocInfo,
-                            &m_vertBuffer.buffer,
-                            &m_vertBuffer.bufferAlloc,
-                            nullptr);
-
-            SharedLib::CopyRamDataToGpuBuffer(m_vertData.data(),
-                                              pAllocator,
-                                              m_vertBuffer.buffer,
-                                              m_vertBuffer.bufferAlloc,
-                                              sizeof(float) * m_vertData.size());
         }
+        return rowCnt;
+    }
 
-        // Create index buffer and send to GPU memory
+    // ================================================================================================================
+    void MeshPrimitive::SetIndices(
+        const std::vector<uint32_t>& indices,
+        bool                         allowUint8)
+    {
+        uint32_t maxIdx = 0;
+        for (uint32_t idx : indices)
         {
-            VkBufferCreateInfo indexBufferInfo{};
-            {
-                indexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-                indexBufferInfo.size = m_idxDataUint16.size() * sizeof(uint16_t);
-                indexBufferInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-                indexBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-            }
+            maxIdx = std::max(maxIdx, idx);
+        }
 
-            VmaAllocationCreateInfo indexBufferAllocInfo{};
-            {
-                indexBufferAllocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-                indexBufferAllocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT |
-                                             VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-            }
+        m_idxDataUint8.clear();
+        m_idxDataUint16.clear();
+        m_idxDataUint32.clear();
 
-            vmaCreateBuffer(*pAllocator,
-                            &indexBufferInfo,
-                            &indexBufferAllocInfo,
-                            &m_indexBuffer.buffer,
-                            &m_indexBuffer.bufferAlloc,
-                            nullptr);
-
-            SharedLib::CopyRamDataToGpuBuffer(m_idxDataUint16.data(),
-                                              pAllocator,
-                                              m_indexBuffer.buffer,
-                                              m_indexBuffer.bufferAlloc,
-                                              sizeof(uint16_t) * m_idxDataUint16.size());
+        // The all ones index is the primitive restart value of each type, so it cannot be a vertex index.
+        if (allowUint8 && (maxIdx < UINT8_MAX))
+        {
+            m_idxType = VK_INDEX_TYPE_UINT8_EXT;
+            m_idxDataUint8.assign(indices.begin(), indices.end());
         }
-
-        VmaAllocationCreateInfo gpuImgAllocInfo{};
+        else if (maxIdx < UINT16_MAX)
         {
-            gpuImgAllocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-            gpuImgAllocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+            m_idxType = VK_INDEX_TYPE_UINT16;
+            m_idxDataUint16.assign(indices.begin(), indices.end());
         }
-
-        VkSamplerCreateInfo samplerInfo{};
+        else
         {
-            samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-            samplerInfo.magFilter = VK_FILTER_LINEAR;
-            samplerInfo.minFilter = VK_FILTER_LINEAR;
-            samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-            samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-            samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-            samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-            samplerInfo.minLod = -1000;
-            samplerInfo.maxLod = 1000;
-            samplerInfo.maxAnisotropy = 1.0f;
+            m_idxType = VK_INDEX_TYPE_UINT32;
+            m_idxDataUint32 = indices;
         }
+    }
 
-        // Create base color's GPU image.
+    // ================================================================================================================
+    MeshLod MeshPrimitive::SelectLod(
+        const float  cameraPos[3],
+        float        fovY,
+        float        viewportHeight,
+        float        pixelError,
+        const float* pInstanceMat) const
+    {
+        if (m_lods.empty())
         {
-            VkExtent3D extent{};
-            {
-                extent.width = m_baseColorTex.pixWidth;
-                extent.height = m_baseColorTex.pixHeight;
-                extent.depth = 1;
-            }
-
-            VkImageCreateInfo baseColorImgInfo{};
-            {
-                baseColorImgInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-                baseColorImgInfo.imageType = VK_IMAGE_TYPE_2D;
-                baseColorImgInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
-                baseColorImgInfo.extent = extent;
-                baseColorImgInfo.mipLevels = 1;
-                baseColorImgInfo.arrayLayers = 1;
-                baseColorImgInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-                baseColorImgInfo.tiling = VK_IMAGE_TILING_LINEAR;
-                baseColorImgInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-                baseColorImgInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            }
-
-            vmaCreateImage(*pAllocator,
-                           &baseColorImgInfo,
-                           &gpuImgAllocInfo,
-                           &m_baseColorGpuImg.image,
-                           &m_baseColorGpuImg.imageAllocation,
-                           nullptr);
-
-            VkImageViewCreateInfo info{};
-            {
-                info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-                info.image = m_baseColorGpuImg.image;
-                info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-                info.format = VK_FORMAT_R8G8B8A8_SRGB;
-                info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                info.subresourceRange.levelCount = 1;
-                info.subresourceRange.layerCount = 1;
-            }
-            VK_CHECK(vkCreateImageView(device, &info, nullptr, &m_baseColorGpuImg.imageView));
-            
-            VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &m_baseColorGpuImg.imageSampler));
-
-            m_baseColorGpuImg.imageDescInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            m_baseColorGpuImg.imageDescInfo.imageView = m_baseColorGpuImg.imageView;
-            m_baseColorGpuImg.imageDescInfo.sampler = m_baseColorGpuImg.imageSampler;
+            return { 0, GetIdxCnt(), 0.f };
         }
 
-        // Create normal's GPU image.
+        // The errors are in the mesh's units, so an instance scaled by s has s times their error in the world. Dividing
+        // the allowed error by s compares the same thing.
+        float instanceSphere[4];
+        memcpy(instanceSphere, m_boundingSphere, sizeof(instanceSphere));
+        float maxScale = 1.f;
+        if (pInstanceMat != nullptr)
         {
-            VkExtent3D extent{};
-            {
-                extent.width  = m_normalTex.pixWidth;
-                extent.height = m_normalTex.pixHeight;
-                extent.depth  = 1;
-            }
-
-            VkImageCreateInfo normalImgInfo{};
-            {
-                normalImgInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-                normalImgInfo.imageType = VK_IMAGE_TYPE_2D;
-                normalImgInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
-                normalImgInfo.extent = extent;
-                normalImgInfo.mipLevels = 1;
-                normalImgInfo.arrayLayers = 1;
-                normalImgInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-                normalImgInfo.tiling = VK_IMAGE_TILING_LINEAR;
-                normalImgInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-                normalImgInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            }
-
-            vmaCreateImage(*pAllocator,
-                           &normalImgInfo,
-                           &gpuImgAllocInfo,
-                           &m_normalGpuImg.image,
-                           &m_normalGpuImg.imageAllocation,
-                           nullptr);
-
-            VkImageViewCreateInfo info{};
-            {
-                info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-                info.image = m_normalGpuImg.image;
-                info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-                info.format = VK_FORMAT_R8G8B8A8_UNORM;
-                info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                info.subresourceRange.levelCount = 1;
-                info.subresourceRange.layerCount = 1;
-            }
-            VK_CHECK(vkCreateImageView(device, &info, nullptr, &m_normalGpuImg.imageView));
+            maxScale = TransformBoundingSphere(m_boundingSphere, pInstanceMat, instanceSphere);
+        }
 
-            VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &m_normalGpuImg.imageSampler));
+        uint32_t lodIdx = SelectMeshLod(m_lods.data(),
+                                        m_lods.size(),
+                                        instanceSphere,
+                                        cameraPos,
+                                        fovY,
+                                        viewportHeight,
+                                        (maxScale > 0.f) ? (pixelError / maxScale) : pixelError);
+        return m_lods[lodIdx];
+    }
 
-            m_normalGpuImg.imageDescInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            m_normalGpuImg.imageDescInfo.imageView = m_normalGpuImg.imageView;
-            m_normalGpuImg.imageDescInfo.sampler = m_normalGpuImg.imageSampler;
+    // ================================================================================================================
+    uint32_t MeshPrimitive::GetIdxCnt() const
+    {
+        switch (m_idxType)
+        {
+        case VK_INDEX_TYPE_UINT8_EXT:
+            return m_idxDataUint8.size();
+        case VK_INDEX_TYPE_UINT32:
+            return m_idxDataUint32.size();
+        default:
+            return m_idxDataUint16.size();
         }
+    }
 
-        // Metallic roughness
+    // ================================================================================================================
+    static uint32_t GetIdxTypeByteCnt(
+        VkIndexType idxType)
+    {
+        switch (idxType)
         {
-            VkExtent3D extent{};
-            {
-                extent.width = m_metallicRoughnessTex.pixWidth;
-                extent.height = m_metallicRoughnessTex.pixHeight;
-                extent.depth = 1;
-            }
+        case VK_INDEX_TYPE_UINT8_EXT:
+            return sizeof(uint8_t);
+        case VK_INDEX_TYPE_UINT32:
+            return sizeof(uint32_t);
+        default:
+            return sizeof(uint16_t);
+        }
+    }
 
-            VkImageCreateInfo metalllicRoughnessImgInfo{};
-            {
-                metalllicRoughnessImgInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-                metalllicRoughnessImgInfo.imageType = VK_IMAGE_TYPE_2D;
-                metalllicRoughnessImgInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
-                metalllicRoughnessImgInfo.extent = extent;
-                metalllicRoughnessImgInfo.mipLevels = 1;
-                metalllicRoughnessImgInfo.arrayLayers = 1;
-                metalllicRoughnessImgInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-                metalllicRoughnessImgInfo.tiling = VK_IMAGE_TILING_LINEAR;
-                metalllicRoughnessImgInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-                metalllicRoughnessImgInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            }
+    // ================================================================================================================
+    uint32_t MeshPrimitive::GetFirstIdx() const
+    {
+        return m_idxRange.offset / GetIdxTypeByteCnt(m_idxType);
+    }
 
-            vmaCreateImage(*pAllocator,
-                           &metalllicRoughnessImgInfo,
-                           &gpuImgAllocInfo,
-                           &m_metallicRoughnessGpuImg.image,
-                           &m_metallicRoughnessGpuImg.imageAllocation,
-                           nullptr);
+    // ================================================================================================================
+    uint32_t MeshPrimitive::GetIdx(
+        uint32_t i) const
+    {
+        switch (m_idxType)
+        {
+        case VK_INDEX_TYPE_UINT8_EXT:
+            return m_idxDataUint8[i];
+        case VK_INDEX_TYPE_UINT32:
+            return m_idxDataUint32[i];
+        default:
+            return m_idxDataUint16[i];
+        }
+    }
 
-            VkImageViewCreateInfo info{};
-            {
-                info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-                info.image = m_metallicRoughnessGpuImg.image;
-                info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-                info.format = VK_FORMAT_R8G8B8A8_UNORM;
-                info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                info.subresourceRange.levelCount = 1;
-                info.subresourceRange.layerCount = 1;
-            }
-            VK_CHECK(vkCreateImageView(device, &info, nullptr, &m_metallicRoughnessGpuImg.imageView));
+    // ================================================================================================================
+    void MeshPrimitive::GetIndicesUint32(
+        std::vector<uint32_t>& oIndices) const
+    {
+        switch (m_idxType)
+        {
+        case VK_INDEX_TYPE_UINT8_EXT:
+            oIndices.assign(m_idxDataUint8.begin(), m_idxDataUint8.end());
+            break;
+        case VK_INDEX_TYPE_UINT32:
+            oIndices = m_idxDataUint32;
+            break;
+        default:
+            oIndices.assign(m_idxDataUint16.begin(), m_idxDataUint16.end());
+        }
+    }
 
-            VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &m_metallicRoughnessGpuImg.imageSampler));
+    // ================================================================================================================
+    const void* MeshPrimitive::GetIdxData() const
+    {
+        switch (m_idxType)
+        {
+        case VK_INDEX_TYPE_UINT8_EXT:
+            return m_idxDataUint8.data();
+        case VK_INDEX_TYPE_UINT32:
+            return m_idxDataUint32.data();
+        default:
+            return m_idxDataUint16.data();
+        }
+    }
 
-            m_metallicRoughnessGpuImg.imageDescInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            m_metallicRoughnessGpuImg.imageDescInfo.imageView = m_metallicRoughnessGpuImg.imageView;
-            m_metallicRoughnessGpuImg.imageDescInfo.sampler = m_metallicRoughnessGpuImg.imageSampler;
+    // ================================================================================================================
+    uint32_t MeshPrimitive::GetIdxByteCnt() const
+    {
+        switch (m_idxType)
+        {
+        case VK_INDEX_TYPE_UINT8_EXT:
+            return m_idxDataUint8.size() * sizeof(uint8_t);
+        case VK_INDEX_TYPE_UINT32:
+            return m_idxDataUint32.size() * sizeof(uint32_t);
+        default:
+            return m_idxDataUint16.size() * sizeof(uint16_t);
         }
+    }
 
-        // Occlusion image
+    // ================================================================================================================
+    // Suballocates the data from the pGeoArena for a storage buffer binding. Empty data leaves the oRange without an
+    // allocation and the oDescInfo's buffer null.
+    static void AllocStorageRange(
+        const void*             pData,
+        uint32_t                byteCnt,
+        GeometryArena*          pGeoArena,
+        VmaAllocator*           pAllocator,
+        UploadManager*          pUploadManager,
+        GeometryRange&          oRange,
+        VkDescriptorBufferInfo& oDescInfo)
+    {
+        if (byteCnt == 0)
         {
-            VkExtent3D extent{};
-            {
-                extent.width = m_occlusionTex.pixWidth;
-                extent.height = m_occlusionTex.pixHeight;
-                extent.depth = 1;
-            }
+            return;
+        }
 
-            VkImageCreateInfo occlusionImgInfo{};
-            {
-                occlusionImgInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-                occlusionImgInfo.imageType = VK_IMAGE_TYPE_2D;
-                occlusionImgInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
-                occlusionImgInfo.extent = extent;
-                occlusionImgInfo.mipLevels = 1;
-                occlusionImgInfo.arrayLayers = 1;
-                occlusionImgInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-                occlusionImgInfo.tiling = VK_IMAGE_TILING_LINEAR;
-                occlusionImgInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-                occlusionImgInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            }
+        oRange = pGeoArena->Alloc(pData,
+                                  byteCnt,
+                                  GeometryArena::StorageBufferAlignment,
+                                  pAllocator,
+                                  pUploadManager);
 
-            vmaCreateImage(*pAllocator,
-                           &occlusionImgInfo,
-                           &gpuImgAllocInfo,
-                           &m_occlusionGpuImg.image,
-                           &m_occlusionGpuImg.imageAllocation,
-                           nullptr);
+        oDescInfo.buffer = pGeoArena->GetBuffer(oRange.blockIdx);
+        oDescInfo.offset = oRange.offset;
+        oDescInfo.range = byteCnt;
+    }
 
-            VkImageViewCreateInfo info{};
-            {
-                info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-                info.image = m_occlusionGpuImg.image;
-                info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-                info.format = VK_FORMAT_R8G8B8A8_UNORM;
-                info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                info.subresourceRange.levelCount = 1;
-                info.subresourceRange.layerCount = 1;
-            }
-            VK_CHECK(vkCreateImageView(device, &info, nullptr, &m_occlusionGpuImg.imageView));
+    // ================================================================================================================
+    const ImgInfo* MeshPrimitive::GetTex(
+        MeshTexSlot slot) const
+    {
+        const ImgInfo* texs[MESH_TEX_CNT] = {
+            m_baseColorTex.get(), m_ormTex.get(), m_normalTex.get(), m_emissiveTex.get()
+        };
+        return texs[slot];
+    }
 
-            VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &m_occlusionGpuImg.imageSampler));
+    // ================================================================================================================
+    void MeshPrimitive::SetCpuTex(
+        MeshTexSlot                    slot,
+        std::shared_ptr<const ImgInfo> tex,
+        uint64_t                       srcId)
+    {
+        std::shared_ptr<const ImgInfo>* texs[MESH_TEX_CNT] = {
+            &m_baseColorTex, &m_ormTex, &m_normalTex, &m_emissiveTex
+        };
+        *texs[slot] = std::move(tex);
+        m_texSrcIds[slot] = srcId;
+    }
 
-            m_occlusionGpuImg.imageDescInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            m_occlusionGpuImg.imageDescInfo.imageView = m_occlusionGpuImg.imageView;
-            m_occlusionGpuImg.imageDescInfo.sampler = m_occlusionGpuImg.imageSampler;
+    // ================================================================================================================
+    VkFormat MeshPrimitive::GetTexFormat(
+        MeshTexSlot slot)
+    {
+        switch (slot)
+        {
+        case MESH_TEX_BASE_COLOR:
+        case MESH_TEX_EMISSIVE:
+            return VK_FORMAT_R8G8B8A8_SRGB;
+        case MESH_TEX_NORMAL:
+            return VK_FORMAT_R8G8_UNORM;
+        default:
+            return VK_FORMAT_R8G8B8A8_UNORM;
         }
+    }
 
-        // Emissive image -- Currently we don't support emissive texture.
-        /*
+    // ================================================================================================================
+    void MeshPrimitive::SetTex(
+        MeshTexSlot                    slot,
+        std::shared_ptr<const ImgInfo> tex,
+        uint64_t                       srcId,
+        uint64_t                       retireFrame,
+        VkDevice                       device,
+        VmaAllocator*                  pAllocator,
+        UploadManager*                 pUploadManager)
+    {
+        SetCpuTex(slot, std::move(tex), srcId);
+        if (slot == MESH_TEX_EMISSIVE)
         {
-            VkExtent3D extent{};
-            {
-                extent.width = m_emissiveTex.pixWidth;
-                extent.height = m_emissiveTex.pixHeight;
-                extent.depth = 1;
-            }
+            return;
+        }
 
-            VkImageCreateInfo emissiveImgInfo{};
-            {
-                emissiveImgInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-                emissiveImgInfo.imageType = VK_IMAGE_TYPE_2D;
-                emissiveImgInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
-                emissiveImgInfo.extent = extent;
-                emissiveImgInfo.mipLevels = 1;
-                emissiveImgInfo.arrayLayers = 1;
-                emissiveImgInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-                emissiveImgInfo.tiling = VK_IMAGE_TILING_LINEAR;
-                emissiveImgInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-                emissiveImgInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            }
+        // The new texture is acquired first, so an unchanged one isn't destroyed and uploaded again.
+        CachedTex* pOldTex = m_pTexs[slot];
+        m_pTexs[slot] = m_pTexCache->Acquire(srcId,
+                                             *GetTex(slot),
+                                             GetTexFormat(slot),
+                                             device,
+                                             pAllocator,
+                                             pUploadManager);
+        m_texDescInfos[slot] = m_pTexs[slot]->gpuImg.imageDescInfo;
+        m_texDescInfos[slot].sampler = m_pTexCache->GetSampler(m_texSamplers[slot], device);
+        m_pTexCache->ReleaseAfterFrame(pOldTex, retireFrame);
+    }
 
-            vmaCreateImage(*pAllocator,
-                           &emissiveImgInfo,
-                           &gpuImgAllocInfo,
-                           &m_emissiveGpuImg.image,
-                           &m_emissiveGpuImg.imageAllocation,
-                           nullptr);
+    // ================================================================================================================
+    void MeshPrimitive::InitGpuRsrc(VkDevice       device,
+                                    VmaAllocator*  pAllocator,
+                                    UploadManager* pUploadManager,
+                                    TextureCache*  pTexCache,
+                                    GeometryArena* pGeoArena)
+    {
+        uint32_t vertCount = m_posData.size() / 3;
 
-            VkImageViewCreateInfo info{};
+        // Interleave the vertex streams in the m_vertLayout.
+        PackVertices(m_vertLayout,
+                     m_posData.data(),
+                     m_normalData.data(),
+                     m_tangentData.data(),
+                     m_texCoordData.data(),
+                     vertCount,
+                     m_vertDequant,
+                     m_vertData);
+
+        // The vertices are aligned to their stride for the vertexOffset and the indices to their size for the firstIndex.
+        m_pGeoArena = pGeoArena;
+        m_vertRange = m_pGeoArena->Alloc(m_vertData.data(),
+                                         m_vertData.size(),
+                                         GetVertStride(m_vertLayout),
+                                         pAllocator,
+                                         pUploadManager);
+
+        m_idxRange = m_pGeoArena->Alloc(GetIdxData(),
+                                        GetIdxByteCnt(),
+                                        GetIdxTypeByteCnt(m_idxType),
+                                        pAllocator,
+                                        pUploadManager);
+
+        // Meshlet data for the task and mesh shaders.
+        {
+            const void* meshletData[MESHLET_DATA_CNT] = { m_meshletData.meshlets.data(),
+                                                          m_meshletData.bounds.data(),
+                                                          m_meshletData.vertIndices.data(),
+                                                          m_meshletData.packedTris.data() };
+
+            const uint32_t meshletByteCnts[MESHLET_DATA_CNT] = {
+                (uint32_t)(m_meshletData.meshlets.size() * sizeof(Meshlet)),
+                (uint32_t)(m_meshletData.bounds.size() * sizeof(MeshletBounds)),
+                (uint32_t)(m_meshletData.vertIndices.size() * sizeof(uint32_t)),
+                (uint32_t)(m_meshletData.packedTris.size() * sizeof(uint32_t))
+            };
+
+            for (uint32_t i = 0; i < MESHLET_DATA_CNT; i++)
             {
-                info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-                info.image = m_emissiveGpuImg.image;
-                info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-                info.format = VK_FORMAT_R8G8B8A8_SRGB;
-                info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                info.subresourceRange.levelCount = 1;
-                info.subresourceRange.layerCount = 1;
+                AllocStorageRange(meshletData[i],
+                                  meshletByteCnts[i],
+                                  m_pGeoArena,
+                                  pAllocator,
+                                  pUploadManager,
+                                  m_meshletRanges[i],
+                                  m_meshletDescInfos[i]);
             }
-            VK_CHECK(vkCreateImageView(device, &info, nullptr, &m_emissiveGpuImg.imageView));
-
-            VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &m_emissiveGpuImg.imageSampler));
-
-            m_emissiveGpuImg.imageDescInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            m_emissiveGpuImg.imageDescInfo.imageView = m_emissiveGpuImg.imageView;
-            m_emissiveGpuImg.imageDescInfo.sampler = m_emissiveGpuImg.imageSampler;
         }
-        */
-
-        // Send image data to the GPU Buffer and Transform their formats to the shader read optimal.
-        SharedLib::Send2dImgDataToGpu(cmdBuffer, device, queue, *pAllocator, &m_baseColorTex, m_baseColorGpuImg.image);
-        SharedLib::Send2dImgDataToGpu(cmdBuffer, device, queue, *pAllocator, &m_normalTex, m_normalGpuImg.image);
-        SharedLib::Send2dImgDataToGpu(cmdBuffer, device, queue, *pAllocator, &m_metallicRoughnessTex, m_metallicRoughnessGpuImg.image);
-        SharedLib::Send2dImgDataToGpu(cmdBuffer, device, queue, *pAllocator, &m_occlusionTex, m_occlusionGpuImg.image);
 
-        VkImageSubresourceRange subresourceRange{};
+        // The emissive texture isn't created. The renderer doesn't support it.
+        m_pTexCache = pTexCache;
+        for (uint32_t slot = 0; slot < MESH_TEX_EMISSIVE; slot++)
         {
-            subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            subresourceRange.baseMipLevel = 0;
-            subresourceRange.levelCount = 1;
-            subresourceRange.baseArrayLayer = 0;
-            subresourceRange.layerCount = 1;
+            m_pTexs[slot] = m_pTexCache->Acquire(m_texSrcIds[slot],
+                                                 *GetTex((MeshTexSlot)slot),
+                                                 GetTexFormat((MeshTexSlot)slot),
+                                                 device,
+                                                 pAllocator,
+                                                 pUploadManager);
+            m_texDescInfos[slot] = m_pTexs[slot]->gpuImg.imageDescInfo;
+            m_texDescInfos[slot].sampler = m_pTexCache->GetSampler(m_texSamplers[slot], device);
         }
-        SharedLib::TransitionImgLayout(cmdBuffer, device, queue, m_baseColorGpuImg.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
-        SharedLib::TransitionImgLayout(cmdBuffer, device, queue, m_normalGpuImg.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
-        SharedLib::TransitionImgLayout(cmdBuffer, device, queue, m_metallicRoughnessGpuImg.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
-        SharedLib::TransitionImgLayout(cmdBuffer, device, queue, m_occlusionGpuImg.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
     }
 
     // ================================================================================================================
     void MeshPrimitive::FinializeGpuRsrc(VkDevice      device,
                                          VmaAllocator* pAllocator)
     {
-        vmaDestroyBuffer(*pAllocator, m_indexBuffer.buffer, m_indexBuffer.bufferAlloc);
-        vmaDestroyBuffer(*pAllocator, m_vertBuffer.buffer, m_vertBuffer.bufferAlloc);
-
-        vmaDestroyImage(*pAllocator, m_baseColorGpuImg.image, m_baseColorGpuImg.imageAllocation);
-        vkDestroyImageView(device, m_baseColorGpuImg.imageView, nullptr);
-        vkDestroySampler(device, m_baseColorGpuImg.imageSampler, nullptr);
-
-        vmaDestroyImage(*pAllocator, m_normalGpuImg.image, m_normalGpuImg.imageAllocation);
-        vkDestroyImageView(device, m_normalGpuImg.imageView, nullptr);
-        vkDestroySampler(device, m_normalGpuImg.imageSampler, nullptr);
-
-        vmaDestroyImage(*pAllocator, m_metallicRoughnessGpuImg.image, m_metallicRoughnessGpuImg.imageAllocation);
-        vkDestroyImageView(device, m_metallicRoughnessGpuImg.imageView, nullptr);
-        vkDestroySampler(device, m_metallicRoughnessGpuImg.imageSampler, nullptr);
-
-        // vmaDestroyImage(*pAllocator, m_emissiveGpuImg.image, m_emissiveGpuImg.imageAllocation);
-        // vkDestroyImageView(device, m_emissiveGpuImg.imageView, nullptr);
-        // vkDestroySampler(device, m_emissiveGpuImg.imageSampler, nullptr);
+        if (m_pGeoArena != nullptr)
+        {
+            m_pGeoArena->Free(m_idxRange);
+            m_pGeoArena->Free(m_vertRange);
+            for (uint32_t i = 0; i < MESHLET_DATA_CNT; i++)
+            {
+                m_pGeoArena->Free(m_meshletRanges[i]);
+                m_meshletDescInfos[i] = VkDescriptorBufferInfo{};
+            }
+        }
 
-        vmaDestroyImage(*pAllocator, m_occlusionGpuImg.image, m_occlusionGpuImg.imageAllocation);
-        vkDestroyImageView(device, m_occlusionGpuImg.imageView, nullptr);
-        vkDestroySampler(device, m_occlusionGpuImg.imageSampler, nullptr);
+        for (uint32_t slot = 0; slot < MESH_TEX_CNT; slot++)
+        {
+            if (m_pTexs[slot] != nullptr)
+            {
+                m_pTexCache->Release(m_pTexs[slot], device, pAllocator);
+                m_pTexs[slot] = nullptr;
+                m_texDescInfos[slot] = VkDescriptorImageInfo{};
+            }
+        }
     }
 }
\ No newline at end of file
@@ -2,7 +2,14 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <map>
+#include <memory>
 #include "../Application/Application.h"
+#include "../MeshProcessing/MeshletBuilder.h"
+#include "../MeshProcessing/MeshLod.h"
+#include "../MeshProcessing/VertexQuantizer.h"
+#include "TextureCache.h"
+#include "GeometryArena.h"
 
 namespace SharedLib
 {
@@ -10,9 +17,9 @@ namespace SharedLib
     {
     public:
         Entity() {}
-        ~Entity() {}
+        virtual ~Entity() {}
 
-        virtual void InitGpuRsrc(VkDevice device, VmaAllocator* pAllocator, VkCommandBuffer cmdBuffer, VkQueue queue) {}
+        virtual void InitGpuRsrc(VkDevice device, VmaAllocator* pAllocator, UploadManager* pUploadManager) {}
         virtual void Finialize(VkDevice device, VmaAllocator* pAllocator) = 0;
 
         float m_position[3];
@@ -22,6 +29,17 @@ namespace SharedLib
         // virtual void Render() = 0;
     };
 
+    // The material textures of a MeshPrimitive, in the order of the MeshPrimitive::GetTex(...). The glTF occlusion and
+    // metallic roughness textures share the MESH_TEX_ORM: occlusion in r, roughness in g and metalness in b.
+    enum MeshTexSlot
+    {
+        MESH_TEX_BASE_COLOR,
+        MESH_TEX_ORM,
+        MESH_TEX_NORMAL,
+        MESH_TEX_EMISSIVE,
+        MESH_TEX_CNT
+    };
+
     class MeshPrimitive
     {
     public:
@@ -29,42 +47,142 @@ namespace SharedLib
         ~MeshPrimitive() {}
         
         // float m_position[3];
-        std::vector<float>    m_vertData;
-        
+        // The interleaved vertex buffer in the m_vertLayout, packed from the streams below by the InitGpuRsrc(...).
+        std::vector<uint8_t>  m_vertData;
+        VertLayout            m_vertLayout = VERT_LAYOUT_FLOAT;
+
         std::vector<float>    m_posData;
         std::vector<float>    m_normalData;
         std::vector<float>    m_tangentData;
         std::vector<float>    m_texCoordData;
 
+        // Only the vector matching the m_idxType holds the indices. The SetIndices(...) picks the narrowest type that
+        // can address all the vertices, so most primitives end up with 16 bits indices.
+        std::vector<uint8_t>  m_idxDataUint8;
         std::vector<uint16_t> m_idxDataUint16;
+        std::vector<uint32_t> m_idxDataUint32;
+        VkIndexType           m_idxType = VK_INDEX_TYPE_UINT16;
+
+        // The uncompressed formats. A block compressed texture carries its own ImgInfo::format. The decoded texels are
+        // shared by all the slots with the same texel source id, so a texture that many primitives use is held once.
+        std::shared_ptr<const ImgInfo> m_baseColorTex; // R8G8B8A8_SRGB
+        std::shared_ptr<const ImgInfo> m_ormTex;       // R8G8B8A8_UNORM, occlusion, roughness, metallic, unused alpha.
+        std::shared_ptr<const ImgInfo> m_normalTex;    // R8G8_UNORM tangent space xy. The shaders rebuild the z.
+        std::shared_ptr<const ImgInfo> m_emissiveTex;  // Currently don't support. Null.
+
+        // The texel sources of the textures, see the TextureCache. The slots of all the primitives with the same id and
+        // format share one GPU image. The loader gives the 1x1 defaults and every distinct baked image their own ids.
+        uint64_t m_texSrcIds[MESH_TEX_CNT] = {};
+
+        // How each slot samples its texture. The slots that share an image may sample it differently.
+        TexSamplerDesc m_texSamplers[MESH_TEX_CNT] = {};
 
-        ImgInfo m_baseColorTex;         // TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE (5121), 4 components.
-        ImgInfo m_metallicRoughnessTex; // R32G32_SFLOAT
-        ImgInfo m_normalTex;            // R32G32B32_SFLOAT
-        ImgInfo m_occlusionTex;         // R32_SFLOAT
-        ImgInfo m_emissiveTex;          // Currently don't support.
+        // Only built when the loader is asked to. See the MeshletBuilder.h. The InitGpuRsrc(...) uploads the non-empty
+        // meshlet data into the geometry arena for the task and mesh shaders, which read it as storage buffers.
+        MeshletData m_meshletData;
 
-        void InitGpuRsrc(VkDevice device, VmaAllocator* pAllocator, VkCommandBuffer cmdBuffer, VkQueue queue);
+        // Only built when the loader is asked to. The index buffer then holds all the levels back to back and the
+        // m_lods are their ranges, see the MeshLod.h. Empty means that the whole index buffer is the only level.
+        std::vector<MeshLod> m_lods;
+
+        // xyz center and w radius. The m_boundingSphere is in the space of the m_posData, the mesh's own space for an
+        // instanced mesh, and the LOD selection transforms it per instance. The m_worldBoundingSphere encloses all the
+        // entity's instances in the world space and is only for the culling.
+        float m_boundingSphere[4]      = {};
+        float m_worldBoundingSphere[4] = {};
+
+        // The textures come from the pTexCache and the vertices, the indices and the meshlets go to the pGeoArena,
+        // which must both outlive the primitive's GPU resources. Their data is enqueued into the pUploadManager, which
+        // the caller flushes.
+        void InitGpuRsrc(VkDevice       device,
+                         VmaAllocator*  pAllocator,
+                         UploadManager* pUploadManager,
+                         TextureCache*  pTexCache,
+                         GeometryArena* pGeoArena);
         void FinializeGpuRsrc(VkDevice device, VmaAllocator* pAllocator);
 
-        VkBuffer* GetVertBuffer() { return &m_vertBuffer.buffer; }
-        VkBuffer  GetIndexBuffer() { return m_indexBuffer.buffer; }
+        // 8 bits indices need the VK_EXT_index_type_uint8, so they are only used when the caller allows them.
+        void        SetIndices(const std::vector<uint32_t>& indices, bool allowUint8 = false);
+        uint32_t    GetIdxCnt() const;
+        uint32_t    GetIdx(uint32_t i) const;
+        void        GetIndicesUint32(std::vector<uint32_t>& oIndices) const;
+        const void* GetIdxData() const;
+        uint32_t    GetIdxByteCnt() const;
+        VkIndexType GetIndexType() const { return m_idxType; }
+
+        // Null for a slot without a texture, i.e. the emissive.
+        const ImgInfo*  GetTex(MeshTexSlot slot) const;
+        static VkFormat GetTexFormat(MeshTexSlot slot);
+
+        // Sets a texture before the InitGpuRsrc(...). The slots that get the same srcId should share the same tex.
+        void SetCpuTex(MeshTexSlot slot, std::shared_ptr<const ImgInfo> tex, uint64_t srcId);
+
+        // Replaces a texture after the InitGpuRsrc(...), e.g. a placeholder with the asynchronously decoded image, and
+        // switches to the srcId's cached GPU image. The frames up to the retireFrame may still use the old image, so
+        // the TextureCache only retires it, see the TextureCache::ReleaseAfterFrame(...). The descriptor infos
+        // returned by the Get*ImgDescInfo() are updated in place, so the next pushed descriptors pick the new image up.
+        void SetTex(MeshTexSlot                    slot,
+                    std::shared_ptr<const ImgInfo> tex,
+                    uint64_t                       srcId,
+                    uint64_t                       retireFrame,
+                    VkDevice                       device,
+                    VmaAllocator*                  pAllocator,
+                    UploadManager*                 pUploadManager);
+
+        // The index range to draw for a camera at the cameraPos, with at most pixelError pixels of geometric error. The
+        // pInstanceMat is the instance's matrix from the MeshEntity::GetInstanceMat(...), null for the identity. Its
+        // largest axis scale scales the levels' errors.
+        MeshLod SelectLod(const float  cameraPos[3],
+                          float        fovY,
+                          float        viewportHeight,
+                          float        pixelError,
+                          const float* pInstanceMat = nullptr) const;
+
+        // The position dequantization of the compact layouts. The identity for the VERT_LAYOUT_FLOAT.
+        const VertDequant& GetVertDequant() const { return m_vertDequant; }
 
-        VkDescriptorImageInfo* GetBaseColorImgDescInfo() { return &m_baseColorGpuImg.imageDescInfo; }
-        VkDescriptorImageInfo* GetMetallicRoughnessImgDescInfo() { return &m_metallicRoughnessGpuImg.imageDescInfo; }
-        VkDescriptorImageInfo* GetNormalImgDescInfo() { return &m_normalGpuImg.imageDescInfo; }
-        VkDescriptorImageInfo* GetOcclusionImgDescInfo() { return &m_occlusionGpuImg.imageDescInfo; }
-        VkDescriptorImageInfo* GetEmissiveImgDescInfo() { return &m_emissiveGpuImg.imageDescInfo; }
+        // The arena blocks that hold the vertices and the indices. The primitives in the same block share the bindings,
+        // so the draws use the GetVertexOffset() and the GetFirstIdx() instead of the binding offsets.
+        VkBuffer GetVertBuffer() const { return m_pGeoArena->GetBuffer(m_vertRange.blockIdx); }
+        VkBuffer GetIndexBuffer() const { return m_pGeoArena->GetBuffer(m_idxRange.blockIdx); }
+        int32_t  GetVertexOffset() const { return m_vertRange.offset / GetVertStride(m_vertLayout); }
+        uint32_t GetFirstIdx() const;
+
+        VkDescriptorImageInfo* GetBaseColorImgDescInfo() { return &m_texDescInfos[MESH_TEX_BASE_COLOR]; }
+        VkDescriptorImageInfo* GetOrmImgDescInfo() { return &m_texDescInfos[MESH_TEX_ORM]; }
+        VkDescriptorImageInfo* GetNormalImgDescInfo() { return &m_texDescInfos[MESH_TEX_NORMAL]; }
+        VkDescriptorImageInfo* GetEmissiveImgDescInfo() { return &m_texDescInfos[MESH_TEX_EMISSIVE]; }
+
+        // The meshlet data's ranges in the arena blocks. An empty array's info has a null buffer.
+        VkDescriptorBufferInfo* GetMeshletsDescInfo() { return &m_meshletDescInfos[MESHLET_DATA_MESHLETS]; }
+        VkDescriptorBufferInfo* GetMeshletBoundsDescInfo() { return &m_meshletDescInfos[MESHLET_DATA_BOUNDS]; }
+        VkDescriptorBufferInfo* GetMeshletVertIndicesDescInfo() { return &m_meshletDescInfos[MESHLET_DATA_VERTS]; }
+        VkDescriptorBufferInfo* GetMeshletPackedTrisDescInfo() { return &m_meshletDescInfos[MESHLET_DATA_TRIS]; }
 
     protected:
-        GpuBuffer m_vertBuffer;
-        GpuBuffer m_indexBuffer;
-
-        GpuImg m_baseColorGpuImg;
-        GpuImg m_metallicRoughnessGpuImg;
-        GpuImg m_normalGpuImg;
-        GpuImg m_occlusionGpuImg;
-        GpuImg m_emissiveGpuImg;
+        GeometryArena* m_pGeoArena = nullptr;
+        GeometryRange  m_vertRange{};
+        GeometryRange  m_idxRange{};
+
+        VertDequant m_vertDequant{};
+
+        enum MeshletDataArray
+        {
+            MESHLET_DATA_MESHLETS,
+            MESHLET_DATA_BOUNDS,
+            MESHLET_DATA_VERTS, // The meshlets' vertex indices.
+            MESHLET_DATA_TRIS,  // The meshlets' packed triangles.
+            MESHLET_DATA_CNT
+        };
+
+        GeometryRange          m_meshletRanges[MESHLET_DATA_CNT] = {};
+        VkDescriptorBufferInfo m_meshletDescInfos[MESHLET_DATA_CNT] = {};
+
+        // The cached textures' descriptor infos are copied, so that they stay in place when the SetTex(...) switches
+        // to another cached texture.
+        TextureCache*         m_pTexCache = nullptr;
+        CachedTex*            m_pTexs[MESH_TEX_CNT] = {};
+        VkDescriptorImageInfo m_texDescInfos[MESH_TEX_CNT] = {};
     };
 
     class MeshEntity : public Entity
@@ -75,14 +193,42 @@ namespace SharedLib
 
         void Finialize(VkDevice device, VmaAllocator* pAllocator) override { FinializeGpuRsrc(device, pAllocator); }
 
-        virtual void InitGpuRsrc(VkDevice device, VmaAllocator* pAllocator, VkCommandBuffer cmdBuffer, VkQueue queue) override;
+        virtual void InitGpuRsrc(VkDevice device, VmaAllocator* pAllocator, UploadManager* pUploadManager) override;
         virtual void FinializeGpuRsrc(VkDevice device, VmaAllocator* pAllocator);
 
         std::vector<MeshPrimitive> m_meshPrimitives;
+
+        // Where the primitives' textures are shared and their geometry is suballocated. The loader sets them before the
+        // InitGpuRsrc(...).
+        TextureCache*  m_pTexCache = nullptr;
+        GeometryArena* m_pGeoArena = nullptr;
+
+        // The instances' model matrices as the top 3 rows of the row-major affine matrices, InstanceMatFloatCnt floats
+        // per instance. All the primitives are drawn once per instance. Empty means one identity instance, which is
+        // what the entities with their node transformation baked into the geometry have.
+        std::vector<float> m_instanceMats;
+
+        // The instance matrices are in the geometry arena, so the per instance vertex buffer is bound at its offset.
+        uint32_t     GetInstanceCnt() const;
+        VkBuffer     GetInstanceBuffer() const { return m_pGeoArena->GetBuffer(m_instanceRange.blockIdx); }
+        VkDeviceSize GetInstanceBufferOffset() const { return m_instanceRange.offset; }
+
+        // InstanceMatFloatCnt floats of the instance's matrix. Null for the identity instance without m_instanceMats.
+        const float* GetInstanceMat(uint32_t instanceIdx) const;
+
+        static constexpr uint32_t InstanceMatFloatCnt = 12;
+
     protected:
-        
+        GeometryRange m_instanceRange{};
     };
 
+    // The per instance vertex input of the MeshEntity::GetInstanceBuffer(): the 3 rows of the instance matrix as float4
+    // at the firstLocation and the next 2 locations. The oAttrDescs must have room for 3. Returns the attribute count.
+    uint32_t GetInstanceInputDescs(uint32_t                           binding,
+                                   uint32_t                           firstLocation,
+                                   VkVertexInputBindingDescription&   oBindingDesc,
+                                   VkVertexInputAttributeDescription* oAttrDescs);
+
     class SkeletalMeshEntity : public MeshEntity
     {
     public:
@@ -118,7 +264,8 @@ namespace SharedLib
         bool AddMshEntity(const std::string& name, MeshEntity* entity);
         bool AddLightEntity(const std::string& name, LightEntity* entity);
 
-        std::unordered_map<std::string, MeshEntity*>  m_meshEntities;
+        // Ordered by name so that iterating the mesh entities doesn't depend on the hash or the loading threads.
+        std::map<std::string, MeshEntity*>            m_meshEntities;
         std::unordered_map<std::string, LightEntity*> m_lightEntities;
     };
 }
\ No newline at end of file
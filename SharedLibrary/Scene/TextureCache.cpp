@@ -0,0 +1,344 @@
+#include "TextureCache.h"
+#include "AppUtils.h"
+#include "VulkanDbgUtils.h"
+#include "vk_mem_alloc.h"
+#include "../TextureProcessing/BlockCompressor.h"
+#include <algorithm>
+
+namespace SharedLib
+{
+    // ================================================================================================================
+    // A sampler without mips clamps the lod to the level 0, as the Vulkan spec suggests for the OpenGL filters without
+    // mipmapping.
+    static VkSampler CreateTexSampler(
+        const TexSamplerDesc& desc,
+        VkDevice              device)
+    {
+        VkSamplerCreateInfo samplerInfo{};
+        {
+            samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+            samplerInfo.magFilter = desc.magFilter;
+            samplerInfo.minFilter = desc.minFilter;
+            samplerInfo.mipmapMode = desc.useMips ? desc.mipmapMode : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+            samplerInfo.addressModeU = desc.addressModeU;
+            samplerInfo.addressModeV = desc.addressModeV;
+            samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+            samplerInfo.minLod = desc.useMips ? -1000.f : 0.f;
+            samplerInfo.maxLod = desc.useMips ? 1000.f : 0.25f;
+            samplerInfo.maxAnisotropy = 1.0f;
+        }
+
+        VkSampler sampler = VK_NULL_HANDLE;
+        VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &sampler));
+        return sampler;
+    }
+
+    // ================================================================================================================
+    // The BC compression of a block compressed format. Returns false for the other formats.
+    static bool GetBcCompression(
+        VkFormat        format,
+        TexCompression& oCompression,
+        bool&           oIsSrgb)
+    {
+        oIsSrgb = (format == VK_FORMAT_BC1_RGB_SRGB_BLOCK) ||
+                  (format == VK_FORMAT_BC3_SRGB_BLOCK) ||
+                  (format == VK_FORMAT_BC7_SRGB_BLOCK);
+
+        switch (format)
+        {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            oCompression = TEX_COMPRESSION_BC1;
+            return true;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            oCompression = TEX_COMPRESSION_BC3;
+            return true;
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            oCompression = TEX_COMPRESSION_BC4;
+            return true;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            oCompression = TEX_COMPRESSION_BC5;
+            return true;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            oCompression = TEX_COMPRESSION_BC7;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // ================================================================================================================
+    // Decodes every mip level of a block compressed tex into the RGBA8 oTex, which has the same channels as the sampler
+    // would see. The tex isn't changed, since a deferred cooked asset write may still read it.
+    static void DecompressBcTex(
+        const ImgInfo& tex,
+        TexCompression compression,
+        bool           isSrgb,
+        ImgInfo&       oTex)
+    {
+        uint32_t levelCnt = tex.mipByteOffsets.empty() ? 1 : tex.mipByteOffsets.size();
+
+        oTex = ImgInfo{};
+        oTex.pixWidth = tex.pixWidth;
+        oTex.pixHeight = tex.pixHeight;
+        oTex.componentCnt = 4;
+        oTex.componentType = tex.componentType;
+        oTex.format = isSrgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+
+        for (uint32_t level = 0; level < levelCnt; level++)
+        {
+            uint32_t width = std::max(tex.pixWidth >> level, 1u);
+            uint32_t height = std::max(tex.pixHeight >> level, 1u);
+
+            uint32_t levelByteOffset = oTex.dataVec.size();
+            if (levelCnt > 1)
+            {
+                oTex.mipByteOffsets.push_back(levelByteOffset);
+            }
+
+            oTex.dataVec.resize(levelByteOffset + 4 * width * height);
+            DecompressBcImage(tex.dataVec.data() + ((levelCnt > 1) ? tex.mipByteOffsets[level] : 0),
+                              width,
+                              height,
+                              compression,
+                              oTex.dataVec.data() + levelByteOffset);
+        }
+    }
+
+    // ================================================================================================================
+    // A sampled, optimally tiled 2D image of the tex's size and format with all its mip levels, filled with the tex's
+    // pixels and left in the shader read only layout. The slots that use it add their own samplers to its descriptor
+    // info.
+    static void CreateTexGpuImg(
+        VkDevice       device,
+        VmaAllocator*  pAllocator,
+        UploadManager* pUploadManager,
+        const ImgInfo& tex,
+        VkFormat       format,
+        GpuImg&        oGpuImg)
+    {
+        // Most material textures are small, so they share the VMA's memory blocks instead of a dedicated allocation
+        // each. The VMA still gives the large ones their own allocations.
+        VmaAllocationCreateInfo gpuImgAllocInfo{};
+        {
+            gpuImgAllocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        }
+
+        VkExtent3D extent{};
+        {
+            extent.width = tex.pixWidth;
+            extent.height = tex.pixHeight;
+            extent.depth = 1;
+        }
+
+        uint32_t mipLevelCnt = tex.mipByteOffsets.empty() ? 1 : tex.mipByteOffsets.size();
+
+        VkImageCreateInfo imgInfo{};
+        {
+            imgInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imgInfo.imageType = VK_IMAGE_TYPE_2D;
+            imgInfo.format = format;
+            imgInfo.extent = extent;
+            imgInfo.mipLevels = mipLevelCnt;
+            imgInfo.arrayLayers = 1;
+            imgInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imgInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imgInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+            imgInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+
+        vmaCreateImage(*pAllocator,
+                       &imgInfo,
+                       &gpuImgAllocInfo,
+                       &oGpuImg.image,
+                       &oGpuImg.imageAllocation,
+                       nullptr);
+
+        VkImageViewCreateInfo info{};
+        {
+            info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            info.image = oGpuImg.image;
+            info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            info.format = format;
+            info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            info.subresourceRange.levelCount = mipLevelCnt;
+            info.subresourceRange.layerCount = 1;
+        }
+        VK_CHECK(vkCreateImageView(device, &info, nullptr, &oGpuImg.imageView));
+
+        oGpuImg.imageDescInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        oGpuImg.imageDescInfo.imageView = oGpuImg.imageView;
+
+        // Upload all the mip levels. The upload leaves the image in the shader read optimal layout, so no other
+        // transition is needed. A transition from the undefined layout here would discard the texels.
+        pUploadManager->Enqueue2dImgUpload(&tex, oGpuImg.image);
+    }
+
+    // ================================================================================================================
+    static void DestroyTexGpuImg(
+        VkDevice      device,
+        VmaAllocator* pAllocator,
+        GpuImg&       gpuImg)
+    {
+        if (gpuImg.image == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        vmaDestroyImage(*pAllocator, gpuImg.image, gpuImg.imageAllocation);
+        vkDestroyImageView(device, gpuImg.imageView, nullptr);
+        gpuImg = GpuImg{};
+    }
+
+    // ================================================================================================================
+    CachedTex* TextureCache::Acquire(
+        uint64_t       srcId,
+        const ImgInfo& tex,
+        VkFormat       defaultFormat,
+        VkDevice       device,
+        VmaAllocator*  pAllocator,
+        UploadManager* pUploadManager)
+    {
+        // The compressed textures carry their own formats.
+        VkFormat format = (tex.format != VK_FORMAT_UNDEFINED) ? tex.format : defaultFormat;
+
+        auto texItr = m_texs.find({ srcId, format });
+        if (texItr == m_texs.end())
+        {
+            CachedTex cachedTex{};
+            cachedTex.srcId = srcId;
+            cachedTex.format = format;
+            cachedTex.refCnt = 0;
+
+            // The cache's key keeps the tex's own format, so a decompressed texture is still shared by its slots.
+            TexCompression compression = TEX_COMPRESSION_NONE;
+            bool           isSrgb = false;
+            if ((IsOptimalTilingSupported(format) == false) && GetBcCompression(format, compression, isSrgb))
+            {
+                ImgInfo decompressedTex;
+                DecompressBcTex(tex, compression, isSrgb, decompressedTex);
+                CreateTexGpuImg(device,
+                                pAllocator,
+                                pUploadManager,
+                                decompressedTex,
+                                decompressedTex.format,
+                                cachedTex.gpuImg);
+            }
+            else
+            {
+                ASSERT(IsOptimalTilingSupported(format), "The device cannot sample the texture's format.");
+                CreateTexGpuImg(device, pAllocator, pUploadManager, tex, format, cachedTex.gpuImg);
+            }
+
+            texItr = m_texs.insert({ { srcId, format }, cachedTex }).first;
+        }
+
+        texItr->second.refCnt++;
+        return &texItr->second;
+    }
+
+    // ================================================================================================================
+    void TextureCache::Release(
+        CachedTex*    pTex,
+        VkDevice      device,
+        VmaAllocator* pAllocator)
+    {
+        if (pTex == nullptr)
+        {
+            return;
+        }
+
+        pTex->refCnt--;
+        if (pTex->refCnt == 0)
+        {
+            DestroyTexGpuImg(device, pAllocator, pTex->gpuImg);
+            m_texs.erase({ pTex->srcId, pTex->format });
+        }
+    }
+
+    // ================================================================================================================
+    void TextureCache::ReleaseAfterFrame(
+        CachedTex* pTex,
+        uint64_t   retireFrame)
+    {
+        if (pTex == nullptr)
+        {
+            return;
+        }
+
+        pTex->refCnt--;
+        if (pTex->refCnt == 0)
+        {
+            m_retiredImgs.push_back({ pTex->gpuImg, retireFrame });
+            m_texs.erase({ pTex->srcId, pTex->format });
+        }
+    }
+
+    // ================================================================================================================
+    void TextureCache::DestroyRetiredImgs(
+        uint64_t      completedFrameCnt,
+        VkDevice      device,
+        VmaAllocator* pAllocator)
+    {
+        uint32_t destroyedCnt = 0;
+        while ((destroyedCnt < m_retiredImgs.size()) &&
+               (m_retiredImgs[destroyedCnt].retireFrame <= completedFrameCnt))
+        {
+            DestroyTexGpuImg(device, pAllocator, m_retiredImgs[destroyedCnt].gpuImg);
+            destroyedCnt++;
+        }
+        m_retiredImgs.erase(m_retiredImgs.begin(), m_retiredImgs.begin() + destroyedCnt);
+    }
+
+    // ================================================================================================================
+    void TextureCache::Finalize(
+        VkDevice device)
+    {
+        ASSERT(m_texs.empty(), "All the cached textures should be released before the cache is finalized.");
+        ASSERT(m_retiredImgs.empty(), "All the retired images should be destroyed before the cache is finalized.");
+
+        for (auto& sampler : m_samplers)
+        {
+            vkDestroySampler(device, sampler.second, nullptr);
+        }
+        m_samplers.clear();
+    }
+
+    // ================================================================================================================
+    VkSampler TextureCache::GetSampler(
+        const TexSamplerDesc& desc,
+        VkDevice              device)
+    {
+        auto samplerItr = m_samplers.find(desc);
+        if (samplerItr == m_samplers.end())
+        {
+            samplerItr = m_samplers.insert({ desc, CreateTexSampler(desc, device) }).first;
+        }
+        return samplerItr->second;
+    }
+
+    // ================================================================================================================
+    bool TextureCache::IsOptimalTilingSupported(
+        VkFormat format)
+    {
+        if (m_physicalDevice == VK_NULL_HANDLE)
+        {
+            return true;
+        }
+
+        auto featuresItr = m_optimalTilingFeatures.find(format);
+        if (featuresItr == m_optimalTilingFeatures.end())
+        {
+            VkFormatProperties formatProps{};
+            vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &formatProps);
+            featuresItr = m_optimalTilingFeatures.insert({ format, formatProps.optimalTilingFeatures }).first;
+        }
+
+        const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                                      VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT |
+                                                      VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+        return (featuresItr->second & requiredFeatures) == requiredFeatures;
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "../Application/Application.h"
+#include "../Utils/UploadManager.h"
+
+namespace SharedLib
+{
+    // A GPU texture shared by all the texture slots with the same texel source and format.
+    struct CachedTex
+    {
+        uint64_t srcId;
+        VkFormat format;
+        GpuImg   gpuImg;
+        uint32_t refCnt;
+    };
+
+    // The sampler state of a texture slot, e.g. from a glTF sampler. The default is the trilinear repeat sampler that
+    // glTF assumes for the textures without one. All the members are 32 bits, so it can be stored as raw bytes.
+    struct TexSamplerDesc
+    {
+        VkFilter             magFilter    = VK_FILTER_LINEAR;
+        VkFilter             minFilter    = VK_FILTER_LINEAR;
+        VkSamplerMipmapMode  mipmapMode   = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        VkSamplerAddressMode addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        VkSamplerAddressMode addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        uint32_t             useMips      = 1; // 0 only samples the level 0, like the glTF min filters without mips.
+
+        bool operator<(const TexSamplerDesc& other) const
+        {
+            return std::tie(magFilter, minFilter, mipmapMode, addressModeU, addressModeV, useMips) <
+                   std::tie(other.magFilter, other.minFilter, other.mipmapMode, other.addressModeU, other.addressModeV,
+                            other.useMips);
+        }
+    };
+
+    // Deduplicates the material textures on the GPU. The slots that name the same texel source id and format share one
+    // image, which the first Acquire(...) uploads and the last Release(...) destroys. The sampler isn't part of the
+    // image's key: the slots that sample the same image differently share it and each picks its sampler with the
+    // GetSampler(...). Only the render thread may use it.
+    //
+    // The images are optimally tiled and get all the mip levels of their ImgInfo through buffer to image copies. A
+    // format that the device cannot sample with the optimal tiling, e.g. a BC format without the textureCompressionBC,
+    // is decompressed back to RGBA8 with all its mip levels.
+    class TextureCache
+    {
+    public:
+        TextureCache() {}
+        ~TextureCache() {}
+
+        // The formats' support is queried on the physicalDevice. Before it, all the formats are assumed to be supported.
+        void Init(VkPhysicalDevice physicalDevice) { m_physicalDevice = physicalDevice; }
+
+        // Equal srcIds must mean equal texels. The tex's format is used if it is defined, the defaultFormat otherwise.
+        // A miss creates the image and enqueues its texels into the pUploadManager, whose batch leaves it in the
+        // shader read only layout. The caller flushes the uploads. The image's descriptor info has no sampler.
+        CachedTex* Acquire(uint64_t       srcId,
+                           const ImgInfo& tex,
+                           VkFormat       defaultFormat,
+                           VkDevice       device,
+                           VmaAllocator*  pAllocator,
+                           UploadManager* pUploadManager);
+
+        // The GPU must not use the image anymore if this is its last reference. A null pTex is ignored.
+        void Release(CachedTex* pTex, VkDevice device, VmaAllocator* pAllocator);
+
+        // Like the Release(...), but the frames up to the retireFrame may still use the image. Its last reference
+        // moves it into the retired images, which the DestroyRetiredImgs(...) frees after those frames completed. A
+        // later Acquire(...) of the same texture creates a new image.
+        void ReleaseAfterFrame(CachedTex* pTex, uint64_t retireFrame);
+
+        // Destroys the retired images whose retire frames are within the completedFrameCnt. UINT64_MAX destroys all of
+        // them, e.g. after the device is idle.
+        void DestroyRetiredImgs(uint64_t completedFrameCnt, VkDevice device, VmaAllocator* pAllocator);
+
+        // One sampler per distinct desc, created by its first request and kept until the Finalize(...).
+        VkSampler GetSampler(const TexSamplerDesc& desc, VkDevice device);
+
+        // Destroys the samplers. Every texture must be released and every retired image destroyed before.
+        void Finalize(VkDevice device);
+
+        uint32_t GetTexCnt() const { return m_texs.size(); }
+
+    private:
+        // Whether the format can be sampled with the linear filter and filled by copies in the optimal tiling.
+        bool IsOptimalTilingSupported(VkFormat format);
+
+        VkPhysicalDevice                    m_physicalDevice = VK_NULL_HANDLE;
+        std::map<TexSamplerDesc, VkSampler> m_samplers;
+
+        // The optimal tiling features of the queried formats, so that every format is only queried once.
+        std::map<VkFormat, VkFormatFeatureFlags> m_optimalTilingFeatures;
+
+        // The map's nodes don't move, so the returned CachedTex pointers stay valid until their release.
+        std::map<std::pair<uint64_t, VkFormat>, CachedTex> m_texs;
+
+        struct RetiredImg
+        {
+            GpuImg   gpuImg;
+            uint64_t retireFrame;
+        };
+
+        // In the release order, so their retire frames never decrease.
+        std::vector<RetiredImg> m_retiredImgs;
+    };
+}
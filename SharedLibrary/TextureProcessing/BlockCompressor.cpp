@@ -0,0 +1,1108 @@
+#include "BlockCompressor.h"
+#include "../Utils/ThreadUtils.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace SharedLib
+{
+    // The BC7 interpolation weights of the 4 bits indices, out of 64.
+    static const uint32_t Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // The BC1 interpolation position of each 2 bits index between the endpoint 0 and the endpoint 1.
+    static const float Bc1IdxPositions[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+
+    // ================================================================================================================
+    // Little endian bit packing for the BC7 blocks.
+    class BcBitWriter
+    {
+    public:
+        explicit BcBitWriter(uint8_t* pBytes)
+            : m_pBytes(pBytes), m_bitOffset(0)
+        {
+            memset(m_pBytes, 0, 16);
+        }
+
+        void Write(uint32_t val, uint32_t bitCnt)
+        {
+            for (uint32_t i = 0; i < bitCnt; i++, m_bitOffset++)
+            {
+                m_pBytes[m_bitOffset / 8] |= ((val >> i) & 1) << (m_bitOffset % 8);
+            }
+        }
+
+    private:
+        uint8_t* m_pBytes;
+        uint32_t m_bitOffset;
+    };
+
+    // ================================================================================================================
+    class BcBitReader
+    {
+    public:
+        explicit BcBitReader(const uint8_t* pBytes)
+            : m_pBytes(pBytes), m_bitOffset(0)
+        {}
+
+        uint32_t Read(uint32_t bitCnt)
+        {
+            uint32_t val = 0;
+            for (uint32_t i = 0; i < bitCnt; i++, m_bitOffset++)
+            {
+                val |= ((m_pBytes[m_bitOffset / 8] >> (m_bitOffset % 8)) & 1) << i;
+            }
+            return val;
+        }
+
+    private:
+        const uint8_t* m_pBytes;
+        uint32_t       m_bitOffset;
+    };
+
+    // ================================================================================================================
+    // Copies a 4x4 block out of the image. The texels past the right and bottom edges repeat the edge ones.
+    static void FetchBlock(
+        const uint8_t* pRgba8,
+        uint32_t       width,
+        uint32_t       height,
+        uint32_t       blockX,
+        uint32_t       blockY,
+        uint8_t        oTexels[16][4])
+    {
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            uint32_t srcY = std::min(blockY * 4 + y, height - 1);
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                uint32_t srcX = std::min(blockX * 4 + x, width - 1);
+                memcpy(oTexels[y * 4 + x], &pRgba8[4 * (srcY * width + srcX)], 4);
+            }
+        }
+    }
+
+    // ================================================================================================================
+    static void StoreBlock(
+        const uint8_t texels[16][4],
+        uint32_t      width,
+        uint32_t      height,
+        uint32_t      blockX,
+        uint32_t      blockY,
+        uint8_t*      pRgba8)
+    {
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                uint32_t dstX = blockX * 4 + x;
+                uint32_t dstY = blockY * 4 + y;
+                if ((dstX < width) && (dstY < height))
+                {
+                    memcpy(&pRgba8[4 * (dstY * width + dstX)], texels[y * 4 + x], 4);
+                }
+            }
+        }
+    }
+
+    // ================================================================================================================
+    // The mean and the principal axis of the texels' first channelCnt channels. The axis comes from a few power
+    // iterations on the covariance, which is plenty for 16 points.
+    static void ComputePrincipalAxis(
+        const uint8_t texels[16][4],
+        uint32_t      channelCnt,
+        float         oMean[4],
+        float         oAxis[4])
+    {
+        float minVal[4] = { 255.f, 255.f, 255.f, 255.f };
+        float maxVal[4] = { 0.f, 0.f, 0.f, 0.f };
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            oMean[c] = 0.f;
+            oAxis[c] = 0.f;
+        }
+
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t c = 0; c < channelCnt; c++)
+            {
+                oMean[c] += texels[i][c] / 16.f;
+                minVal[c] = std::min(minVal[c], (float)texels[i][c]);
+                maxVal[c] = std::max(maxVal[c], (float)texels[i][c]);
+            }
+        }
+
+        float cov[4][4] = {};
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t r = 0; r < channelCnt; r++)
+            {
+                for (uint32_t c = 0; c < channelCnt; c++)
+                {
+                    cov[r][c] += (texels[i][r] - oMean[r]) * (texels[i][c] - oMean[c]);
+                }
+            }
+        }
+
+        // The bounding box's diagonal is a good starting guess.
+        float axis[4] = { 0.f, 0.f, 0.f, 0.f };
+        for (uint32_t c = 0; c < channelCnt; c++)
+        {
+            axis[c] = maxVal[c] - minVal[c];
+        }
+
+        for (uint32_t iter = 0; iter < 8; iter++)
+        {
+            float next[4] = { 0.f, 0.f, 0.f, 0.f };
+            float lenSq = 0.f;
+            for (uint32_t r = 0; r < channelCnt; r++)
+            {
+                for (uint32_t c = 0; c < channelCnt; c++)
+                {
+                    next[r] += cov[r][c] * axis[c];
+                }
+                lenSq += next[r] * next[r];
+            }
+
+            if (lenSq < 1e-12f)
+            {
+                break;
+            }
+
+            float invLen = 1.f / std::sqrt(lenSq);
+            for (uint32_t c = 0; c < channelCnt; c++)
+            {
+                axis[c] = next[c] * invLen;
+            }
+        }
+
+        float lenSq = 0.f;
+        for (uint32_t c = 0; c < channelCnt; c++)
+        {
+            lenSq += axis[c] * axis[c];
+        }
+        for (uint32_t c = 0; c < channelCnt; c++)
+        {
+            oAxis[c] = (lenSq > 1e-12f) ? axis[c] / std::sqrt(lenSq) : 1.f / std::sqrt((float)channelCnt);
+        }
+    }
+
+    // ================================================================================================================
+    // Fits the endpoints that minimize the squared error, given every texel's interpolation position between them.
+    // Returns false when the positions can't determine the endpoints, e.g. when they are all equal.
+    static bool FitEndpointsLeastSquares(
+        const uint8_t texels[16][4],
+        const float   positions[16],
+        uint32_t      channelCnt,
+        float         oEndpoint0[4],
+        float         oEndpoint1[4])
+    {
+        float aa = 0.f;
+        float ab = 0.f;
+        float bb = 0.f;
+        float ax[4] = { 0.f, 0.f, 0.f, 0.f };
+        float bx[4] = { 0.f, 0.f, 0.f, 0.f };
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            float b = positions[i];
+            float a = 1.f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (uint32_t c = 0; c < channelCnt; c++)
+            {
+                ax[c] += a * texels[i][c];
+                bx[c] += b * texels[i][c];
+            }
+        }
+
+        float det = aa * bb - ab * ab;
+        if (std::abs(det) < 1e-6f)
+        {
+            return false;
+        }
+
+        for (uint32_t c = 0; c < channelCnt; c++)
+        {
+            oEndpoint0[c] = std::min(std::max((bb * ax[c] - ab * bx[c]) / det, 0.f), 255.f);
+            oEndpoint1[c] = std::min(std::max((aa * bx[c] - ab * ax[c]) / det, 0.f), 255.f);
+        }
+        return true;
+    }
+
+    // ================================================================================================================
+    static uint32_t ColorDistSq(
+        const uint8_t* pA,
+        const uint8_t* pB,
+        uint32_t       channelCnt)
+    {
+        uint32_t distSq = 0;
+        for (uint32_t c = 0; c < channelCnt; c++)
+        {
+            int32_t diff = (int32_t)pA[c] - (int32_t)pB[c];
+            distSq += diff * diff;
+        }
+        return distSq;
+    }
+
+    // ================================================================================================================
+    static uint16_t PackRgb565(
+        const float rgb[3])
+    {
+        uint32_t r = (uint32_t)(std::min(std::max(rgb[0], 0.f), 255.f) * 31.f / 255.f + 0.5f);
+        uint32_t g = (uint32_t)(std::min(std::max(rgb[1], 0.f), 255.f) * 63.f / 255.f + 0.5f);
+        uint32_t b = (uint32_t)(std::min(std::max(rgb[2], 0.f), 255.f) * 31.f / 255.f + 0.5f);
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    // ================================================================================================================
+    static void UnpackRgb565(
+        uint16_t color,
+        uint8_t  oRgb[4])
+    {
+        uint32_t r = (color >> 11) & 31;
+        uint32_t g = (color >> 5) & 63;
+        uint32_t b = color & 31;
+        oRgb[0] = (uint8_t)((r << 3) | (r >> 2));
+        oRgb[1] = (uint8_t)((g << 2) | (g >> 4));
+        oRgb[2] = (uint8_t)((b << 3) | (b >> 2));
+        oRgb[3] = 255;
+    }
+
+    // ================================================================================================================
+    // The 4 palette colors of a BC1 color block. The BC1 blocks with color0 <= color1 are in the 3 colors mode, whose
+    // last entry is the transparent black. The BC3 color blocks always interpolate 4 colors.
+    static void BuildBc1Palette(
+        uint16_t color0,
+        uint16_t color1,
+        bool     isFourColors,
+        uint8_t  oPalette[4][4])
+    {
+        UnpackRgb565(color0, oPalette[0]);
+        UnpackRgb565(color1, oPalette[1]);
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            if (isFourColors)
+            {
+                oPalette[2][c] = (uint8_t)((2 * oPalette[0][c] + oPalette[1][c]) / 3);
+                oPalette[3][c] = (uint8_t)((oPalette[0][c] + 2 * oPalette[1][c]) / 3);
+            }
+            else
+            {
+                oPalette[2][c] = (uint8_t)((oPalette[0][c] + oPalette[1][c]) / 2);
+                oPalette[3][c] = 0;
+            }
+        }
+        oPalette[2][3] = 255;
+        oPalette[3][3] = isFourColors ? 255 : 0;
+    }
+
+    // ================================================================================================================
+    // For every 8 bits value, the pair of 5 or 6 bits endpoints whose 1/3 interpolation reproduces it most closely. A
+    // flat block uses them with all the indices at 2, which is much closer than rounding the color to 565.
+    struct Bc1SingleColorTables
+    {
+        Bc1SingleColorTables()
+        {
+            BuildTable(5, table5);
+            BuildTable(6, table6);
+        }
+
+        static void BuildTable(uint32_t bitCnt, uint8_t oTable[256][2])
+        {
+            uint32_t maxVal = (1u << bitCnt) - 1;
+            for (int32_t v = 0; v < 256; v++)
+            {
+                int32_t bestError = INT32_MAX;
+                for (uint32_t e0 = 0; e0 <= maxVal; e0++)
+                {
+                    for (uint32_t e1 = 0; e1 <= maxVal; e1++)
+                    {
+                        int32_t expanded0 = (int32_t)((e0 << (8 - bitCnt)) | (e0 >> (2 * bitCnt - 8)));
+                        int32_t expanded1 = (int32_t)((e1 << (8 - bitCnt)) | (e1 >> (2 * bitCnt - 8)));
+                        int32_t error = std::abs((2 * expanded0 + expanded1) / 3 - v);
+                        if (error < bestError)
+                        {
+                            bestError = error;
+                            oTable[v][0] = (uint8_t)e0;
+                            oTable[v][1] = (uint8_t)e1;
+                        }
+                    }
+                }
+            }
+        }
+
+        uint8_t table5[256][2];
+        uint8_t table6[256][2];
+    };
+
+    // ================================================================================================================
+    // Picks each texel's nearest palette color. Returns the block's squared error.
+    static uint32_t SelectBc1Indices(
+        const uint8_t texels[16][4],
+        uint16_t      color0,
+        uint16_t      color1,
+        uint32_t      oIndices[16])
+    {
+        uint8_t palette[4][4];
+        BuildBc1Palette(color0, color1, color0 > color1, palette);
+
+        uint32_t blockError = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            uint32_t bestError = UINT32_MAX;
+            for (uint32_t p = 0; p < 4; p++)
+            {
+                uint32_t error = ColorDistSq(texels[i], palette[p], 3);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    oIndices[i] = p;
+                }
+            }
+            blockError += bestError;
+        }
+        return blockError;
+    }
+
+    // ================================================================================================================
+    // Encodes the RGB of a block into an 8 bytes BC1 color block, always in the 4 colors mode, so the BC3 can use it
+    // too. The endpoints come from the principal axis, then get one least squares refinement.
+    static void EncodeBc1ColorBlock(
+        const uint8_t texels[16][4],
+        uint8_t*      pBlock)
+    {
+        bool isFlat = true;
+        for (uint32_t i = 1; (i < 16) && isFlat; i++)
+        {
+            isFlat = ColorDistSq(texels[0], texels[i], 3) == 0;
+        }
+
+        if (isFlat)
+        {
+            static const Bc1SingleColorTables tables;
+            const uint8_t* pR = tables.table5[texels[0][0]];
+            const uint8_t* pG = tables.table6[texels[0][1]];
+            const uint8_t* pB = tables.table5[texels[0][2]];
+            uint16_t color0 = (uint16_t)((pR[0] << 11) | (pG[0] << 5) | pB[0]);
+            uint16_t color1 = (uint16_t)((pR[1] << 11) | (pG[1] << 5) | pB[1]);
+
+            // The palette entry 2 is at 1/3 from the color0 in the 4 colors mode, and the entry 3 from the color1.
+            uint32_t indexBits = 0xAAAAAAAA;
+            if (color0 < color1)
+            {
+                std::swap(color0, color1);
+                indexBits = 0xFFFFFFFF;
+            }
+            else if (color0 == color1)
+            {
+                indexBits = 0;
+            }
+
+            memcpy(pBlock, &color0, 2);
+            memcpy(pBlock + 2, &color1, 2);
+            memcpy(pBlock + 4, &indexBits, 4);
+            return;
+        }
+
+        float mean[4];
+        float axis[4];
+        ComputePrincipalAxis(texels, 3, mean, axis);
+
+        float minT = FLT_MAX;
+        float maxT = -FLT_MAX;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            float t = 0.f;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                t += (texels[i][c] - mean[c]) * axis[c];
+            }
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+
+        // The extreme texels are rarely exactly reproducible, so the endpoints are pulled in by half a palette step.
+        float inset = (maxT - minT) / 16.f;
+        float endpoint0[4];
+        float endpoint1[4];
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            endpoint0[c] = mean[c] + axis[c] * (maxT - inset);
+            endpoint1[c] = mean[c] + axis[c] * (minT + inset);
+        }
+
+        uint16_t color0 = PackRgb565(endpoint0);
+        uint16_t color1 = PackRgb565(endpoint1);
+        uint32_t indices[16];
+        uint32_t bestError = SelectBc1Indices(texels, std::max(color0, color1), std::min(color0, color1), indices);
+        uint16_t bestColor0 = std::max(color0, color1);
+        uint16_t bestColor1 = std::min(color0, color1);
+
+        float positions[16];
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            positions[i] = Bc1IdxPositions[indices[i]];
+        }
+
+        if (FitEndpointsLeastSquares(texels, positions, 3, endpoint0, endpoint1))
+        {
+            color0 = PackRgb565(endpoint0);
+            color1 = PackRgb565(endpoint1);
+
+            uint32_t refinedIndices[16];
+            uint32_t refinedError = SelectBc1Indices(texels,
+                                                     std::max(color0, color1),
+                                                     std::min(color0, color1),
+                                                     refinedIndices);
+            if (refinedError < bestError)
+            {
+                bestError = refinedError;
+                bestColor0 = std::max(color0, color1);
+                bestColor1 = std::min(color0, color1);
+                memcpy(indices, refinedIndices, sizeof(indices));
+            }
+        }
+
+        // Equal endpoints fall into the 3 colors mode, where only the index 0 gives the endpoint's color.
+        if (bestColor0 == bestColor1)
+        {
+            std::fill(indices, indices + 16, 0);
+        }
+
+        uint32_t indexBits = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            indexBits |= indices[i] << (2 * i);
+        }
+
+        memcpy(pBlock, &bestColor0, 2);
+        memcpy(pBlock + 2, &bestColor1, 2);
+        memcpy(pBlock + 4, &indexBits, 4);
+    }
+
+    // ================================================================================================================
+    static void DecodeBc1ColorBlock(
+        const uint8_t* pBlock,
+        bool           isBc1,
+        uint8_t        oTexels[16][4])
+    {
+        uint16_t color0;
+        uint16_t color1;
+        uint32_t indexBits;
+        memcpy(&color0, pBlock, 2);
+        memcpy(&color1, pBlock + 2, 2);
+        memcpy(&indexBits, pBlock + 4, 4);
+
+        uint8_t palette[4][4];
+        BuildBc1Palette(color0, color1, (isBc1 == false) || (color0 > color1), palette);
+
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            memcpy(oTexels[i], palette[(indexBits >> (2 * i)) & 3], 4);
+        }
+    }
+
+    // ================================================================================================================
+    // The 8 values of a BC4 block. With value0 <= value1 it has 6 interpolated values plus 0 and 255.
+    static void BuildBc4Palette(
+        uint8_t value0,
+        uint8_t value1,
+        uint8_t oPalette[8])
+    {
+        oPalette[0] = value0;
+        oPalette[1] = value1;
+        if (value0 > value1)
+        {
+            for (uint32_t k = 1; k < 7; k++)
+            {
+                oPalette[k + 1] = (uint8_t)(((7 - k) * value0 + k * value1 + 3) / 7);
+            }
+        }
+        else
+        {
+            for (uint32_t k = 1; k < 5; k++)
+            {
+                oPalette[k + 1] = (uint8_t)(((5 - k) * value0 + k * value1 + 2) / 5);
+            }
+            oPalette[6] = 0;
+            oPalette[7] = 255;
+        }
+    }
+
+    // ================================================================================================================
+    // Encodes one channel of a block into an 8 bytes BC4 block with the min and max as the endpoints.
+    static void EncodeBc4Block(
+        const uint8_t texels[16][4],
+        uint32_t      channel,
+        uint8_t*      pBlock)
+    {
+        uint8_t minVal = 255;
+        uint8_t maxVal = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            minVal = std::min(minVal, texels[i][channel]);
+            maxVal = std::max(maxVal, texels[i][channel]);
+        }
+
+        uint8_t palette[8];
+        BuildBc4Palette(maxVal, minVal, palette);
+
+        uint64_t indexBits = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            uint32_t bestIdx = 0;
+            int32_t  bestError = INT32_MAX;
+            for (uint32_t p = 0; p < 8; p++)
+            {
+                int32_t error = std::abs((int32_t)texels[i][channel] - (int32_t)palette[p]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIdx = p;
+                }
+            }
+            indexBits |= (uint64_t)bestIdx << (3 * i);
+        }
+
+        pBlock[0] = maxVal;
+        pBlock[1] = minVal;
+        for (uint32_t b = 0; b < 6; b++)
+        {
+            pBlock[2 + b] = (uint8_t)(indexBits >> (8 * b));
+        }
+    }
+
+    // ================================================================================================================
+    static void DecodeBc4Block(
+        const uint8_t* pBlock,
+        uint32_t       channel,
+        uint8_t        oTexels[16][4])
+    {
+        uint8_t palette[8];
+        BuildBc4Palette(pBlock[0], pBlock[1], palette);
+
+        uint64_t indexBits = 0;
+        for (uint32_t b = 0; b < 6; b++)
+        {
+            indexBits |= (uint64_t)pBlock[2 + b] << (8 * b);
+        }
+
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            oTexels[i][channel] = palette[(indexBits >> (3 * i)) & 7];
+        }
+    }
+
+    // ================================================================================================================
+    // A BC7 endpoint is 7 bits per channel plus a p-bit shared by its channels, as the lowest bit of each.
+    static void QuantizeBc7Endpoint(
+        const float endpoint[4],
+        uint32_t    pBit,
+        uint8_t     oQuantized[4])
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            float q = std::round((std::min(std::max(endpoint[c], 0.f), 255.f) - pBit) / 2.f);
+            oQuantized[c] = (uint8_t)std::min(std::max(q, 0.f), 127.f);
+        }
+    }
+
+    // ================================================================================================================
+    static void BuildBc7Mode6Palette(
+        const uint8_t quantized0[4],
+        const uint8_t quantized1[4],
+        uint32_t      pBit0,
+        uint32_t      pBit1,
+        uint8_t       oPalette[16][4])
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            uint32_t value0 = (quantized0[c] << 1) | pBit0;
+            uint32_t value1 = (quantized1[c] << 1) | pBit1;
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                oPalette[i][c] = (uint8_t)(((64 - Bc7Weights4[i]) * value0 + Bc7Weights4[i] * value1 + 32) >> 6);
+            }
+        }
+    }
+
+    // ================================================================================================================
+    struct Bc7Mode6Candidate
+    {
+        uint8_t  quantized0[4];
+        uint8_t  quantized1[4];
+        uint32_t pBit0;
+        uint32_t pBit1;
+        uint32_t indices[16];
+        uint32_t error;
+    };
+
+    // ================================================================================================================
+    static void EvaluateBc7Mode6(
+        const uint8_t      texels[16][4],
+        const float        endpoint0[4],
+        const float        endpoint1[4],
+        Bc7Mode6Candidate& oCandidate)
+    {
+        // The p-bits are tried jointly. With different p-bits, the interpolated values reach the odd and even values
+        // that a flat block needs.
+        oCandidate.error = UINT32_MAX;
+        for (uint32_t pBits = 0; pBits < 4; pBits++)
+        {
+            Bc7Mode6Candidate candidate;
+            candidate.pBit0 = pBits & 1;
+            candidate.pBit1 = pBits >> 1;
+            QuantizeBc7Endpoint(endpoint0, candidate.pBit0, candidate.quantized0);
+            QuantizeBc7Endpoint(endpoint1, candidate.pBit1, candidate.quantized1);
+
+            uint8_t palette[16][4];
+            BuildBc7Mode6Palette(candidate.quantized0, candidate.quantized1, candidate.pBit0, candidate.pBit1, palette);
+
+            candidate.error = 0;
+            for (uint32_t i = 0; (i < 16) && (candidate.error < oCandidate.error); i++)
+            {
+                uint32_t bestError = UINT32_MAX;
+                for (uint32_t p = 0; p < 16; p++)
+                {
+                    uint32_t error = ColorDistSq(texels[i], palette[p], 4);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        candidate.indices[i] = p;
+                    }
+                }
+                candidate.error += bestError;
+            }
+
+            if (candidate.error < oCandidate.error)
+            {
+                oCandidate = candidate;
+            }
+        }
+    }
+
+    // ================================================================================================================
+    // A flat block has no principal axis to follow, so the endpoints are searched around the color directly: for each
+    // p-bits combination and each index, every channel takes the endpoint pair whose interpolation is the closest.
+    static void EncodeBc7FlatBlock(
+        const uint8_t      color[4],
+        Bc7Mode6Candidate& oCandidate)
+    {
+        oCandidate.error = UINT32_MAX;
+        for (uint32_t pBits = 0; pBits < 4; pBits++)
+        {
+            uint32_t pBit0 = pBits & 1;
+            uint32_t pBit1 = pBits >> 1;
+            for (uint32_t idx = 0; idx < 16; idx++)
+            {
+                Bc7Mode6Candidate candidate;
+                candidate.pBit0 = pBit0;
+                candidate.pBit1 = pBit1;
+                candidate.error = 0;
+
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    int32_t center = color[c] / 2;
+                    int32_t bestError = INT32_MAX;
+                    for (int32_t q0 = std::max(center - 2, 0); q0 <= std::min(center + 2, 127); q0++)
+                    {
+                        for (int32_t q1 = std::max(center - 2, 0); q1 <= std::min(center + 2, 127); q1++)
+                        {
+                            int32_t value0 = (q0 << 1) | pBit0;
+                            int32_t value1 = (q1 << 1) | pBit1;
+                            int32_t value = ((64 - Bc7Weights4[idx]) * value0 + Bc7Weights4[idx] * value1 + 32) >> 6;
+                            int32_t error = std::abs(value - color[c]);
+                            if (error < bestError)
+                            {
+                                bestError = error;
+                                candidate.quantized0[c] = (uint8_t)q0;
+                                candidate.quantized1[c] = (uint8_t)q1;
+                            }
+                        }
+                    }
+                    candidate.error += 16 * bestError * bestError;
+                }
+
+                if (candidate.error < oCandidate.error)
+                {
+                    std::fill(candidate.indices, candidate.indices + 16, idx);
+                    oCandidate = candidate;
+                }
+            }
+        }
+    }
+
+    // ================================================================================================================
+    // The endpoints start at the extremes of the texels' principal axis, then get least squares refinements from the
+    // chosen indices.
+    static void EncodeBc7CurvedBlock(
+        const uint8_t      texels[16][4],
+        Bc7Mode6Candidate& oBest)
+    {
+        float mean[4];
+        float axis[4];
+        ComputePrincipalAxis(texels, 4, mean, axis);
+
+        float minT = FLT_MAX;
+        float maxT = -FLT_MAX;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            float t = 0.f;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                t += (texels[i][c] - mean[c]) * axis[c];
+            }
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+
+        float endpoint0[4];
+        float endpoint1[4];
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            endpoint0[c] = mean[c] + axis[c] * minT;
+            endpoint1[c] = mean[c] + axis[c] * maxT;
+        }
+
+        EvaluateBc7Mode6(texels, endpoint0, endpoint1, oBest);
+
+        // Two rounds of least squares refinement from the previous indices.
+        for (uint32_t iter = 0; (iter < 2) && (oBest.error > 0); iter++)
+        {
+            float positions[16];
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                positions[i] = Bc7Weights4[oBest.indices[i]] / 64.f;
+            }
+
+            if (FitEndpointsLeastSquares(texels, positions, 4, endpoint0, endpoint1) == false)
+            {
+                break;
+            }
+
+            Bc7Mode6Candidate refined;
+            EvaluateBc7Mode6(texels, endpoint0, endpoint1, refined);
+            if (refined.error >= oBest.error)
+            {
+                break;
+            }
+            oBest = refined;
+        }
+    }
+
+    // ================================================================================================================
+    // Encodes an RGBA block into a 16 bytes BC7 mode 6 block: one subset, RGBA endpoints and 16 interpolation steps.
+    static void EncodeBc7Block(
+        const uint8_t texels[16][4],
+        uint8_t*      pBlock)
+    {
+        bool isFlat = true;
+        for (uint32_t i = 1; (i < 16) && isFlat; i++)
+        {
+            isFlat = ColorDistSq(texels[0], texels[i], 4) == 0;
+        }
+
+        Bc7Mode6Candidate best;
+        if (isFlat)
+        {
+            EncodeBc7FlatBlock(texels[0], best);
+        }
+        else
+        {
+            EncodeBc7CurvedBlock(texels, best);
+        }
+
+        // The first texel's index has an implicit 0 top bit. Swapping the endpoints flips all the indices.
+        if (best.indices[0] & 8)
+        {
+            std::swap(best.quantized0, best.quantized1);
+            std::swap(best.pBit0, best.pBit1);
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                best.indices[i] = 15 - best.indices[i];
+            }
+        }
+
+        BcBitWriter writer(pBlock);
+        writer.Write(1 << 6, 7);
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            writer.Write(best.quantized0[c], 7);
+            writer.Write(best.quantized1[c], 7);
+        }
+        writer.Write(best.pBit0, 1);
+        writer.Write(best.pBit1, 1);
+        writer.Write(best.indices[0], 3);
+        for (uint32_t i = 1; i < 16; i++)
+        {
+            writer.Write(best.indices[i], 4);
+        }
+    }
+
+
+    // ================================================================================================================
+    static void DecodeBc7Block(
+        const uint8_t* pBlock,
+        uint8_t        oTexels[16][4])
+    {
+        BcBitReader reader(pBlock);
+        if (reader.Read(7) != (1 << 6))
+        {
+            // Not the mode 6. The invalid blocks decode to the transparent black as well.
+            memset(oTexels, 0, 16 * 4);
+            return;
+        }
+
+        uint8_t quantized0[4];
+        uint8_t quantized1[4];
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            quantized0[c] = (uint8_t)reader.Read(7);
+            quantized1[c] = (uint8_t)reader.Read(7);
+        }
+        uint32_t pBit0 = reader.Read(1);
+        uint32_t pBit1 = reader.Read(1);
+
+        uint8_t palette[16][4];
+        BuildBc7Mode6Palette(quantized0, quantized1, pBit0, pBit1, palette);
+
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            memcpy(oTexels[i], palette[reader.Read(i == 0 ? 3 : 4)], 4);
+        }
+    }
+
+    // ================================================================================================================
+    static void EncodeBlock(
+        const uint8_t  texels[16][4],
+        TexCompression compression,
+        uint8_t*       pBlock)
+    {
+        switch (compression)
+        {
+        case TEX_COMPRESSION_BC1:
+            EncodeBc1ColorBlock(texels, pBlock);
+            break;
+        case TEX_COMPRESSION_BC3:
+            EncodeBc4Block(texels, 3, pBlock);
+            EncodeBc1ColorBlock(texels, pBlock + 8);
+            break;
+        case TEX_COMPRESSION_BC4:
+            EncodeBc4Block(texels, 0, pBlock);
+            break;
+        case TEX_COMPRESSION_BC5:
+            EncodeBc4Block(texels, 0, pBlock);
+            EncodeBc4Block(texels, 1, pBlock + 8);
+            break;
+        case TEX_COMPRESSION_BC7:
+            EncodeBc7Block(texels, pBlock);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // ================================================================================================================
+    static void DecodeBlock(
+        const uint8_t* pBlock,
+        TexCompression compression,
+        uint8_t        oTexels[16][4])
+    {
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            oTexels[i][0] = 0;
+            oTexels[i][1] = 0;
+            oTexels[i][2] = 0;
+            oTexels[i][3] = 255;
+        }
+
+        switch (compression)
+        {
+        case TEX_COMPRESSION_BC1:
+            DecodeBc1ColorBlock(pBlock, true, oTexels);
+            break;
+        case TEX_COMPRESSION_BC3:
+            DecodeBc1ColorBlock(pBlock + 8, false, oTexels);
+            DecodeBc4Block(pBlock, 3, oTexels);
+            break;
+        case TEX_COMPRESSION_BC4:
+            DecodeBc4Block(pBlock, 0, oTexels);
+            break;
+        case TEX_COMPRESSION_BC5:
+            DecodeBc4Block(pBlock, 0, oTexels);
+            DecodeBc4Block(pBlock + 8, 1, oTexels);
+            break;
+        case TEX_COMPRESSION_BC7:
+            DecodeBc7Block(pBlock, oTexels);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // ================================================================================================================
+    uint32_t GetBcBlockByteCnt(
+        TexCompression compression)
+    {
+        switch (compression)
+        {
+        case TEX_COMPRESSION_BC1:
+        case TEX_COMPRESSION_BC4:
+            return 8;
+        case TEX_COMPRESSION_BC3:
+        case TEX_COMPRESSION_BC5:
+        case TEX_COMPRESSION_BC7:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+    // ================================================================================================================
+    uint32_t GetBcImageByteCnt(
+        TexCompression compression,
+        uint32_t       width,
+        uint32_t       height)
+    {
+        return ((width + 3) / 4) * ((height + 3) / 4) * GetBcBlockByteCnt(compression);
+    }
+
+    // ================================================================================================================
+    void CompressBcImage(
+        const uint8_t* pRgba8,
+        uint32_t       width,
+        uint32_t       height,
+        TexCompression compression,
+        ThreadPool*    pThreadPool,
+        uint8_t*       pBlocks)
+    {
+        uint32_t blockCntX = (width + 3) / 4;
+        uint32_t blockCntY = (height + 3) / 4;
+        uint32_t blockByteCnt = GetBcBlockByteCnt(compression);
+
+        auto compressBlockRow = [&](uint32_t blockY) {
+            uint8_t texels[16][4];
+            for (uint32_t blockX = 0; blockX < blockCntX; blockX++)
+            {
+                FetchBlock(pRgba8, width, height, blockX, blockY, texels);
+                EncodeBlock(texels, compression, &pBlocks[(blockY * blockCntX + blockX) * blockByteCnt]);
+            }
+        };
+
+        if ((pThreadPool != nullptr) && (blockCntY > 1))
+        {
+            pThreadPool->ParallelFor(blockCntY, compressBlockRow);
+        }
+        else
+        {
+            for (uint32_t blockY = 0; blockY < blockCntY; blockY++)
+            {
+                compressBlockRow(blockY);
+            }
+        }
+    }
+
+    // ================================================================================================================
+    void CompressBcMipChain(
+        const uint8_t*               pRgba8,
+        uint32_t                     width,
+        uint32_t                     height,
+        const std::vector<uint32_t>& mipByteOffsets,
+        TexCompression               compression,
+        ThreadPool*                  pThreadPool,
+        std::vector<uint8_t>&        oData,
+        std::vector<uint32_t>&       oMipByteOffsets)
+    {
+        uint32_t levelCnt = mipByteOffsets.empty() ? 1 : mipByteOffsets.size();
+
+        oMipByteOffsets.clear();
+        uint32_t byteCnt = 0;
+        for (uint32_t level = 0; level < levelCnt; level++)
+        {
+            oMipByteOffsets.push_back(byteCnt);
+            byteCnt += GetBcImageByteCnt(compression, std::max(width >> level, 1u), std::max(height >> level, 1u));
+        }
+        oData.resize(byteCnt);
+
+        for (uint32_t level = 0; level < levelCnt; level++)
+        {
+            CompressBcImage(pRgba8 + (mipByteOffsets.empty() ? 0 : mipByteOffsets[level]),
+                            std::max(width >> level, 1u),
+                            std::max(height >> level, 1u),
+                            compression,
+                            pThreadPool,
+                            &oData[oMipByteOffsets[level]]);
+        }
+
+        // A single level input keeps the single level convention.
+        if (mipByteOffsets.empty())
+        {
+            oMipByteOffsets.clear();
+        }
+    }
+
+    // ================================================================================================================
+    void DecompressBcImage(
+        const uint8_t* pBlocks,
+        uint32_t       width,
+        uint32_t       height,
+        TexCompression compression,
+        uint8_t*       pRgba8)
+    {
+        uint32_t blockCntX = (width + 3) / 4;
+        uint32_t blockCntY = (height + 3) / 4;
+        uint32_t blockByteCnt = GetBcBlockByteCnt(compression);
+
+        uint8_t texels[16][4];
+        for (uint32_t blockY = 0; blockY < blockCntY; blockY++)
+        {
+            for (uint32_t blockX = 0; blockX < blockCntX; blockX++)
+            {
+                DecodeBlock(&pBlocks[(blockY * blockCntX + blockX) * blockByteCnt], compression, texels);
+                StoreBlock(texels, width, height, blockX, blockY, pRgba8);
+            }
+        }
+    }
+
+    // ================================================================================================================
+    double ComputeBcPsnr(
+        const uint8_t* pRefRgba8,
+        const uint8_t* pRgba8,
+        uint32_t       texelCnt,
+        TexCompression compression)
+    {
+        uint32_t channelCnt = 4;
+        switch (compression)
+        {
+        case TEX_COMPRESSION_BC1:
+            channelCnt = 3;
+            break;
+        case TEX_COMPRESSION_BC4:
+            channelCnt = 1;
+            break;
+        case TEX_COMPRESSION_BC5:
+            channelCnt = 2;
+            break;
+        default:
+            break;
+        }
+
+        double errorSum = 0.0;
+        for (uint32_t i = 0; i < texelCnt; i++)
+        {
+            for (uint32_t c = 0; c < channelCnt; c++)
+            {
+                double diff = (double)pRefRgba8[4 * i + c] - (double)pRgba8[4 * i + c];
+                errorSum += diff * diff;
+            }
+        }
+
+        double mse = errorSum / ((double)texelCnt * channelCnt);
+        if (mse <= 0.0)
+        {
+            return 100.0;
+        }
+        return std::min(10.0 * std::log10(255.0 * 255.0 / mse), 100.0);
+    }
+}
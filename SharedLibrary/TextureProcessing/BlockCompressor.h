@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace SharedLib
+{
+    class ThreadPool;
+
+    // The block compressed formats of the material textures. Every format stores 4x4 texel blocks.
+    enum TexCompression
+    {
+        TEX_COMPRESSION_NONE,
+        TEX_COMPRESSION_BC1, // RGB at 4 bits per texel. The alpha is dropped.
+        TEX_COMPRESSION_BC3, // RGBA at 8 bits per texel. The alpha is stored like a BC4 channel.
+        TEX_COMPRESSION_BC4, // R at 4 bits per texel, e.g. the occlusion.
+        TEX_COMPRESSION_BC5, // RG at 8 bits per texel, e.g. the xy of a normal map.
+        TEX_COMPRESSION_BC7  // RGBA at 8 bits per texel. Only the mode 6 is encoded: one subset and 4 bits indices.
+    };
+
+    // 8 or 16 bytes per block. 0 for the TEX_COMPRESSION_NONE.
+    uint32_t GetBcBlockByteCnt(TexCompression compression);
+
+    // The byte count of one image or mip level. The partial blocks at the right and bottom edges count as whole ones.
+    uint32_t GetBcImageByteCnt(TexCompression compression, uint32_t width, uint32_t height);
+
+    // Compresses an RGBA8 image into pBlocks, which must hold the GetBcImageByteCnt(...). The block rows are split
+    // across the pThreadPool, which is optional. The partial blocks repeat the edge texels.
+    void CompressBcImage(const uint8_t* pRgba8,
+                         uint32_t       width,
+                         uint32_t       height,
+                         TexCompression compression,
+                         ThreadPool*    pThreadPool,
+                         uint8_t*       pBlocks);
+
+    // Compresses every level of a mip chain laid out as the MipGenerator's output. An empty pMipByteOffsets means a
+    // single level. oData receives the compressed levels back to back and oMipByteOffsets their byte offsets.
+    void CompressBcMipChain(const uint8_t*               pRgba8,
+                            uint32_t                     width,
+                            uint32_t                     height,
+                            const std::vector<uint32_t>& mipByteOffsets,
+                            TexCompression               compression,
+                            ThreadPool*                  pThreadPool,
+                            std::vector<uint8_t>&        oData,
+                            std::vector<uint32_t>&       oMipByteOffsets);
+
+    // Decodes the blocks back to RGBA8 as the sampler would see them: BC4 gives (r, 0, 0, 255) and BC5 (r, g, 0, 255).
+    // The BC7 decoder only knows the mode 6, so it only reads the CompressBcImage(...)'s own output.
+    void DecompressBcImage(const uint8_t* pBlocks,
+                           uint32_t       width,
+                           uint32_t       height,
+                           TexCompression compression,
+                           uint8_t*       pRgba8);
+
+    // The PSNR in dB between two RGBA8 images over the channels that the compression keeps. Equal images give 100.
+    double ComputeBcPsnr(const uint8_t* pRefRgba8, const uint8_t* pRgba8, uint32_t texelCnt, TexCompression compression);
+}
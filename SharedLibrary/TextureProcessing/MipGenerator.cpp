@@ -0,0 +1,523 @@
+#include "MipGenerator.h"
+#include "../Utils/ThreadUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE 1
+#endif
+
+namespace SharedLib
+{
+    // Half width of the Kaiser filter in destination texels and the window's shape parameter.
+    static const double MipKaiserRadius = 3.0;
+    static const double MipKaiserAlpha = 4.0;
+
+    // Rows per ParallelFor(...) task.
+    static const uint32_t MipRowsPerTask = 16;
+
+    // The sRGB encoding quantizes the linear value to this many steps first. It is fine enough to round every 8 bits
+    // sRGB value correctly.
+    static const uint32_t MipSrgbEncodeSteps = 4096;
+
+    // One axis of the separable resampling. Each destination texel sums the weights times the source texels from its
+    // range of the taps.
+    struct MipAxisWeights
+    {
+        std::vector<uint32_t> tapBegins;  // dstSize + 1 offsets into the taps.
+        std::vector<uint32_t> srcIndices; // Already wrapped to [0, srcSize).
+        std::vector<float>    weights;
+    };
+
+    // ================================================================================================================
+    static double BesselI0(
+        double x)
+    {
+        // The series converges quickly for the small arguments of the window.
+        double sum = 1.0;
+        double term = 1.0;
+        for (uint32_t k = 1; k < 32; k++)
+        {
+            term *= (x * 0.5 / k) * (x * 0.5 / k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    // ================================================================================================================
+    static double KaiserSinc(
+        double t)
+    {
+        if (std::abs(t) >= MipKaiserRadius)
+        {
+            return 0.0;
+        }
+
+        const double pi = 3.14159265358979323846;
+        double sinc = (t == 0.0) ? 1.0 : std::sin(pi * t) / (pi * t);
+        double r = t / MipKaiserRadius;
+        return sinc * BesselI0(MipKaiserAlpha * std::sqrt(1.0 - r * r)) / BesselI0(MipKaiserAlpha);
+    }
+
+    // ================================================================================================================
+    static void BuildAxisWeights(
+        uint32_t        srcSize,
+        uint32_t        dstSize,
+        MipFilter       filter,
+        MipAxisWeights& oAxis)
+    {
+        oAxis.tapBegins.clear();
+        oAxis.srcIndices.clear();
+        oAxis.weights.clear();
+
+        double scale = (double)srcSize / dstSize;
+        std::vector<double> weights;
+
+        for (uint32_t dst = 0; dst < dstSize; dst++)
+        {
+            oAxis.tapBegins.push_back(oAxis.srcIndices.size());
+            weights.clear();
+
+            int32_t first = 0;
+            int32_t last = 0;
+            if (filter == MIP_FILTER_BOX)
+            {
+                // The overlap of each source texel with [dst * scale, (dst + 1) * scale).
+                double begin = dst * scale;
+                double end = begin + scale;
+                first = (int32_t)std::floor(begin);
+                last = (int32_t)std::ceil(end) - 1;
+                for (int32_t src = first; src <= last; src++)
+                {
+                    weights.push_back(std::min(end, src + 1.0) - std::max(begin, (double)src));
+                }
+            }
+            else
+            {
+                // The texel centers in the source's texel space. The kernel is stretched by the scale, so it cuts at
+                // the destination's Nyquist frequency.
+                double center = (dst + 0.5) * scale - 0.5;
+                double radius = MipKaiserRadius * std::max(scale, 1.0);
+                first = (int32_t)std::ceil(center - radius);
+                last = (int32_t)std::floor(center + radius);
+                for (int32_t src = first; src <= last; src++)
+                {
+                    weights.push_back(KaiserSinc((src - center) / std::max(scale, 1.0)));
+                }
+            }
+
+            double weightSum = 0.0;
+            for (double weight : weights)
+            {
+                weightSum += weight;
+            }
+
+            for (int32_t src = first; src <= last; src++)
+            {
+                double weight = weights[src - first] / weightSum;
+                if (weight == 0.0)
+                {
+                    continue;
+                }
+
+                int32_t wrapped = src % (int32_t)srcSize;
+                oAxis.srcIndices.push_back((wrapped < 0) ? wrapped + srcSize : wrapped);
+                oAxis.weights.push_back((float)weight);
+            }
+        }
+        oAxis.tapBegins.push_back(oAxis.srcIndices.size());
+    }
+
+    // ================================================================================================================
+    static float SrgbToLinear(
+        float c)
+    {
+        return (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    // ================================================================================================================
+    static float LinearToSrgb(
+        float c)
+    {
+        return (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+    }
+
+    // ================================================================================================================
+    // The conversion tables are shared by both paths, so they can't make them disagree.
+    struct MipSrgbTables
+    {
+        MipSrgbTables()
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                decode[i] = SrgbToLinear(i / 255.f);
+            }
+            for (uint32_t i = 0; i <= MipSrgbEncodeSteps; i++)
+            {
+                encode[i] = (uint8_t)(LinearToSrgb((float)i / MipSrgbEncodeSteps) * 255.f + 0.5f);
+            }
+        }
+
+        float   decode[256];
+        uint8_t encode[MipSrgbEncodeSteps + 1];
+    };
+
+    // ================================================================================================================
+    static const MipSrgbTables& GetSrgbTables()
+    {
+        static const MipSrgbTables tables;
+        return tables;
+    }
+
+    // ================================================================================================================
+    static void DecodeTexels(
+        const uint8_t* pRgba8,
+        uint32_t       texelCnt,
+        MipColorSpace  colorSpace,
+        float*         pDst)
+    {
+        const MipSrgbTables& srgbTables = GetSrgbTables();
+        for (uint32_t i = 0; i < 4 * texelCnt; i += 4)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                if (colorSpace == MIP_COLOR_SPACE_SRGB)
+                {
+                    pDst[i + c] = srgbTables.decode[pRgba8[i + c]];
+                }
+                else if (colorSpace == MIP_COLOR_SPACE_NORMAL)
+                {
+                    pDst[i + c] = pRgba8[i + c] / 255.f * 2.f - 1.f;
+                }
+                else
+                {
+                    pDst[i + c] = pRgba8[i + c] / 255.f;
+                }
+            }
+            pDst[i + 3] = pRgba8[i + 3] / 255.f;
+        }
+    }
+
+    // ================================================================================================================
+    static uint8_t QuantizeUnorm(
+        float c)
+    {
+        return (uint8_t)(std::min(std::max(c, 0.f), 1.f) * 255.f + 0.5f);
+    }
+
+    // ================================================================================================================
+    static void EncodeTexels(
+        const float*  pSrc,
+        uint32_t      texelCnt,
+        MipColorSpace colorSpace,
+        uint8_t*      pRgba8)
+    {
+        const MipSrgbTables& srgbTables = GetSrgbTables();
+        for (uint32_t i = 0; i < 4 * texelCnt; i += 4)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                if (colorSpace == MIP_COLOR_SPACE_SRGB)
+                {
+                    float linear = std::min(std::max(pSrc[i + c], 0.f), 1.f);
+                    pRgba8[i + c] = srgbTables.encode[(uint32_t)(linear * MipSrgbEncodeSteps + 0.5f)];
+                }
+                else if (colorSpace == MIP_COLOR_SPACE_NORMAL)
+                {
+                    pRgba8[i + c] = QuantizeUnorm(pSrc[i + c] * 0.5f + 0.5f);
+                }
+                else
+                {
+                    pRgba8[i + c] = QuantizeUnorm(pSrc[i + c]);
+                }
+            }
+            pRgba8[i + 3] = QuantizeUnorm(pSrc[i + 3]);
+        }
+    }
+
+    // ================================================================================================================
+    // The filtered normals get shorter where they diverge, which would darken the lighting of the far mips.
+    static void RenormalizeTexels(
+        float*   pTexels,
+        uint32_t texelCnt)
+    {
+        for (uint32_t i = 0; i < texelCnt; i++)
+        {
+            float* pN = &pTexels[4 * i];
+            float  lenSq = pN[0] * pN[0] + pN[1] * pN[1] + pN[2] * pN[2];
+            if (lenSq > 0.f)
+            {
+                float invLen = 1.f / std::sqrt(lenSq);
+                pN[0] *= invLen;
+                pN[1] *= invLen;
+                pN[2] *= invLen;
+            }
+            else
+            {
+                pN[0] = 0.f;
+                pN[1] = 0.f;
+                pN[2] = 1.f;
+            }
+        }
+    }
+
+    // ================================================================================================================
+    // pDst[x] = sum(weight * pSrc[srcIdx]) for one row of RGBA float texels. Both kernels start from 0 and add the taps
+    // in order, with a separate multiply and add.
+    static void FilterRowScalar(
+        const float*          pSrc,
+        const MipAxisWeights& axis,
+        uint32_t              dstWidth,
+        float*                pDst)
+    {
+        for (uint32_t x = 0; x < dstWidth; x++)
+        {
+            float acc[4] = { 0.f, 0.f, 0.f, 0.f };
+            for (uint32_t t = axis.tapBegins[x]; t < axis.tapBegins[x + 1]; t++)
+            {
+                const float* pTexel = &pSrc[4 * axis.srcIndices[t]];
+                float        weight = axis.weights[t];
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    float weighted = weight * pTexel[c];
+                    acc[c] = acc[c] + weighted;
+                }
+            }
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                pDst[4 * x + c] = acc[c];
+            }
+        }
+    }
+
+    // ================================================================================================================
+    static void FilterRowSimd(
+        const float*          pSrc,
+        const MipAxisWeights& axis,
+        uint32_t              dstWidth,
+        float*                pDst)
+    {
+#ifdef MIP_GENERATOR_SSE
+        // One register holds one RGBA texel.
+        for (uint32_t x = 0; x < dstWidth; x++)
+        {
+            __m128 acc = _mm_setzero_ps();
+            for (uint32_t t = axis.tapBegins[x]; t < axis.tapBegins[x + 1]; t++)
+            {
+                __m128 texel = _mm_loadu_ps(&pSrc[4 * axis.srcIndices[t]]);
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(axis.weights[t]), texel));
+            }
+            _mm_storeu_ps(&pDst[4 * x], acc);
+        }
+#else
+        FilterRowScalar(pSrc, axis, dstWidth, pDst);
+#endif
+    }
+
+    // ================================================================================================================
+    // pDst[x] = sum(weight * ppRows[tap][x]) over the taps of one destination row.
+    static void BlendRowsScalar(
+        const float* const* ppRows,
+        const float*        pWeights,
+        uint32_t            tapCnt,
+        uint32_t            floatCnt,
+        float*              pDst)
+    {
+        std::fill(pDst, pDst + floatCnt, 0.f);
+        for (uint32_t t = 0; t < tapCnt; t++)
+        {
+            const float* pRow = ppRows[t];
+            float        weight = pWeights[t];
+            for (uint32_t i = 0; i < floatCnt; i++)
+            {
+                float weighted = weight * pRow[i];
+                pDst[i] = pDst[i] + weighted;
+            }
+        }
+    }
+
+    // ================================================================================================================
+    static void BlendRowsSimd(
+        const float* const* ppRows,
+        const float*        pWeights,
+        uint32_t            tapCnt,
+        uint32_t            floatCnt,
+        float*              pDst)
+    {
+#ifdef MIP_GENERATOR_SSE
+        // The rows are whole RGBA texels, so the float count is always a multiple of 4.
+        std::fill(pDst, pDst + floatCnt, 0.f);
+        for (uint32_t t = 0; t < tapCnt; t++)
+        {
+            const float* pRow = ppRows[t];
+            __m128       weight = _mm_set1_ps(pWeights[t]);
+            for (uint32_t i = 0; i < floatCnt; i += 4)
+            {
+                __m128 acc = _mm_loadu_ps(&pDst[i]);
+                acc = _mm_add_ps(acc, _mm_mul_ps(weight, _mm_loadu_ps(&pRow[i])));
+                _mm_storeu_ps(&pDst[i], acc);
+            }
+        }
+#else
+        BlendRowsScalar(ppRows, pWeights, tapCnt, floatCnt, pDst);
+#endif
+    }
+
+    // ================================================================================================================
+    // Runs func(rowBegin, rowEnd) over the rows in chunks, on the pool when there is one.
+    static void ForEachRowChunk(
+        ThreadPool*                                        pThreadPool,
+        uint32_t                                           rowCnt,
+        const std::function<void(uint32_t, uint32_t)>& func)
+    {
+        uint32_t chunkCnt = (rowCnt + MipRowsPerTask - 1) / MipRowsPerTask;
+        auto runChunk = [&](uint32_t chunkIdx) {
+            uint32_t rowBegin = chunkIdx * MipRowsPerTask;
+            func(rowBegin, std::min(rowBegin + MipRowsPerTask, rowCnt));
+        };
+
+        if ((pThreadPool != nullptr) && (chunkCnt > 1))
+        {
+            pThreadPool->ParallelFor(chunkCnt, runChunk);
+        }
+        else
+        {
+            for (uint32_t i = 0; i < chunkCnt; i++)
+            {
+                runChunk(i);
+            }
+        }
+    }
+
+    // ================================================================================================================
+    static void GenerateMipChainImpl(
+        const uint8_t*         pRgba8,
+        uint32_t               width,
+        uint32_t               height,
+        MipFilter              filter,
+        MipColorSpace          colorSpace,
+        ThreadPool*            pThreadPool,
+        bool                   useSimd,
+        std::vector<uint8_t>&  oData,
+        std::vector<uint32_t>& oMipByteOffsets)
+    {
+        uint32_t levelCnt = GetMipLevelCnt(width, height);
+
+        oMipByteOffsets.clear();
+        uint32_t byteCnt = 0;
+        for (uint32_t level = 0; level < levelCnt; level++)
+        {
+            oMipByteOffsets.push_back(byteCnt);
+            byteCnt += 4 * std::max(width >> level, 1u) * std::max(height >> level, 1u);
+        }
+
+        oData.resize(byteCnt);
+        std::copy(pRgba8, pRgba8 + 4 * width * height, oData.begin());
+
+        auto filterRow = useSimd ? FilterRowSimd : FilterRowScalar;
+        auto blendRows = useSimd ? BlendRowsSimd : BlendRowsScalar;
+
+        std::vector<float> srcLevel(4 * width * height);
+        std::vector<float> hFiltered;
+        std::vector<float> dstLevel;
+        DecodeTexels(pRgba8, width * height, colorSpace, srcLevel.data());
+
+        uint32_t srcWidth = width;
+        uint32_t srcHeight = height;
+        for (uint32_t level = 1; level < levelCnt; level++)
+        {
+            uint32_t dstWidth = std::max(srcWidth / 2, 1u);
+            uint32_t dstHeight = std::max(srcHeight / 2, 1u);
+
+            MipAxisWeights xAxis;
+            MipAxisWeights yAxis;
+            BuildAxisWeights(srcWidth, dstWidth, filter, xAxis);
+            BuildAxisWeights(srcHeight, dstHeight, filter, yAxis);
+
+            // The horizontal pass filters every source row down to the destination width.
+            hFiltered.resize(4 * dstWidth * srcHeight);
+            ForEachRowChunk(pThreadPool, srcHeight, [&](uint32_t rowBegin, uint32_t rowEnd) {
+                for (uint32_t y = rowBegin; y < rowEnd; y++)
+                {
+                    filterRow(&srcLevel[4 * srcWidth * y], xAxis, dstWidth, &hFiltered[4 * dstWidth * y]);
+                }
+            });
+
+            // The vertical pass blends the filtered rows, then the level is quantized into its part of the output.
+            dstLevel.resize(4 * dstWidth * dstHeight);
+            uint8_t* pDstBytes = &oData[oMipByteOffsets[level]];
+            ForEachRowChunk(pThreadPool, dstHeight, [&](uint32_t rowBegin, uint32_t rowEnd) {
+                std::vector<const float*> rows;
+                for (uint32_t y = rowBegin; y < rowEnd; y++)
+                {
+                    uint32_t tapBegin = yAxis.tapBegins[y];
+                    uint32_t tapCnt = yAxis.tapBegins[y + 1] - tapBegin;
+
+                    rows.clear();
+                    for (uint32_t t = tapBegin; t < tapBegin + tapCnt; t++)
+                    {
+                        rows.push_back(&hFiltered[4 * dstWidth * yAxis.srcIndices[t]]);
+                    }
+
+                    float* pDstRow = &dstLevel[4 * dstWidth * y];
+                    blendRows(rows.data(), &yAxis.weights[tapBegin], tapCnt, 4 * dstWidth, pDstRow);
+
+                    if (colorSpace == MIP_COLOR_SPACE_NORMAL)
+                    {
+                        RenormalizeTexels(pDstRow, dstWidth);
+                    }
+                    EncodeTexels(pDstRow, dstWidth, colorSpace, &pDstBytes[4 * dstWidth * y]);
+                }
+            });
+
+            // The next level filters the float result, not the quantized bytes.
+            srcLevel.swap(dstLevel);
+            srcWidth = dstWidth;
+            srcHeight = dstHeight;
+        }
+    }
+
+    // ================================================================================================================
+    uint32_t GetMipLevelCnt(
+        uint32_t width,
+        uint32_t height)
+    {
+        uint32_t levelCnt = 1;
+        uint32_t size = std::max(width, height);
+        while (size > 1)
+        {
+            size /= 2;
+            levelCnt++;
+        }
+        return levelCnt;
+    }
+
+    // ================================================================================================================
+    void GenerateMipChain(
+        const uint8_t*         pRgba8,
+        uint32_t               width,
+        uint32_t               height,
+        MipFilter              filter,
+        MipColorSpace          colorSpace,
+        ThreadPool*            pThreadPool,
+        std::vector<uint8_t>&  oData,
+        std::vector<uint32_t>& oMipByteOffsets)
+    {
+        GenerateMipChainImpl(pRgba8, width, height, filter, colorSpace, pThreadPool, true, oData, oMipByteOffsets);
+    }
+
+    // ================================================================================================================
+    void GenerateMipChainScalar(
+        const uint8_t*         pRgba8,
+        uint32_t               width,
+        uint32_t               height,
+        MipFilter              filter,
+        MipColorSpace          colorSpace,
+        std::vector<uint8_t>&  oData,
+        std::vector<uint32_t>& oMipByteOffsets)
+    {
+        GenerateMipChainImpl(pRgba8, width, height, filter, colorSpace, nullptr, false, oData, oMipByteOffsets);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace SharedLib
+{
+    class ThreadPool;
+
+    enum MipFilter
+    {
+        MIP_FILTER_BOX,   // The average of the source texels that a destination texel covers. Cheap, slightly blurry.
+        MIP_FILTER_KAISER // Kaiser windowed sinc over 3 lobes. Sharper and with less aliasing than the box.
+    };
+
+    // How the RGB channels are filtered. The alpha is always filtered as linear data.
+    enum MipColorSpace
+    {
+        MIP_COLOR_SPACE_LINEAR, // Data textures, e.g. the metallic roughness and the occlusion.
+        MIP_COLOR_SPACE_SRGB,   // Color textures. Filtered in linear space and encoded back to sRGB.
+        MIP_COLOR_SPACE_NORMAL  // Tangent space normal maps. The filtered xyz is renormalized on every level.
+    };
+
+    // floor(log2(max(width, height))) + 1. Each level is half of the previous one, rounded down and at least 1.
+    uint32_t GetMipLevelCnt(uint32_t width, uint32_t height);
+
+    // Builds the full mip chain of an RGBA8 image. oData receives all the levels back to back, the level 0 being a
+    // copy of the input, and oMipByteOffsets the byte offset of each level in oData.
+    //
+    // Every level is filtered from the previous one in float and only quantized for the output, so the rounding
+    // doesn't accumulate along the chain. The texture coordinates wrap at the edges, as the samplers repeat. The
+    // filters run on SSE with the rows split across the pThreadPool, which is optional.
+    void GenerateMipChain(const uint8_t*         pRgba8,
+                          uint32_t               width,
+                          uint32_t               height,
+                          MipFilter              filter,
+                          MipColorSpace          colorSpace,
+                          ThreadPool*            pThreadPool,
+                          std::vector<uint8_t>&  oData,
+                          std::vector<uint32_t>& oMipByteOffsets);
+
+    // The single threaded scalar reference of the GenerateMipChain(...). Both do the same float operations in the
+    // same order, so their outputs are identical unless the compiler contracts the reference's multiply-adds into
+    // FMAs.
+    void GenerateMipChainScalar(const uint8_t*         pRgba8,
+                                uint32_t               width,
+                                uint32_t               height,
+                                MipFilter              filter,
+                                MipColorSpace          colorSpace,
+                                std::vector<uint8_t>&  oData,
+                                std::vector<uint32_t>& oMipByteOffsets);
+}
@@ -0,0 +1,447 @@
+#include "TransformHierarchy.h"
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SHARED_LIB_SSE2 1
+#include <emmintrin.h>
+#else
+#define SHARED_LIB_SSE2 0
+#endif
+
+namespace SharedLib
+{
+#if SHARED_LIB_SSE2 == 0
+    // ================================================================================================================
+    // The top 3 rows of M = T * R * S, where R is the rotation matrix of the (x, y, z, w) quaternion.
+    static void ComposeLocalMat(
+        const float translation[3],
+        const float rotation[4],
+        const float scale[3],
+        float*      oMat)
+    {
+        float x = rotation[0];
+        float y = rotation[1];
+        float z = rotation[2];
+        float w = rotation[3];
+
+        oMat[0]  = (1.f - 2.f * (y * y + z * z)) * scale[0];
+        oMat[1]  = 2.f * (x * y - w * z) * scale[1];
+        oMat[2]  = 2.f * (x * z + w * y) * scale[2];
+        oMat[3]  = translation[0];
+        oMat[4]  = 2.f * (x * y + w * z) * scale[0];
+        oMat[5]  = (1.f - 2.f * (x * x + z * z)) * scale[1];
+        oMat[6]  = 2.f * (y * z - w * x) * scale[2];
+        oMat[7]  = translation[1];
+        oMat[8]  = 2.f * (x * z - w * y) * scale[0];
+        oMat[9]  = 2.f * (y * z + w * x) * scale[1];
+        oMat[10] = (1.f - 2.f * (x * x + y * y)) * scale[2];
+        oMat[11] = translation[2];
+    }
+#endif
+
+    // ================================================================================================================
+    // World = ParentWorld * Local. Both are affine, so only the top 3 rows of the world matrix change.
+    static void ComposeWorldMat(
+        const float* pParentWorldMat,
+        const float* pLocalMat,
+        float*       oWorldMat)
+    {
+#if SHARED_LIB_SSE2
+        __m128 localRow0 = _mm_loadu_ps(pLocalMat);
+        __m128 localRow1 = _mm_loadu_ps(pLocalMat + 4);
+        __m128 localRow2 = _mm_loadu_ps(pLocalMat + 8);
+        for (uint32_t row = 0; row < 3; row++)
+        {
+            const float* pParentRow = pParentWorldMat + 4 * row;
+            __m128 res = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pParentRow[0]), localRow0),
+                                    _mm_mul_ps(_mm_set1_ps(pParentRow[1]), localRow1));
+            res = _mm_add_ps(res, _mm_mul_ps(_mm_set1_ps(pParentRow[2]), localRow2));
+            res = _mm_add_ps(res, _mm_set_ps(pParentRow[3], 0.f, 0.f, 0.f));
+            _mm_storeu_ps(oWorldMat + 4 * row, res);
+        }
+#else
+        for (uint32_t row = 0; row < 3; row++)
+        {
+            const float* pParentRow = pParentWorldMat + 4 * row;
+            for (uint32_t col = 0; col < 4; col++)
+            {
+                oWorldMat[4 * row + col] = pParentRow[0] * pLocalMat[col] +
+                                           pParentRow[1] * pLocalMat[4 + col] +
+                                           pParentRow[2] * pLocalMat[8 + col];
+            }
+            oWorldMat[4 * row + 3] += pParentRow[3];
+        }
+#endif
+    }
+
+    // ================================================================================================================
+    void TransformHierarchy::Init(
+        const std::vector<uint32_t>& parentIdxs)
+    {
+        m_nodeCnt = parentIdxs.size();
+        uint32_t paddedNodeCnt = (m_nodeCnt + 3) & ~3u;
+
+        // The children lists in the CSR layout, so the sorting doesn't allocate per node.
+        std::vector<uint32_t> childrenOffsets(m_nodeCnt + 1, 0);
+        for (uint32_t parentIdx : parentIdxs)
+        {
+            if (parentIdx != InvalidNodeIdx)
+            {
+                assert(parentIdx < m_nodeCnt && "The parent index is out of range.");
+                childrenOffsets[parentIdx + 1]++;
+            }
+        }
+
+        for (uint32_t i = 0; i < m_nodeCnt; i++)
+        {
+            childrenOffsets[i + 1] += childrenOffsets[i];
+        }
+
+        std::vector<uint32_t> children(childrenOffsets[m_nodeCnt]);
+        std::vector<uint32_t> childrenFillCnts(m_nodeCnt, 0);
+        for (uint32_t i = 0; i < m_nodeCnt; i++)
+        {
+            uint32_t parentIdx = parentIdxs[i];
+            if (parentIdx != InvalidNodeIdx)
+            {
+                children[childrenOffsets[parentIdx] + childrenFillCnts[parentIdx]] = i;
+                childrenFillCnts[parentIdx]++;
+            }
+        }
+
+        // The depth first pre-order. The stack is filled in the reverse order so that the siblings keep their order.
+        m_sortedIdxs.assign(m_nodeCnt, InvalidNodeIdx);
+        m_nodeIdxs.clear();
+        m_nodeIdxs.reserve(m_nodeCnt);
+        m_parents.clear();
+        m_parents.reserve(m_nodeCnt);
+
+        std::vector<uint32_t> stack;
+        for (uint32_t i = m_nodeCnt; i > 0; i--)
+        {
+            if (parentIdxs[i - 1] == InvalidNodeIdx)
+            {
+                stack.push_back(i - 1);
+            }
+        }
+
+        while (stack.empty() == false)
+        {
+            uint32_t nodeIdx = stack.back();
+            stack.pop_back();
+
+            m_sortedIdxs[nodeIdx] = m_nodeIdxs.size();
+            m_nodeIdxs.push_back(nodeIdx);
+            m_parents.push_back(parentIdxs[nodeIdx] == InvalidNodeIdx ? InvalidNodeIdx
+                                                                      : m_sortedIdxs[parentIdxs[nodeIdx]]);
+
+            for (uint32_t i = childrenOffsets[nodeIdx + 1]; i > childrenOffsets[nodeIdx]; i--)
+            {
+                stack.push_back(children[i - 1]);
+            }
+        }
+        assert(m_nodeIdxs.size() == m_nodeCnt && "The hierarchy has a cycle.");
+
+        // A subtree ends where the next node that isn't its descendant starts. Walking backwards, every node pushes
+        // its own end up to its parent.
+        m_subtreeEnds.resize(m_nodeCnt);
+        for (uint32_t i = 0; i < m_nodeCnt; i++)
+        {
+            m_subtreeEnds[i] = i + 1;
+        }
+
+        for (uint32_t i = m_nodeCnt; i > 0; i--)
+        {
+            uint32_t parent = m_parents[i - 1];
+            if (parent != InvalidNodeIdx)
+            {
+                m_subtreeEnds[parent] = std::max(m_subtreeEnds[parent], m_subtreeEnds[i - 1]);
+            }
+        }
+
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            m_translations[i].assign(paddedNodeCnt, 0.f);
+            m_scales[i].assign(paddedNodeCnt, 1.f);
+        }
+
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            m_rotations[i].assign(paddedNodeCnt, i == 3 ? 1.f : 0.f);
+        }
+
+        const float identityMat[16] = {
+            1.f, 0.f, 0.f, 0.f,
+            0.f, 1.f, 0.f, 0.f,
+            0.f, 0.f, 1.f, 0.f,
+            0.f, 0.f, 0.f, 1.f
+        };
+
+        m_localMats.resize(12 * m_nodeCnt);
+        m_worldMats.resize(16 * m_nodeCnt);
+        for (uint32_t i = 0; i < m_nodeCnt; i++)
+        {
+            memcpy(&m_localMats[12 * i], identityMat, 12 * sizeof(float));
+            memcpy(&m_worldMats[16 * i], identityMat, sizeof(identityMat));
+        }
+
+        // The padding nodes are never dirty, so they don't keep the last block alive.
+        m_isLocalMats.assign(paddedNodeCnt, 0);
+        m_dirtyFlags.assign(paddedNodeCnt, 0);
+        memset(m_dirtyFlags.data(), 1, m_nodeCnt);
+        m_dirtyBegin = 0;
+        m_dirtyEnd = m_nodeCnt;
+        m_lastUpdateNodeCnt = 0;
+    }
+
+    // ================================================================================================================
+    uint32_t TransformHierarchy::GetParentIdx(
+        uint32_t nodeIdx) const
+    {
+        uint32_t parent = m_parents[m_sortedIdxs[nodeIdx]];
+        return parent == InvalidNodeIdx ? InvalidNodeIdx : m_nodeIdxs[parent];
+    }
+
+    // ================================================================================================================
+    void TransformHierarchy::MarkDirty(
+        uint32_t sortedIdx)
+    {
+        m_dirtyFlags[sortedIdx] = 1;
+        if (m_dirtyBegin == m_dirtyEnd)
+        {
+            m_dirtyBegin = sortedIdx;
+            m_dirtyEnd = m_subtreeEnds[sortedIdx];
+        }
+        else
+        {
+            m_dirtyBegin = std::min(m_dirtyBegin, sortedIdx);
+            m_dirtyEnd = std::max(m_dirtyEnd, m_subtreeEnds[sortedIdx]);
+        }
+    }
+
+    // ================================================================================================================
+    void TransformHierarchy::SetLocalTrs(
+        uint32_t    nodeIdx,
+        const float translation[3],
+        const float rotation[4],
+        const float scale[3])
+    {
+        uint32_t sortedIdx = m_sortedIdxs[nodeIdx];
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            m_translations[i][sortedIdx] = translation[i];
+            m_scales[i][sortedIdx] = scale[i];
+        }
+
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            m_rotations[i][sortedIdx] = rotation[i];
+        }
+
+        m_isLocalMats[sortedIdx] = 0;
+        MarkDirty(sortedIdx);
+    }
+
+    // ================================================================================================================
+    void TransformHierarchy::SetLocalTranslation(
+        uint32_t    nodeIdx,
+        const float translation[3])
+    {
+        uint32_t sortedIdx = m_sortedIdxs[nodeIdx];
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            m_translations[i][sortedIdx] = translation[i];
+        }
+        MarkDirty(sortedIdx);
+    }
+
+    // ================================================================================================================
+    void TransformHierarchy::SetLocalRotation(
+        uint32_t    nodeIdx,
+        const float rotation[4])
+    {
+        uint32_t sortedIdx = m_sortedIdxs[nodeIdx];
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            m_rotations[i][sortedIdx] = rotation[i];
+        }
+        MarkDirty(sortedIdx);
+    }
+
+    // ================================================================================================================
+    void TransformHierarchy::SetLocalScale(
+        uint32_t    nodeIdx,
+        const float scale[3])
+    {
+        uint32_t sortedIdx = m_sortedIdxs[nodeIdx];
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            m_scales[i][sortedIdx] = scale[i];
+        }
+        MarkDirty(sortedIdx);
+    }
+
+    // ================================================================================================================
+    void TransformHierarchy::SetLocalMat(
+        uint32_t    nodeIdx,
+        const float mat[16])
+    {
+        uint32_t sortedIdx = m_sortedIdxs[nodeIdx];
+        memcpy(&m_localMats[12 * sortedIdx], mat, 12 * sizeof(float));
+        m_isLocalMats[sortedIdx] = 1;
+        MarkDirty(sortedIdx);
+    }
+
+    // ================================================================================================================
+    // Recomputes the local matrices of the dirty TRS nodes in the sorted range. The SoA layout lets the SSE compose
+    // four nodes in the lanes of the same registers. A block without any dirty node is skipped as a whole.
+    void TransformHierarchy::UpdateLocalMats(
+        uint32_t sortedBegin,
+        uint32_t sortedEnd)
+    {
+        for (uint32_t blockBegin = sortedBegin & ~3u; blockBegin < sortedEnd; blockBegin += 4)
+        {
+            uint32_t blockDirtyFlags = 0;
+            memcpy(&blockDirtyFlags, &m_dirtyFlags[blockBegin], sizeof(blockDirtyFlags));
+            if (blockDirtyFlags == 0)
+            {
+                continue;
+            }
+
+#if SHARED_LIB_SSE2
+            __m128 tx = _mm_loadu_ps(&m_translations[0][blockBegin]);
+            __m128 ty = _mm_loadu_ps(&m_translations[1][blockBegin]);
+            __m128 tz = _mm_loadu_ps(&m_translations[2][blockBegin]);
+            __m128 qx = _mm_loadu_ps(&m_rotations[0][blockBegin]);
+            __m128 qy = _mm_loadu_ps(&m_rotations[1][blockBegin]);
+            __m128 qz = _mm_loadu_ps(&m_rotations[2][blockBegin]);
+            __m128 qw = _mm_loadu_ps(&m_rotations[3][blockBegin]);
+            __m128 sx = _mm_loadu_ps(&m_scales[0][blockBegin]);
+            __m128 sy = _mm_loadu_ps(&m_scales[1][blockBegin]);
+            __m128 sz = _mm_loadu_ps(&m_scales[2][blockBegin]);
+
+            const __m128 one = _mm_set1_ps(1.f);
+            const __m128 two = _mm_set1_ps(2.f);
+            __m128 xx = _mm_mul_ps(qx, qx);
+            __m128 yy = _mm_mul_ps(qy, qy);
+            __m128 zz = _mm_mul_ps(qz, qz);
+            __m128 xy = _mm_mul_ps(qx, qy);
+            __m128 xz = _mm_mul_ps(qx, qz);
+            __m128 yz = _mm_mul_ps(qy, qz);
+            __m128 wx = _mm_mul_ps(qw, qx);
+            __m128 wy = _mm_mul_ps(qw, qy);
+            __m128 wz = _mm_mul_ps(qw, qz);
+
+            // Each register holds one matrix element of the four nodes.
+            __m128 rows[3][4] = {
+                { _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+                  _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+                  _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+                  tx },
+                { _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+                  _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+                  _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+                  ty },
+                { _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+                  _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+                  _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+                  tz }
+            };
+
+            // After the transpose, rows[r][lane] is the row r of the lane's node.
+            for (uint32_t row = 0; row < 3; row++)
+            {
+                _MM_TRANSPOSE4_PS(rows[row][0], rows[row][1], rows[row][2], rows[row][3]);
+            }
+#endif
+
+            for (uint32_t lane = 0; lane < 4; lane++)
+            {
+                uint32_t sortedIdx = blockBegin + lane;
+                if ((sortedIdx >= m_nodeCnt) || (m_dirtyFlags[sortedIdx] == 0) || m_isLocalMats[sortedIdx])
+                {
+                    continue;
+                }
+
+                float* pLocalMat = &m_localMats[12 * sortedIdx];
+#if SHARED_LIB_SSE2
+                for (uint32_t row = 0; row < 3; row++)
+                {
+                    _mm_storeu_ps(pLocalMat + 4 * row, rows[row][lane]);
+                }
+#else
+                float translation[3] = { m_translations[0][sortedIdx],
+                                         m_translations[1][sortedIdx],
+                                         m_translations[2][sortedIdx] };
+
+                float rotation[4] = { m_rotations[0][sortedIdx],
+                                      m_rotations[1][sortedIdx],
+                                      m_rotations[2][sortedIdx],
+                                      m_rotations[3][sortedIdx] };
+
+                float scale[3] = { m_scales[0][sortedIdx], m_scales[1][sortedIdx], m_scales[2][sortedIdx] };
+                ComposeLocalMat(translation, rotation, scale, pLocalMat);
+#endif
+            }
+        }
+    }
+
+    // ================================================================================================================
+    // Parents come first, so one forward pass sees a parent's new world matrix before any of its children. A node is
+    // recomputed if its own local transformation or any ancestor's changed, and everything outside the dirty range is
+    // left as it is.
+    void TransformHierarchy::Update()
+    {
+        m_lastUpdateNodeCnt = 0;
+        if (m_dirtyBegin == m_dirtyEnd)
+        {
+            return;
+        }
+
+        UpdateLocalMats(m_dirtyBegin, m_dirtyEnd);
+
+        for (uint32_t i = m_dirtyBegin; i < m_dirtyEnd; i++)
+        {
+            uint32_t parent = m_parents[i];
+            if (parent != InvalidNodeIdx)
+            {
+                // A parent before the dirty range is always clean.
+                m_dirtyFlags[i] |= m_dirtyFlags[parent];
+            }
+
+            if (m_dirtyFlags[i] == 0)
+            {
+                continue;
+            }
+
+            const float* pLocalMat = &m_localMats[12 * i];
+            float* pWorldMat = &m_worldMats[16 * i];
+            if (parent == InvalidNodeIdx)
+            {
+                memcpy(pWorldMat, pLocalMat, 12 * sizeof(float));
+            }
+            else
+            {
+                ComposeWorldMat(&m_worldMats[16 * parent], pLocalMat, pWorldMat);
+            }
+            m_lastUpdateNodeCnt++;
+        }
+
+        memset(&m_dirtyFlags[m_dirtyBegin], 0, m_dirtyEnd - m_dirtyBegin);
+        m_dirtyBegin = 0;
+        m_dirtyEnd = 0;
+    }
+
+    // ================================================================================================================
+    void TransformHierarchy::GetWorldMats(
+        std::vector<float>& matsVec) const
+    {
+        matsVec.resize(16 * m_nodeCnt);
+        for (uint32_t i = 0; i < m_nodeCnt; i++)
+        {
+            memcpy(&matsVec[16 * m_nodeIdxs[i]], &m_worldMats[16 * i], 16 * sizeof(float));
+        }
+    }
+}
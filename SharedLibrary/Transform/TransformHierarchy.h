@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace SharedLib
+{
+    // A flattened node hierarchy for the scene graphs and the skeletons. The local TRS are kept in SoA arrays sorted in
+    // the depth first pre-order, so a parent always comes before its children and a subtree is a contiguous range.
+    // Update() then computes the local matrices four nodes a time and the world matrices in one linear pass, but only
+    // for the subtrees whose local transformations have changed since the last update.
+    //
+    // All the public node indices are the caller's, e.g. the gltf node indices. All the matrices are row-major.
+    class TransformHierarchy
+    {
+    public:
+        static constexpr uint32_t InvalidNodeIdx = UINT32_MAX;
+
+        // parentIdxs[i] is the parent of the node i or the InvalidNodeIdx for a root. The nodes start with the
+        // identity local transformations and all of them are dirty.
+        void Init(const std::vector<uint32_t>& parentIdxs);
+
+        uint32_t GetNodeCnt() const { return m_nodeCnt; }
+        uint32_t GetParentIdx(uint32_t nodeIdx) const;
+
+        // The rotation is a (x, y, z, w) quaternion as the gltf stores it.
+        void SetLocalTrs(uint32_t nodeIdx, const float translation[3], const float rotation[4], const float scale[3]);
+        void SetLocalTranslation(uint32_t nodeIdx, const float translation[3]);
+        void SetLocalRotation(uint32_t nodeIdx, const float rotation[4]);
+        void SetLocalScale(uint32_t nodeIdx, const float scale[3]);
+
+        // An affine local matrix replaces the node's TRS until the next SetLocalTrs(...).
+        void SetLocalMat(uint32_t nodeIdx, const float mat[16]);
+
+        // Recomputes the world matrices of all the dirty subtrees.
+        void Update();
+
+        const float* GetWorldMat(uint32_t nodeIdx) const { return &m_worldMats[16 * m_sortedIdxs[nodeIdx]]; }
+
+        // All the nodes' world matrices in the caller's order. matsVec has 16 floats per node.
+        void GetWorldMats(std::vector<float>& matsVec) const;
+
+        // How many nodes the last Update() recomputed.
+        uint32_t GetLastUpdateNodeCnt() const { return m_lastUpdateNodeCnt; }
+
+    private:
+        void MarkDirty(uint32_t sortedIdx);
+        void UpdateLocalMats(uint32_t sortedBegin, uint32_t sortedEnd);
+
+        uint32_t m_nodeCnt = 0;
+
+        std::vector<uint32_t> m_sortedIdxs;  // The caller's node index to the sorted index.
+        std::vector<uint32_t> m_nodeIdxs;    // The sorted index to the caller's node index.
+        std::vector<uint32_t> m_parents;     // Sorted parent indices. Always smaller than the child's.
+        std::vector<uint32_t> m_subtreeEnds; // One past the last sorted node in the subtree.
+
+        // The SoA local TRS. Padded to a multiple of 4 nodes.
+        std::vector<float> m_translations[3];
+        std::vector<float> m_rotations[4];
+        std::vector<float> m_scales[3];
+
+        std::vector<uint8_t> m_isLocalMats; // The node uses the local matrix set by the SetLocalMat(...).
+        std::vector<uint8_t> m_dirtyFlags;  // The local transformation has changed since the last update.
+
+        std::vector<float> m_localMats; // The top 3 rows of the affine local matrices. 12 floats per node.
+        std::vector<float> m_worldMats; // 16 floats per node.
+
+        // The sorted range that the next update has to walk. Empty when nothing is dirty.
+        uint32_t m_dirtyBegin = 0;
+        uint32_t m_dirtyEnd = 0;
+
+        uint32_t m_lastUpdateNodeCnt = 0;
+    };
+}
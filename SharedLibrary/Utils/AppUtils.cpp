@@ -31,7 +31,7 @@ namespace SharedLib
 
     // ================================================================================================================
     void CopyRamDataToGpuBuffer(
-        void* pSrc,
+        const void*   pSrc,
         VmaAllocator* pAllocator,
         VkBuffer      dstBuffer,
         VmaAllocation dstAllocation,
@@ -24,7 +24,7 @@ namespace SharedLib
 
     void PrintDeviceImageCapbility(VkPhysicalDevice phyDevice);
 
-    void CopyRamDataToGpuBuffer(void*         pSrc,
+    void CopyRamDataToGpuBuffer(const void*   pSrc,
                                 VmaAllocator* pAllocator,
                                 VkBuffer      dstBuffer,
                                 VmaAllocation dstAllocation,
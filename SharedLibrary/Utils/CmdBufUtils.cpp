@@ -1,6 +1,8 @@
 #include "CmdBufUtils.h"
 #include "VulkanDbgUtils.h"
 #include "Application.h"
+#include <algorithm>
+#include <vector>
 
 namespace SharedLib
 {
@@ -82,31 +84,40 @@ namespace SharedLib
         ImgInfo*        pImgInfo,
         VkImage         image)
     {
+        // One level when the image has no mip chain.
+        uint32_t levelCnt = pImgInfo->mipByteOffsets.empty() ? 1 : pImgInfo->mipByteOffsets.size();
+
         // The universal 2D texture SubresourceRange
         VkImageSubresourceRange tex2dSubResRange{};
         {
             tex2dSubResRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
             tex2dSubResRange.baseMipLevel = 0;
-            tex2dSubResRange.levelCount = 1;
+            tex2dSubResRange.levelCount = levelCnt;
             tex2dSubResRange.baseArrayLayer = 0;
             tex2dSubResRange.layerCount = 1;
         }
 
-        VkBufferImageCopy tex2dBufToImgCopy{};
+        // One copy per mip level from its offset in the tightly packed data.
+        std::vector<VkBufferImageCopy> tex2dBufToImgCopies(levelCnt);
+        for (uint32_t level = 0; level < levelCnt; level++)
         {
             VkExtent3D extent{};
             {
-                extent.width = pImgInfo->pixWidth;
-                extent.height = pImgInfo->pixWidth;
+                extent.width = std::max(pImgInfo->pixWidth >> level, 1u);
+                extent.height = std::max(pImgInfo->pixHeight >> level, 1u);
                 extent.depth = 1;
             }
 
-            tex2dBufToImgCopy.bufferRowLength = extent.width;
-            tex2dBufToImgCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            tex2dBufToImgCopy.imageSubresource.mipLevel = 0;
-            tex2dBufToImgCopy.imageSubresource.baseArrayLayer = 0;
-            tex2dBufToImgCopy.imageSubresource.layerCount = 1;
-            tex2dBufToImgCopy.imageExtent = extent;
+            VkBufferImageCopy& tex2dBufToImgCopy = tex2dBufToImgCopies[level];
+            {
+                tex2dBufToImgCopy.bufferOffset = (levelCnt == 1) ? 0 : pImgInfo->mipByteOffsets[level];
+                tex2dBufToImgCopy.bufferRowLength = 0; // Tightly packed, also in the blocks of a compressed format.
+                tex2dBufToImgCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                tex2dBufToImgCopy.imageSubresource.mipLevel = level;
+                tex2dBufToImgCopy.imageSubresource.baseArrayLayer = 0;
+                tex2dBufToImgCopy.imageSubresource.layerCount = 1;
+                tex2dBufToImgCopy.imageExtent = extent;
+            }
         }
 
         SharedLib::SendImgDataToGpu(cmdBuffer,
@@ -117,14 +128,12 @@ namespace SharedLib
                                     image,
                                     tex2dSubResRange,
                                     VK_IMAGE_LAYOUT_UNDEFINED,
-                                    tex2dBufToImgCopy,
+                                    tex2dBufToImgCopies.data(),
+                                    tex2dBufToImgCopies.size(),
                                     allocator);
     }
 
     // ================================================================================================================
-    // The staging buffer has to be freed after the copy finishes, so this func has to control a fence.
-    // Transfer the dstImg to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL -- Change it to the shader read optimal.
-    // TODO: I need to cleanup code that transfer it from dst optimal to shader read optimal barriers.
     void SendImgDataToGpu(
         VkCommandBuffer         cmdBuffer,
         VkDevice                device,
@@ -136,6 +145,36 @@ namespace SharedLib
         VkImageLayout           dstImgCurrentLayout,
         VkBufferImageCopy       bufToImgCopyInfo,
         VmaAllocator            allocator)
+    {
+        SendImgDataToGpu(cmdBuffer,
+                         device,
+                         gfxQueue,
+                         pData,
+                         bytesCnt,
+                         dstImg,
+                         subResRange,
+                         dstImgCurrentLayout,
+                         &bufToImgCopyInfo,
+                         1,
+                         allocator);
+    }
+
+    // ================================================================================================================
+    // The staging buffer has to be freed after the copy finishes, so this func has to control a fence.
+    // Transfer the dstImg to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL -- Change it to the shader read optimal.
+    // TODO: I need to cleanup code that transfer it from dst optimal to shader read optimal barriers.
+    void SendImgDataToGpu(
+        VkCommandBuffer          cmdBuffer,
+        VkDevice                 device,
+        VkQueue                  gfxQueue,
+        void*                    pData,
+        uint32_t                 bytesCnt,
+        VkImage                  dstImg,
+        VkImageSubresourceRange  subResRange,
+        VkImageLayout            dstImgCurrentLayout,
+        const VkBufferImageCopy* pBufToImgCopyInfos,
+        uint32_t                 copyInfoCnt,
+        VmaAllocator             allocator)
     {
         // Create the staging buffer resources
         VkBuffer stagingBuffer;
@@ -205,7 +244,7 @@ namespace SharedLib
             stagingBuffer,
             dstImg,
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1, &bufToImgCopyInfo);
+            copyInfoCnt, pBufToImgCopyInfos);
 
         // Transform the layout of the image to shader read optimal
         VkImageMemoryBarrier cpDstToRdOpt = undefToDstBarrier;
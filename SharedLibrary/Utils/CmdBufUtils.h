@@ -16,7 +16,8 @@ namespace SharedLib
                              VkImageLayout newLayout,
                              VkImageSubresourceRange subResRange);
 
-    // A helper function to send 2D image data to the GPU. Block the thread until the data is sent.
+    // A helper function to send 2D image data to the GPU. Block the thread until the data is sent. All the mip levels
+    // in the pImgInfo are sent, so the image must have at least as many levels.
     void Send2dImgDataToGpu(
         VkCommandBuffer cmdBuffer,
         VkDevice        device,
@@ -37,6 +38,19 @@ namespace SharedLib
                           VkBufferImageCopy bufToImgCopyInfo,
                           VmaAllocator allocator);
 
+    // Same as above, with one copy region per mip level or array layer from the same data.
+    void SendImgDataToGpu(VkCommandBuffer          cmdBuffer,
+                          VkDevice                 device,
+                          VkQueue                  gfxQueue,
+                          void*                    pData,
+                          uint32_t                 bytesCnt,
+                          VkImage                  dstImg,
+                          VkImageSubresourceRange  subResRange,
+                          VkImageLayout            dstImgCurrentLayout,
+                          const VkBufferImageCopy* pBufToImgCopyInfos,
+                          uint32_t                 copyInfoCnt,
+                          VmaAllocator             allocator);
+
     // The output color is always a 3 channels -- RGB.
     // The input image is always 4 channels -- RGBA.
     // Always 32 bits for each channels.
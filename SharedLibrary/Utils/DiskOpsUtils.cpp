@@ -1,6 +1,18 @@
 #include "DiskOpsUtils.h"
 #include <iostream>
 #include <fstream>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -78,4 +90,147 @@ namespace SharedLib
         oData.resize(size); // << resize not reserve
         ifd.read(oData.data(), size);
     }
+
+    // ================================================================================================================
+    bool WriteBinaryFileAtomic(
+        const std::string& namePath,
+        const void*        pData,
+        uint64_t           byteCnt)
+    {
+        std::string tmpNamePath = namePath + ".tmp";
+        {
+            std::ofstream ofd(tmpNamePath, std::ios::binary | std::ios::trunc);
+            if (!ofd.is_open())
+            {
+                return false;
+            }
+
+            ofd.write(static_cast<const char*>(pData), byteCnt);
+            if (!ofd.good())
+            {
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmpNamePath, namePath, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tmpNamePath, ec);
+            return false;
+        }
+
+        return true;
+    }
+
+    // ================================================================================================================
+    MappedFile::MappedFile()
+        : m_pData(nullptr),
+          m_size(0),
+          m_fileHandle(nullptr),
+          m_mappingHandle(nullptr),
+          m_fd(-1)
+    {}
+
+    // ================================================================================================================
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    // ================================================================================================================
+    bool MappedFile::Open(
+        const std::string& namePath)
+    {
+        Close();
+
+#ifdef _WIN32
+        HANDLE fileHandle = CreateFileA(namePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        m_fileHandle = fileHandle;
+
+        LARGE_INTEGER fileSize{};
+        if ((GetFileSizeEx(fileHandle, &fileSize) == FALSE) || (fileSize.QuadPart == 0))
+        {
+            Close();
+            return false;
+        }
+        m_size = fileSize.QuadPart;
+
+        m_mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mappingHandle == nullptr)
+        {
+            Close();
+            return false;
+        }
+
+        m_pData = static_cast<const uint8_t*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+        m_fd = open(namePath.c_str(), O_RDONLY);
+        if (m_fd < 0)
+        {
+            return false;
+        }
+
+        struct stat fileStat{};
+        if ((fstat(m_fd, &fileStat) != 0) || (fileStat.st_size == 0))
+        {
+            Close();
+            return false;
+        }
+        m_size = fileStat.st_size;
+
+        void* pMapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        m_pData = (pMapped == MAP_FAILED) ? nullptr : static_cast<const uint8_t*>(pMapped);
+#endif
+
+        if (m_pData == nullptr)
+        {
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    // ================================================================================================================
+    void MappedFile::Close()
+    {
+#ifdef _WIN32
+        if (m_pData != nullptr)
+        {
+            UnmapViewOfFile(m_pData);
+        }
+
+        if (m_mappingHandle != nullptr)
+        {
+            CloseHandle(m_mappingHandle);
+        }
+
+        if (m_fileHandle != nullptr)
+        {
+            CloseHandle(m_fileHandle);
+        }
+#else
+        if (m_pData != nullptr)
+        {
+            munmap(const_cast<uint8_t*>(m_pData), m_size);
+        }
+
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+        }
+#endif
+
+        m_pData         = nullptr;
+        m_size          = 0;
+        m_fileHandle    = nullptr;
+        m_mappingHandle = nullptr;
+        m_fd            = -1;
+    }
 }
\ No newline at end of file
@@ -1,14 +1,46 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <cstdint>
 
 namespace SharedLib
 {
+    // Read-only memory mapping of a whole file. The OS pages the file in on demand, so large source files that are only
+    // parsed or hashed don't need to be read into a temporary buffer first. The mapping is released in Close() or the
+    // destructor, so it can't be copied.
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool Open(const std::string& namePath);
+        void Close();
+
+        const uint8_t* GetData() const { return m_pData; }
+        uint64_t       GetSize() const { return m_size; }
+
+    private:
+        const uint8_t* m_pData;
+        uint64_t       m_size;
+
+        void* m_fileHandle;    // HANDLE on Windows.
+        void* m_mappingHandle; // HANDLE on Windows. Unused on other platforms.
+        int   m_fd;            // File descriptor on other platforms.
+    };
+
     float* ReadImg(const std::string& namePath, int& components, int& width, int& height);
     void SaveImgHdr(const std::string& namePath, uint32_t width, uint32_t height, uint32_t components, float* pData);
     void SaveImgPng(const std::string& namePath, uint32_t width, uint32_t height, uint32_t components, void* pData, uint32_t strideInByte);
     void ReadBinaryFile(const std::string& namePath, std::vector<char>& oData);
 
+    // Write the data into a temporary file and then rename it to the target, so an interrupted write never leaves a
+    // half written file behind.
+    bool WriteBinaryFileAtomic(const std::string& namePath, const void* pData, uint64_t byteCnt);
+
     // TODO: An interface to read obj/gltf.
     static void ReadModel() {};
 }
\ No newline at end of file
@@ -1,12 +1,15 @@
 #include "GltfUtils.h"
 #include "MathUtils.h"
 #include <vector>
+#include <limits>
+#include <algorithm>
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/quaternion.hpp>
-#include <glm/gtc/matrix_access.hpp>
-#include <glm/ext/quaternion_common.hpp>
-#include <glm/ext/quaternion_float.hpp>
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SHARED_LIB_SSE2 1
+#include <emmintrin.h>
+#else
+#define SHARED_LIB_SSE2 0
+#endif
 
 namespace SharedLib
 {
@@ -24,16 +27,19 @@ namespace SharedLib
             aComponentEleBytesCnt = sizeof(float);
             break;
         case TINYGLTF_COMPONENT_TYPE_INT:
-            aComponentEleBytesCnt = sizeof(int);
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+            aComponentEleBytesCnt = sizeof(uint32_t);
             break;
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
         case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-            aComponentEleBytesCnt = sizeof(unsigned short);
+            aComponentEleBytesCnt = sizeof(uint16_t);
             break;
         case TINYGLTF_COMPONENT_TYPE_BYTE:
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
             aComponentEleBytesCnt = 1;
             break;
         default:
-            assert(false, "Invalid component type.");
+            assert(false && "Invalid component type.");
         }
         return aComponentEleBytesCnt;
     }
@@ -55,13 +61,17 @@ namespace SharedLib
             componentEleCnt = 3;
             break;
         case TINYGLTF_TYPE_VEC4:
+        case TINYGLTF_TYPE_MAT2:
             componentEleCnt = 4;
             break;
+        case TINYGLTF_TYPE_MAT3:
+            componentEleCnt = 9;
+            break;
         case TINYGLTF_TYPE_MAT4:
             componentEleCnt = 16;
             break;
         default:
-            assert(false, "Invalid accessor type.");
+            assert(false && "Invalid accessor type.");
         }
 
         return componentEleCnt;
@@ -79,171 +89,479 @@ namespace SharedLib
     }
 
     // ================================================================================================================
-    void ReadOutAccessorData(
-        void*                              pDst,
-        const tinygltf::Accessor&          accessor,
-        std::vector<tinygltf::BufferView>& bufferViews,
-        std::vector<tinygltf::Buffer>&     buffers)
+    const void* GetPackedAccessorData(
+        const tinygltf::Accessor&                accessor,
+        const std::vector<tinygltf::BufferView>& bufferViews,
+        const std::vector<tinygltf::Buffer>&     buffers)
     {
-        auto&    bufferView = bufferViews[accessor.bufferView];
-        auto&    buffer     = buffers[bufferView.buffer];
-        uint32_t bytesCnt   = GetAccessorDataBytes(accessor);
+        if ((accessor.bufferView < 0) || accessor.sparse.isSparse)
+        {
+            return nullptr;
+        }
 
-        int accessorByteOffset = accessor.byteOffset;
-        int componentCnt       = accessor.count;
+        const auto& bufferView = bufferViews[accessor.bufferView];
+        const auto& buffer     = buffers[bufferView.buffer];
 
-        uint32_t aComponentEleBytesCnt = GetAComponentEleBytesCnt(accessor.componentType);
-        uint32_t componentEleCnt       = GetComponentEleCnt(accessor.type);
-        uint32_t componentBytesCnt     = aComponentEleBytesCnt * componentEleCnt;
+        // A byte stride equal to the element size is as packed as no stride at all.
+        uint32_t eleBytesCnt = GetAComponentEleBytesCnt(accessor.componentType) * GetComponentEleCnt(accessor.type);
+        if ((bufferView.byteStride != 0) && (bufferView.byteStride != eleBytesCnt))
+        {
+            return nullptr;
+        }
 
-        int bufferOffset = accessorByteOffset + bufferView.byteOffset;
-        
-        const unsigned char* pBufferData = buffers[bufferView.buffer].data.data();
+        uint64_t bufferOffset = uint64_t(bufferView.byteOffset) + accessor.byteOffset;
+        if (bufferOffset + GetAccessorDataBytes(accessor) > buffer.data.size())
+        {
+            return nullptr;
+        }
 
-        if (bufferView.byteStride == 0)
+        return buffer.data.data() + bufferOffset;
+    }
+
+    // ================================================================================================================
+    // Copy eleCnt elements of EleBytesCnt bytes each from a strided source into a packed destination. The fixed element
+    // size lets the copy turn into a few register moves instead of a memcpy call per element.
+    template<uint32_t EleBytesCnt>
+    static void DeinterleaveElements(
+        uint8_t*       pDst,
+        const uint8_t* pSrc,
+        uint32_t       srcStride,
+        uint32_t       eleCnt)
+    {
+        for (uint32_t i = 0; i < eleCnt; i++)
         {
-            memcpy(pDst, &pBufferData[bufferOffset], bytesCnt);
+#if SHARED_LIB_SSE2
+            if constexpr (EleBytesCnt == 16)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc)));
+            }
+            else if constexpr (EleBytesCnt == 8)
+            {
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst), _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc)));
+            }
+            else if constexpr (EleBytesCnt == 12)
+            {
+                // A vec3 of floats, e.g. a position or a normal. Every element but the last one moves 16 bytes, whose
+                // extra 4 bytes are still inside the next element in both the source and the destination, and the
+                // next element overwrites them. The last element moves 8 + 4 bytes.
+                if (i + 1 < eleCnt)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc)));
+                }
+                else
+                {
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst), _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc)));
+                    memcpy(pDst + 8, pSrc + 8, 4);
+                }
+            }
+            else
+#endif
+            {
+                memcpy(pDst, pSrc, EleBytesCnt);
+            }
+
+            pDst += EleBytesCnt;
+            pSrc += srcStride;
         }
-        else
+    }
+
+    // ================================================================================================================
+    // Interleaved vertex buffers are de-interleaved straight into the destination in one pass.
+    static void DeinterleaveAccessorElements(
+        uint8_t*       pDstBytes,
+        const uint8_t* pSrc,
+        uint32_t       srcStride,
+        uint32_t       componentBytesCnt,
+        uint32_t       componentCnt)
+    {
+        switch (componentBytesCnt)
         {
-            std::vector<uint8_t> tmpData(bytesCnt, 0);
-            for(uint32_t i = 0; i < componentCnt; i++)
+        case 4:
+            DeinterleaveElements<4>(pDstBytes, pSrc, srcStride, componentCnt);
+            break;
+        case 8:
+            DeinterleaveElements<8>(pDstBytes, pSrc, srcStride, componentCnt);
+            break;
+        case 12:
+            DeinterleaveElements<12>(pDstBytes, pSrc, srcStride, componentCnt);
+            break;
+        case 16:
+            DeinterleaveElements<16>(pDstBytes, pSrc, srcStride, componentCnt);
+            break;
+        default:
+            for (uint32_t i = 0; i < componentCnt; i++)
             {
-                int srcByteOffset = bufferOffset + i * bufferView.byteStride;
-                int dstByteOffset = i * componentBytesCnt;
-                memcpy(&tmpData[dstByteOffset], pBufferData + srcByteOffset, componentBytesCnt);
+                memcpy(pDstBytes + i * componentBytesCnt, pSrc + uint64_t(i) * srcStride, componentBytesCnt);
             }
-            memcpy(pDst, tmpData.data(), tmpData.size());
         }
     }
 
     // ================================================================================================================
-    // TODO: We maybe able to abstract the local transformation code out so that we can reuse the code.
-    void GetNodeAndChildrenModelMats(const std::vector<tinygltf::Node>& nodes,
-                                     float                              parentChainedTransformationMat[16],
-                                     uint32_t                           curNodeIdx,
-                                     std::vector<float>&                matsVec)
+    // The sparse accessor's element indices, which the glTF requires to be strictly increasing and below the count.
+    static void ReadSparseIndices(
+        const tinygltf::Accessor&                accessor,
+        const std::vector<tinygltf::BufferView>& bufferViews,
+        const std::vector<tinygltf::Buffer>&     buffers,
+        std::vector<uint32_t>&                   oIndices)
     {
-        const tinygltf::Node& node = nodes[curNodeIdx];
-        int matStartOffset = curNodeIdx * 16;
-        float localTransformMat[16] = {};
+        const auto& sparseIndices = accessor.sparse.indices;
+        const auto& bufferView    = bufferViews[sparseIndices.bufferView];
+        const auto& buffer        = buffers[bufferView.buffer];
 
-        if (node.matrix.size() != 0)
+        const uint8_t* pSrc = buffer.data.data() + bufferView.byteOffset + sparseIndices.byteOffset;
+        uint32_t       idxBytesCnt = GetAComponentEleBytesCnt(sparseIndices.componentType);
+
+        oIndices.resize(accessor.sparse.count);
+        for (uint32_t i = 0; i < oIndices.size(); i++)
         {
-            // This node's local transformation is represented by a matrix.
-            // The TinyGltf Mat's ele are double, but we want float, so we cannot directly memcpy.
-            for (int eleIdx = 0; eleIdx < 16; eleIdx++)
+            uint32_t idx = 0;
+            switch (sparseIndices.componentType)
             {
-                localTransformMat[eleIdx] = node.matrix[eleIdx];
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                idx = pSrc[i];
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            {
+                uint16_t idx16;
+                memcpy(&idx16, pSrc + i * idxBytesCnt, sizeof(idx16));
+                idx = idx16;
+                break;
+            }
+            default:
+                memcpy(&idx, pSrc + i * idxBytesCnt, sizeof(idx));
             }
 
-            SharedLib::MatTranspose(localTransformMat, 4);
+            assert((idx < accessor.count) && "A sparse accessor's index is out of its element range.");
+            oIndices[i] = idx;
+        }
+    }
+
+    // ================================================================================================================
+    // The sparse accessor's substitute values, packed like the accessor's elements.
+    static const uint8_t* GetSparseValues(
+        const tinygltf::Accessor&                accessor,
+        const std::vector<tinygltf::BufferView>& bufferViews,
+        const std::vector<tinygltf::Buffer>&     buffers)
+    {
+        const auto& sparseValues = accessor.sparse.values;
+        const auto& bufferView   = bufferViews[sparseValues.bufferView];
+        return buffers[bufferView.buffer].data.data() + bufferView.byteOffset + sparseValues.byteOffset;
+    }
+
+    // ================================================================================================================
+    // Overwrites the packed pDst's elements of eleBytesCnt bytes at the indices with the packed pValues.
+    static void ScatterSparseElements(
+        uint8_t*                     pDst,
+        const uint8_t*               pValues,
+        uint32_t                     eleBytesCnt,
+        const std::vector<uint32_t>& indices)
+    {
+        for (uint32_t i = 0; i < indices.size(); i++)
+        {
+            memcpy(pDst + uint64_t(indices[i]) * eleBytesCnt, pValues + uint64_t(i) * eleBytesCnt, eleBytesCnt);
+        }
+    }
+
+    // ================================================================================================================
+    void ReadOutAccessorData(
+        void*                                    pDst,
+        const tinygltf::Accessor&                accessor,
+        const std::vector<tinygltf::BufferView>& bufferViews,
+        const std::vector<tinygltf::Buffer>&     buffers)
+    {
+        uint32_t bytesCnt          = GetAccessorDataBytes(accessor);
+        uint32_t componentCnt      = accessor.count;
+        uint32_t componentBytesCnt = GetAComponentEleBytesCnt(accessor.componentType) * GetComponentEleCnt(accessor.type);
+        uint8_t* pDstBytes         = static_cast<uint8_t*>(pDst);
+
+        // Packed data doesn't need the per-element copy. An accessor without a buffer view is all zeros, apart from
+        // its sparse elements.
+        const void* pPackedData = GetPackedAccessorData(accessor, bufferViews, buffers);
+        if (pPackedData != nullptr)
+        {
+            memcpy(pDst, pPackedData, bytesCnt);
+        }
+        else if (accessor.bufferView < 0)
+        {
+            memset(pDst, 0, bytesCnt);
         }
         else
         {
-            // This node's local transformation is represented by TRS params.
-            // Set joint translation from the gltf
-            float localTranslation[3];
-            if (node.translation.size() != 0)
+            const auto& bufferView = bufferViews[accessor.bufferView];
+            const auto& buffer     = buffers[bufferView.buffer];
+
+            uint32_t       srcStride = bufferView.byteStride == 0 ? componentBytesCnt : bufferView.byteStride;
+            const uint8_t* pSrc      = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
+            DeinterleaveAccessorElements(pDstBytes, pSrc, srcStride, componentBytesCnt, componentCnt);
+        }
+
+        if (accessor.sparse.isSparse)
+        {
+            std::vector<uint32_t> sparseIndices;
+            ReadSparseIndices(accessor, bufferViews, buffers, sparseIndices);
+            ScatterSparseElements(pDstBytes,
+                                  GetSparseValues(accessor, bufferViews, buffers),
+                                  componentBytesCnt,
+                                  sparseIndices);
+        }
+    }
+
+    // ================================================================================================================
+    // Convert the components to float in the glTF way. Normalized integers map to [0, 1] or [-1, 1], where the signed
+    // ones are clamped so that both -128 and -127 map to -1. See the "Encoding quantized data" part of
+    // https://github.com/KhronosGroup/glTF/tree/main/extensions/2.0/Khronos/KHR_mesh_quantization
+    template<typename T>
+    static void ConvertComponentsToFloat(
+        float*         pDst,
+        const uint8_t* pSrc,
+        uint32_t       srcStride,
+        uint32_t       componentEleCnt,
+        uint32_t       eleCnt,
+        bool           normalized)
+    {
+        const float scale    = normalized ? 1.f / float(std::numeric_limits<T>::max()) : 1.f;
+        const float minValue = (normalized && std::is_signed<T>::value) ? -1.f : -std::numeric_limits<float>::max();
+
+        if (srcStride == componentEleCnt * sizeof(T))
+        {
+            // The components are contiguous, so they are converted as one flat array.
+            const T* pSrcComponents = reinterpret_cast<const T*>(pSrc);
+            uint64_t totalCnt = uint64_t(eleCnt) * componentEleCnt;
+            uint64_t i = 0;
+
+#if SHARED_LIB_SSE2
+            if constexpr (sizeof(T) <= 2)
+            {
+                const __m128 scale4    = _mm_set1_ps(scale);
+                const __m128 minValue4 = _mm_set1_ps(minValue);
+                const __m128i zero     = _mm_setzero_si128();
+                for (; i + 8 <= totalCnt; i += 8)
+                {
+                    // Widen 8 components to 2 x 4 int32.
+                    __m128i src16;
+                    if constexpr (sizeof(T) == 1)
+                    {
+                        __m128i src8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrcComponents + i));
+                        src16 = std::is_signed<T>::value ? _mm_srai_epi16(_mm_unpacklo_epi8(src8, src8), 8)
+                                                         : _mm_unpacklo_epi8(src8, zero);
+                    }
+                    else
+                    {
+                        src16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrcComponents + i));
+                    }
+
+                    __m128i lo32 = std::is_signed<T>::value ? _mm_srai_epi32(_mm_unpacklo_epi16(src16, src16), 16)
+                                                            : _mm_unpacklo_epi16(src16, zero);
+                    __m128i hi32 = std::is_signed<T>::value ? _mm_srai_epi32(_mm_unpackhi_epi16(src16, src16), 16)
+                                                            : _mm_unpackhi_epi16(src16, zero);
+
+                    __m128 lo = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo32), scale4), minValue4);
+                    __m128 hi = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi32), scale4), minValue4);
+                    _mm_storeu_ps(pDst + i, lo);
+                    _mm_storeu_ps(pDst + i + 4, hi);
+                }
+            }
+#endif
+
+            for (; i < totalCnt; i++)
+            {
+                pDst[i] = std::max(float(pSrcComponents[i]) * scale, minValue);
+            }
+        }
+        else if (componentEleCnt == 3)
+        {
+            // The interleaved vec3s, e.g. the quantized positions and normals padded to 4 components, get a fixed
+            // count loop instead of the generic one below.
+            for (uint32_t i = 0; i < eleCnt; i++)
             {
-                localTranslation[0] = node.translation[0];
-                localTranslation[1] = node.translation[1];
-                localTranslation[2] = node.translation[2];
+                const uint8_t* pSrcEle = pSrc + uint64_t(i) * srcStride;
+                T components[3];
+                memcpy(components, pSrcEle, sizeof(components));
+                pDst[3 * i]     = std::max(float(components[0]) * scale, minValue);
+                pDst[3 * i + 1] = std::max(float(components[1]) * scale, minValue);
+                pDst[3 * i + 2] = std::max(float(components[2]) * scale, minValue);
             }
-            else
+        }
+        else
+        {
+            for (uint32_t i = 0; i < eleCnt; i++)
             {
-                localTranslation[0] = 0.f;
-                localTranslation[1] = 0.f;
-                localTranslation[2] = 0.f;
+                const uint8_t* pSrcEle = pSrc + uint64_t(i) * srcStride;
+                for (uint32_t c = 0; c < componentEleCnt; c++)
+                {
+                    T component;
+                    memcpy(&component, pSrcEle + c * sizeof(T), sizeof(T));
+                    pDst[i * componentEleCnt + c] = std::max(float(component) * scale, minValue);
+                }
             }
+        }
+    }
+
+    // ================================================================================================================
+    static void ConvertAccessorComponentsToFloat(
+        float*                    pDst,
+        const uint8_t*            pSrc,
+        uint32_t                  srcStride,
+        const tinygltf::Accessor& accessor,
+        uint32_t                  eleCnt)
+    {
+        uint32_t componentEleCnt = GetComponentEleCnt(accessor.type);
+        switch (accessor.componentType)
+        {
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
+            ConvertComponentsToFloat<int8_t>(pDst, pSrc, srcStride, componentEleCnt, eleCnt, accessor.normalized);
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            ConvertComponentsToFloat<uint8_t>(pDst, pSrc, srcStride, componentEleCnt, eleCnt, accessor.normalized);
+            break;
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
+            ConvertComponentsToFloat<int16_t>(pDst, pSrc, srcStride, componentEleCnt, eleCnt, accessor.normalized);
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            ConvertComponentsToFloat<uint16_t>(pDst, pSrc, srcStride, componentEleCnt, eleCnt, accessor.normalized);
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+            ConvertComponentsToFloat<uint32_t>(pDst, pSrc, srcStride, componentEleCnt, eleCnt, accessor.normalized);
+            break;
+        default:
+            assert(false && "The component type cannot be converted to float.");
+        }
+    }
+
+    // ================================================================================================================
+    void ReadOutAccessorDataAsFloat(
+        float*                                   pDst,
+        const tinygltf::Accessor&                accessor,
+        const std::vector<tinygltf::BufferView>& bufferViews,
+        const std::vector<tinygltf::Buffer>&     buffers)
+    {
+        if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+        {
+            ReadOutAccessorData(pDst, accessor, bufferViews, buffers);
+            return;
+        }
+
+        uint32_t componentEleCnt   = GetComponentEleCnt(accessor.type);
+        uint32_t componentBytesCnt = GetAComponentEleBytesCnt(accessor.componentType) * componentEleCnt;
+
+        // An accessor without a buffer view is all zeros, apart from its sparse elements.
+        if (accessor.bufferView < 0)
+        {
+            memset(pDst, 0, uint64_t(accessor.count) * componentEleCnt * sizeof(float));
+        }
+        else
+        {
+            const auto& bufferView = bufferViews[accessor.bufferView];
+            const auto& buffer     = buffers[bufferView.buffer];
 
-            // Set joint rotation from the gltf
-            // GLM's quat's scalar element is the first element but the GLTF's quat scalar element is the last element.
-            // localRotationQuat is a GLM's quat. node.rotation is a GLTF's quat.
-            glm::quat localRotationQuat;
-            if (node.rotation.size() != 0)
+            uint32_t       srcStride = bufferView.byteStride == 0 ? componentBytesCnt : bufferView.byteStride;
+            const uint8_t* pSrc      = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
+            ConvertAccessorComponentsToFloat(pDst, pSrc, srcStride, accessor, accessor.count);
+        }
+
+        if (accessor.sparse.isSparse)
+        {
+            std::vector<uint32_t> sparseIndices;
+            ReadSparseIndices(accessor, bufferViews, buffers, sparseIndices);
+
+            std::vector<float> sparseValues(sparseIndices.size() * componentEleCnt);
+            ConvertAccessorComponentsToFloat(sparseValues.data(),
+                                             GetSparseValues(accessor, bufferViews, buffers),
+                                             componentBytesCnt,
+                                             accessor,
+                                             sparseIndices.size());
+
+            ScatterSparseElements(reinterpret_cast<uint8_t*>(pDst),
+                                  reinterpret_cast<const uint8_t*>(sparseValues.data()),
+                                  componentEleCnt * sizeof(float),
+                                  sparseIndices);
+        }
+    }
+
+    // ================================================================================================================
+    void SetGltfNodeLocalTransform(
+        const tinygltf::Node& node,
+        uint32_t              nodeIdx,
+        TransformHierarchy&   hierarchy)
+    {
+        if (node.matrix.size() != 0)
+        {
+            // The TinyGltf Mat's ele are double and col-major, but we want float and row-major.
+            float localTransformMat[16] = {};
+            for (int eleIdx = 0; eleIdx < 16; eleIdx++)
             {
-                localRotationQuat = glm::quat(node.rotation[3],
-                                              node.rotation[0],
-                                              node.rotation[1],
-                                              node.rotation[2]);
+                localTransformMat[eleIdx] = node.matrix[eleIdx];
             }
-            else
+
+            SharedLib::MatTranspose(localTransformMat, 4);
+            hierarchy.SetLocalMat(nodeIdx, localTransformMat);
+        }
+        else
+        {
+            // Both the gltf and the hierarchy keep the quaternion's scalar element last.
+            float translation[3] = { 0.f, 0.f, 0.f };
+            float rotation[4] = { 0.f, 0.f, 0.f, 1.f };
+            float scale[3] = { 1.f, 1.f, 1.f };
+            for (uint32_t i = 0; i < node.translation.size(); i++)
             {
-                localRotationQuat = glm::quat(1.f, 0.f, 0.f, 0.f);
+                translation[i] = node.translation[i];
             }
 
-            // Set joint scaling from the gltf
-            float localScale[3];
-            if (node.scale.size() != 0)
+            for (uint32_t i = 0; i < node.rotation.size(); i++)
             {
-                localScale[0] = node.scale[0];
-                localScale[1] = node.scale[1];
-                localScale[2] = node.scale[2];
+                rotation[i] = node.rotation[i];
             }
-            else
+
+            for (uint32_t i = 0; i < node.scale.size(); i++)
             {
-                localScale[0] = 1.f;
-                localScale[1] = 1.f;
-                localScale[2] = 1.f;
+                scale[i] = node.scale[i];
             }
 
-            glm::mat4 rotationMatrix = glm::toMat4(localRotationQuat);
-            glm::vec4 rotRow0 = glm::row(rotationMatrix, 0);
-            glm::vec4 rotRow1 = glm::row(rotationMatrix, 1);
-            glm::vec4 rotRow2 = glm::row(rotationMatrix, 2);
-
-            float localTranslationMat[16] = {
-                1.f, 0.f, 0.f, localTranslation[0],
-                0.f, 1.f, 0.f, localTranslation[1],
-                0.f, 0.f, 1.f, localTranslation[2],
-                0.f, 0.f, 0.f, 1.f
-            };
-
-            float localRotationMat[16] = {
-                rotRow0[0], rotRow0[1], rotRow0[2], 0.f,
-                rotRow1[0], rotRow1[1], rotRow1[2], 0.f,
-                rotRow2[0], rotRow2[1], rotRow2[2], 0.f,
-                0.f,        0.f,        0.f,        1.f
-            };
-
-            float localScaleMat[16] = {
-                localScale[0], 0.f,                  0.f,                  0.f,
-                0.f,           localScale[1],        0.f,                  0.f,
-                0.f,           0.f,                  localScale[2],        0.f,
-                0.f,           0.f,                  0.f,                  1.f
-            };
-
-            float localRSMat[16] = {};
-            MatrixMul4x4(localRotationMat, localScaleMat, localRSMat);
-            MatrixMul4x4(localTranslationMat, localRSMat, localTransformMat);
+            hierarchy.SetLocalTrs(nodeIdx, translation, rotation, scale);
         }
+    }
 
-        float nodeModelMat[16];
-        MatrixMul4x4(parentChainedTransformationMat, localTransformMat, nodeModelMat);
-        memcpy(&matsVec[matStartOffset], nodeModelMat, sizeof(nodeModelMat));
+    // ================================================================================================================
+    void InitGltfTransformHierarchy(
+        const tinygltf::Model& model,
+        TransformHierarchy&    oHierarchy)
+    {
+        std::vector<uint32_t> parentIdxs(model.nodes.size(), TransformHierarchy::InvalidNodeIdx);
+        for (uint32_t i = 0; i < model.nodes.size(); i++)
+        {
+            for (int childNodeIdx : model.nodes[i].children)
+            {
+                parentIdxs[childNodeIdx] = i;
+            }
+        }
 
-        for (int childNodeId : node.children)
+        oHierarchy.Init(parentIdxs);
+        for (uint32_t i = 0; i < model.nodes.size(); i++)
         {
-            GetNodeAndChildrenModelMats(nodes, nodeModelMat, childNodeId, matsVec);
+            SetGltfNodeLocalTransform(model.nodes[i], i, oHierarchy);
         }
     }
 
     // ================================================================================================================
     void GetNodesModelMats(const tinygltf::Model& model,
-                           std::vector<float>&    matsVec)
+                           std::vector<float>&    matsVec,
+                           int                    sceneIdx)
     {
+        TransformHierarchy hierarchy;
+        InitGltfTransformHierarchy(model, hierarchy);
+        hierarchy.Update();
+
+        // Only the nodes under the scene's roots are written out.
         matsVec.resize(model.nodes.size() * 16);
-        for (auto rootNodeId : model.scenes[0].nodes)
+        std::vector<int> nodeStack(model.scenes[sceneIdx].nodes.begin(), model.scenes[sceneIdx].nodes.end());
+        while (nodeStack.empty() == false)
         {
-            float identityMat[16] = {
-                1.f, 0.f, 0.f, 0.f,
-                0.f, 1.f, 0.f, 0.f,
-                0.f, 0.f, 1.f, 0.f,
-                0.f, 0.f, 0.f, 1.f
-            };
-
-            GetNodeAndChildrenModelMats(model.nodes, identityMat, rootNodeId, matsVec);
+            int nodeIdx = nodeStack.back();
+            nodeStack.pop_back();
+
+            memcpy(&matsVec[nodeIdx * 16], hierarchy.GetWorldMat(nodeIdx), 16 * sizeof(float));
+            const auto& children = model.nodes[nodeIdx].children;
+            nodeStack.insert(nodeStack.end(), children.begin(), children.end());
         }
     }
 
@@ -1,17 +1,89 @@
 #pragma once
 #include <cstdint>
+#include <type_traits>
 #include "tiny_gltf.h"
+#include "../Transform/TransformHierarchy.h"
 
 namespace SharedLib
 {
+    uint32_t GetAComponentEleBytesCnt(int componentType);
+    uint32_t GetComponentEleCnt(int accessorType);
     uint32_t GetAccessorDataBytes(const tinygltf::Accessor& accessor);
 
-    void ReadOutAccessorData(void*                              pDst,
-                             const tinygltf::Accessor&          accessor,
-                             std::vector<tinygltf::BufferView>& bufferViews,
-                             std::vector<tinygltf::Buffer>&     buffers);
+    // A typed read-only view of an accessor's components in place inside the loaded gltf buffer, e.g. a float VEC3
+    // accessor with N elements is viewed as 3N floats. It is only valid while the tinygltf::Model is alive.
+    template<typename T>
+    struct AccessorView
+    {
+        const T* pData  = nullptr;
+        uint64_t eleCnt = 0;
 
-    void GetNodesModelMats(const tinygltf::Model& model, std::vector<float>& matsVec);
+        bool     IsValid() const { return pData != nullptr; }
+        const T* begin() const { return pData; }
+        const T* end() const { return pData + eleCnt; }
+        const T& operator[](uint64_t i) const { return pData[i]; }
+    };
+
+    // Returns the accessor's data if its elements are tightly packed in the buffer view, otherwise nullptr. Sparse
+    // accessors and accessors without a buffer view have no packed data.
+    const void* GetPackedAccessorData(const tinygltf::Accessor&                accessor,
+                                      const std::vector<tinygltf::BufferView>& bufferViews,
+                                      const std::vector<tinygltf::Buffer>&     buffers);
+
+    template<typename T>
+    constexpr int GetGltfComponentType()
+    {
+        if constexpr (std::is_same<T, float>::value)    { return TINYGLTF_COMPONENT_TYPE_FLOAT; }
+        if constexpr (std::is_same<T, uint32_t>::value) { return TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT; }
+        if constexpr (std::is_same<T, uint16_t>::value) { return TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT; }
+        if constexpr (std::is_same<T, int16_t>::value)  { return TINYGLTF_COMPONENT_TYPE_SHORT; }
+        if constexpr (std::is_same<T, uint8_t>::value)  { return TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE; }
+        if constexpr (std::is_same<T, int8_t>::value)   { return TINYGLTF_COMPONENT_TYPE_BYTE; }
+        return -1;
+    }
+
+    // The view is invalid if reading the accessor as T needs any conversion (a different or normalized component type)
+    // or a de-interleave. Then the caller has to fall back to the ReadOutAccessorData(...).
+    template<typename T>
+    AccessorView<T> GetAccessorView(const tinygltf::Accessor&                accessor,
+                                    const std::vector<tinygltf::BufferView>& bufferViews,
+                                    const std::vector<tinygltf::Buffer>&     buffers)
+    {
+        AccessorView<T> view;
+        if ((accessor.componentType == GetGltfComponentType<T>()) && (accessor.normalized == false))
+        {
+            const void* pData = GetPackedAccessorData(accessor, bufferViews, buffers);
+            if ((pData != nullptr) && (reinterpret_cast<uintptr_t>(pData) % alignof(T) == 0))
+            {
+                view.pData  = static_cast<const T*>(pData);
+                view.eleCnt = uint64_t(accessor.count) * GetComponentEleCnt(accessor.type);
+            }
+        }
+        return view;
+    }
+
+    // Copy the accessor's elements as they are into the packed pDst. Interleaved data is de-interleaved in one pass. An
+    // accessor without a buffer view reads as zeros, and the sparse accessors' substitute elements are applied on top.
+    void ReadOutAccessorData(void*                                    pDst,
+                             const tinygltf::Accessor&                accessor,
+                             const std::vector<tinygltf::BufferView>& bufferViews,
+                             const std::vector<tinygltf::Buffer>&     buffers);
+
+    // Same as the ReadOutAccessorData(...), but every component is converted to float. It handles the quantized
+    // (KHR_mesh_quantization) attributes, e.g. normalized byte normals or normalized unsigned short uvs.
+    void ReadOutAccessorDataAsFloat(float*                                   pDst,
+                                    const tinygltf::Accessor&                accessor,
+                                    const std::vector<tinygltf::BufferView>& bufferViews,
+                                    const std::vector<tinygltf::Buffer>&     buffers);
+
+    // Sets the node's local matrix or TRS in the hierarchy. The missing TRS parts are the identity.
+    void SetGltfNodeLocalTransform(const tinygltf::Node& node, uint32_t nodeIdx, TransformHierarchy& hierarchy);
+
+    // A hierarchy of all the gltf nodes, indexed by the gltf node indices, with their local transformations set.
+    void InitGltfTransformHierarchy(const tinygltf::Model& model, TransformHierarchy& oHierarchy);
+
+    // Row-major model matrices of all the nodes under the scene. Nodes that are not in the scene are left untouched.
+    void GetNodesModelMats(const tinygltf::Model& model, std::vector<float>& matsVec, int sceneIdx = 0);
 
     int GetArmatureNodeIdx(const tinygltf::Model& model);
 }
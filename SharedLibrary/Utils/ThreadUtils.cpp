@@ -0,0 +1,164 @@
+#include "ThreadUtils.h"
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+namespace SharedLib
+{
+    // ================================================================================================================
+    ThreadPool::ThreadPool(
+        uint32_t threadCnt)
+        : m_busyWorkerCnt(0),
+          m_stop(false)
+    {
+        if (threadCnt == 0)
+        {
+            threadCnt = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        m_workers.reserve(threadCnt);
+        for (uint32_t i = 0; i < threadCnt; i++)
+        {
+            m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+        }
+    }
+
+    // ================================================================================================================
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_taskCv.notify_all();
+
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    // ================================================================================================================
+    void ThreadPool::Submit(
+        const std::function<void()>& task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push(task);
+        }
+        m_taskCv.notify_one();
+    }
+
+    // ================================================================================================================
+    void ThreadPool::WaitIdle()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idleCv.wait(lock, [this]() { return m_tasks.empty() && (m_busyWorkerCnt == 0); });
+    }
+
+    // ================================================================================================================
+    void ThreadPool::WorkerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_taskCv.wait(lock, [this]() { return m_stop || (m_tasks.empty() == false); });
+
+                if (m_stop && m_tasks.empty())
+                {
+                    return;
+                }
+
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+                m_busyWorkerCnt++;
+            }
+
+            task();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_busyWorkerCnt--;
+                if (m_tasks.empty() && (m_busyWorkerCnt == 0))
+                {
+                    m_idleCv.notify_all();
+                }
+            }
+        }
+    }
+
+    // ================================================================================================================
+    // The indices are handed out through an atomic counter, so the tasks' execution order is not deterministic but
+    // each index is processed exactly once. Callers that need a deterministic output should write the result of the
+    // index i into the slot i of a pre-sized container.
+    void ThreadPool::ParallelFor(
+        uint32_t                             taskCnt,
+        const std::function<void(uint32_t)>& func)
+    {
+        if (taskCnt == 0)
+        {
+            return;
+        }
+
+        if (taskCnt == 1 || m_workers.size() <= 1)
+        {
+            for (uint32_t i = 0; i < taskCnt; i++)
+            {
+                func(i);
+            }
+            return;
+        }
+
+        // The helper tasks may still sit in the queue after all the indices are finished, so the shared state has to
+        // be kept alive by them.
+        struct ParallelForState
+        {
+            std::atomic<uint32_t>   nextIdx;
+            uint32_t                finishedCnt;
+            std::mutex              mutex;
+            std::condition_variable doneCv;
+        };
+
+        auto pState = std::make_shared<ParallelForState>();
+        pState->nextIdx = 0;
+        pState->finishedCnt = 0;
+
+        auto pfnRunIndices = [pState, taskCnt, func]() {
+            uint32_t localFinishedCnt = 0;
+            while (true)
+            {
+                uint32_t idx = pState->nextIdx.fetch_add(1);
+                if (idx >= taskCnt)
+                {
+                    break;
+                }
+                func(idx);
+                localFinishedCnt++;
+            }
+
+            if (localFinishedCnt > 0)
+            {
+                std::lock_guard<std::mutex> lock(pState->mutex);
+                pState->finishedCnt += localFinishedCnt;
+                if (pState->finishedCnt == taskCnt)
+                {
+                    pState->doneCv.notify_all();
+                }
+            }
+        };
+
+        uint32_t helperCnt = std::min<uint32_t>(m_workers.size(), taskCnt - 1);
+        for (uint32_t i = 0; i < helperCnt; i++)
+        {
+            Submit(pfnRunIndices);
+        }
+
+        // The calling thread works on the indices as well.
+        pfnRunIndices();
+
+        std::unique_lock<std::mutex> lock(pState->mutex);
+        pState->doneCv.wait(lock, [pState, taskCnt]() { return pState->finishedCnt == taskCnt; });
+    }
+}
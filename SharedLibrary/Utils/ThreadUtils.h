@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace SharedLib
+{
+    // A fixed size worker pool. The workers are created in the constructor and joined in the destructor.
+    // - Submit(...) pushes a fire-and-forget task. WaitIdle() blocks until the queue is empty and all workers are idle.
+    // - ParallelFor(...) splits [0, taskCnt) across the workers and blocks until all the indices are processed. The
+    //   calling thread also works on the indices, so it is safe to call it from a worker task.
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(uint32_t threadCnt = 0); // 0 means std::thread::hardware_concurrency().
+        ~ThreadPool();
+
+        void Submit(const std::function<void()>& task);
+        void WaitIdle();
+
+        void ParallelFor(uint32_t taskCnt, const std::function<void(uint32_t)>& func);
+
+        uint32_t GetThreadCnt() const { return m_workers.size(); }
+
+    private:
+        void WorkerLoop();
+
+        std::vector<std::thread>          m_workers;
+        std::queue<std::function<void()>> m_tasks;
+
+        std::mutex              m_mutex;
+        std::condition_variable m_taskCv;
+        std::condition_variable m_idleCv;
+        uint32_t                m_busyWorkerCnt;
+        bool                    m_stop;
+    };
+}
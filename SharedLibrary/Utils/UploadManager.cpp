@@ -0,0 +1,717 @@
+#include "UploadManager.h"
+#include "VulkanDbgUtils.h"
+#include "vk_mem_alloc.h"
+#include <algorithm>
+#include <cstring>
+
+namespace SharedLib
+{
+    // ================================================================================================================
+    void UploadManager::Init(
+        VkDevice     device,
+        VmaAllocator allocator,
+        VkQueue      copyQueue,
+        uint32_t     copyQueueFamilyIdx,
+        VkQueue      dstQueue,
+        uint32_t     dstQueueFamilyIdx,
+        VkDeviceSize ringByteCnt)
+    {
+        m_device = device;
+        m_allocator = allocator;
+        m_copyQueue = copyQueue;
+        m_copyQueueFamilyIdx = copyQueueFamilyIdx;
+        m_dstQueue = dstQueue;
+        m_dstQueueFamilyIdx = dstQueueFamilyIdx;
+
+        VkCommandPoolCreateInfo cmdPoolInfo{};
+        {
+            cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT |
+                                VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            cmdPoolInfo.queueFamilyIndex = m_copyQueueFamilyIdx;
+        }
+        VK_CHECK(vkCreateCommandPool(m_device, &cmdPoolInfo, nullptr, &m_copyCmdPool));
+
+        if (HasDedicatedCopyQueue())
+        {
+            cmdPoolInfo.queueFamilyIndex = m_dstQueueFamilyIdx;
+            VK_CHECK(vkCreateCommandPool(m_device, &cmdPoolInfo, nullptr, &m_dstCmdPool));
+        }
+
+        VkCommandBufferAllocateInfo cmdBufferAllocInfo{};
+        {
+            cmdBufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            cmdBufferAllocInfo.commandBufferCount = 1;
+        }
+
+        for (uint32_t i = 0; i < BatchCnt; i++)
+        {
+            m_batches[i] = Batch{};
+
+            cmdBufferAllocInfo.commandPool = m_copyCmdPool;
+            VK_CHECK(vkAllocateCommandBuffers(m_device, &cmdBufferAllocInfo, &m_batches[i].cmdBuffer));
+
+            if (HasDedicatedCopyQueue())
+            {
+                cmdBufferAllocInfo.commandPool = m_dstCmdPool;
+                VK_CHECK(vkAllocateCommandBuffers(m_device, &cmdBufferAllocInfo, &m_batches[i].dstCmdBuffer));
+            }
+        }
+
+        m_batchDoneSemaphore = CreateTimelineSemaphore();
+        if (HasDedicatedCopyQueue())
+        {
+            m_copyDoneSemaphore = CreateTimelineSemaphore();
+        }
+
+        // The ring is written sequentially by the CPU and only read by the copies.
+        VmaAllocationCreateInfo ringAllocInfo{};
+        {
+            ringAllocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+            ringAllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+        }
+
+        VkBufferCreateInfo ringBufferInfo{};
+        {
+            ringBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            ringBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            ringBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            ringBufferInfo.size = ringByteCnt;
+        }
+
+        VmaAllocationInfo ringAllocResult{};
+        VK_CHECK(vmaCreateBuffer(m_allocator,
+                                 &ringBufferInfo,
+                                 &ringAllocInfo,
+                                 &m_ringBuffer,
+                                 &m_ringAlloc,
+                                 &ringAllocResult));
+
+        m_pRingData = static_cast<uint8_t*>(ringAllocResult.pMappedData);
+        m_ringByteCnt = ringByteCnt;
+        m_ringHead = 0;
+        m_ringUsedByteCnt = 0;
+        m_openBatchId = 1;
+        m_completedBatchId = 0;
+        m_stallCnt = 0;
+    }
+
+    // ================================================================================================================
+    void UploadManager::Finalize()
+    {
+        if (m_device == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        WaitIdle();
+
+        vkDestroySemaphore(m_device, m_batchDoneSemaphore, nullptr);
+        if (m_copyDoneSemaphore != VK_NULL_HANDLE)
+        {
+            vkDestroySemaphore(m_device, m_copyDoneSemaphore, nullptr);
+        }
+
+        // The command buffers are freed with the pools.
+        vkDestroyCommandPool(m_device, m_copyCmdPool, nullptr);
+        if (m_dstCmdPool != VK_NULL_HANDLE)
+        {
+            vkDestroyCommandPool(m_device, m_dstCmdPool, nullptr);
+        }
+        vmaDestroyBuffer(m_allocator, m_ringBuffer, m_ringAlloc);
+
+        m_pRingData = nullptr;
+        m_batchDoneSemaphore = VK_NULL_HANDLE;
+        m_copyDoneSemaphore = VK_NULL_HANDLE;
+        m_dstCmdPool = VK_NULL_HANDLE;
+        m_device = VK_NULL_HANDLE;
+    }
+
+    // ================================================================================================================
+    void UploadManager::EnqueueBufferUpload(
+        const void*  pData,
+        VkDeviceSize byteCnt,
+        VkBuffer     dstBuffer,
+        VkDeviceSize dstOffset)
+    {
+        if (byteCnt == 0)
+        {
+            return;
+        }
+
+        VkBuffer     stagingBuffer = VK_NULL_HANDLE;
+        VkDeviceSize stagingOffset = 0;
+        Batch& batch = StageData(pData, byteCnt, stagingBuffer, stagingOffset);
+
+        VkBufferCopy bufferCopy{};
+        {
+            bufferCopy.srcOffset = stagingOffset;
+            bufferCopy.dstOffset = dstOffset;
+            bufferCopy.size = byteCnt;
+        }
+        vkCmdCopyBuffer(batch.cmdBuffer, stagingBuffer, dstBuffer, 1, &bufferCopy);
+
+        // One memory barrier at the Flush() makes all the batch's buffer copies visible. On a dedicated copy queue,
+        // the semaphore wait of the dst queue does it.
+        batch.hasBufferCopies = true;
+    }
+
+    // ================================================================================================================
+    void UploadManager::EnqueueImgUpload(
+        const void*              pData,
+        VkDeviceSize             byteCnt,
+        VkImage                  dstImg,
+        VkImageSubresourceRange  subResRange,
+        VkImageLayout            dstImgCurrentLayout,
+        const VkBufferImageCopy* pBufToImgCopyInfos,
+        uint32_t                 copyInfoCnt)
+    {
+        ASSERT(((HasDedicatedCopyQueue() == false) || (dstImgCurrentLayout == VK_IMAGE_LAYOUT_UNDEFINED)),
+               "The dedicated copy queue doesn't own the image's contents.");
+
+        VkBuffer     stagingBuffer = VK_NULL_HANDLE;
+        VkDeviceSize stagingOffset = 0;
+        Batch& batch = StageData(pData, byteCnt, stagingBuffer, stagingOffset);
+
+        std::vector<VkBufferImageCopy> bufToImgCopies(pBufToImgCopyInfos, pBufToImgCopyInfos + copyInfoCnt);
+        for (auto& bufToImgCopy : bufToImgCopies)
+        {
+            bufToImgCopy.bufferOffset += stagingOffset;
+        }
+
+        // The previous contents are discarded, so only the previous accesses' execution has to finish.
+        VkImageMemoryBarrier toDstBarrier{};
+        {
+            toDstBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            toDstBarrier.image = dstImg;
+            toDstBarrier.subresourceRange = subResRange;
+            toDstBarrier.srcAccessMask = 0;
+            toDstBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            toDstBarrier.oldLayout = dstImgCurrentLayout;
+            toDstBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            toDstBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            toDstBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        }
+
+        vkCmdPipelineBarrier(
+            batch.cmdBuffer,
+            (dstImgCurrentLayout == VK_IMAGE_LAYOUT_UNDEFINED) ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT :
+                                                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &toDstBarrier);
+
+        vkCmdCopyBufferToImage(
+            batch.cmdBuffer,
+            stagingBuffer,
+            dstImg,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            bufToImgCopies.size(), bufToImgCopies.data());
+
+        VkImageMemoryBarrier toShaderReadBarrier = toDstBarrier;
+        {
+            toShaderReadBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            toShaderReadBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            toShaderReadBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            toShaderReadBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        }
+
+        if (HasDedicatedCopyQueue())
+        {
+            // The layout transition is part of the ownership transfer, so the release and the acquire barriers are
+            // the same. The Flush() records them together.
+            toShaderReadBarrier.srcQueueFamilyIndex = m_copyQueueFamilyIdx;
+            toShaderReadBarrier.dstQueueFamilyIndex = m_dstQueueFamilyIdx;
+            batch.ownershipTransBarriers.push_back(toShaderReadBarrier);
+            return;
+        }
+
+        vkCmdPipelineBarrier(
+            batch.cmdBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &toShaderReadBarrier);
+    }
+
+    // ================================================================================================================
+    void UploadManager::Enqueue2dImgUpload(
+        const ImgInfo* pImgInfo,
+        VkImage        image)
+    {
+        // One level when the image has no mip chain.
+        uint32_t levelCnt = pImgInfo->mipByteOffsets.empty() ? 1 : pImgInfo->mipByteOffsets.size();
+
+        VkImageSubresourceRange tex2dSubResRange{};
+        {
+            tex2dSubResRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            tex2dSubResRange.baseMipLevel = 0;
+            tex2dSubResRange.levelCount = levelCnt;
+            tex2dSubResRange.baseArrayLayer = 0;
+            tex2dSubResRange.layerCount = 1;
+        }
+
+        // One copy per mip level from its offset in the tightly packed data.
+        std::vector<VkBufferImageCopy> tex2dBufToImgCopies(levelCnt);
+        for (uint32_t level = 0; level < levelCnt; level++)
+        {
+            VkExtent3D extent{};
+            {
+                extent.width = std::max(pImgInfo->pixWidth >> level, 1u);
+                extent.height = std::max(pImgInfo->pixHeight >> level, 1u);
+                extent.depth = 1;
+            }
+
+            VkBufferImageCopy& tex2dBufToImgCopy = tex2dBufToImgCopies[level];
+            {
+                tex2dBufToImgCopy.bufferOffset = (levelCnt == 1) ? 0 : pImgInfo->mipByteOffsets[level];
+                tex2dBufToImgCopy.bufferRowLength = 0; // Tightly packed, also in the blocks of a compressed format.
+                tex2dBufToImgCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                tex2dBufToImgCopy.imageSubresource.mipLevel = level;
+                tex2dBufToImgCopy.imageSubresource.baseArrayLayer = 0;
+                tex2dBufToImgCopy.imageSubresource.layerCount = 1;
+                tex2dBufToImgCopy.imageExtent = extent;
+            }
+        }
+
+        EnqueueImgUpload(pImgInfo->dataVec.data(),
+                         pImgInfo->dataVec.size(),
+                         image,
+                         tex2dSubResRange,
+                         VK_IMAGE_LAYOUT_UNDEFINED,
+                         tex2dBufToImgCopies.data(),
+                         tex2dBufToImgCopies.size());
+    }
+
+    // ================================================================================================================
+    void UploadManager::EnqueueImgLayoutTransition(
+        VkImage                 img,
+        VkImageLayout           oldLayout,
+        VkImageLayout           newLayout,
+        VkImageSubresourceRange subResRange)
+    {
+        Batch& batch = GetOpenBatch();
+
+        // The transitions don't know the image's users, so they wait for and flush everything.
+        VkImageMemoryBarrier layoutTransBarrier{};
+        {
+            layoutTransBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            layoutTransBarrier.image = img;
+            layoutTransBarrier.subresourceRange = subResRange;
+            layoutTransBarrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+            layoutTransBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+            layoutTransBarrier.oldLayout = oldLayout;
+            layoutTransBarrier.newLayout = newLayout;
+            layoutTransBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            layoutTransBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        }
+
+        if (HasDedicatedCopyQueue())
+        {
+            batch.dstLayoutTransBarriers.push_back(layoutTransBarrier);
+            return;
+        }
+
+        vkCmdPipelineBarrier(
+            batch.cmdBuffer,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &layoutTransBarrier);
+    }
+
+    // ================================================================================================================
+    uint64_t UploadManager::Flush()
+    {
+        Batch& batch = m_batches[m_openBatchId % BatchCnt];
+        if (batch.isRecording == false)
+        {
+            return m_openBatchId - 1;
+        }
+
+        if (batch.hasBufferCopies && (HasDedicatedCopyQueue() == false))
+        {
+            VkMemoryBarrier copiedBarrier{};
+            {
+                copiedBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                copiedBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                copiedBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+            }
+
+            vkCmdPipelineBarrier(
+                batch.cmdBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                0,
+                1, &copiedBarrier,
+                0, nullptr,
+                0, nullptr);
+        }
+
+        if (batch.ownershipTransBarriers.empty() == false)
+        {
+            // The release half. Its dst access is ignored and the dst queue's semaphore wait orders the acquire.
+            std::vector<VkImageMemoryBarrier> releaseBarriers = batch.ownershipTransBarriers;
+            for (auto& releaseBarrier : releaseBarriers)
+            {
+                releaseBarrier.dstAccessMask = 0;
+            }
+
+            vkCmdPipelineBarrier(
+                batch.cmdBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                0,
+                0, nullptr,
+                0, nullptr,
+                releaseBarriers.size(), releaseBarriers.data());
+        }
+
+        VK_CHECK(vkEndCommandBuffer(batch.cmdBuffer));
+
+        // Without a dedicated copy queue, the copies signal the batch's completion themselves.
+        VkSemaphore signalSemaphore = HasDedicatedCopyQueue() ? m_copyDoneSemaphore : m_batchDoneSemaphore;
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        {
+            timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            timelineInfo.signalSemaphoreValueCount = 1;
+            timelineInfo.pSignalSemaphoreValues = &batch.id;
+        }
+
+        VkSubmitInfo submitInfo{};
+        {
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.pNext = &timelineInfo;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &batch.cmdBuffer;
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &signalSemaphore;
+        }
+        VK_CHECK(vkQueueSubmit(m_copyQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+        if (HasDedicatedCopyQueue())
+        {
+            SubmitToDstQueue(batch);
+        }
+
+        batch.isRecording = false;
+        return m_openBatchId++;
+    }
+
+    // ================================================================================================================
+    // The dst queue only waits on the GPU, so the CPU and the dst queue's work before the acquire barriers keep going
+    // while the copies run. A batch without the images still signals its completion through an empty submission.
+    void UploadManager::SubmitToDstQueue(
+        Batch& batch)
+    {
+        const bool hasDstCmds = (batch.ownershipTransBarriers.empty() == false) ||
+                                (batch.dstLayoutTransBarriers.empty() == false);
+        if (hasDstCmds)
+        {
+            VkCommandBufferBeginInfo beginInfo{};
+            {
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            }
+            VK_CHECK(vkResetCommandBuffer(batch.dstCmdBuffer, 0));
+            VK_CHECK(vkBeginCommandBuffer(batch.dstCmdBuffer, &beginInfo));
+
+            if (batch.ownershipTransBarriers.empty() == false)
+            {
+                // The acquire half. Its src access is ignored.
+                std::vector<VkImageMemoryBarrier> acquireBarriers = batch.ownershipTransBarriers;
+                for (auto& acquireBarrier : acquireBarriers)
+                {
+                    acquireBarrier.srcAccessMask = 0;
+                }
+
+                vkCmdPipelineBarrier(
+                    batch.dstCmdBuffer,
+                    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                    0,
+                    0, nullptr,
+                    0, nullptr,
+                    acquireBarriers.size(), acquireBarriers.data());
+            }
+
+            if (batch.dstLayoutTransBarriers.empty() == false)
+            {
+                vkCmdPipelineBarrier(
+                    batch.dstCmdBuffer,
+                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                    0,
+                    0, nullptr,
+                    0, nullptr,
+                    batch.dstLayoutTransBarriers.size(), batch.dstLayoutTransBarriers.data());
+            }
+
+            VK_CHECK(vkEndCommandBuffer(batch.dstCmdBuffer));
+        }
+
+        const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        {
+            timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            timelineInfo.waitSemaphoreValueCount = 1;
+            timelineInfo.pWaitSemaphoreValues = &batch.id;
+            timelineInfo.signalSemaphoreValueCount = 1;
+            timelineInfo.pSignalSemaphoreValues = &batch.id;
+        }
+
+        VkSubmitInfo submitInfo{};
+        {
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.pNext = &timelineInfo;
+            submitInfo.waitSemaphoreCount = 1;
+            submitInfo.pWaitSemaphores = &m_copyDoneSemaphore;
+            submitInfo.pWaitDstStageMask = &waitStage;
+            submitInfo.commandBufferCount = hasDstCmds ? 1 : 0;
+            submitInfo.pCommandBuffers = &batch.dstCmdBuffer;
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &m_batchDoneSemaphore;
+        }
+        VK_CHECK(vkQueueSubmit(m_dstQueue, 1, &submitInfo, VK_NULL_HANDLE));
+    }
+
+    // ================================================================================================================
+    void UploadManager::WaitForBatch(
+        uint64_t batchId)
+    {
+        if (batchId >= m_openBatchId)
+        {
+            Flush();
+        }
+
+        while ((m_completedBatchId < batchId) && (m_completedBatchId + 1 < m_openBatchId))
+        {
+            RetireOldestBatch();
+        }
+    }
+
+    // ================================================================================================================
+    bool UploadManager::IsBatchDone(
+        uint64_t batchId)
+    {
+        RetireFinishedBatches();
+        return m_completedBatchId >= batchId;
+    }
+
+    // ================================================================================================================
+    UploadManager::Batch& UploadManager::GetOpenBatch()
+    {
+        Batch& batch = m_batches[m_openBatchId % BatchCnt];
+        if (batch.isRecording)
+        {
+            return batch;
+        }
+
+        // The slot's previous batch has to finish before its command buffers are reused.
+        while (m_openBatchId > m_completedBatchId + BatchCnt)
+        {
+            m_stallCnt++;
+            RetireOldestBatch();
+        }
+
+        VK_CHECK(vkResetCommandBuffer(batch.cmdBuffer, 0));
+
+        VkCommandBufferBeginInfo beginInfo{};
+        {
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        }
+        VK_CHECK(vkBeginCommandBuffer(batch.cmdBuffer, &beginInfo));
+
+        batch.id = m_openBatchId;
+        batch.ringByteCnt = 0;
+        batch.isRecording = true;
+        batch.hasBufferCopies = false;
+        batch.ownershipTransBarriers.clear();
+        batch.dstLayoutTransBarriers.clear();
+        return batch;
+    }
+
+    // ================================================================================================================
+    UploadManager::Batch& UploadManager::StageData(
+        const void*   pData,
+        VkDeviceSize  byteCnt,
+        VkBuffer&     oStagingBuffer,
+        VkDeviceSize& oOffset)
+    {
+        VkDeviceSize ringOffset = 0;
+        VkDeviceSize chargedByteCnt = 0;
+        if (AllocRingRange(byteCnt, ringOffset, chargedByteCnt))
+        {
+            memcpy(m_pRingData + ringOffset, pData, byteCnt);
+            VK_CHECK(vmaFlushAllocation(m_allocator, m_ringAlloc, ringOffset, byteCnt));
+
+            Batch& batch = GetOpenBatch();
+            batch.ringByteCnt += chargedByteCnt;
+
+            oStagingBuffer = m_ringBuffer;
+            oOffset = ringOffset;
+            return batch;
+        }
+
+        // Larger than the whole ring, e.g. a big HDR cubemap.
+        Batch& batch = GetOpenBatch();
+
+        VmaAllocationCreateInfo stagingBufAllocInfo{};
+        {
+            stagingBufAllocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+            stagingBufAllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+        }
+
+        VkBufferCreateInfo stgBufInfo{};
+        {
+            stgBufInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            stgBufInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            stgBufInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            stgBufInfo.size = byteCnt;
+        }
+
+        VkBuffer          stagingBuffer = VK_NULL_HANDLE;
+        VmaAllocation     stagingBufAlloc = VK_NULL_HANDLE;
+        VmaAllocationInfo stagingAllocResult{};
+        VK_CHECK(vmaCreateBuffer(m_allocator,
+                                 &stgBufInfo,
+                                 &stagingBufAllocInfo,
+                                 &stagingBuffer,
+                                 &stagingBufAlloc,
+                                 &stagingAllocResult));
+
+        memcpy(stagingAllocResult.pMappedData, pData, byteCnt);
+        VK_CHECK(vmaFlushAllocation(m_allocator, stagingBufAlloc, 0, byteCnt));
+
+        batch.ownStagingBuffers.push_back({ stagingBuffer, stagingBufAlloc });
+
+        oStagingBuffer = stagingBuffer;
+        oOffset = 0;
+        return batch;
+    }
+
+    // ================================================================================================================
+    // The used range always runs from the oldest batch's start to the m_ringHead, so a range fits if the bytes from
+    // the head to it and its own bytes are free.
+    bool UploadManager::AllocRingRange(
+        VkDeviceSize  byteCnt,
+        VkDeviceSize& oOffset,
+        VkDeviceSize& oChargedByteCnt)
+    {
+        if (byteCnt > m_ringByteCnt)
+        {
+            return false;
+        }
+
+        RetireFinishedBatches();
+
+        while (true)
+        {
+            if (m_ringUsedByteCnt == 0)
+            {
+                m_ringHead = 0;
+            }
+
+            VkDeviceSize offset = ((m_ringHead + RingAlignment - 1) / RingAlignment) * RingAlignment;
+            if (offset + byteCnt > m_ringByteCnt)
+            {
+                // Skip the ring's tail and wrap around to its start.
+                offset = 0;
+            }
+
+            VkDeviceSize paddingByteCnt = (offset >= m_ringHead) ? (offset - m_ringHead) : (m_ringByteCnt - m_ringHead);
+            if (m_ringUsedByteCnt + paddingByteCnt + byteCnt <= m_ringByteCnt)
+            {
+                oOffset = offset;
+                oChargedByteCnt = paddingByteCnt + byteCnt;
+                m_ringHead = offset + byteCnt;
+                m_ringUsedByteCnt += oChargedByteCnt;
+                return true;
+            }
+
+            // The ring is full. The open batch is submitted if it is the only one holding the ring.
+            m_stallCnt++;
+            if (m_completedBatchId + 1 == m_openBatchId)
+            {
+                Flush();
+            }
+            RetireOldestBatch();
+        }
+    }
+
+    // ================================================================================================================
+    void UploadManager::RetireOldestBatch()
+    {
+        Batch& batch = m_batches[(m_completedBatchId + 1) % BatchCnt];
+
+        VkSemaphoreWaitInfo waitInfo{};
+        {
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &m_batchDoneSemaphore;
+            waitInfo.pValues = &batch.id;
+        }
+        VK_CHECK(vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX));
+
+        m_ringUsedByteCnt -= batch.ringByteCnt;
+        batch.ringByteCnt = 0;
+
+        for (const auto& stagingBuffer : batch.ownStagingBuffers)
+        {
+            vmaDestroyBuffer(m_allocator, stagingBuffer.first, stagingBuffer.second);
+        }
+        batch.ownStagingBuffers.clear();
+
+        m_completedBatchId++;
+    }
+
+    // ================================================================================================================
+    void UploadManager::RetireFinishedBatches()
+    {
+        if (m_completedBatchId + 1 >= m_openBatchId)
+        {
+            return;
+        }
+
+        // One query covers all the finished batches, since they complete in order.
+        uint64_t doneBatchId = 0;
+        VK_CHECK(vkGetSemaphoreCounterValue(m_device, m_batchDoneSemaphore, &doneBatchId));
+
+        while ((m_completedBatchId < doneBatchId) && (m_completedBatchId + 1 < m_openBatchId))
+        {
+            RetireOldestBatch();
+        }
+    }
+
+    // ================================================================================================================
+    VkSemaphore UploadManager::CreateTimelineSemaphore()
+    {
+        VkSemaphoreTypeCreateInfo timelineInfo{};
+        {
+            timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+            timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+            timelineInfo.initialValue = 0;
+        }
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        {
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            semaphoreInfo.pNext = &timelineInfo;
+        }
+
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        VK_CHECK(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &semaphore));
+        return semaphore;
+    }
+}
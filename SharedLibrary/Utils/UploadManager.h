@@ -0,0 +1,149 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include "../Application/Application.h"
+
+namespace SharedLib
+{
+    // Batches the buffer and image uploads into few queue submissions, instead of the submit and wait per resource of
+    // the SendImgDataToGpu(...). The data is copied into a persistently mapped staging ring and the copies are recorded
+    // into the open batch, which the Flush() submits without waiting. A batch's ring range is reused after the batch
+    // signals its timeline semaphore value, so the CPU only stalls when the ring is full or all the batches are in
+    // flight. Only one thread may use it.
+    //
+    // The copies run on either the queue that uses the resources, e.g. the graphics queue, or a dedicated copy queue of
+    // another family, which overlaps them with the rendering. On the dedicated copy queue, the images' ownership is
+    // released to the dst queue family, and the dst queue acquires it after waiting for the copies on the GPU. Either
+    // way, the later submissions to the dst queue see the uploads without a CPU wait.
+    class UploadManager
+    {
+    public:
+        UploadManager() {}
+        ~UploadManager() {}
+
+        // The copy queue can be the dst queue, then there is no ownership transfer.
+        void Init(VkDevice     device,
+                  VmaAllocator allocator,
+                  VkQueue      copyQueue,
+                  uint32_t     copyQueueFamilyIdx,
+                  VkQueue      dstQueue,
+                  uint32_t     dstQueueFamilyIdx,
+                  VkDeviceSize ringByteCnt);
+
+        // Submits the open batch and waits for all of them before the destruction.
+        void Finalize();
+
+        // The dstBuffer needs the VK_BUFFER_USAGE_TRANSFER_DST_BIT. The copies are visible to all the later commands.
+        // With a dedicated copy queue, the dstBuffer has to be shared concurrently by the GetCopyQueueFamilyIdx() and
+        // the GetDstQueueFamilyIdx(), since a buffer's ranges are usually uploaded while the others are in use.
+        void EnqueueBufferUpload(const void*  pData,
+                                 VkDeviceSize byteCnt,
+                                 VkBuffer     dstBuffer,
+                                 VkDeviceSize dstOffset);
+
+        // The same copies and layouts as the SendImgDataToGpu(...). The copies' bufferOffsets are relative to the
+        // pData. The subResRange ends in the shader read only layout and is owned by the dst queue family. With a
+        // dedicated copy queue, the dstImgCurrentLayout has to be undefined, since the contents aren't acquired from
+        // the dst queue family.
+        void EnqueueImgUpload(const void*              pData,
+                              VkDeviceSize             byteCnt,
+                              VkImage                  dstImg,
+                              VkImageSubresourceRange  subResRange,
+                              VkImageLayout            dstImgCurrentLayout,
+                              const VkBufferImageCopy* pBufToImgCopyInfos,
+                              uint32_t                 copyInfoCnt);
+
+        // All the mip levels in the pImgInfo, like the Send2dImgDataToGpu(...).
+        void Enqueue2dImgUpload(const ImgInfo* pImgInfo, VkImage image);
+
+        // Executed on the dst queue. With a dedicated copy queue, it comes after all the batch's copies.
+        void EnqueueImgLayoutTransition(VkImage                 img,
+                                        VkImageLayout           oldLayout,
+                                        VkImageLayout           newLayout,
+                                        VkImageSubresourceRange subResRange);
+
+        // Submits the open batch and returns its id. An empty open batch isn't submitted and the last submitted id is
+        // returned, which is 0 before the first submission.
+        uint64_t Flush();
+
+        // Blocks until the batch and all the ones before it are done. The open batch is submitted if it is waited.
+        void WaitForBatch(uint64_t batchId);
+        void WaitIdle() { WaitForBatch(Flush()); }
+
+        bool IsBatchDone(uint64_t batchId);
+
+        // How many times an upload had to wait for a batch because the ring was full.
+        uint32_t GetStallCnt() const { return m_stallCnt; }
+
+        bool HasDedicatedCopyQueue() const { return m_copyQueueFamilyIdx != m_dstQueueFamilyIdx; }
+        uint32_t GetCopyQueueFamilyIdx() const { return m_copyQueueFamilyIdx; }
+        uint32_t GetDstQueueFamilyIdx() const { return m_dstQueueFamilyIdx; }
+
+    private:
+        struct Batch
+        {
+            VkCommandBuffer cmdBuffer;       // On the copy queue.
+            VkCommandBuffer dstCmdBuffer;    // On the dst queue. Only for a dedicated copy queue.
+            uint64_t        id;
+            VkDeviceSize    ringByteCnt;     // Including the alignment and the wrap around paddings.
+            bool            isRecording;
+            bool            hasBufferCopies;
+
+            // Recorded at the Flush() with a dedicated copy queue. The ownership transfers are released on the copy
+            // queue and acquired on the dst queue. The layout transitions are only on the dst queue.
+            std::vector<VkImageMemoryBarrier> ownershipTransBarriers;
+            std::vector<VkImageMemoryBarrier> dstLayoutTransBarriers;
+
+            // The uploads that don't fit into the ring get their own staging buffers, released with the batch.
+            std::vector<std::pair<VkBuffer, VmaAllocation>> ownStagingBuffers;
+        };
+
+        static constexpr uint32_t BatchCnt = 4;
+
+        // A multiple of every texel and block size up to 16 bytes, including the 3 and 12 bytes RGB ones, as the
+        // buffer to image copies need.
+        static constexpr VkDeviceSize RingAlignment = 48;
+
+        Batch& GetOpenBatch();
+
+        // Copies the data into the ring or an own staging buffer of the open batch. The open batch may be submitted
+        // to make room, so the returned batch is the one to record the copy into.
+        Batch& StageData(const void* pData, VkDeviceSize byteCnt, VkBuffer& oStagingBuffer, VkDeviceSize& oOffset);
+
+        bool AllocRingRange(VkDeviceSize byteCnt, VkDeviceSize& oOffset, VkDeviceSize& oChargedByteCnt);
+
+        void SubmitToDstQueue(Batch& batch);
+
+        void RetireOldestBatch();
+        void RetireFinishedBatches();
+
+        VkSemaphore CreateTimelineSemaphore();
+
+        VkDevice      m_device = VK_NULL_HANDLE;
+        VmaAllocator  m_allocator = VK_NULL_HANDLE;
+        VkQueue       m_copyQueue = VK_NULL_HANDLE;
+        VkQueue       m_dstQueue = VK_NULL_HANDLE;
+        uint32_t      m_copyQueueFamilyIdx = 0;
+        uint32_t      m_dstQueueFamilyIdx = 0;
+        VkCommandPool m_copyCmdPool = VK_NULL_HANDLE;
+        VkCommandPool m_dstCmdPool = VK_NULL_HANDLE;
+
+        // The timeline values are the batch ids. A batch is done when the m_batchDoneSemaphore reaches its id. With a
+        // dedicated copy queue, the copies signal the m_copyDoneSemaphore, which the dst queue waits for.
+        VkSemaphore m_batchDoneSemaphore = VK_NULL_HANDLE;
+        VkSemaphore m_copyDoneSemaphore = VK_NULL_HANDLE;
+
+        VkBuffer      m_ringBuffer = VK_NULL_HANDLE;
+        VmaAllocation m_ringAlloc = VK_NULL_HANDLE;
+        uint8_t*      m_pRingData = nullptr;
+        VkDeviceSize  m_ringByteCnt = 0;
+        VkDeviceSize  m_ringHead = 0;        // Where the next staging range starts, before the alignment.
+        VkDeviceSize  m_ringUsedByteCnt = 0; // Held by the open batch and the batches in flight.
+
+        // The batch with the id uses the m_batches[id % BatchCnt]. The ids before the open one are submitted.
+        Batch    m_batches[BatchCnt] = {};
+        uint64_t m_openBatchId = 1;
+        uint64_t m_completedBatchId = 0;
+        uint32_t m_stallCnt = 0;
+    };
+}
@@ -0,0 +1,197 @@
+#include "AssetLoadBench.h"
+#include "../../SharedLibrary/AssetsLoader/AssetsLoader.h"
+#include "../../SharedLibrary/Scene/Level.h"
+#include "../../SharedLibrary/Utils/UploadManager.h"
+#include "../../SharedLibrary/Utils/DiskOpsUtils.h"
+#include "../../SharedLibrary/Utils/StrPathUtils.h"
+
+#include "vk_mem_alloc.h"
+#include "stb_image.h"
+
+#include <chrono>
+#include <cstring>
+
+// ================================================================================================================
+void AssetLoadBench::AppInit()
+{
+    std::vector<const char*> instExtensions;
+    InitInstance(instExtensions, 0);
+
+    InitPhysicalDevice();
+    InitGfxQueueFamilyIdx();
+    InitTransferQueueFamilyIdx();
+
+    std::vector<VkDeviceQueueCreateInfo> deviceQueueInfos = CreateDeviceQueueInfos({ m_graphicsQueueFamilyIdx,
+                                                                                     m_transferQueueFamilyIdx });
+    const std::vector<const char*> deviceExtensions = {};
+
+    InitDevice(deviceExtensions, deviceQueueInfos, nullptr);
+    InitVmaAllocator();
+    InitGraphicsQueue();
+    InitTransferQueue();
+
+    InitGfxCommandPool();
+    InitGfxCommandBuffers(1);
+    InitUploadManager();
+}
+
+// ================================================================================================================
+BenchRunResult AssetLoadBench::RunLoad(
+    const std::string& absPath,
+    bool               isGpuUpload,
+    bool               useCookedCache)
+{
+    BenchRunResult result{};
+    SharedLib::ResetProcessPeakRss();
+
+    std::string filePostfix;
+    SharedLib::GetFilePostfix(absPath, filePostfix);
+    if (strcmp(filePostfix.c_str(), "hdr") == 0)
+    {
+        LoadHdrImage(absPath, isGpuUpload, result);
+    }
+    else
+    {
+        LoadMeshAsset(absPath, isGpuUpload, useCookedCache, result);
+    }
+
+    return result;
+}
+
+// ================================================================================================================
+void AssetLoadBench::LoadMeshAsset(
+    const std::string& absPath,
+    bool               isGpuUpload,
+    bool               useCookedCache,
+    BenchRunResult&    oResult)
+{
+    SharedLib::AssetsLoaderOptions loaderOptions;
+    {
+        loaderOptions.useCookedCache = useCookedCache;
+        loaderOptions.asyncTextureDecode = false;
+    }
+
+    std::string filePostfix;
+    SharedLib::GetFilePostfix(absPath, filePostfix);
+
+    // The manager's worker threads are created before the timing starts.
+    SharedLib::AssetsLoaderManager* pLoaderManager = nullptr;
+    if (strcmp(filePostfix.c_str(), "obj") == 0)
+    {
+        pLoaderManager = new SharedLib::ObjLoaderManager(loaderOptions);
+    }
+    else
+    {
+        pLoaderManager = new SharedLib::GltfLoaderManager(loaderOptions);
+    }
+
+    SharedLib::Level level;
+    pLoaderManager->GetLoadProfiler().SetPhasePeakRssEnabled(m_isPhasePeakRssEnabled);
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    if (pLoaderManager->Load(absPath, level) == false)
+    {
+        printf("Failed to load the mesh asset %s\n", absPath.c_str());
+        exit(1);
+    }
+    if (isGpuUpload)
+    {
+        // The load isn't done before its uploads are.
+        pLoaderManager->InitEntitesGpuRsrc(m_physicalDevice, m_device, m_pAllocator, m_pUploadManager);
+        m_pUploadManager->WaitIdle();
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    oResult.wallMs = std::chrono::duration<double, std::milli>(end - start).count();
+    oResult.peakRssBytes = SharedLib::GetProcessPeakRssBytes();
+    for (uint32_t phase = 0; phase < SharedLib::LOAD_PHASE_CNT; phase++)
+    {
+        oResult.phases[phase] = pLoaderManager->GetLoadProfiler().GetPhaseStats((SharedLib::LoadPhase)phase);
+    }
+
+    pLoaderManager->FinializeEntities(m_device, m_pAllocator);
+    delete pLoaderManager;
+}
+
+// ================================================================================================================
+void AssetLoadBench::LoadHdrImage(
+    const std::string& absPath,
+    bool               isGpuUpload,
+    BenchRunResult&    oResult)
+{
+    SharedLib::LoadProfiler profiler;
+    SharedLib::GpuImg hdrImg{};
+    profiler.SetPhasePeakRssEnabled(m_isPhasePeakRssEnabled);
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<char> encodedData;
+    {
+        SharedLib::ScopedLoadPhase phase(&profiler, SharedLib::LOAD_PHASE_FILE_IO);
+        SharedLib::ReadBinaryFile(absPath, encodedData);
+        phase.SetByteCnt(encodedData.size());
+    }
+
+    SharedLib::ImgInfo hdrImgInfo{};
+    {
+        SharedLib::ScopedLoadPhase phase(&profiler, SharedLib::LOAD_PHASE_IMAGE_DECODE, encodedData.size());
+
+        int width = 0;
+        int height = 0;
+        int componentCnt = 0;
+        float* pTexels = stbi_loadf_from_memory(reinterpret_cast<const stbi_uc*>(encodedData.data()),
+                                                encodedData.size(),
+                                                &width,
+                                                &height,
+                                                &componentCnt,
+                                                4);
+        if (pTexels == nullptr)
+        {
+            printf("Failed to decode the hdr image %s\n", absPath.c_str());
+            exit(1);
+        }
+
+        const uint32_t texelByteCnt = 4 * sizeof(float) * width * height;
+        hdrImgInfo.pixWidth = width;
+        hdrImgInfo.pixHeight = height;
+        hdrImgInfo.componentCnt = 4;
+        hdrImgInfo.dataVec.resize(texelByteCnt);
+        memcpy(hdrImgInfo.dataVec.data(), pTexels, texelByteCnt);
+        stbi_image_free(pTexels);
+    }
+
+    if (isGpuUpload)
+    {
+        SharedLib::ScopedLoadPhase phase(&profiler, SharedLib::LOAD_PHASE_GPU_UPLOAD, hdrImgInfo.dataVec.size());
+
+        SharedLib::GpuImgCreateInfo hdrImgCreateInfo{};
+        {
+            hdrImgCreateInfo.allocFlags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+            hdrImgCreateInfo.imgSubresRange = GetImgSubrsrcRange(0, 1, 0, 1);
+            hdrImgCreateInfo.imgViewType = VK_IMAGE_VIEW_TYPE_2D;
+            hdrImgCreateInfo.imgFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
+            hdrImgCreateInfo.imgExtent = VkExtent3D{ hdrImgInfo.pixWidth, hdrImgInfo.pixHeight, 1 };
+            hdrImgCreateInfo.imgUsageFlags = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+            hdrImgCreateInfo.hasSampler = true;
+            hdrImgCreateInfo.samplerInfo = GetSamplerInfo(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+        }
+
+        hdrImg = CreateGpuImage(hdrImgCreateInfo);
+        m_pUploadManager->Enqueue2dImgUpload(&hdrImgInfo, hdrImg.image);
+        m_pUploadManager->WaitIdle();
+    }
+
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    oResult.wallMs = std::chrono::duration<double, std::milli>(end - start).count();
+    oResult.peakRssBytes = SharedLib::GetProcessPeakRssBytes();
+    for (uint32_t phase = 0; phase < SharedLib::LOAD_PHASE_CNT; phase++)
+    {
+        oResult.phases[phase] = profiler.GetPhaseStats((SharedLib::LoadPhase)phase);
+    }
+
+    if (isGpuUpload)
+    {
+        DestroyGpuImgResource(hdrImg);
+    }
+}
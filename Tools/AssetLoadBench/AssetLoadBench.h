@@ -0,0 +1,43 @@
+#pragma once
+#include "../../SharedLibrary/Application/Application.h"
+#include "../../SharedLibrary/AssetsLoader/LoadProfiler.h"
+
+// The timings of one load of an asset. The wall time covers the load and the GPU upload, but not the release.
+struct BenchRunResult
+{
+    double                    wallMs;
+    uint64_t                  peakRssBytes;
+    SharedLib::LoadPhaseStats phases[SharedLib::LOAD_PHASE_CNT];
+};
+
+// A headless application that only creates the device and a command buffer, so the benchmark can time the GPU uploads
+// without a window or a swapchain.
+class AssetLoadBench : public SharedLib::Application
+{
+public:
+    AssetLoadBench() {}
+    ~AssetLoadBench() {}
+
+    virtual void AppInit() override;
+
+    // The gltf, glb and obj go through their AssetsLoaderManager with the textures decoded synchronously, so that the
+    // image decoding is part of the load. The hdr is decoded to float RGBA like the ReadImg(...) and sent to a sampled
+    // image. The peak RSS restarts with every run where the platform allows it.
+    BenchRunResult RunLoad(const std::string& absPath, bool isGpuUpload, bool useCookedCache);
+
+    // Records the peak RSS at every phase sample too, see the LoadProfiler. It slows the phases down, so it is off by
+    // default and the runs only read their peak RSS at the end.
+    void SetPhasePeakRssEnabled(bool isEnabled) { m_isPhasePeakRssEnabled = isEnabled; }
+
+private:
+    void LoadMeshAsset(const std::string& absPath,
+                       bool               isGpuUpload,
+                       bool               useCookedCache,
+                       BenchRunResult&    oResult);
+
+    void LoadHdrImage(const std::string& absPath,
+                      bool               isGpuUpload,
+                      BenchRunResult&    oResult);
+
+    bool m_isPhasePeakRssEnabled = false;
+};
@@ -0,0 +1,263 @@
+#include "args.hxx"
+
+#include "AssetLoadBench.h"
+#include "../../SharedLibrary/Utils/StrPathUtils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The per asset results of all the measured runs. The warm up runs are dropped.
+struct BenchAssetResult
+{
+    std::string                 absPath;
+    std::vector<BenchRunResult> runs;
+};
+
+// ================================================================================================================
+double GetMedian(
+    std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return (values.size() % 2 == 1) ? values[mid] : 0.5 * (values[mid - 1] + values[mid]);
+}
+
+// ================================================================================================================
+// The windows paths have backslashes, which the JSON strings have to escape.
+std::string EscapeJsonStr(
+    const std::string& str)
+{
+    std::string escapedStr;
+    for (char c : str)
+    {
+        if ((c == '"') || (c == '\\'))
+        {
+            escapedStr += '\\';
+        }
+        escapedStr += c;
+    }
+    return escapedStr;
+}
+
+// ================================================================================================================
+void WritePhasesJson(
+    FILE*                            pFile,
+    const SharedLib::LoadPhaseStats* pPhases,
+    const char*                      pIndent)
+{
+    for (uint32_t phase = 0; phase < SharedLib::LOAD_PHASE_CNT; phase++)
+    {
+        const SharedLib::LoadPhaseStats& stats = pPhases[phase];
+        fprintf(pFile,
+                "%s\"%s\": { \"ms\": %.3f, \"bytes\": %llu, \"samples\": %u, \"peakRssBytes\": %llu }%s\n",
+                pIndent,
+                SharedLib::LoadProfiler::GetPhaseName((SharedLib::LoadPhase)phase),
+                stats.milliseconds,
+                (unsigned long long)stats.byteCnt,
+                stats.sampleCnt,
+                (unsigned long long)stats.peakRssBytes,
+                (phase + 1 < SharedLib::LOAD_PHASE_CNT) ? "," : "");
+    }
+}
+
+// ================================================================================================================
+// The medians are what a regression gate should compare. The runs are kept for the spread.
+bool WriteResultsJson(
+    const std::string&                   outputPath,
+    const std::vector<BenchAssetResult>& results,
+    uint32_t                             warmUpRunCnt,
+    bool                                 isGpuUpload,
+    bool                                 useCookedCache)
+{
+    FILE* pFile = fopen(outputPath.c_str(), "w");
+    if (pFile == nullptr)
+    {
+        return false;
+    }
+
+    fprintf(pFile, "{\n");
+    fprintf(pFile, "  \"runCnt\": %u,\n", results.empty() ? 0 : (uint32_t)results[0].runs.size());
+    fprintf(pFile, "  \"warmUpRunCnt\": %u,\n", warmUpRunCnt);
+    fprintf(pFile, "  \"gpuUpload\": %s,\n", isGpuUpload ? "true" : "false");
+    fprintf(pFile, "  \"cookedCache\": %s,\n", useCookedCache ? "true" : "false");
+    fprintf(pFile, "  \"assets\": [\n");
+
+    for (uint32_t assetIdx = 0; assetIdx < results.size(); assetIdx++)
+    {
+        const BenchAssetResult& result = results[assetIdx];
+
+        std::vector<double> wallMs;
+        uint64_t maxPeakRssBytes = 0;
+        for (const auto& run : result.runs)
+        {
+            wallMs.push_back(run.wallMs);
+            maxPeakRssBytes = std::max(maxPeakRssBytes, run.peakRssBytes);
+        }
+
+        fprintf(pFile, "    {\n");
+        fprintf(pFile, "      \"path\": \"%s\",\n", EscapeJsonStr(result.absPath).c_str());
+        fprintf(pFile, "      \"medianWallMs\": %.3f,\n", GetMedian(wallMs));
+        fprintf(pFile, "      \"minWallMs\": %.3f,\n", *std::min_element(wallMs.begin(), wallMs.end()));
+        fprintf(pFile, "      \"maxPeakRssBytes\": %llu,\n", (unsigned long long)maxPeakRssBytes);
+
+        fprintf(pFile, "      \"medianPhaseMs\": {\n");
+        for (uint32_t phase = 0; phase < SharedLib::LOAD_PHASE_CNT; phase++)
+        {
+            std::vector<double> phaseMs;
+            for (const auto& run : result.runs)
+            {
+                phaseMs.push_back(run.phases[phase].milliseconds);
+            }
+
+            fprintf(pFile,
+                    "        \"%s\": %.3f%s\n",
+                    SharedLib::LoadProfiler::GetPhaseName((SharedLib::LoadPhase)phase),
+                    GetMedian(phaseMs),
+                    (phase + 1 < SharedLib::LOAD_PHASE_CNT) ? "," : "");
+        }
+        fprintf(pFile, "      },\n");
+
+        fprintf(pFile, "      \"runs\": [\n");
+        for (uint32_t runIdx = 0; runIdx < result.runs.size(); runIdx++)
+        {
+            const BenchRunResult& run = result.runs[runIdx];
+            fprintf(pFile, "        {\n");
+            fprintf(pFile, "          \"wallMs\": %.3f,\n", run.wallMs);
+            fprintf(pFile, "          \"peakRssBytes\": %llu,\n", (unsigned long long)run.peakRssBytes);
+            fprintf(pFile, "          \"phases\": {\n");
+            WritePhasesJson(pFile, run.phases, "            ");
+            fprintf(pFile, "          }\n");
+            fprintf(pFile, "        }%s\n", (runIdx + 1 < result.runs.size()) ? "," : "");
+        }
+        fprintf(pFile, "      ]\n");
+        fprintf(pFile, "    }%s\n", (assetIdx + 1 < results.size()) ? "," : "");
+    }
+
+    fprintf(pFile, "  ]\n");
+    fprintf(pFile, "}\n");
+    return fclose(pFile) == 0;
+}
+
+// ================================================================================================================
+int main(
+    int    argc,
+    char** argv)
+{
+    args::ArgumentParser parser("This tool loads the assets repeatedly and reports the time, the peak RSS and the bytes "
+                                "of each loading phase as JSON.",
+                                "E.g. AssetLoadBench.exe -a ./Sponza.gltf -a ./sphere.obj -a ./sky.hdr -o ./bench.json");
+    args::HelpFlag help(parser, "help", "Display this help menu", { 'h', "help" });
+
+    args::ValueFlagList<std::string> assetPaths(parser, "", "An asset to load. gltf, glb, obj or hdr.", { 'a', "asset" });
+    args::ValueFlag<std::string> assetListPath(parser, "", "A text file with an asset path per line.", { 'l', "list" });
+    args::ValueFlag<std::string> outputPath(parser, "", "The output JSON file.", { 'o', "output" });
+    args::ValueFlag<uint32_t> runCnt(parser, "", "The measured runs per asset. 5 by default.", { 'r', "runs" });
+    args::ValueFlag<uint32_t> warmUpRunCnt(parser, "", "The dropped runs per asset. 1 by default.", { 'w', "warmup" });
+    args::Flag noGpuUpload(parser, "", "Skip the GPU upload.", { "no-gpu" });
+    args::Flag useCookedCache(parser, "", "Load through the cooked cache. The first run may write it.", { "cooked" });
+    args::Flag phasePeakRss(parser, "", "Record the peak RSS of every phase. It slows them down.", { "phase-rss" });
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch (const args::Help&)
+    {
+        std::cout << parser;
+        return 0;
+    }
+    catch (const args::ParseError& e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    std::vector<std::string> inputPaths = args::get(assetPaths);
+    if (assetListPath)
+    {
+        std::ifstream listFile(args::get(assetListPath));
+        if (listFile.is_open() == false)
+        {
+            std::cerr << "Cannot open the asset list: " << args::get(assetListPath) << std::endl;
+            return 1;
+        }
+
+        std::string line;
+        while (std::getline(listFile, line))
+        {
+            // Skip the empty lines and the comments.
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if ((line.empty() == false) && (line[0] != '#'))
+            {
+                inputPaths.push_back(line);
+            }
+        }
+    }
+
+    std::vector<std::string> absPaths;
+    for (const auto& inputPath : inputPaths)
+    {
+        std::string absPath;
+        if ((SharedLib::IsFile(inputPath) == false) || (SharedLib::GetAbsolutePathName(inputPath, absPath) == false))
+        {
+            std::cerr << "Invalid asset path: " << inputPath << std::endl;
+            return 1;
+        }
+        absPaths.push_back(absPath);
+    }
+
+    if (absPaths.empty())
+    {
+        std::cerr << "Cannot find any asset to load!" << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    const uint32_t measuredRunCnt = std::max(runCnt ? args::get(runCnt) : 5u, 1u);
+    const uint32_t droppedRunCnt = warmUpRunCnt ? args::get(warmUpRunCnt) : 1u;
+    const std::string jsonPath = outputPath ? args::get(outputPath) : "AssetLoadBench.json";
+    const bool isGpuUpload = (args::get(noGpuUpload) == false);
+    const bool isCooked = args::get(useCookedCache);
+
+    AssetLoadBench app;
+    app.AppInit();
+    app.SetPhasePeakRssEnabled(args::get(phasePeakRss));
+
+    std::vector<BenchAssetResult> results;
+    for (const auto& absPath : absPaths)
+    {
+        BenchAssetResult result{};
+        result.absPath = absPath;
+        for (uint32_t runIdx = 0; runIdx < droppedRunCnt + measuredRunCnt; runIdx++)
+        {
+            BenchRunResult run = app.RunLoad(absPath, isGpuUpload, isCooked);
+            if (runIdx >= droppedRunCnt)
+            {
+                result.runs.push_back(run);
+            }
+        }
+
+        std::vector<double> wallMs;
+        for (const auto& run : result.runs)
+        {
+            wallMs.push_back(run.wallMs);
+        }
+        printf("%s: median %.3f ms over %u runs\n", absPath.c_str(), GetMedian(wallMs), measuredRunCnt);
+
+        results.push_back(std::move(result));
+    }
+
+    if (WriteResultsJson(jsonPath, results, droppedRunCnt, isGpuUpload, isCooked) == false)
+    {
+        std::cerr << "Cannot write the results to: " << jsonPath << std::endl;
+        return 1;
+    }
+
+    printf("The results are written to %s\n", jsonPath.c_str());
+    return 0;
+}
@@ -0,0 +1,455 @@
+#include "args.hxx"
+
+#define TINYGLTF_IMPLEMENTATION
+#include "tiny_gltf.h"
+
+#include "../../SharedLibrary/MeshProcessing/ClusterLod.h"
+#include "../../SharedLibrary/MeshProcessing/MeshWeld.h"
+#include "../../SharedLibrary/MeshProcessing/MeshOptimizer.h"
+#include "../../SharedLibrary/AssetsLoader/ObjParser.h"
+#include "../../SharedLibrary/Utils/GltfUtils.h"
+#include "../../SharedLibrary/Utils/DiskOpsUtils.h"
+#include "../../SharedLibrary/Utils/ThreadUtils.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The benchmark runs the offline half of the cluster LOD pipeline on a mesh: it builds the DAG, validates it, saves it
+// into the streamable file and loads it back, and then times the cut selection from a range of camera distances. Any
+// failure returns 1, so it also works as a check of the ClusterLod.h.
+struct BenchMesh
+{
+    std::vector<float>    positions; // 3 floats per vertex.
+    std::vector<uint32_t> indices;   // Triangle list.
+};
+
+const uint32_t CutIterCnt = 100;
+const float    CameraDistanceScales[] = { 1.f, 2.f, 4.f, 8.f, 16.f, 32.f, 64.f, 128.f, 256.f, 1024.f };
+const float    PixelError = 1.f;
+const float    FovY = 1.0472f; // 60 degrees.
+const float    ViewportHeight = 1080.f;
+
+// ================================================================================================================
+template<typename Func>
+double GetMilliseconds(
+    Func func)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+    func();
+    auto endTime = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(endTime - startTime).count();
+}
+
+// ================================================================================================================
+// All the obj's groups are merged into one mesh.
+bool LoadObjMesh(
+    const std::string&     path,
+    SharedLib::ThreadPool* pThreadPool,
+    BenchMesh&             oMesh)
+{
+    SharedLib::MappedFile objFile;
+    if (objFile.Open(path) == false)
+    {
+        return false;
+    }
+
+    SharedLib::ObjData objData;
+    std::string        err;
+    if (SharedLib::ParseObj(reinterpret_cast<const char*>(objFile.GetData()),
+                            objFile.GetSize(),
+                            pThreadPool,
+                            objData,
+                            err) == false)
+    {
+        std::cerr << "Failed to parse the obj: " << err << std::endl;
+        return false;
+    }
+
+    for (const auto& group : objData.groups)
+    {
+        std::vector<float>    positions;
+        std::vector<float>    uvs;
+        std::vector<float>    normals;
+        std::vector<uint32_t> indices;
+        SharedLib::BuildObjGroupVertices(objData, group, positions, uvs, normals, indices);
+
+        uint32_t baseVert = oMesh.positions.size() / 3;
+        oMesh.positions.insert(oMesh.positions.end(), positions.begin(), positions.end());
+        for (uint32_t idx : indices)
+        {
+            oMesh.indices.push_back(baseVert + idx);
+        }
+    }
+    return true;
+}
+
+// ================================================================================================================
+// All the triangle list primitives under the default scene are merged into one mesh in the world space.
+bool LoadGltfMesh(
+    const std::string& path,
+    BenchMesh&         oMesh)
+{
+    tinygltf::Model    model;
+    tinygltf::TinyGLTF loader;
+    std::string        err;
+    std::string        warn;
+
+    bool isLoaded = (std::filesystem::path(path).extension() == ".glb") ?
+                    loader.LoadBinaryFromFile(&model, &err, &warn, path) :
+                    loader.LoadASCIIFromFile(&model, &err, &warn, path);
+    if (isLoaded == false)
+    {
+        std::cerr << "Failed to parse the gltf: " << err << std::endl;
+        return false;
+    }
+
+    int sceneIdx = std::max(model.defaultScene, 0);
+    std::vector<float> modelMats;
+    SharedLib::GetNodesModelMats(model, modelMats, sceneIdx);
+
+    std::vector<int> nodeStack(model.scenes[sceneIdx].nodes.begin(), model.scenes[sceneIdx].nodes.end());
+    while (nodeStack.empty() == false)
+    {
+        int nodeIdx = nodeStack.back();
+        nodeStack.pop_back();
+
+        const tinygltf::Node& node = model.nodes[nodeIdx];
+        nodeStack.insert(nodeStack.end(), node.children.begin(), node.children.end());
+        if (node.mesh < 0)
+        {
+            continue;
+        }
+
+        const float* pModelMat = &modelMats[16 * nodeIdx];
+        for (const auto& primitive : model.meshes[node.mesh].primitives)
+        {
+            if (((primitive.mode != -1) && (primitive.mode != TINYGLTF_MODE_TRIANGLES)) ||
+                (primitive.attributes.count("POSITION") == 0))
+            {
+                continue;
+            }
+
+            const auto& posAccessor = model.accessors[primitive.attributes.at("POSITION")];
+            std::vector<float> positions(3 * posAccessor.count);
+            SharedLib::ReadOutAccessorDataAsFloat(positions.data(), posAccessor, model.bufferViews, model.buffers);
+
+            uint32_t baseVert = oMesh.positions.size() / 3;
+            for (uint32_t i = 0; i < posAccessor.count; i++)
+            {
+                // The model matrices are row-major.
+                const float* p = &positions[3 * i];
+                for (uint32_t row = 0; row < 3; row++)
+                {
+                    const float* m = &pModelMat[4 * row];
+                    oMesh.positions.push_back(m[0] * p[0] + m[1] * p[1] + m[2] * p[2] + m[3]);
+                }
+            }
+
+            if (primitive.indices < 0)
+            {
+                for (uint32_t i = 0; i < posAccessor.count; i++)
+                {
+                    oMesh.indices.push_back(baseVert + i);
+                }
+                continue;
+            }
+
+            const auto& idxAccessor = model.accessors[primitive.indices];
+            std::vector<uint8_t> idxData(SharedLib::GetAccessorDataBytes(idxAccessor));
+            SharedLib::ReadOutAccessorData(idxData.data(), idxAccessor, model.bufferViews, model.buffers);
+            for (uint32_t i = 0; i < idxAccessor.count; i++)
+            {
+                uint32_t idx = 0;
+                switch (idxAccessor.componentType)
+                {
+                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                    idx = idxData[i];
+                    break;
+                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+                {
+                    uint16_t idx16;
+                    memcpy(&idx16, &idxData[2 * i], sizeof(idx16));
+                    idx = idx16;
+                    break;
+                }
+                default:
+                    memcpy(&idx, &idxData[4 * i], sizeof(idx));
+                }
+                oMesh.indices.push_back(baseVert + idx);
+            }
+        }
+    }
+    return true;
+}
+
+// ================================================================================================================
+// A uv sphere of radius 1, used when no mesh is given.
+void GenSphereMesh(
+    uint32_t   segmentCnt,
+    uint32_t   ringCnt,
+    BenchMesh& oMesh)
+{
+    for (uint32_t ring = 0; ring <= ringCnt; ring++)
+    {
+        float theta = 3.14159265f * ring / ringCnt;
+        for (uint32_t segment = 0; segment <= segmentCnt; segment++)
+        {
+            float phi = 2.f * 3.14159265f * segment / segmentCnt;
+            oMesh.positions.push_back(std::sin(theta) * std::cos(phi));
+            oMesh.positions.push_back(std::cos(theta));
+            oMesh.positions.push_back(std::sin(theta) * std::sin(phi));
+        }
+    }
+
+    for (uint32_t ring = 0; ring < ringCnt; ring++)
+    {
+        for (uint32_t segment = 0; segment < segmentCnt; segment++)
+        {
+            uint32_t v0 = ring * (segmentCnt + 1) + segment;
+            uint32_t v1 = v0 + segmentCnt + 1;
+            oMesh.indices.insert(oMesh.indices.end(), { v0, v1, v0 + 1, v0 + 1, v1, v1 + 1 });
+        }
+    }
+}
+
+// ================================================================================================================
+// The uv and normal seams split the positions, which the DAG would treat as open borders and lock. The DAG only needs
+// the positions, so the bitwise equal ones are merged.
+void WeldMeshPositions(
+    BenchMesh& mesh)
+{
+    uint32_t vertCnt = mesh.positions.size() / 3;
+
+    SharedLib::WeldStream posStream{};
+    posStream.pData = mesh.positions.data();
+    posStream.compCnt = 3;
+
+    std::vector<uint32_t> remap(vertCnt);
+    uint32_t weldedVertCnt = SharedLib::GenerateWeldRemap(&posStream,
+                                                          1,
+                                                          vertCnt,
+                                                          mesh.indices.data(),
+                                                          mesh.indices.size(),
+                                                          remap.data());
+
+    std::vector<float> weldedPositions(3 * weldedVertCnt);
+    SharedLib::RemapVertexData(mesh.positions.data(), vertCnt, 3, remap.data(), weldedPositions.data());
+    SharedLib::RemapIndices(mesh.indices.data(), mesh.indices.size(), remap.data(), mesh.indices.data());
+    mesh.positions.swap(weldedPositions);
+}
+
+// ================================================================================================================
+bool IsSameDag(
+    const SharedLib::ClusterLodDag& dag,
+    const SharedLib::ClusterLodDag& otherDag)
+{
+    return (dag.lodLevelCnt == otherDag.lodLevelCnt) &&
+           (dag.positions == otherDag.positions) &&
+           (dag.payload == otherDag.payload) &&
+           (dag.clusters.size() == otherDag.clusters.size()) &&
+           (memcmp(dag.clusters.data(),
+                   otherDag.clusters.data(),
+                   dag.clusters.size() * sizeof(SharedLib::LodCluster)) == 0);
+}
+
+// ================================================================================================================
+int main(
+    int    argc,
+    char** argv)
+{
+    args::ArgumentParser parser("This tool builds the cluster LOD DAG of a mesh, validates it, round-trips it through "
+                                "its file and times the cut selection from a range of camera distances.",
+                                "E.g. ClusterLodBench.exe -m ./bunny.obj -o ./bunny.clod");
+    args::HelpFlag help(parser, "help", "Display this help menu", { 'h', "help" });
+
+    args::ValueFlag<std::string> meshPath(parser, "", "An obj, gltf or glb mesh. A uv sphere by default.", { 'm', "mesh" });
+    args::ValueFlag<std::string> outputPath(parser, "", "The cluster LOD file. ClusterLodBench.clod by default.", { 'o', "output" });
+    args::ValueFlag<uint32_t> threadCnt(parser, "", "The builder's threads. All the cores by default.", { 't', "threads" });
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch (const args::Help&)
+    {
+        std::cout << parser;
+        return 0;
+    }
+    catch (const args::ParseError& e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    SharedLib::ThreadPool threadPool(threadCnt ? args::get(threadCnt) : 0);
+
+    BenchMesh mesh;
+    bool isLoaded = true;
+    double loadMs = GetMilliseconds([&]() {
+        if (meshPath)
+        {
+            std::string extension = std::filesystem::path(args::get(meshPath)).extension().string();
+            isLoaded = (extension == ".obj") ? LoadObjMesh(args::get(meshPath), &threadPool, mesh) :
+                                               LoadGltfMesh(args::get(meshPath), mesh);
+        }
+        else
+        {
+            GenSphereMesh(512, 256, mesh);
+        }
+    });
+
+    if ((isLoaded == false) || mesh.indices.empty())
+    {
+        std::cerr << "Cannot load any triangle from the mesh." << std::endl;
+        return 1;
+    }
+
+    WeldMeshPositions(mesh);
+    printf("%s: %u vertices, %u triangles, loaded in %.3f ms\n",
+           meshPath ? args::get(meshPath).c_str() : "uv sphere",
+           (uint32_t)mesh.positions.size() / 3,
+           (uint32_t)mesh.indices.size() / 3,
+           loadMs);
+
+    // Build.
+    SharedLib::ClusterLodDag dag;
+    double buildMs = GetMilliseconds([&]() {
+        SharedLib::BuildClusterLodDag(mesh.indices.data(),
+                                      mesh.indices.size(),
+                                      mesh.positions.data(),
+                                      mesh.positions.size() / 3,
+                                      &threadPool,
+                                      dag);
+    });
+
+    std::vector<uint32_t> levelClusterCnts(dag.lodLevelCnt, 0);
+    std::vector<uint32_t> levelTriCnts(dag.lodLevelCnt, 0);
+    for (const auto& cluster : dag.clusters)
+    {
+        if (cluster.lodLevel < dag.lodLevelCnt)
+        {
+            levelClusterCnts[cluster.lodLevel]++;
+            levelTriCnts[cluster.lodLevel] += cluster.triCnt;
+        }
+    }
+
+    printf("Built %u clusters in %u levels in %.3f ms on %u threads\n",
+           (uint32_t)dag.clusters.size(),
+           dag.lodLevelCnt,
+           buildMs,
+           threadPool.GetThreadCnt());
+    for (uint32_t level = 0; level < dag.lodLevelCnt; level++)
+    {
+        printf("    Level %2u: %6u clusters, %8u triangles\n", level, levelClusterCnts[level], levelTriCnts[level]);
+    }
+
+    // Validate.
+    if (SharedLib::ValidateClusterLodDag(dag) == false)
+    {
+        std::cerr << "The DAG is invalid." << std::endl;
+        return 1;
+    }
+
+    // The level 0 is the original geometry, so it has to keep every input triangle.
+    if ((dag.lodLevelCnt == 0) || (levelTriCnts[0] != mesh.indices.size() / 3))
+    {
+        std::cerr << "The level 0 doesn't have all the input triangles." << std::endl;
+        return 1;
+    }
+
+    // Round-trip the file.
+    const std::string clodPath = outputPath ? args::get(outputPath) : "ClusterLodBench.clod";
+    SharedLib::ClusterLodDag loadedDag;
+    bool isSaved = false;
+    bool isReloaded = false;
+    double saveMs = GetMilliseconds([&]() { isSaved = SharedLib::SaveClusterLodDag(clodPath, dag); });
+    double reloadMs = GetMilliseconds([&]() { isReloaded = SharedLib::LoadClusterLodDag(clodPath, loadedDag); });
+
+    if ((isSaved == false) || (isReloaded == false))
+    {
+        std::cerr << "Cannot round-trip the DAG through " << clodPath << std::endl;
+        return 1;
+    }
+
+    if ((IsSameDag(dag, loadedDag) == false) || (SharedLib::ValidateClusterLodDag(loadedDag) == false))
+    {
+        std::cerr << "The reloaded DAG differs from the built one." << std::endl;
+        return 1;
+    }
+
+    printf("Saved %s (%llu bytes) in %.3f ms and reloaded it in %.3f ms\n",
+           clodPath.c_str(),
+           (unsigned long long)std::filesystem::file_size(clodPath),
+           saveMs,
+           reloadMs);
+
+    // Time the cuts. The camera looks at the mesh's bounds from further and further away.
+    float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (uint32_t i = 0; i < mesh.positions.size(); i++)
+    {
+        boundsMin[i % 3] = std::min(boundsMin[i % 3], mesh.positions[i]);
+        boundsMax[i % 3] = std::max(boundsMax[i % 3], mesh.positions[i]);
+    }
+
+    float center[3] = {};
+    float radius = 0.f;
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        center[c] = 0.5f * (boundsMin[c] + boundsMax[c]);
+        radius += 0.25f * (boundsMax[c] - boundsMin[c]) * (boundsMax[c] - boundsMin[c]);
+    }
+    radius = std::sqrt(radius);
+
+    const float errorThreshold = SharedLib::ClusterLodErrorThreshold(PixelError, FovY, ViewportHeight);
+    printf("Cut selection at %.1f pixel error, averaged over %u iterations:\n", PixelError, CutIterCnt);
+    printf("    Distance (radii)      ms   Clusters   Triangles   Levels\n");
+
+    std::vector<uint32_t> clusterIdxs;
+    for (float distanceScale : CameraDistanceScales)
+    {
+        const float cameraPos[3] = { center[0], center[1], center[2] + distanceScale * radius };
+        double cutMs = GetMilliseconds([&]() {
+            for (uint32_t i = 0; i < CutIterCnt; i++)
+            {
+                SharedLib::SelectClusterLodCut(loadedDag, cameraPos, errorThreshold, clusterIdxs);
+            }
+        }) / CutIterCnt;
+
+        uint32_t triCnt = 0;
+        uint32_t minLevel = UINT32_MAX;
+        uint32_t maxLevel = 0;
+        for (uint32_t clusterIdx : clusterIdxs)
+        {
+            const SharedLib::LodCluster& cluster = loadedDag.clusters[clusterIdx];
+            triCnt += cluster.triCnt;
+            minLevel = std::min(minLevel, cluster.lodLevel);
+            maxLevel = std::max(maxLevel, cluster.lodLevel);
+        }
+
+        if (clusterIdxs.empty())
+        {
+            std::cerr << "The cut at " << distanceScale << " radii is empty." << std::endl;
+            return 1;
+        }
+
+        printf("    %16.1f %7.3f %10u %11u   %u-%u\n",
+               distanceScale,
+               cutMs,
+               (uint32_t)clusterIdxs.size(),
+               triCnt,
+               minLevel,
+               maxLevel);
+    }
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include "../../SharedLibrary/TextureProcessing/MipGenerator.h"
+#include "../../SharedLibrary/Utils/ThreadUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// The check runs the SSE and threaded GenerateMipChain(...) and its scalar reference GenerateMipChainScalar(...) on
+// random RGBA8 images and fails when any texel of any level differs by more than 1 LSB. The sizes are odd and not
+// powers of two, so the last columns and rows of the box filter and the wrapped taps of the Kaiser filter are covered.
+struct CheckSize
+{
+    uint32_t width;
+    uint32_t height;
+};
+
+const CheckSize CheckSizes[] = {
+    { 1, 1 }, { 3, 1 }, { 1, 7 }, { 3, 5 }, { 7, 7 }, { 13, 9 }, { 17, 33 }, { 100, 37 }, { 255, 129 }, { 333, 333 },
+    { 1023, 3 }, { 640, 360 }, { 1001, 517 }
+};
+
+const uint32_t MaxLsbDiff = 1;
+
+struct CheckImageType
+{
+    const char*              pName;
+    SharedLib::MipColorSpace colorSpace;
+};
+
+// The albedo is a sRGB color texture, the data is e.g. the metallic roughness and the normals are tangent space unit
+// vectors.
+const CheckImageType CheckImageTypes[] = {
+    { "albedo", SharedLib::MIP_COLOR_SPACE_SRGB },
+    { "data",   SharedLib::MIP_COLOR_SPACE_LINEAR },
+    { "normal", SharedLib::MIP_COLOR_SPACE_NORMAL }
+};
+
+// ================================================================================================================
+std::vector<uint8_t> GenCheckImage(
+    uint32_t                 width,
+    uint32_t                 height,
+    SharedLib::MipColorSpace colorSpace,
+    uint32_t                 seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> rgba8(4 * width * height);
+    if (colorSpace != SharedLib::MIP_COLOR_SPACE_NORMAL)
+    {
+        for (uint8_t& channel : rgba8)
+        {
+            channel = rng() & 0xFF;
+        }
+        return rgba8;
+    }
+
+    // Random directions in the upper hemisphere, encoded as the normal maps store them.
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    for (uint32_t i = 0; i < width * height; i++)
+    {
+        float n[3] = { dist(rng), dist(rng), std::abs(dist(rng)) + 0.1f };
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            rgba8[4 * i + c] = (uint8_t)std::lround((n[c] / length * 0.5f + 0.5f) * 255.f);
+        }
+        rgba8[4 * i + 3] = rng() & 0xFF;
+    }
+    return rgba8;
+}
+
+// ================================================================================================================
+int main()
+{
+    SharedLib::ThreadPool threadPool;
+    const SharedLib::MipFilter filters[] = { SharedLib::MIP_FILTER_BOX, SharedLib::MIP_FILTER_KAISER };
+    const char* filterNames[] = { "box", "kaiser" };
+
+    uint32_t failedCnt = 0;
+    uint32_t caseCnt = 0;
+    for (const CheckImageType& imageType : CheckImageTypes)
+    {
+        for (uint32_t f = 0; f < 2; f++)
+        {
+            uint32_t worstDiff = 0;
+            for (const CheckSize& size : CheckSizes)
+            {
+                std::vector<uint8_t> rgba8 = GenCheckImage(size.width, size.height, imageType.colorSpace, caseCnt++);
+
+                std::vector<uint8_t>  data;
+                std::vector<uint32_t> mipByteOffsets;
+                SharedLib::GenerateMipChain(rgba8.data(),
+                                            size.width,
+                                            size.height,
+                                            filters[f],
+                                            imageType.colorSpace,
+                                            &threadPool,
+                                            data,
+                                            mipByteOffsets);
+
+                std::vector<uint8_t>  refData;
+                std::vector<uint32_t> refMipByteOffsets;
+                SharedLib::GenerateMipChainScalar(rgba8.data(),
+                                                  size.width,
+                                                  size.height,
+                                                  filters[f],
+                                                  imageType.colorSpace,
+                                                  refData,
+                                                  refMipByteOffsets);
+
+                if ((data.size() != refData.size()) || (mipByteOffsets != refMipByteOffsets) ||
+                    (mipByteOffsets.size() != SharedLib::GetMipLevelCnt(size.width, size.height)))
+                {
+                    printf("FAILED %s %s %ux%u: The mip chain layouts differ.\n",
+                           imageType.pName, filterNames[f], size.width, size.height);
+                    failedCnt++;
+                    continue;
+                }
+
+                uint32_t maxDiff = 0;
+                size_t   maxDiffIdx = 0;
+                for (size_t i = 0; i < data.size(); i++)
+                {
+                    uint32_t diff = std::abs((int)data[i] - (int)refData[i]);
+                    if (diff > maxDiff)
+                    {
+                        maxDiff = diff;
+                        maxDiffIdx = i;
+                    }
+                }
+
+                if (maxDiff > MaxLsbDiff)
+                {
+                    uint32_t level = std::upper_bound(mipByteOffsets.begin(), mipByteOffsets.end(), maxDiffIdx) -
+                                     mipByteOffsets.begin() - 1;
+                    printf("FAILED %s %s %ux%u: Level %u byte %zu is %u, the scalar reference is %u.\n",
+                           imageType.pName, filterNames[f], size.width, size.height, level,
+                           maxDiffIdx - mipByteOffsets[level], data[maxDiffIdx], refData[maxDiffIdx]);
+                    failedCnt++;
+                }
+                worstDiff = std::max(worstDiff, maxDiff);
+            }
+
+            printf("%-6s %-6s: max difference %u LSB over %zu sizes.\n",
+                   imageType.pName, filterNames[f], worstDiff, sizeof(CheckSizes) / sizeof(CheckSizes[0]));
+        }
+    }
+
+    if (failedCnt > 0)
+    {
+        printf("%u of the %u cases differ by more than %u LSB.\n", failedCnt, caseCnt, MaxLsbDiff);
+        return 1;
+    }
+
+    printf("The SSE mip chains of all the %u cases are within %u LSB of the scalar reference.\n", caseCnt, MaxLsbDiff);
+    return 0;
+}
@@ -0,0 +1,227 @@
+#include "../../SharedLibrary/Transform/TransformHierarchy.h"
+#include "../../SharedLibrary/Utils/MathUtils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// The benchmark compares the recursive model matrices generation, which rebuilds every node's TRS matrices through
+// full 4x4 multiplications like the gltf utils used to do, with the flattened TransformHierarchy. The hierarchy is
+// timed when all the nodes are dirty, when 1% of the nodes are animated and when a single leaf moves.
+struct BenchScene
+{
+    std::vector<uint32_t>              parentIdxs;
+    std::vector<std::vector<uint32_t>> children;
+    std::vector<uint32_t>              rootIdxs;
+
+    std::vector<float> translations; // 3 floats per node.
+    std::vector<float> rotations;    // 4 floats per node. (x, y, z, w)
+    std::vector<float> scales;       // 3 floats per node.
+};
+
+const uint32_t NodeCnts[] = { 10000, 100000 };
+const uint32_t IterCnt = 100;
+const uint32_t MaxParentDistance = 64; // Parents are picked among the last nodes, which keeps the trees bushy.
+
+// ================================================================================================================
+BenchScene GenBenchScene(
+    uint32_t nodeCnt)
+{
+    std::mt19937 rng(nodeCnt);
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+    BenchScene scene{};
+    scene.parentIdxs.resize(nodeCnt);
+    scene.children.resize(nodeCnt);
+    scene.translations.resize(3 * nodeCnt);
+    scene.rotations.resize(4 * nodeCnt);
+    scene.scales.resize(3 * nodeCnt);
+
+    for (uint32_t i = 0; i < nodeCnt; i++)
+    {
+        if (i % 1000 == 0)
+        {
+            scene.parentIdxs[i] = SharedLib::TransformHierarchy::InvalidNodeIdx;
+            scene.rootIdxs.push_back(i);
+        }
+        else
+        {
+            uint32_t parentDistance = 1 + rng() % std::min(i % 1000, MaxParentDistance);
+            scene.parentIdxs[i] = i - parentDistance;
+            scene.children[i - parentDistance].push_back(i);
+        }
+
+        float quatLength = 0.f;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            scene.rotations[4 * i + c] = dist(rng);
+            quatLength += scene.rotations[4 * i + c] * scene.rotations[4 * i + c];
+        }
+
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            scene.rotations[4 * i + c] /= std::sqrt(quatLength);
+        }
+
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            scene.translations[3 * i + c] = dist(rng);
+            scene.scales[3 * i + c] = 1.f + 0.1f * dist(rng);
+        }
+    }
+    return scene;
+}
+
+// ================================================================================================================
+// The recursive reference. Same as the old GetNodeAndChildrenModelMats(...): M = T * R * S with full 4x4 matrices.
+void GenRecursiveModelMats(
+    const BenchScene&   scene,
+    const float         parentModelMat[16],
+    uint32_t            nodeIdx,
+    std::vector<float>& matsVec)
+{
+    const float* t = &scene.translations[3 * nodeIdx];
+    const float* q = &scene.rotations[4 * nodeIdx];
+    const float* s = &scene.scales[3 * nodeIdx];
+
+    float localTranslationMat[16] = {
+        1.f, 0.f, 0.f, t[0],
+        0.f, 1.f, 0.f, t[1],
+        0.f, 0.f, 1.f, t[2],
+        0.f, 0.f, 0.f, 1.f
+    };
+
+    float xx = q[0] * q[0], yy = q[1] * q[1], zz = q[2] * q[2];
+    float xy = q[0] * q[1], xz = q[0] * q[2], yz = q[1] * q[2];
+    float wx = q[3] * q[0], wy = q[3] * q[1], wz = q[3] * q[2];
+    float localRotationMat[16] = {
+        1.f - 2.f * (yy + zz), 2.f * (xy - wz),       2.f * (xz + wy),       0.f,
+        2.f * (xy + wz),       1.f - 2.f * (xx + zz), 2.f * (yz - wx),       0.f,
+        2.f * (xz - wy),       2.f * (yz + wx),       1.f - 2.f * (xx + yy), 0.f,
+        0.f,                   0.f,                   0.f,                   1.f
+    };
+
+    float localScaleMat[16] = {
+        s[0], 0.f,  0.f,  0.f,
+        0.f,  s[1], 0.f,  0.f,
+        0.f,  0.f,  s[2], 0.f,
+        0.f,  0.f,  0.f,  1.f
+    };
+
+    float localRSMat[16] = {};
+    float localTransformMat[16] = {};
+    SharedLib::MatrixMul4x4(localRotationMat, localScaleMat, localRSMat);
+    SharedLib::MatrixMul4x4(localTranslationMat, localRSMat, localTransformMat);
+
+    float nodeModelMat[16];
+    SharedLib::MatrixMul4x4(parentModelMat, localTransformMat, nodeModelMat);
+    memcpy(&matsVec[16 * nodeIdx], nodeModelMat, sizeof(nodeModelMat));
+
+    for (uint32_t childIdx : scene.children[nodeIdx])
+    {
+        GenRecursiveModelMats(scene, nodeModelMat, childIdx, matsVec);
+    }
+}
+
+// ================================================================================================================
+template<typename Func>
+double GetAverageMilliseconds(
+    Func func)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < IterCnt; i++)
+    {
+        func();
+    }
+    auto endTime = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(endTime - startTime).count() / IterCnt;
+}
+
+// ================================================================================================================
+int main()
+{
+    const float identityMat[16] = {
+        1.f, 0.f, 0.f, 0.f,
+        0.f, 1.f, 0.f, 0.f,
+        0.f, 0.f, 1.f, 0.f,
+        0.f, 0.f, 0.f, 1.f
+    };
+
+    for (uint32_t nodeCnt : NodeCnts)
+    {
+        BenchScene scene = GenBenchScene(nodeCnt);
+
+        std::vector<float> recursiveMats(16 * nodeCnt);
+        double recursiveMs = GetAverageMilliseconds([&]() {
+            for (uint32_t rootIdx : scene.rootIdxs)
+            {
+                GenRecursiveModelMats(scene, identityMat, rootIdx, recursiveMats);
+            }
+        });
+
+        SharedLib::TransformHierarchy hierarchy;
+        hierarchy.Init(scene.parentIdxs);
+        auto setAllLocalTrs = [&]() {
+            for (uint32_t i = 0; i < nodeCnt; i++)
+            {
+                hierarchy.SetLocalTrs(i, &scene.translations[3 * i], &scene.rotations[4 * i], &scene.scales[3 * i]);
+            }
+        };
+
+        setAllLocalTrs();
+        hierarchy.Update();
+
+        // The hierarchy has to agree with the recursive reference before its timings mean anything.
+        float maxError = 0.f;
+        for (uint32_t i = 0; i < nodeCnt; i++)
+        {
+            const float* pWorldMat = hierarchy.GetWorldMat(i);
+            for (uint32_t c = 0; c < 16; c++)
+            {
+                maxError = std::max(maxError, std::abs(pWorldMat[c] - recursiveMats[16 * i + c]));
+            }
+        }
+
+        double fullUpdateMs = GetAverageMilliseconds([&]() {
+            setAllLocalTrs();
+            hierarchy.Update();
+        });
+
+        std::vector<uint32_t> animatedIdxs(nodeCnt / 100);
+        std::mt19937 rng(42);
+        for (uint32_t& idx : animatedIdxs)
+        {
+            idx = rng() % nodeCnt;
+        }
+
+        uint32_t animatedUpdateNodeCnt = 0;
+        double animatedUpdateMs = GetAverageMilliseconds([&]() {
+            for (uint32_t i : animatedIdxs)
+            {
+                hierarchy.SetLocalRotation(i, &scene.rotations[4 * i]);
+            }
+            hierarchy.Update();
+            animatedUpdateNodeCnt = hierarchy.GetLastUpdateNodeCnt();
+        });
+
+        uint32_t leafIdx = nodeCnt - 1;
+        double leafUpdateMs = GetAverageMilliseconds([&]() {
+            hierarchy.SetLocalTranslation(leafIdx, &scene.translations[3 * leafIdx]);
+            hierarchy.Update();
+        });
+
+        printf("%u nodes (max error %g):\n", nodeCnt, maxError);
+        printf("    Recursive:                   %8.3f ms\n", recursiveMs);
+        printf("    Hierarchy, all dirty:        %8.3f ms\n", fullUpdateMs);
+        printf("    Hierarchy, 1%% animated:      %8.3f ms (%u nodes recomputed)\n",
+               animatedUpdateMs,
+               animatedUpdateNodeCnt);
+        printf("    Hierarchy, one leaf moved:   %8.3f ms\n", leafUpdateMs);
+    }
+
+    return 0;
+}